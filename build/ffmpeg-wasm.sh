@@ -33,21 +33,41 @@ CONF_FLAGS=(
   -sWASM_BIGINT                            # enable big int support
   -sUSE_SDL=2                              # use emscripten SDL2 lib port
   -sMODULARIZE                             # modularized to use as a library
-  ${FFMPEG_MT:+ -sINITIAL_MEMORY=1024MB}   # ALLOW_MEMORY_GROWTH is not recommended when using threads, thus we use a large initial memory
-  ${FFMPEG_MT:+ -sPTHREAD_POOL_SIZE=32}    # use 32 threads
+  ${FFMPEG_MT:+ -sINITIAL_MEMORY=256MB}    # default initial memory, can be overridden by Module.INITIAL_MEMORY
+  ${FFMPEG_MT:+ -sALLOW_MEMORY_GROWTH -sMAXIMUM_MEMORY=4GB -Wno-pthreads-mem-growth} # grow shared memory for large jobs instead of reserving it upfront
+  ${FFMPEG_MT:+ -sPTHREAD_POOL_SIZE=Module.pthreadPoolSize} # spawn a few threads on load, the pool grows in bind.js
+  ${FFMPEG_MT:+ -sPTHREAD_POOL_SIZE_STRICT=2} # fail pthread_create() instead of blocking when the pool is exhausted
   ${FFMPEG_ST:+ -sINITIAL_MEMORY=32MB -sALLOW_MEMORY_GROWTH} # Use just enough memory as memory usage can grow
+  ${FFMPEG_WASM64:+ -sMAXIMUM_MEMORY=16GB}  # wasm64 is not limited to 4GB
+  -sMALLOC=${FFMPEG_MALLOC:-dlmalloc}      # malloc backend, mimalloc has per-thread heaps for MT builds
+  -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc,--wrap=posix_memalign,--wrap=free # allocation telemetry, see ffmpeg_malloc.c
   -sEXPORT_NAME="$EXPORT_NAME"             # required in browser env, so that user can access this module from window object
   -sEXPORTED_FUNCTIONS=$(node src/bind/ffmpeg/export.js) # exported functions
   -sEXPORTED_RUNTIME_METHODS=$(node src/bind/ffmpeg/export-runtime.js) # exported built-in functions
   -lworkerfs.js
+  ${FFMPEG_WASM64:+ --pre-js src/bind/ffmpeg/bind-wasm64.js} # pointer size of wasm64
   --pre-js src/bind/ffmpeg/bind.js        # extra bindings, contains most of the ffmpeg.wasm javascript code
   # ffmpeg source code
   src/fftools/cmdutils.c 
+  src/fftools/ffcut.c 
+  src/fftools/ffframes.c 
+  src/fftools/ffindex.c 
   src/fftools/ffmpeg.c 
+  src/fftools/ffmpeg_branch.c 
+  src/fftools/ffmpeg_cache.c 
+  src/fftools/ffmpeg_dec.c 
+  src/fftools/ffmpeg_enc.c 
   src/fftools/ffmpeg_filter.c 
   src/fftools/ffmpeg_hw.c 
+  src/fftools/ffmpeg_malloc.c 
   src/fftools/ffmpeg_mux.c 
   src/fftools/ffmpeg_opt.c 
+  src/fftools/ffpeaks.c 
+  src/fftools/ffprobe.c 
+  src/fftools/ffsamples.c 
+  src/fftools/ffsession.c 
+  src/fftools/ffthumb.c 
+  src/fftools/objpool.c 
   src/fftools/opt_common.c 
 )
 
@@ -2,11 +2,77 @@
 
 set -euo pipefail
 
+ARCH=x86_32
+if [[ "$FFMPEG_WASM64" == "yes" ]]; then
+  ARCH=x86_64
+fi
+
+# WebAssembly SIMD128 kernels, copied from src/ffmpeg, they are compiled to
+# nothing without -msimd128 and are hooked in after the C init of each DSP
+# context, so clearing AV_CPU_FLAG_SIMD128 (-cpuflags 0) selects C again.
+patch_src() {
+  local file=$1 pattern=$2 replacement=$3
+  if ! grep -q "$pattern" "$file"; then
+    echo "$file: '$pattern' not found" >&2
+    exit 1
+  fi
+  sed -i "s@$pattern@$replacement@" "$file"
+}
+
+if [[ -d libavutil/wasm ]] && ! grep -q ff_get_cpu_flags_wasm libavutil/cpu.c; then
+  echo 'OBJS += wasm/cpu.o' >> libavutil/Makefile
+  patch_src libavutil/cpu.c '^#include "cpu.h"$' '&\n#include "wasm/cpu.h"'
+  patch_src libavutil/cpu.c '^static int get_cpu_flags(void)$' \
+    'static int get_cpu_flags_arch(void);\n\nstatic int get_cpu_flags(void)\n{\n    return get_cpu_flags_arch() | ff_get_cpu_flags_wasm();\n}\n\nstatic int get_cpu_flags_arch(void)'
+
+  echo 'OBJS += wasm/input.o wasm/swscale.o wasm/yuv2rgb.o' >> libswscale/Makefile
+  patch_src libswscale/swscale.c '^#include "swscale_internal.h"$' '&\n#include "wasm/swscale_wasm.h"'
+  patch_src libswscale/swscale.c '^    sws_init_swscale(c);$' '&\n    ff_sws_init_swscale_wasm(c);'
+  patch_src libswscale/yuv2rgb.c '^#include "swscale_internal.h"$' '&\n#include "wasm/swscale_wasm.h"'
+  patch_src libswscale/yuv2rgb.c '^\( *\)t = ff_yuv2rgb_init_x86(c);$' '&\n\1if (!t)\n\1    t = ff_yuv2rgb_init_wasm(c);'
+
+  cat >> libavcodec/Makefile <<'EOF'
+OBJS-$(CONFIG_H264DSP)      += wasm/h264dsp_init.o
+OBJS-$(CONFIG_H264QPEL)     += wasm/h264qpel_init.o
+OBJS-$(CONFIG_HEVC_DECODER) += wasm/hevcdsp_init.o
+OBJS-$(CONFIG_VP9_DECODER)  += wasm/vp9dsp_init.o
+EOF
+  patch_src libavcodec/h264dsp.h '^void ff_h264dsp_init_x86(' \
+    'void ff_h264dsp_init_wasm(H264DSPContext *c, const int bit_depth,\n                          const int chroma_format_idc);\n&'
+  patch_src libavcodec/h264qpel.h '^void ff_h264qpel_init_x86(' \
+    'void ff_h264qpel_init_wasm(H264QpelContext *c, int bit_depth);\n&'
+  patch_src libavcodec/hevcdsp.h '^void ff_hevc_dsp_init_x86(' \
+    'void ff_hevc_dsp_init_wasm(HEVCDSPContext *c, const int bit_depth);\n&'
+  patch_src libavcodec/vp9dsp.h '^void ff_vp9dsp_init_x86(' \
+    'void ff_vp9dsp_init_wasm(VP9DSPContext *dsp, int bpp, int bitexact);\n&'
+  patch_src libavcodec/h264dsp.c '^\( *\).*ff_h264dsp_init_x86(\(.*\));$' '&\n\1ff_h264dsp_init_wasm(\2);'
+  patch_src libavcodec/h264qpel.c '^\( *\).*ff_h264qpel_init_x86(\(.*\));$' '&\n\1ff_h264qpel_init_wasm(\2);'
+  patch_src libavcodec/hevcdsp.c '^\( *\).*ff_hevc_dsp_init_x86(\(.*\));$' '&\n\1ff_hevc_dsp_init_wasm(\2);'
+  patch_src libavcodec/vp9dsp.c '^\( *\).*ff_vp9dsp_init_x86(\(.*\));$' '&\n\1ff_vp9dsp_init_wasm(\2);'
+
+  # zimg has no cpuid on wasm, its SSE / SSE2 kernels are pinned, see build/zimg.sh
+  patch_src libavfilter/vf_zscale.c '^#include <zimg.h>$' '&\n\n#include "libavutil/cpu.h"\n#include "libavutil/wasm/cpu.h"'
+  patch_src libavfilter/vf_zscale.c '^\(.*\)cpu_type = ZIMG_CPU_AUTO;$' \
+    '\1cpu_type = have_simd128(av_get_cpu_flags()) ? ZIMG_CPU_X86_SSE2 : ZIMG_CPU_NONE;'
+
+  # the encoder kernels of x264, x265 and libvpx, see build/x264.sh, x265.sh and libvpx.sh
+  patch_src libavcodec/libx264.c '^#include <x264.h>$' '&\n\n#include "libavutil/cpu.h"\n#include "libavutil/wasm/cpu.h"\n'
+  patch_src libavcodec/libx264.c '^\( *\)x4->params.pf_log *= X264_log;$' \
+    '&\n\1if (!have_simd128(av_get_cpu_flags()))\n\1    x4->params.cpu \&= ~X264_CPU_SIMD128;'
+  patch_src libavcodec/libx265.c '^#include <x265.h>$' '&\n\n#include "libavutil/cpu.h"\n#include "libavutil/wasm/cpu.h"\n'
+  patch_src libavcodec/libx265.c '^\( *\)ctx->params->frameNumThreads = avctx->thread_count;$' \
+    '&\n\1if (!have_simd128(av_get_cpu_flags()))\n\1    ctx->params->cpuid \&= ~X265_CPU_SIMD128;'
+  patch_src libavcodec/libvpxenc.c '^#include <vpx/vpx_encoder.h>$' \
+    '&\n\n#include "libavutil/cpu.h"\n#include "libavutil/wasm/cpu.h"\n\nvoid vpx_wasm_set_simd128(int enabled);\n'
+  patch_src libavcodec/libvpxenc.c '^\( *\)av_log(avctx, AV_LOG_VERBOSE, "%s\\n", vpx_codec_build_config());$' \
+    '&\n\1vpx_wasm_set_simd128(have_simd128(av_get_cpu_flags()));'
+fi
+
 CONF_FLAGS=(
   --target-os=none              # disable target specific configs
-  --arch=x86_32                 # use x86_32 arch
+  --arch=$ARCH                  # use x86_32 arch, x86_64 for wasm64
   --enable-cross-compile        # use cross compile configs
-  --disable-asm                 # disable asm
+  --disable-asm                 # disable asm, x86 asm cannot target wasm, SIMD comes from -msimd128 and the wasm/ kernels
   --disable-stripping           # disable stripping as it won't work
   --disable-programs            # disable ffmpeg, ffprobe and ffplay build
   --disable-doc                 # disable doc build
@@ -31,3 +97,16 @@ CONF_FLAGS=(
 
 emconfigure ./configure "${CONF_FLAGS[@]}" $@
 emmake make -j
+
+# checkasm of the WebAssembly SIMD128 kernels, fails the build when a kernel
+# differs from its C function, see src/ffmpeg/tests/wasm/checkasm.c.
+if [[ -d tests/wasm && "$CFLAGS" == *-msimd128* ]]; then
+  emcc -I. $CFLAGS tests/wasm/*.c -o tests/wasm/checkasm.js \
+    -Llibavcodec -Llibswscale -Llibavutil -lavcodec -lswscale -lavutil -lm \
+    -sEXIT_RUNTIME -sALLOW_MEMORY_GROWTH
+  if [[ "$FFMPEG_WASM64" == "yes" ]]; then
+    ${EMSDK_NODE:-node} --experimental-wasm-memory64 tests/wasm/checkasm.js --bench
+  else
+    ${EMSDK_NODE:-node} tests/wasm/checkasm.js --bench
+  fi
+fi
@@ -2,6 +2,14 @@
 
 set -euo pipefail
 
+# Emscripten translates SSE intrinsics to wasm SIMD when -msimd128 is enabled.
+# lame builds its xmmintrin quantization kernel (libmp3lame/vector) once the
+# header is usable, and MIN_ARCH_SSE selects it without cpu detection, which
+# only exists with NASM.
+if [[ "$CFLAGS" == *"-msimd128"* ]]; then
+  CFLAGS="$CFLAGS -msse -DMIN_ARCH_SSE"
+fi
+
 CONF_FLAGS=(
   --prefix=$INSTALL_DIR                               # install library in a build directory for FFmpeg to include
   --host=i686-linux                                   # use i686 linux
@@ -2,6 +2,33 @@
 
 set -euo pipefail
 
+# WebAssembly SIMD128 kernels, copied from src/libvpx, they are compiled to
+# nothing without -msimd128. generic-gnu has no run time cpu detection, so
+# vpx_config.h redefines the rtcd names of the kernels at the end of
+# vpx_dsp_rtcd.h / vp8_rtcd.h as a choice on vpx_wasm_simd128, which FFmpeg
+# clears for -cpuflags 0 to select C again.
+if [[ -d vpx_dsp/wasm ]] && ! grep -q wasm/sad_simd128.c vpx_dsp/vpx_dsp.mk; then
+  cat >> vpx_dsp/vpx_dsp.mk <<'EOF'
+
+DSP_SRCS-$(CONFIG_ENCODERS) += wasm/vpx_dsp_wasm.h
+DSP_SRCS-$(CONFIG_ENCODERS) += wasm/sad_simd128.c
+DSP_SRCS-$(CONFIG_ENCODERS) += wasm/subtract_simd128.c
+DSP_SRCS-$(CONFIG_ENCODERS) += wasm/variance_simd128.c
+DSP_SRCS-$(CONFIG_VP9_ENCODER) += wasm/avg_simd128.c
+EOF
+  cat >> vp8/vp8cx.mk <<'EOF'
+
+VP8_CX_SRCS-yes += encoder/wasm/vp8_wasm.h
+VP8_CX_SRCS-yes += encoder/wasm/dct_simd128.c
+VP8_CX_SRCS-yes += encoder/wasm/quantize_simd128.c
+EOF
+  cat >> vpx_ports/vpx_ports.mk <<'EOF'
+
+PORTS_SRCS-yes += wasm.h
+PORTS_SRCS-yes += wasm_cpudetect.c
+EOF
+fi
+
 CONF_FLAGS=(
   --prefix=$INSTALL_DIR                              # install library in a build directory for FFmpeg to include
   --target=generic-gnu                               # target with miminal features
@@ -17,6 +44,30 @@ CONF_FLAGS=(
 )
 
 emconfigure ./configure "${CONF_FLAGS[@]}"
+if [[ -d vpx_dsp/wasm ]]; then
+  cat >> vpx_config.h <<'EOF'
+
+/* WebAssembly SIMD128 kernels, once the rtcd header has defined its names */
+#if defined(__wasm_simd128__) && defined(VPX_DSP_RTCD_H_) && defined(vpx_sad16x16)
+#include "vpx_dsp/wasm/vpx_dsp_wasm.h"
+#endif
+#if defined(__wasm_simd128__) && defined(VP8_RTCD_H_) && defined(vp8_short_fdct4x4)
+#include "vp8/encoder/wasm/vp8_wasm.h"
+#endif
+EOF
+fi
 emmake make install -j
 # Fix ffmpeg configure error: "libvpx enabled but no supported decoders found"
 emranlib $INSTALL_DIR/lib/libvpx.a
+
+# checkasm of the WebAssembly SIMD128 kernels, fails the build when a kernel
+# differs from its C function, see src/libvpx/test/wasm/checkasm.c.
+if [[ -d test/wasm && "$CFLAGS" == *-msimd128* ]]; then
+  emcc -I. $CFLAGS test/wasm/checkasm.c libvpx.a \
+    -o test/wasm/checkasm.js -sEXIT_RUNTIME -sALLOW_MEMORY_GROWTH
+  if [[ "$FFMPEG_WASM64" == "yes" ]]; then
+    ${EMSDK_NODE:-node} --experimental-wasm-memory64 test/wasm/checkasm.js
+  else
+    ${EMSDK_NODE:-node} test/wasm/checkasm.js
+  fi
+fi
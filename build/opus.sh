@@ -2,13 +2,22 @@
 
 set -euo pipefail
 
+# Emscripten translates SSE intrinsics to wasm SIMD when -msimd128 is enabled,
+# opus presumes SSE4.1 from CFLAGS as cpu detection (rtcd) is disabled.
+if [[ "$CFLAGS" == *"-msimd128"* ]]; then
+  CFLAGS="$CFLAGS -msse4.1"
+  INTRINSICS_FLAG=--enable-intrinsics
+else
+  INTRINSICS_FLAG=--disable-intrinsics
+fi
+
 CONF_FLAGS=(
   --prefix=$INSTALL_DIR                               # install library in a build directory for FFmpeg to include
   --host=i686-none                                 # use i686 unknown
   --enable-shared=no                                  # not to build shared library
   --disable-asm                                       # not to use asm
   --disable-rtcd                                      # not to detect cpu capabilities
-  --disable-intrinsics                                # not to use intrinsics
+  $INTRINSICS_FLAG                                    # use intrinsics only when wasm SIMD is enabled
   --disable-doc                                       # not to build docs
   --disable-extra-programs                            # not to build demo and tests
   --disable-stack-protector
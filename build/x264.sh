@@ -2,15 +2,80 @@
 
 set -euo pipefail
 
+# WebAssembly SIMD128 kernels, copied from src/x264, they are compiled to
+# nothing without -msimd128 and are hooked in after the C init of pixel, dct
+# and quant, so clearing X264_CPU_SIMD128 (asm=0, or -cpuflags 0 in FFmpeg)
+# selects C again.
+patch_src() {
+  local file=$1 pattern=$2 replacement=$3
+  if ! grep -q "$pattern" "$file"; then
+    echo "$file: '$pattern' not found" >&2
+    exit 1
+  fi
+  sed -i "s@$pattern@$replacement@" "$file"
+}
+
+# renames the C init func of file and appends one calling it, then func_wasm
+wrap_init() {
+  local file=$1 func=$2 args=$3 proto
+  proto=$(grep -m1 "^void $func(" "$file") || { echo "$file: $func not found" >&2; exit 1; }
+  sed -i "s@^void $func(@static void ${func}_c(@" "$file"
+  cat >> "$file" <<EOF
+
+$proto
+{
+    ${func}_c( $args );
+    ${func}_wasm( $args );
+}
+EOF
+}
+
+if [[ -d common/wasm ]] && ! grep -q X264_CPU_SIMD128 x264.h; then
+  patch_src x264.h '^#define X264_CPU_MSA .*$' '&\n\n/* WebAssembly */\n#define X264_CPU_SIMD128         0x40000000U /* SIMD128 */'
+  patch_src common/cpu.c '^uint32_t x264_cpu_detect( void )$' 'static uint32_t cpu_detect_arch( void )'
+  patch_src common/cpu.c '^    {"", 0},$' '#if defined(__wasm_simd128__)\n    {"SIMD128",         X264_CPU_SIMD128},\n#endif\n&'
+  cat >> common/cpu.c <<'EOF'
+
+uint32_t x264_cpu_detect( void )
+{
+#if defined(__wasm_simd128__)
+    return cpu_detect_arch() | X264_CPU_SIMD128;
+#else
+    return cpu_detect_arch();
+#endif
+}
+EOF
+
+  patch_src common/pixel.c '^#include "common.h"$' '&\n#include "wasm/pixel.h"'
+  patch_src common/dct.c '^#include "common.h"$' '&\n#include "wasm/dct.h"'
+  patch_src common/quant.c '^#include "common.h"$' '&\n#include "wasm/quant.h"'
+  wrap_init common/pixel.c x264_pixel_init 'cpu, pixf'
+  wrap_init common/dct.c x264_dct_init 'cpu, dctf'
+  wrap_init common/quant.c x264_quant_init 'h, cpu, pf'
+  patch_src Makefile '^SRCS_X = ' '&common/wasm/pixel.c common/wasm/dct.c common/wasm/quant.c '
+fi
+
 CONF_FLAGS=(
   --prefix=$INSTALL_DIR           # lib installation dir
   --host=x86-gnu                  # use x86 linux host
   --enable-static                 # build static library
   --disable-cli                   # disable cli build
-  --disable-asm                   # disable assembly
+  --disable-asm                   # disable asm, x86 asm cannot target wasm, SIMD comes from -msimd128 and common/wasm
   --extra-cflags="$CFLAGS"        # add extra cflags
   ${FFMPEG_ST:+ --disable-thread} # disable thread when FFMPEG_ST is defined
 )
 
 emconfigure ./configure "${CONF_FLAGS[@]}"
 emmake make install-lib-static -j
+
+# checkasm of the WebAssembly SIMD128 kernels, fails the build when a kernel
+# differs from its C function, see src/x264/tools/wasm/checkasm.c.
+if [[ -d tools/wasm && "$CFLAGS" == *-msimd128* ]]; then
+  emcc -I. $CFLAGS -DBIT_DEPTH=8 -DHIGH_BIT_DEPTH=0 tools/wasm/checkasm.c libx264.a \
+    -o tools/wasm/checkasm.js -lm -sEXIT_RUNTIME -sALLOW_MEMORY_GROWTH
+  if [[ "$FFMPEG_WASM64" == "yes" ]]; then
+    ${EMSDK_NODE:-node} --experimental-wasm-memory64 tools/wasm/checkasm.js
+  else
+    ${EMSDK_NODE:-node} tools/wasm/checkasm.js
+  fi
+fi
@@ -2,6 +2,45 @@
 
 set -euo pipefail
 
+# WebAssembly SIMD128 kernels, copied from src/x265, they are compiled to
+# nothing without -msimd128 or in the 10 / 12-bit builds, and are set up after
+# the C primitives when param->cpuid has X265_CPU_SIMD128, so clearing it
+# (asm=0, or -cpuflags 0 in FFmpeg) selects C again.
+patch_src() {
+  local file=$1 pattern=$2 replacement=$3
+  if ! grep -q "$pattern" "$file"; then
+    echo "$file: '$pattern' not found" >&2
+    exit 1
+  fi
+  sed -i "s@$pattern@$replacement@" "$file"
+}
+
+if [[ -d source/common/wasm ]] && ! grep -q X265_CPU_SIMD128 source/x265.h; then
+  patch_src source/x265.h '^#define X265_CPU_ALTIVEC .*$' '&\n\n/* WebAssembly */\n#define X265_CPU_SIMD128         (1 << 30) /* SIMD128 */'
+  patch_src source/common/cpu.cpp '^uint32_t cpu_detect(\(.*\))$' 'static uint32_t cpu_detect_arch(\1)'
+  cat >> source/common/cpu.cpp <<'EOF'
+
+uint32_t X265_NS::cpu_detect(bool benableavx512)
+{
+#if defined(__wasm_simd128__)
+    return cpu_detect_arch(benableavx512) | X265_CPU_SIMD128;
+#else
+    return cpu_detect_arch(benableavx512);
+#endif
+}
+EOF
+
+  # the primitives are set up again when X265_CPU_SIMD128 changes between encoders
+  patch_src source/common/primitives.h '^void setupCPrimitives(EncoderPrimitives &p);$' \
+    '&\nvoid setupPixelPrimitives_wasm(EncoderPrimitives \&p);\nvoid setupDCTPrimitives_wasm(EncoderPrimitives \&p);'
+  patch_src source/common/primitives.cpp '^void x265_setup_primitives(x265_param \*param)$' 'static int s_simd128 = -1;\n\n&'
+  patch_src source/common/primitives.cpp '^\( *\)if (!primitives.pu\[0\].sad)$' \
+    '\1if (!primitives.pu[0].sad || s_simd128 != (int)(param->cpuid \& X265_CPU_SIMD128))'
+  patch_src source/common/primitives.cpp '^\( *\)setupAliasPrimitives(primitives);$' \
+    '#if defined(__wasm_simd128__)\n\1if (param->cpuid \& X265_CPU_SIMD128)\n\1{\n\1    setupPixelPrimitives_wasm(primitives);\n\1    setupDCTPrimitives_wasm(primitives);\n\1}\n#endif\n\1s_simd128 = param->cpuid \& X265_CPU_SIMD128;\n\n&'
+  patch_src source/common/CMakeLists.txt '^add_library(common OBJECT' '&\n    wasm/pixel_wasm.cpp wasm/dct_wasm.cpp'
+fi
+
 BASE_FLAGS=(
   -DCMAKE_TOOLCHAIN_FILE=$EM_TOOLCHAIN_FILE
   -DENABLE_LIBNUMA=OFF
@@ -52,6 +91,18 @@ emmake cmake ../.. -DCMAKE_CXX_FLAGS="$CXXFLAGS" ${FLAGS_MAIN[@]}
 emmake make -j
 mv libx265.a libx265_main.a
 
+# checkasm of the WebAssembly SIMD128 kernels, fails the build when a kernel
+# differs from its C function, see src/x265/source/test/wasm/checkasm.cpp.
+if [[ -d ../../test/wasm && "$CXXFLAGS" == *-msimd128* ]]; then
+  em++ $(sed -n 's/^CXX_\(DEFINES\|INCLUDES\|FLAGS\) = //p' common/CMakeFiles/common.dir/flags.make) \
+    ../../test/wasm/checkasm.cpp libx265_main.a -o checkasm.js -sEXIT_RUNTIME -sALLOW_MEMORY_GROWTH
+  if [[ "$FFMPEG_WASM64" == "yes" ]]; then
+    ${EMSDK_NODE:-node} --experimental-wasm-memory64 checkasm.js
+  else
+    ${EMSDK_NODE:-node} checkasm.js
+  fi
+fi
+
 # Merge static libraries
 emar -M <<EOF
 CREATE libx265.a
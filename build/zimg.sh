@@ -2,16 +2,78 @@
 
 set -euo pipefail
 
+# Emscripten translates SSE / SSE2 intrinsics to wasm SIMD when -msimd128 is
+# enabled, so prod builds keep the x86 kernels of zimg up to SSE2, which
+# FFmpeg selects with a pinned cpu class (ZIMG_CPU_X86_SSE2, see
+# build/ffmpeg.sh). AVX and later have no translation, and there is no cpuid
+# on wasm, so:
+#   - the AVX / F16C / AVX2 / AVX-512 sources are compiled to nothing,
+#   - their functions in the x86 dispatch code become wasm_no_kernel, a null
+#     function, which makes the dispatch fall back to SSE2,
+#   - cpuid and xgetbv are skipped, autodetection (ZIMG_CPU_AUTO) finds no
+#     x86 feature and uses the C kernels.
+if [[ "$CFLAGS" == *"-msimd128"* ]]; then
+  SIMD_FLAG=--enable-simd
+  shopt -s nullglob
+
+  for f in src/zimg/*/x86/*_avx*.cpp src/zimg/*/x86/*_ivb.cpp; do
+    sed -i '1i #ifndef __EMSCRIPTEN__' "$f"
+    echo '#endif' >> "$f"
+  done
+
+  cat > src/zimg/common/x86/wasm_no_kernel.h <<'EOF'
+#ifndef ZIMG_X86_WASM_NO_KERNEL_H_
+#define ZIMG_X86_WASM_NO_KERNEL_H_
+
+#include <cstddef>
+
+// Stands for the x86 kernels which are not built for wasm, a null function
+// pointer or a creator that returns nullptr.
+struct wasm_no_kernel_t {
+	template <class ...T>
+	std::nullptr_t operator()(T &&...) const { return nullptr; }
+
+	template <class F>
+	operator F *() const { return nullptr; }
+};
+
+#define wasm_no_kernel wasm_no_kernel_t{}
+
+#endif // ZIMG_X86_WASM_NO_KERNEL_H_
+EOF
+  for f in src/zimg/*/x86/*_x86.cpp; do
+    [[ "$f" == */cpuinfo_x86.cpp ]] && continue
+    sed -i -e '/^#/!s/\<[A-Za-z0-9_]*_\(avx[0-9a-z_]*\|ivb\)\>/wasm_no_kernel/g' \
+      -e '1i #include "common/x86/wasm_no_kernel.h"' "$f"
+  done
+
+  if ! grep -q 'defined(__GNUC__)' src/zimg/common/x86/cpuinfo_x86.cpp; then
+    echo "cpuinfo_x86.cpp: cpuid is not guarded by __GNUC__" >&2
+    exit 1
+  fi
+  sed -i 's/defined(__GNUC__)/(defined(__GNUC__) \&\& !defined(__EMSCRIPTEN__))/' \
+    src/zimg/common/x86/cpuinfo_x86.cpp
+else
+  SIMD_FLAG=--disable-simd
+fi
+
 CONF_FLAGS=(
   --prefix=$INSTALL_DIR            # lib installation directory
   --host=x86_64-linux-gnu          # use i686 linux host
   --disable-shared                 # build static library
   --enable-static                  # enable static library
   --disable-dependency-tracking    # speed up one-time build
-  --disable-simd                   # disable simd optimization
+  $SIMD_FLAG                       # x86 kernels up to SSE2 only when wasm SIMD is enabled
+  --disable-x86simd-avx512         # no AVX-512 kernels, they are not built for wasm
 )
 
 emconfigure ./autogen.sh
 
 emconfigure ./configure "${CONF_FLAGS[@]}"
-emmake make install -j
\ No newline at end of file
+
+# drop the AVX and later -m flags of the kernels compiled to nothing above
+if [[ "$SIMD_FLAG" == --enable-simd ]]; then
+  sed -i -E 's/ -m(avx[0-9a-z]*|fma|f16c|tune=[a-z0-9-]+)\b//g' Makefile
+fi
+
+emmake make install -j
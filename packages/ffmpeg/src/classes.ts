@@ -12,6 +12,34 @@ import {
   ProgressEvent,
   LogEventCallback,
   ProgressEventCallback,
+  MemoryEvent,
+  MemoryEventCallback,
+  SegmentEvent,
+  SegmentEventCallback,
+  FFMessageLadderData,
+  FFMessageThumbnailsData,
+  FFMessageCutData,
+  FFMessageProbeData,
+  ProbeResult,
+  FFMessagePeaksData,
+  PeakPyramid,
+  FFMessageIndexData,
+  KeyframeIndex,
+  FFMessageFramesOpenData,
+  FrameReaderInfo,
+  FrameBatchData,
+  VideoFrameData,
+  FFMessageFrameWriterOpenData,
+  FrameWriterInfo,
+  VideoFrameWriter,
+  FFMessageSamplesOpenData,
+  SampleReaderInfo,
+  SampleChunkData,
+  AudioSamplesData,
+  FFMessageSessionOpenData,
+  SessionInfo,
+  SessionFrameData,
+  MediaSession,
   FileData,
   FFFSType,
   FFFSMountOptions,
@@ -19,6 +47,8 @@ import {
 } from "./types.js";
 import { getMessageID } from "./utils.js";
 import { ERROR_TERMINATED, ERROR_NOT_LOADED } from "./errors.js";
+import { parsePeaks } from "./peaks.js";
+import { parseKeyframeIndex } from "./keyframes.js";
 
 type FFMessageOptions = {
   signal?: AbortSignal;
@@ -43,6 +73,8 @@ export class FFmpeg {
 
   #logEventCallbacks: LogEventCallback[] = [];
   #progressEventCallbacks: ProgressEventCallback[] = [];
+  #memoryEventCallbacks: MemoryEventCallback[] = [];
+  #segmentEventCallbacks: SegmentEventCallback[] = [];
 
   public loaded = false;
 
@@ -62,6 +94,26 @@ export class FFmpeg {
           case FFMessageType.MOUNT:
           case FFMessageType.UNMOUNT:
           case FFMessageType.EXEC:
+          case FFMessageType.LADDER:
+          case FFMessageType.THUMBNAILS:
+          case FFMessageType.CLEAR_PROBE_CACHE:
+          case FFMessageType.CUT:
+          case FFMessageType.PROBE:
+          case FFMessageType.PEAKS:
+          case FFMessageType.INDEX:
+          case FFMessageType.FRAMES_OPEN:
+          case FFMessageType.FRAMES_READ:
+          case FFMessageType.FRAMES_CLOSE:
+          case FFMessageType.FRAME_WRITER_OPEN:
+          case FFMessageType.FRAME_WRITER_WRITE:
+          case FFMessageType.FRAME_WRITER_CLOSE:
+          case FFMessageType.SAMPLES_OPEN:
+          case FFMessageType.SAMPLES_READ:
+          case FFMessageType.SAMPLES_CLOSE:
+          case FFMessageType.SESSION_OPEN:
+          case FFMessageType.SESSION_FRAME:
+          case FFMessageType.SESSION_AUDIO:
+          case FFMessageType.SESSION_CLOSE:
           case FFMessageType.WRITE_FILE:
           case FFMessageType.READ_FILE:
           case FFMessageType.DELETE_FILE:
@@ -79,6 +131,12 @@ export class FFmpeg {
               f(data as ProgressEvent)
             );
             break;
+          case FFMessageType.MEMORY:
+            this.#memoryEventCallbacks.forEach((f) => f(data as MemoryEvent));
+            break;
+          case FFMessageType.SEGMENT:
+            this.#segmentEventCallbacks.forEach((f) => f(data as SegmentEvent));
+            break;
           case FFMessageType.ERROR:
             this.#rejects[id](data);
             break;
@@ -118,7 +176,8 @@ export class FFmpeg {
   };
 
   /**
-   * Listen to log or prgress events from `ffmpeg.exec()`.
+   * Listen to log, progress or memory events from `ffmpeg.exec()`, or
+   * segment events from `ffmpeg.ladder()`.
    *
    * @example
    * ```ts
@@ -134,36 +193,70 @@ export class FFmpeg {
    * })
    * ```
    *
+   * @example
+   * ```ts
+   * ffmpeg.on("memory", ({ heapSize, inUse }) => {
+   *   // ...
+   * })
+   * ```
+   *
+   * @example
+   * ```ts
+   * ffmpeg.on("segment", ({ rung, index, path }) => {
+   *   // ...
+   * })
+   * ```
+   *
    * @remarks
    * - log includes output to stdout and stderr.
    * - The progress events are accurate only when the length of
    * input and output video/audio file are the same.
+   * - The memory events are sent when wasm memory grows and at the end of
+   * every exec, allocation counts are reset at the start of every exec.
+   * - The segment events are sent once a segment file is complete, it can be
+   * read after `ffmpeg.ladder()` resolves.
    *
    * @category FFmpeg
    */
   public on(event: "log", callback: LogEventCallback): void;
   public on(event: "progress", callback: ProgressEventCallback): void;
+  public on(event: "memory", callback: MemoryEventCallback): void;
+  public on(event: "segment", callback: SegmentEventCallback): void;
   public on(
-    event: "log" | "progress",
-    callback: LogEventCallback | ProgressEventCallback
+    event: "log" | "progress" | "memory" | "segment",
+    callback:
+      | LogEventCallback
+      | ProgressEventCallback
+      | MemoryEventCallback
+      | SegmentEventCallback
   ) {
     if (event === "log") {
       this.#logEventCallbacks.push(callback as LogEventCallback);
     } else if (event === "progress") {
       this.#progressEventCallbacks.push(callback as ProgressEventCallback);
+    } else if (event === "memory") {
+      this.#memoryEventCallbacks.push(callback as MemoryEventCallback);
+    } else if (event === "segment") {
+      this.#segmentEventCallbacks.push(callback as SegmentEventCallback);
     }
   }
 
   /**
-   * Unlisten to log or prgress events from `ffmpeg.exec()`.
+   * Unlisten to log, progress, memory or segment events.
    *
    * @category FFmpeg
    */
   public off(event: "log", callback: LogEventCallback): void;
   public off(event: "progress", callback: ProgressEventCallback): void;
+  public off(event: "memory", callback: MemoryEventCallback): void;
+  public off(event: "segment", callback: SegmentEventCallback): void;
   public off(
-    event: "log" | "progress",
-    callback: LogEventCallback | ProgressEventCallback
+    event: "log" | "progress" | "memory" | "segment",
+    callback:
+      | LogEventCallback
+      | ProgressEventCallback
+      | MemoryEventCallback
+      | SegmentEventCallback
   ) {
     if (event === "log") {
       this.#logEventCallbacks = this.#logEventCallbacks.filter(
@@ -173,6 +266,14 @@ export class FFmpeg {
       this.#progressEventCallbacks = this.#progressEventCallbacks.filter(
         (f) => f !== callback
       );
+    } else if (event === "memory") {
+      this.#memoryEventCallbacks = this.#memoryEventCallbacks.filter(
+        (f) => f !== callback
+      );
+    } else if (event === "segment") {
+      this.#segmentEventCallbacks = this.#segmentEventCallbacks.filter(
+        (f) => f !== callback
+      );
     }
   }
 
@@ -249,6 +350,497 @@ export class FFmpeg {
       signal
     ) as Promise<number>;
 
+  /**
+   * Drop the stream info cached by exec() calls with `-probe_cache`.
+   *
+   * @remarks
+   * With `-probe_cache` before `-i`, the stream info of a local input is
+   * probed once and reused by the next exec() calls on it, as long as its
+   * size and modification time, and the `-probesize`, `-analyzeduration` and
+   * `-fpsprobesize` it is probed with, are unchanged. Entries of changed files are
+   * dropped when they are used, this frees the memory of all of them.
+   *
+   * @example
+   * ```ts
+   * const ffmpeg = new FFmpeg();
+   * await ffmpeg.load();
+   * await ffmpeg.writeFile("video.mp4", ...);
+   * await ffmpeg.exec(["-probe_cache", "-i", "video.mp4", "-t", "1", "a.mp4"]);
+   * // video.mp4 is not probed again
+   * await ffmpeg.exec(["-probe_cache", "-i", "video.mp4", "-ss", "1", "b.mp4"]);
+   * await ffmpeg.clearProbeCache();
+   * ```
+   *
+   * @category FFmpeg
+   */
+  public clearProbeCache = ({ signal }: FFMessageOptions = {}): Promise<OK> =>
+    this.#send(
+      {
+        type: FFMessageType.CLEAR_PROBE_CACHE,
+      },
+      undefined,
+      signal
+    ) as Promise<OK>;
+
+  /**
+   * Encode an ABR ladder of segmented outputs with playlists in one command,
+   * the input is decoded once for all rungs and keyframes are forced at
+   * segment boundaries so segments of all rungs are aligned.
+   *
+   * @example
+   * ```ts
+   * const ffmpeg = new FFmpeg();
+   * await ffmpeg.load();
+   * await ffmpeg.writeFile("video.mp4", ...);
+   * ffmpeg.on("segment", ({ rung, index }) => {
+   *   // ...
+   * });
+   * await ffmpeg.ladder({
+   *   input: "video.mp4",
+   *   outputDir: "hls",
+   *   rungs: [
+   *     { name: "1080p", height: 1080, videoBitrate: "5000k" },
+   *     { name: "720p", height: 720, videoBitrate: "2800k" },
+   *     { name: "480p", height: 480, videoBitrate: "1400k" },
+   *     { name: "360p", height: 360, videoBitrate: "800k" },
+   *   ],
+   * });
+   * // hls/master.m3u8, hls/720p/index.m3u8, hls/720p/segment_00000.ts, ...
+   * const master = await ffmpeg.readFile("hls/master.m3u8", "utf8");
+   * ```
+   *
+   * @returns `0` if no error, `!= 0` if timeout (1) or error.
+   * @category FFmpeg
+   */
+  public ladder = (
+    data: FFMessageLadderData,
+    { signal }: FFMessageOptions = {}
+  ): Promise<number> =>
+    this.#send(
+      {
+        type: FFMessageType.LADDER,
+        data,
+      },
+      undefined,
+      signal
+    ) as Promise<number>;
+
+  /**
+   * Extract thumbnails at several positions of a video, as images or as a
+   * sprite sheet with a WebVTT index. The input is opened once, and only the
+   * keyframe before every position is decoded, so thumbnails are as fast to
+   * extract as seeking but land on keyframes.
+   *
+   * @example
+   * ```ts
+   * const ffmpeg = new FFmpeg();
+   * await ffmpeg.load();
+   * await ffmpeg.writeFile("video.mp4", ...);
+   * // thumb_0.jpg, thumb_1.jpg and thumb_2.jpg
+   * await ffmpeg.thumbnails({
+   *   input: "video.mp4",
+   *   times: [1, 30, 60],
+   *   output: "thumb_%d.jpg",
+   * });
+   * // sprite.jpg with 10 thumbnails per row, indexed by sprite.vtt
+   * await ffmpeg.thumbnails({
+   *   input: "video.mp4",
+   *   times: Array.from({ length: 60 }, (_, i) => i * 10),
+   *   output: "sprite.jpg",
+   *   sprite: { columns: 10, vtt: "sprite.vtt" },
+   * });
+   * ```
+   *
+   * @returns `0` if no error, `!= 0` if error.
+   * @category FFmpeg
+   */
+  public thumbnails = (
+    data: FFMessageThumbnailsData,
+    { signal }: FFMessageOptions = {}
+  ): Promise<number> =>
+    this.#send(
+      {
+        type: FFMessageType.THUMBNAILS,
+        data,
+      },
+      undefined,
+      signal
+    ) as Promise<number>;
+
+  /**
+   * Cut a video at exact frames without re-encoding all of it: the GOPs
+   * within the cut are copied and only the GOPs crossing its start or end
+   * are re-encoded, with the codec and parameters of the input.
+   *
+   * @example
+   * ```ts
+   * const ffmpeg = new FFmpeg();
+   * await ffmpeg.load();
+   * await ffmpeg.writeFile("video.mp4", ...);
+   * // frames from 12.5s up to 70s
+   * await ffmpeg.cut({ input: "video.mp4", output: "cut.mp4", start: 12.5, end: 70 });
+   * ```
+   *
+   * @returns `0` if no error, `!= 0` if error.
+   * @category FFmpeg
+   */
+  public cut = (
+    data: FFMessageCutData,
+    { signal }: FFMessageOptions = {}
+  ): Promise<number> =>
+    this.#send(
+      {
+        type: FFMessageType.CUT,
+        data,
+      },
+      undefined,
+      signal
+    ) as Promise<number>;
+
+  /**
+   * Probe a file with ffprobe and get its format and streams. The JSON
+   * output of ffprobe is kept in memory, no file is written.
+   *
+   * @example
+   * ```ts
+   * const ffmpeg = new FFmpeg();
+   * await ffmpeg.load();
+   * await ffmpeg.writeFile("video.mp4", ...);
+   * const { format, streams } = await ffmpeg.probe({ input: "video.mp4" });
+   * // only read the headers, ex: to list the streams of a large file
+   * await ffmpeg.probe({ input: "video.mp4", fast: true });
+   * ```
+   *
+   * @category FFmpeg
+   */
+  public probe = (
+    data: FFMessageProbeData,
+    { signal }: FFMessageOptions = {}
+  ): Promise<ProbeResult> =>
+    this.#send(
+      {
+        type: FFMessageType.PROBE,
+        data,
+      },
+      undefined,
+      signal
+    ) as Promise<ProbeResult>;
+
+  /**
+   * Index the keyframes of a file once, with their timestamps, byte offsets
+   * and GOP sizes, and keep the index as a sidecar file next to it. Later
+   * execs given the sidecar with `-seek_index` seek without searching the
+   * input for keyframes, which matters for formats without an index of
+   * their own like MPEG-TS or Matroska without cues.
+   *
+   * @example
+   * ```ts
+   * const ffmpeg = new FFmpeg();
+   * await ffmpeg.load();
+   * await ffmpeg.writeFile("video.ts", ...);
+   * const { streams } = await ffmpeg.index({ input: "video.ts" });
+   * await ffmpeg.exec([
+   *   "-seek_index", "video.ts.ffindex", "-ss", "600", "-i", "video.ts",
+   *   "-t", "10", "clip.mp4",
+   * ]);
+   * ```
+   *
+   * @category FFmpeg
+   */
+  public index = async (
+    data: FFMessageIndexData,
+    { signal }: FFMessageOptions = {}
+  ): Promise<KeyframeIndex> =>
+    parseKeyframeIndex(
+      (await this.#send(
+        {
+          type: FFMessageType.INDEX,
+          data,
+        },
+        undefined,
+        signal
+      )) as string
+    );
+
+  /**
+   * Build a waveform peak pyramid: min / max peaks of the audio at several
+   * zoom levels, computed natively while decoding the input once, instead of
+   * extracting all samples to compute them in JS. With `output`, the pyramid
+   * is also written as a sidecar file, to be cached and read again with
+   * `parsePeaks()`.
+   *
+   * @example
+   * ```ts
+   * const ffmpeg = new FFmpeg();
+   * await ffmpeg.load();
+   * await ffmpeg.writeFile("audio.mp3", ...);
+   * const { levels, samplesPerPeak, factor } = await ffmpeg.peaks({
+   *   input: "audio.mp3",
+   *   channels: 1,
+   * });
+   * // levels[i][2 * j] and levels[i][2 * j + 1] are the min and max of the
+   * // samplesPerPeak * factor ** i samples of peak j
+   * ```
+   *
+   * @category FFmpeg
+   */
+  public peaks = async (
+    data: FFMessagePeaksData,
+    { signal }: FFMessageOptions = {}
+  ): Promise<PeakPyramid> =>
+    parsePeaks(
+      (await this.#send(
+        {
+          type: FFMessageType.PEAKS,
+          data,
+        },
+        undefined,
+        signal
+      )) as Uint8Array
+    );
+
+  /**
+   * Decode the frames of a video, optionally scaled and converted, without
+   * encoding them to images in FS. Frames are decoded in batches in the
+   * worker, and every batch is transferred without copy.
+   *
+   * @example
+   * ```ts
+   * const ffmpeg = new FFmpeg();
+   * await ffmpeg.load();
+   * await ffmpeg.writeFile("video.mp4", ...);
+   * const ctx = canvas.getContext("2d");
+   * for await (const { data, width, height } of ffmpeg.frames({
+   *   input: "video.mp4",
+   *   width: 320,
+   * })) {
+   *   ctx.putImageData(
+   *     new ImageData(new Uint8ClampedArray(data.buffer, data.byteOffset, data.length), width, height),
+   *     0,
+   *     0
+   *   );
+   * }
+   * ```
+   *
+   * @category FFmpeg
+   */
+  public async *frames(
+    data: FFMessageFramesOpenData,
+    { signal }: FFMessageOptions = {}
+  ): AsyncGenerator<VideoFrameData> {
+    const { id, width, height, pixelFormat, frameSize } = (await this.#send(
+      { type: FFMessageType.FRAMES_OPEN, data },
+      undefined,
+      signal
+    )) as FrameReaderInfo;
+
+    try {
+      for (;;) {
+        const { count, data: frames, times } = (await this.#send(
+          { type: FFMessageType.FRAMES_READ, data: { id } },
+          undefined,
+          signal
+        )) as FrameBatchData;
+        if (count === 0) return;
+        for (let i = 0; i < count; i++) {
+          yield {
+            data: frames.subarray(i * frameSize, (i + 1) * frameSize),
+            time: times[i],
+            width,
+            height,
+            pixelFormat,
+          };
+        }
+      }
+    } finally {
+      // the worker may be gone after terminate()
+      if (this.#worker) {
+        await this.#send({ type: FFMessageType.FRAMES_CLOSE, data: { id } });
+      }
+    }
+  }
+
+  /**
+   * Decode the audio of a file into float samples, resampled and mixed to
+   * sampleRate and channels in the same pass, without writing raw PCM to
+   * FS. Chunks are yielded as they are decoded, so processing can start
+   * before the end of the input.
+   *
+   * @example
+   * ```ts
+   * const ffmpeg = new FFmpeg();
+   * await ffmpeg.load();
+   * await ffmpeg.writeFile("video.mp4", ...);
+   * for await (const { data, time } of ffmpeg.samples({
+   *   input: "video.mp4",
+   *   sampleRate: 16000,
+   *   channels: 1,
+   * })) {
+   *   // data holds mono samples at 16 kHz starting at time seconds
+   * }
+   * ```
+   *
+   * @category FFmpeg
+   */
+  public async *samples(
+    data: FFMessageSamplesOpenData,
+    { signal }: FFMessageOptions = {}
+  ): AsyncGenerator<AudioSamplesData> {
+    const { id, sampleRate, channels } = (await this.#send(
+      { type: FFMessageType.SAMPLES_OPEN, data },
+      undefined,
+      signal
+    )) as SampleReaderInfo;
+
+    try {
+      for (;;) {
+        const { count, time, data: samples } = (await this.#send(
+          { type: FFMessageType.SAMPLES_READ, data: { id } },
+          undefined,
+          signal
+        )) as SampleChunkData;
+        if (count === 0) return;
+        yield { data: samples, count, time, sampleRate, channels };
+      }
+    } finally {
+      // the worker may be gone after terminate()
+      if (this.#worker) {
+        await this.#send({ type: FFMessageType.SAMPLES_CLOSE, data: { id } });
+      }
+    }
+  }
+
+  /**
+   * Open an encoder fed with raw frames, ex: pixels of a canvas or frames
+   * generated by an ML model, configured with ffmpeg output args. Frames are
+   * encoded as they are written, without a sequence of images in FS.
+   *
+   * @example
+   * ```ts
+   * const ffmpeg = new FFmpeg();
+   * await ffmpeg.load();
+   * const writer = await ffmpeg.frameWriter({
+   *   output: "output.mp4",
+   *   width: canvas.width,
+   *   height: canvas.height,
+   *   args: ["-c:v", "libx264", "-pix_fmt", "yuv420p"],
+   * });
+   * for (let i = 0; i < 90; i++) {
+   *   draw(ctx, i);
+   *   const { data } = ctx.getImageData(0, 0, canvas.width, canvas.height);
+   *   // wait for the frame to be encoded before drawing the next one
+   *   await writer.write(new Uint8Array(data.buffer));
+   * }
+   * await writer.close();
+   * const data = await ffmpeg.readFile("output.mp4");
+   * ```
+   *
+   * @category FFmpeg
+   */
+  public frameWriter = async (
+    data: FFMessageFrameWriterOpenData,
+    { signal }: FFMessageOptions = {}
+  ): Promise<VideoFrameWriter> => {
+    const { id, frameSize } = (await this.#send(
+      { type: FFMessageType.FRAME_WRITER_OPEN, data },
+      undefined,
+      signal
+    )) as FrameWriterInfo;
+
+    return {
+      frameSize,
+      write: (frame: Uint8Array, time?: number) =>
+        this.#send(
+          {
+            type: FFMessageType.FRAME_WRITER_WRITE,
+            data: { id, data: frame, time },
+          },
+          [frame.buffer],
+          signal
+        ) as Promise<OK>,
+      close: () =>
+        this.#send(
+          { type: FFMessageType.FRAME_WRITER_CLOSE, data: { id } },
+          undefined,
+          signal
+        ) as Promise<OK>,
+    };
+  };
+
+  /**
+   * Open an input and keep it open for the many small requests of an editing
+   * UI, like the frame under the playhead or the audio of a selection. The
+   * input is probed once and its decoders stay open, so a request seeks
+   * within the open input, or decodes on from the previous request, instead
+   * of running a whole ffmpeg command.
+   *
+   * @example
+   * ```ts
+   * const ffmpeg = new FFmpeg();
+   * await ffmpeg.load();
+   * await ffmpeg.writeFile("video.mp4", ...);
+   * const session = await ffmpeg.session({ input: "video.mp4", width: 640 });
+   * const frame = await session.frame(12.5);
+   * if (frame) {
+   *   const image = new ImageData(
+   *     new Uint8ClampedArray(frame.data.buffer),
+   *     frame.width,
+   *     frame.height
+   *   );
+   * }
+   * const { data } = await session.audio(12.5, 2);
+   * await session.close();
+   * ```
+   *
+   * @category FFmpeg
+   */
+  public session = async (
+    data: FFMessageSessionOpenData,
+    { signal }: FFMessageOptions = {}
+  ): Promise<MediaSession> => {
+    const { id, width, height, pixelFormat, sampleRate, channels, duration } =
+      (await this.#send(
+        { type: FFMessageType.SESSION_OPEN, data },
+        undefined,
+        signal
+      )) as SessionInfo;
+
+    return {
+      width,
+      height,
+      pixelFormat,
+      sampleRate,
+      channels,
+      duration,
+      frame: async (time: number) => {
+        const { time: frameTime, data: frame } = (await this.#send(
+          { type: FFMessageType.SESSION_FRAME, data: { id, time } },
+          undefined,
+          signal
+        )) as SessionFrameData;
+        if (frame.length === 0) return null;
+        return { data: frame, time: frameTime, width, height, pixelFormat };
+      },
+      audio: async (start: number, duration: number) => {
+        const { count, time, data: samples } = (await this.#send(
+          {
+            type: FFMessageType.SESSION_AUDIO,
+            data: { id, start, duration },
+          },
+          undefined,
+          signal
+        )) as SampleChunkData;
+        return { data: samples, count, time, sampleRate, channels };
+      },
+      close: () =>
+        this.#send(
+          { type: FFMessageType.SESSION_CLOSE, data: { id } },
+          undefined,
+          signal
+        ) as Promise<OK>,
+    };
+  };
+
   /**
    * Terminate all ongoing API calls and terminate web worker.
    * `FFmpeg.load()` must be called again before calling any other APIs.
@@ -7,6 +7,7 @@ export const CORE_URL = `https://unpkg.com/@ffmpeg/core@${CORE_VERSION}/dist/umd
 export enum FFMessageType {
   LOAD = "LOAD",
   EXEC = "EXEC",
+  CLEAR_PROBE_CACHE = "CLEAR_PROBE_CACHE",
   WRITE_FILE = "WRITE_FILE",
   READ_FILE = "READ_FILE",
   DELETE_FILE = "DELETE_FILE",
@@ -14,10 +15,31 @@ export enum FFMessageType {
   CREATE_DIR = "CREATE_DIR",
   LIST_DIR = "LIST_DIR",
   DELETE_DIR = "DELETE_DIR",
+  LADDER = "LADDER",
+  THUMBNAILS = "THUMBNAILS",
+  CUT = "CUT",
+  PROBE = "PROBE",
+  PEAKS = "PEAKS",
+  INDEX = "INDEX",
+  FRAMES_OPEN = "FRAMES_OPEN",
+  FRAMES_READ = "FRAMES_READ",
+  FRAMES_CLOSE = "FRAMES_CLOSE",
+  FRAME_WRITER_OPEN = "FRAME_WRITER_OPEN",
+  FRAME_WRITER_WRITE = "FRAME_WRITER_WRITE",
+  FRAME_WRITER_CLOSE = "FRAME_WRITER_CLOSE",
+  SAMPLES_OPEN = "SAMPLES_OPEN",
+  SAMPLES_READ = "SAMPLES_READ",
+  SAMPLES_CLOSE = "SAMPLES_CLOSE",
+  SESSION_OPEN = "SESSION_OPEN",
+  SESSION_FRAME = "SESSION_FRAME",
+  SESSION_AUDIO = "SESSION_AUDIO",
+  SESSION_CLOSE = "SESSION_CLOSE",
   ERROR = "ERROR",
 
   DOWNLOAD = "DOWNLOAD",
   PROGRESS = "PROGRESS",
+  MEMORY = "MEMORY",
+  SEGMENT = "SEGMENT",
   LOG = "LOG",
   MOUNT = "MOUNT",
   UNMOUNT = "UNMOUNT",
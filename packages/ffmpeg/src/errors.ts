@@ -6,3 +6,45 @@ export const ERROR_TERMINATED = new Error("called FFmpeg.terminate()");
 export const ERROR_IMPORT_FAILURE = new Error(
   "failed to import ffmpeg-core.js"
 );
+export const ERROR_PROBE_FAILURE = new Error(
+  "ffprobe failed to read the input, see the logs for details"
+);
+export const ERROR_FRAMES_OPEN_FAILURE = new Error(
+  "failed to open the input to read frames, see the logs for details"
+);
+export const ERROR_FRAMES_READ_FAILURE = new Error(
+  "failed to decode frames, see the logs for details"
+);
+export const ERROR_FRAME_WRITER_OPEN_FAILURE = new Error(
+  "failed to open the encoder to write frames, see the logs for details"
+);
+export const ERROR_FRAME_WRITE_FAILURE = new Error(
+  "failed to encode frames, see the logs for details"
+);
+export const ERROR_SAMPLES_OPEN_FAILURE = new Error(
+  "failed to open the input to read audio, see the logs for details"
+);
+export const ERROR_SAMPLES_READ_FAILURE = new Error(
+  "failed to decode audio, see the logs for details"
+);
+export const ERROR_SESSION_OPEN_FAILURE = new Error(
+  "failed to open the input of the session, see the logs for details"
+);
+export const ERROR_SESSION_READ_FAILURE = new Error(
+  "failed to decode the input of the session, see the logs for details"
+);
+export const ERROR_PEAKS_FAILURE = new Error(
+  "ffpeaks failed to read the audio of the input, see the logs for details"
+);
+export const ERROR_INVALID_PEAKS = new Error(
+  "invalid peak pyramid, expected data written by ffpeaks"
+);
+export const ERROR_INDEX_FAILURE = new Error(
+  "ffindex failed to read the input, see the logs for details"
+);
+export const ERROR_INVALID_INDEX = new Error(
+  "invalid keyframe index, expected an index written by ffindex"
+);
+export const ERROR_INVALID_LADDER = new Error(
+  "ladder requires at least one rung, rung names must match /^[\\w-]+$/"
+);
@@ -1 +1,3 @@
 export * from "./classes.js";
+export { parsePeaks } from "./peaks.js";
+export { parseKeyframeIndex } from "./keyframes.js";
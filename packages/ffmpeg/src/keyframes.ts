@@ -0,0 +1,75 @@
+import type {
+  FFMessageIndexData,
+  Keyframe,
+  KeyframeIndex,
+  KeyframeIndexStream,
+} from "./types";
+import { ERROR_INVALID_INDEX } from "./errors.js";
+
+const VERSION = 1;
+
+const STREAM_TYPES: Record<string, KeyframeIndexStream["type"]> = {
+  v: "video",
+  a: "audio",
+  s: "subtitle",
+  d: "data",
+  t: "attachment",
+};
+
+/**
+ * Generate ffindex args of `FFmpeg.index()`.
+ */
+export const getIndexArgs = ({
+  input,
+  output = `${input}.ffindex`,
+  interval,
+}: FFMessageIndexData): string[] => {
+  const args = ["-i", input];
+  if (interval !== undefined) args.push("-interval", `${interval}`);
+  args.push(output);
+  return args;
+};
+
+/**
+ * Parse a keyframe index written by ffindex, ex: to plan segments at
+ * keyframes.
+ */
+export const parseKeyframeIndex = (text: string): KeyframeIndex => {
+  const [header, ...lines] = text.trim().split("\n");
+  const [magic, version, size] = header.split(" ");
+  if (magic !== "ffindex" || Number(version) !== VERSION) {
+    throw ERROR_INVALID_INDEX;
+  }
+
+  const streams: KeyframeIndexStream[] = [];
+  for (const line of lines) {
+    const [record, ...fields] = line.split(" ");
+    if (record === "stream") {
+      const [index, type, num, den] = fields;
+      streams[Number(index)] = {
+        index: Number(index),
+        type: STREAM_TYPES[type] ?? "data",
+        timeBase: [Number(num), Number(den)],
+        keyframes: [],
+      };
+    } else if (record === "key") {
+      const [index, dts, pts, pos, packets, bytes] = fields.map(Number);
+      const stream = streams[index];
+      if (!stream) throw ERROR_INVALID_INDEX;
+      const [num, den] = stream.timeBase;
+      const keyframe: Keyframe = {
+        time: (pts * num) / den,
+        pts,
+        dts,
+        pos,
+        packets,
+        bytes,
+      };
+      stream.keyframes.push(keyframe);
+    } else {
+      throw ERROR_INVALID_INDEX;
+    }
+  }
+
+  return { size: Number(size), streams };
+};
@@ -0,0 +1,107 @@
+import type { FFFSPath, FFMessageLadderData, SegmentEvent } from "./types";
+import { ERROR_INVALID_LADDER } from "./errors.js";
+
+const RUNG_NAME = /^[\w-]+$/;
+
+/**
+ * Generate ffmpeg args of `FFmpeg.ladder()`, the input is decoded once and
+ * split into a scaled stream per rung. Keyframes are forced at every segment
+ * boundary so the segments of all rungs start at the same time.
+ */
+export const getLadderArgs = ({
+  input,
+  outputDir,
+  rungs,
+  format = "hls",
+  segmentDuration = 4,
+  audio = true,
+  videoCodec = "libx264",
+  audioCodec = "aac",
+  preset = "veryfast",
+}: FFMessageLadderData): string[] => {
+  if (!rungs.length || rungs.some(({ name }) => !RUNG_NAME.test(name))) {
+    throw ERROR_INVALID_LADDER;
+  }
+
+  const split = `[0:v]split=${rungs.length}${rungs
+    .map((_, i) => `[v${i}]`)
+    .join("")}`;
+  const scales = rungs.map(
+    ({ width = -2, height }, i) => `[v${i}]scale=${width}:${height}[s${i}]`
+  );
+  const args = ["-i", input, "-filter_complex", [split, ...scales].join(";")];
+
+  // video and audio streams of a rung are interleaved, see getSegment().
+  rungs.forEach(({ videoBitrate, audioBitrate = "128k" }, i) => {
+    args.push(
+      "-map", `[s${i}]`,
+      `-b:v:${i}`, videoBitrate,
+      `-maxrate:v:${i}`, videoBitrate,
+      `-bufsize:v:${i}`, videoBitrate
+    );
+    if (audio) args.push("-map", "0:a:0", `-b:a:${i}`, audioBitrate);
+  });
+  args.push(
+    "-c:v", videoCodec,
+    "-preset:v", preset,
+    "-force_key_frames:v", `expr:gte(t,n_forced*${segmentDuration})`
+  );
+  if (audio) args.push("-c:a", audioCodec);
+
+  if (format === "dash") {
+    args.push(
+      "-f", "dash",
+      "-seg_duration", `${segmentDuration}`,
+      "-use_template", "1",
+      "-use_timeline", "0",
+      "-adaptation_sets", audio ? "id=0,streams=v id=1,streams=a" : "id=0,streams=v",
+      "-init_seg_name", "init-$RepresentationID$.$ext$",
+      "-media_seg_name", "chunk-$RepresentationID$-$Number%05d$.$ext$",
+      `${outputDir}/manifest.mpd`
+    );
+  } else {
+    args.push(
+      "-f", "hls",
+      "-hls_time", `${segmentDuration}`,
+      "-hls_playlist_type", "vod",
+      "-hls_flags", "independent_segments",
+      "-hls_segment_filename", `${outputDir}/%v/segment_%05d.ts`,
+      "-master_pl_name", "master.m3u8",
+      "-var_stream_map",
+      rungs
+        .map(({ name }, i) => `v:${i},${audio ? `a:${i},` : ""}name:${name}`)
+        .join(" "),
+      `${outputDir}/%v/index.m3u8`
+    );
+  }
+  return args;
+};
+
+/**
+ * Map a file written by `FFmpeg.ladder()` to its segment, `null` for
+ * playlists, init segments and unrelated files.
+ *
+ * @param dir absolute path of outputDir
+ */
+export const getSegment = (
+  { rungs, format = "hls", audio = true }: FFMessageLadderData,
+  dir: FFFSPath,
+  path: FFFSPath,
+  size: number
+): SegmentEvent | null => {
+  if (!path.startsWith(`${dir}/`)) return null;
+  // the dash muxer writes to a temporary file and renames it once complete.
+  const file = path.slice(dir.length + 1).replace(/\.tmp$/, "");
+
+  if (format === "dash") {
+    const m = /^chunk-(\d+)-(\d+)\.\w+$/.exec(file);
+    // representation ids are output stream indexes.
+    const rung = m && rungs[audio ? Math.floor(+m[1] / 2) : +m[1]];
+    return m && rung
+      ? { rung: rung.name, index: +m[2] - 1, path: `${dir}/${file}`, size }
+      : null;
+  }
+
+  const m = /^([\w-]+)\/segment_(\d+)\.ts$/.exec(file);
+  return m ? { rung: m[1], index: +m[2], path, size } : null;
+};
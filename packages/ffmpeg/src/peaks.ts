@@ -0,0 +1,62 @@
+import type { FFMessagePeaksData, PeakPyramid } from "./types";
+import { ERROR_INVALID_PEAKS } from "./errors.js";
+
+const MAGIC = "FFPK";
+const VERSION = 1;
+
+/**
+ * Generate ffpeaks args of `FFmpeg.peaks()`.
+ */
+export const getPeaksArgs = ({
+  input,
+  output,
+  samplesPerPeak,
+  levels,
+  factor,
+  channels,
+}: FFMessagePeaksData): string[] => {
+  const args = ["-i", input];
+  if (samplesPerPeak !== undefined) args.push("-spp", `${samplesPerPeak}`);
+  if (levels !== undefined) args.push("-levels", `${levels}`);
+  if (factor !== undefined) args.push("-factor", `${factor}`);
+  if (channels !== undefined) args.push("-ac", `${channels}`);
+  if (output) args.push(output);
+  return args;
+};
+
+/**
+ * Parse a peak pyramid written by ffpeaks, ex: a sidecar file cached by the
+ * app. Levels are views on data, no peak is copied.
+ */
+export const parsePeaks = (data: Uint8Array): PeakPyramid => {
+  const view = new DataView(data.buffer, data.byteOffset, data.byteLength);
+  const magic = String.fromCharCode(...data.subarray(0, 4));
+  if (data.length < 28 || magic !== MAGIC || view.getUint32(4, true) !== VERSION) {
+    throw ERROR_INVALID_PEAKS;
+  }
+
+  const channels = view.getUint32(12, true);
+  const nbLevels = view.getUint32(24, true);
+  let offset = 28 + 4 * nbLevels;
+  const levels: Int16Array[] = [];
+  for (let i = 0; i < nbLevels; i++) {
+    const length = view.getUint32(28 + 4 * i, true) * channels * 2;
+    if (offset + length * 2 > data.length) throw ERROR_INVALID_PEAKS;
+    // Int16Array views need an even offset, copy when data is not aligned
+    levels.push(
+      (data.byteOffset + offset) % 2
+        ? new Int16Array(data.slice(offset, offset + length * 2).buffer)
+        : new Int16Array(data.buffer, data.byteOffset + offset, length)
+    );
+    offset += length * 2;
+  }
+
+  return {
+    data,
+    sampleRate: view.getUint32(8, true),
+    channels,
+    samplesPerPeak: view.getUint32(16, true),
+    factor: view.getUint32(20, true),
+    levels,
+  };
+};
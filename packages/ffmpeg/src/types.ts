@@ -30,6 +30,34 @@ export interface FFMessageLoadConfig {
    * @defaultValue `./worker.js`
    */
   classWorkerURL?: string;
+  /**
+   * Number of threads spawned when multithread version of ffmpeg-core is
+   * loaded, the threads an `FFmpeg.exec()` missed are spawned after it
+   * returns, up to `maxThreads`.
+   *
+   * @defaultValue `Math.min(navigator.hardwareConcurrency + 4, maxThreads)`
+   */
+  initialThreads?: number;
+  /**
+   * Maximum number of threads of multithread version of ffmpeg-core.
+   *
+   * @defaultValue `Math.min(2 * navigator.hardwareConcurrency, 32)`
+   */
+  maxThreads?: number;
+  /**
+   * Initial memory size in bytes of multithread version of ffmpeg-core, the
+   * memory grows on demand up to 4GB.
+   *
+   * @defaultValue `256 * 1024 * 1024`
+   */
+  initialMemory?: number;
+  /**
+   * Memory budget in bytes of a `FFmpeg.exec()` call, the command is stopped
+   * with exit code 1 when memory allocated by ffmpeg exceeds this value.
+   *
+   * @defaultValue `-1` (no limit)
+   */
+  maxMemory?: number;
 }
 
 export interface FFMessageExecData {
@@ -107,6 +135,488 @@ export interface FFMessageUnmountData {
   mountPoint: FFFSPath;
 }
 
+/**
+ * A rendition of an ABR ladder.
+ */
+export interface LadderRung {
+  /**
+   * Name of the rendition, used in playlists and output paths, only letters,
+   * digits, `_` and `-` are allowed, ex: `720p`.
+   */
+  name: string;
+  /** height of the rendition in pixels */
+  height: number;
+  /**
+   * width of the rendition in pixels.
+   *
+   * @defaultValue computed from height to keep the input aspect ratio
+   */
+  width?: number;
+  /** video bitrate, ex: `3000k` */
+  videoBitrate: string;
+  /**
+   * audio bitrate, ex: `128k`
+   *
+   * @defaultValue `128k`
+   */
+  audioBitrate?: string;
+}
+
+export interface FFMessageLadderData {
+  /** input file, decoded once for all rungs */
+  input: FFFSPath;
+  /** directory receiving playlists and segments, created if missing */
+  outputDir: FFFSPath;
+  rungs: LadderRung[];
+  /**
+   * `hls` writes `master.m3u8` and `<rung>/index.m3u8`, `dash` writes
+   * `manifest.mpd`.
+   *
+   * @defaultValue `hls`
+   */
+  format?: "hls" | "dash";
+  /**
+   * target segment duration in seconds, keyframes are forced at every
+   * multiple of it so segments of all rungs are aligned.
+   *
+   * @defaultValue 4
+   */
+  segmentDuration?: number;
+  /**
+   * encode the first audio stream of the input in every rung.
+   *
+   * @defaultValue true
+   */
+  audio?: boolean;
+  /** @defaultValue `libx264` */
+  videoCodec?: string;
+  /** @defaultValue `aac` */
+  audioCodec?: string;
+  /**
+   * encoder preset, ignored by encoders without presets.
+   *
+   * @defaultValue `veryfast`
+   */
+  preset?: string;
+  timeout?: number;
+}
+
+export interface ThumbnailSprite {
+  /** number of thumbnails per row of the sprite sheet */
+  columns: number;
+  /** WebVTT file mapping time ranges to tiles of the sprite sheet */
+  vtt?: FFFSPath;
+}
+
+export interface FFMessageThumbnailsData {
+  input: FFFSPath;
+  /** positions of the thumbnails in seconds */
+  times: number[];
+  /**
+   * Image path, its extension selects the encoder, ex: `jpg`, `png` or
+   * `webp`. Without sprite, it must contain `%d` when several thumbnails are
+   * extracted, replaced by the index of the position in `times`.
+   */
+  output: FFFSPath;
+  /**
+   * width of a thumbnail in pixels, computed from height to keep the aspect
+   * ratio when only height is set.
+   *
+   * @defaultValue 160
+   */
+  width?: number;
+  /** @defaultValue computed from width to keep the aspect ratio */
+  height?: number;
+  /** encoder quality scale, ex: 2 (best) to 31 for jpg */
+  quality?: number;
+  /** pack all thumbnails in one image */
+  sprite?: ThumbnailSprite;
+}
+
+export interface FFMessageCutData {
+  input: FFFSPath;
+  output: FFFSPath;
+  /** start of the cut in seconds */
+  start?: number;
+  /** end of the cut in seconds, the end of the input when not set */
+  end?: number;
+  /**
+   * copy the audio stream
+   *
+   * @defaultValue true
+   */
+  audio?: boolean;
+}
+
+export interface FFMessageProbeData {
+  input: FFFSPath;
+  /**
+   * only parse the headers of the input, fields requiring to read or decode
+   * frames, ex: the duration of some streams, may be missing.
+   *
+   * @defaultValue false
+   */
+  fast?: boolean;
+  /**
+   * extra ffprobe args, ex: `["-show_chapters"]`, format and streams are
+   * always shown.
+   */
+  args?: string[];
+}
+
+export interface FFMessagePeaksData {
+  input: FFFSPath;
+  /**
+   * sidecar file to write the pyramid to, ex: `input.peaks`, the pyramid is
+   * returned either way.
+   */
+  output?: FFFSPath;
+  /**
+   * samples per peak of the first level.
+   *
+   * @defaultValue 256
+   */
+  samplesPerPeak?: number;
+  /**
+   * maximum number of levels, fewer are built once a peak covers the input.
+   *
+   * @defaultValue 8
+   */
+  levels?: number;
+  /**
+   * peaks of a level merged into a peak of the next one.
+   *
+   * @defaultValue 2
+   */
+  factor?: number;
+  /**
+   * mix down or up to channels, ex: 1 for a single waveform.
+   *
+   * @defaultValue channels of the input
+   */
+  channels?: number;
+}
+
+/**
+ * Waveform peak pyramid returned by `ffmpeg.peaks()` and `parsePeaks()`.
+ */
+export interface PeakPyramid {
+  /** the pyramid as written by ffpeaks, to cache and parse again later */
+  data: Uint8Array;
+  sampleRate: number;
+  channels: number;
+  /** samples per peak of levels[0] */
+  samplesPerPeak: number;
+  /** levels[i] has samplesPerPeak * factor ** i samples per peak */
+  factor: number;
+  /**
+   * peaks of every level as min / max pairs, the channels of a peak are
+   * interleaved, values are in [-32767, 32767]
+   */
+  levels: Int16Array[];
+}
+
+export interface FFMessageIndexData {
+  input: FFFSPath;
+  /**
+   * sidecar file of the index, to give to `-seek_index` in later execs.
+   *
+   * @defaultValue `${input}.ffindex`
+   */
+  output?: FFFSPath;
+  /**
+   * minimum seconds between entries of streams where every packet is a
+   * keyframe, ex: audio. Every keyframe of video streams is indexed.
+   *
+   * @defaultValue 1
+   */
+  interval?: number;
+}
+
+export interface Keyframe {
+  /** pts in seconds */
+  time: number;
+  /** pts in the time base of the stream, dts when unknown */
+  pts: number;
+  dts: number;
+  /** byte offset of the keyframe in the input */
+  pos: number;
+  /** packets from this keyframe up to the next indexed one */
+  packets: number;
+  /** bytes of these packets */
+  bytes: number;
+}
+
+export interface KeyframeIndexStream {
+  index: number;
+  type: "video" | "audio" | "subtitle" | "data" | "attachment";
+  /** [numerator, denominator] */
+  timeBase: [number, number];
+  keyframes: Keyframe[];
+}
+
+/**
+ * Keyframe index returned by `ffmpeg.index()` and `parseKeyframeIndex()`.
+ */
+export interface KeyframeIndex {
+  /** size of the indexed input in bytes */
+  size: number;
+  /** streams by index */
+  streams: KeyframeIndexStream[];
+}
+
+export interface FFMessageFramesOpenData {
+  input: FFFSPath;
+  /**
+   * width of frames, computed from height to keep the aspect ratio when only
+   * height is set.
+   *
+   * @defaultValue decoded width
+   */
+  width?: number;
+  /** @defaultValue decoded height, or computed from width */
+  height?: number;
+  /**
+   * pixel format of frames, ex: `rgba` for ImageData or `gray` and
+   * `rgb24` for ML models.
+   *
+   * @defaultValue `rgba`
+   */
+  pixelFormat?: string;
+  /**
+   * frames decoded and transferred from the worker per message.
+   *
+   * @defaultValue 8
+   */
+  batch?: number;
+}
+
+export interface FFMessageFramesData {
+  /**
+   * id returned by FRAMES_OPEN, FRAME_WRITER_OPEN, SAMPLES_OPEN or
+   * SESSION_OPEN
+   */
+  id: number;
+}
+
+export interface FrameReaderInfo {
+  id: number;
+  width: number;
+  height: number;
+  pixelFormat: string;
+  frameSize: number;
+}
+
+export interface FrameBatchData {
+  count: number;
+  /** count frames of frameSize bytes */
+  data: Uint8Array;
+  times: Float64Array;
+}
+
+/**
+ * A decoded frame yielded by `ffmpeg.frames()`.
+ */
+export interface VideoFrameData {
+  /** pixels, packed without padding */
+  data: Uint8Array;
+  /** time in seconds from the start of the stream */
+  time: number;
+  width: number;
+  height: number;
+  pixelFormat: string;
+}
+
+export interface FFMessageFrameWriterOpenData {
+  output: FFFSPath;
+  /** width of written frames */
+  width: number;
+  /** height of written frames */
+  height: number;
+  /**
+   * pixel format of written frames, ex: `rgba` for ImageData.
+   *
+   * @defaultValue `rgba`
+   */
+  pixelFormat?: string;
+  /** @defaultValue 30 */
+  frameRate?: number;
+  /**
+   * ffmpeg output args, ex: `["-c:v", "libx264", "-pix_fmt", "yuv420p"]`,
+   * the encoder and pixel format are picked from the output format when
+   * not set.
+   */
+  args?: string[];
+}
+
+export interface FFMessageFrameWriteData {
+  /** id of the writer returned by FRAME_WRITER_OPEN */
+  id: number;
+  /** a frame of frameSize bytes, packed without padding */
+  data: Uint8Array;
+  /** time in seconds, the frame after the previous one when not set */
+  time?: number;
+}
+
+export interface FrameWriterInfo {
+  id: number;
+  frameSize: number;
+}
+
+/**
+ * An encoder fed with frames, returned by `ffmpeg.frameWriter()`.
+ */
+export interface VideoFrameWriter {
+  /** bytes of a frame */
+  frameSize: number;
+  /**
+   * encode a frame, the promise resolves once the frame is encoded, await it
+   * before writing the next frame to keep memory bounded. The buffer of
+   * data is transferred to the worker.
+   */
+  write: (data: Uint8Array, time?: number) => Promise<OK>;
+  /** flush the encoder and finish the output file */
+  close: () => Promise<OK>;
+}
+
+export interface FFMessageSamplesOpenData {
+  input: FFFSPath;
+  /**
+   * sample rate of samples, ex: 16000 for speech models.
+   *
+   * @defaultValue decoded sample rate
+   */
+  sampleRate?: number;
+  /**
+   * number of channels, ex: 1 to mix down to mono.
+   *
+   * @defaultValue decoded channels
+   */
+  channels?: number;
+  /**
+   * one plane per channel instead of interleaved samples.
+   *
+   * @defaultValue false
+   */
+  planar?: boolean;
+  /**
+   * samples per channel decoded and transferred from the worker per message.
+   *
+   * @defaultValue 16384
+   */
+  chunk?: number;
+}
+
+export interface SampleReaderInfo {
+  id: number;
+  sampleRate: number;
+  channels: number;
+}
+
+export interface SampleChunkData {
+  /** samples per channel */
+  count: number;
+  time: number;
+  /** count * channels samples, see AudioSamplesData.data */
+  data: Float32Array;
+}
+
+/**
+ * A chunk of decoded audio yielded by `ffmpeg.samples()`.
+ */
+export interface AudioSamplesData {
+  /**
+   * interleaved samples, or when planar, one plane of count samples per
+   * channel one after another
+   */
+  data: Float32Array;
+  /** samples per channel */
+  count: number;
+  /** time of the first sample in seconds from the start of the stream */
+  time: number;
+  sampleRate: number;
+  channels: number;
+}
+
+export interface FFMessageSessionOpenData {
+  input: FFFSPath;
+  /**
+   * width of frames, computed from height to keep the aspect ratio when only
+   * height is set.
+   *
+   * @defaultValue decoded width
+   */
+  width?: number;
+  /** @defaultValue decoded height, or computed from width */
+  height?: number;
+  /** @defaultValue `rgba` */
+  pixelFormat?: string;
+  /** @defaultValue decoded sample rate */
+  sampleRate?: number;
+  /** @defaultValue decoded channels */
+  channels?: number;
+}
+
+export interface FFMessageSessionFrameData {
+  /** id of the session returned by SESSION_OPEN */
+  id: number;
+  /** time in seconds */
+  time: number;
+}
+
+export interface FFMessageSessionAudioData {
+  /** id of the session returned by SESSION_OPEN */
+  id: number;
+  /** time of the first sample in seconds */
+  start: number;
+  /** seconds of audio */
+  duration: number;
+}
+
+export interface SessionInfo {
+  id: number;
+  /** 0 without video */
+  width: number;
+  height: number;
+  pixelFormat: string;
+  frameSize: number;
+  sampleRate: number;
+  /** 0 without audio */
+  channels: number;
+  /** duration of the input in seconds, NaN when unknown */
+  duration: number;
+}
+
+export interface SessionFrameData {
+  time: number;
+  /** frameSize bytes, empty when the video has no frame */
+  data: Uint8Array;
+}
+
+/**
+ * An input kept open between requests, returned by `ffmpeg.session()`.
+ */
+export interface MediaSession {
+  /** 0 without video */
+  width: number;
+  height: number;
+  pixelFormat: string;
+  sampleRate: number;
+  /** 0 without audio */
+  channels: number;
+  /** duration of the input in seconds, NaN when unknown */
+  duration: number;
+  /** the frame shown at time in seconds, null when the video has no frame */
+  frame: (time: number) => Promise<VideoFrameData | null>;
+  /**
+   * interleaved samples of duration seconds from start, fewer at the end of
+   * the input
+   */
+  audio: (start: number, duration: number) => Promise<AudioSamplesData>;
+  /** close the input and free its decoders */
+  close: () => Promise<OK>;
+}
+
 export type FFMessageData =
   | FFMessageLoadConfig
   | FFMessageExecData
@@ -118,7 +628,21 @@ export type FFMessageData =
   | FFMessageListDirData
   | FFMessageDeleteDirData
   | FFMessageMountData
-  | FFMessageUnmountData;
+  | FFMessageUnmountData
+  | FFMessageLadderData
+  | FFMessageThumbnailsData
+  | FFMessageCutData
+  | FFMessageProbeData
+  | FFMessagePeaksData
+  | FFMessageIndexData
+  | FFMessageFramesOpenData
+  | FFMessageFramesData
+  | FFMessageFrameWriterOpenData
+  | FFMessageFrameWriteData
+  | FFMessageSamplesOpenData
+  | FFMessageSessionOpenData
+  | FFMessageSessionFrameData
+  | FFMessageSessionAudioData;
 
 export interface Message {
   type: string;
@@ -143,6 +667,72 @@ export interface ProgressEvent {
   time: number;
 }
 
+export interface MemoryEvent {
+  /** size of wasm memory in bytes */
+  heapSize: number;
+  /** bytes allocated by ffmpeg */
+  inUse: number;
+  /** highest inUse observed in current exec */
+  peakInUse: number;
+  /** bytes held by the allocator but free */
+  freeBytes: number;
+  /** ratio of free bytes to all bytes held by the allocator, 0 to 1 */
+  fragmentation: number;
+  /** number of malloc / calloc / posix_memalign calls in current exec */
+  allocs: number;
+  /** number of realloc calls in current exec */
+  reallocs: number;
+  /** number of free calls in current exec */
+  frees: number;
+}
+
+export interface SegmentEvent {
+  /** name of the rung the segment belongs to */
+  rung: string;
+  /** index of the segment in the rung, from 0 */
+  index: number;
+  path: FFFSPath;
+  /** size of the segment in bytes */
+  size: number;
+}
+
+/**
+ * JSON output of ffprobe, only the most used fields are typed, values are
+ * as printed by ffprobe, ex: `duration` is a string.
+ */
+export interface ProbeStream {
+  index: number;
+  codec_name?: string;
+  codec_type?: string;
+  width?: number;
+  height?: number;
+  pix_fmt?: string;
+  sample_rate?: string;
+  channels?: number;
+  r_frame_rate?: string;
+  duration?: string;
+  bit_rate?: string;
+  tags?: Record<string, string>;
+  [key: string]: unknown;
+}
+
+export interface ProbeFormat {
+  filename: string;
+  nb_streams: number;
+  format_name: string;
+  duration?: string;
+  size?: string;
+  bit_rate?: string;
+  tags?: Record<string, string>;
+  [key: string]: unknown;
+}
+
+export interface ProbeResult {
+  format?: ProbeFormat;
+  streams?: ProbeStream[];
+  [key: string]: unknown;
+}
+
 export type ExitCode = number;
 export type ErrorMessage = string;
 export type FileData = Uint8Array | string;
@@ -160,10 +750,20 @@ export type CallbackData =
   | ErrorMessage
   | LogEvent
   | ProgressEvent
+  | MemoryEvent
+  | SegmentEvent
   | IsFirst
   | OK // eslint-disable-line
   | Error
   | FSNode[]
+  | ProbeResult
+  | FrameReaderInfo
+  | FrameBatchData
+  | FrameWriterInfo
+  | SampleReaderInfo
+  | SampleChunkData
+  | SessionInfo
+  | SessionFrameData
   | undefined;
 
 export interface Callbacks {
@@ -172,6 +772,8 @@ export interface Callbacks {
 
 export type LogEventCallback = (event: LogEvent) => void;
 export type ProgressEventCallback = (event: ProgressEvent) => void;
+export type MemoryEventCallback = (event: MemoryEvent) => void;
+export type SegmentEventCallback = (event: SegmentEvent) => void;
 
 export interface FFMessageEventCallback {
   data: {
@@ -2,7 +2,14 @@
 /// <reference lib="esnext" />
 /// <reference lib="webworker" />
 
-import type { FFmpegCoreModule, FFmpegCoreModuleFactory } from "@ffmpeg/types";
+import type {
+  FFmpegCoreModule,
+  FFmpegCoreModuleFactory,
+  FrameReader,
+  FrameWriter,
+  SampleReader,
+  Session,
+} from "@ffmpeg/types";
 import type {
   FFMessageEvent,
   FFMessageLoadConfig,
@@ -16,6 +23,28 @@ import type {
   FFMessageDeleteDirData,
   FFMessageMountData,
   FFMessageUnmountData,
+  FFMessageLadderData,
+  FFMessageThumbnailsData,
+  FFMessageCutData,
+  FFMessageProbeData,
+  ProbeResult,
+  FFMessagePeaksData,
+  FFMessageIndexData,
+  FFMessageFramesOpenData,
+  FFMessageFramesData,
+  FrameReaderInfo,
+  FrameBatchData,
+  FFMessageFrameWriterOpenData,
+  FFMessageFrameWriteData,
+  FrameWriterInfo,
+  FFMessageSamplesOpenData,
+  SampleReaderInfo,
+  SampleChunkData,
+  FFMessageSessionOpenData,
+  FFMessageSessionFrameData,
+  FFMessageSessionAudioData,
+  SessionInfo,
+  SessionFrameData,
   CallbackData,
   IsFirst,
   OK,
@@ -28,7 +57,21 @@ import {
   ERROR_UNKNOWN_MESSAGE_TYPE,
   ERROR_NOT_LOADED,
   ERROR_IMPORT_FAILURE,
+  ERROR_PROBE_FAILURE,
+  ERROR_PEAKS_FAILURE,
+  ERROR_INDEX_FAILURE,
+  ERROR_FRAMES_OPEN_FAILURE,
+  ERROR_FRAMES_READ_FAILURE,
+  ERROR_FRAME_WRITER_OPEN_FAILURE,
+  ERROR_FRAME_WRITE_FAILURE,
+  ERROR_SAMPLES_OPEN_FAILURE,
+  ERROR_SAMPLES_READ_FAILURE,
+  ERROR_SESSION_OPEN_FAILURE,
+  ERROR_SESSION_READ_FAILURE,
 } from "./errors.js";
+import { getLadderArgs, getSegment } from "./ladder.js";
+import { getPeaksArgs } from "./peaks.js";
+import { getIndexArgs } from "./keyframes.js";
 
 declare global {
   interface WorkerGlobalScope {
@@ -41,11 +84,23 @@ interface ImportedFFmpegCoreModuleFactory {
 }
 
 let ffmpeg: FFmpegCoreModule;
+const frameReaders: Record<number, FrameReader> = {};
+let frameReaderID = 0;
+const frameWriters: Record<number, FrameWriter> = {};
+let frameWriterID = 0;
+const sampleReaders: Record<number, SampleReader> = {};
+let sampleReaderID = 0;
+const sessions: Record<number, Session> = {};
+let sessionID = 0;
 
 const load = async ({
   coreURL: _coreURL,
   wasmURL: _wasmURL,
   workerURL: _workerURL,
+  initialThreads,
+  maxThreads,
+  initialMemory,
+  maxMemory,
 }: FFMessageLoadConfig): Promise<IsFirst> => {
   const first = !ffmpeg;
 
@@ -79,6 +134,10 @@ const load = async ({
     mainScriptUrlOrBlob: `${coreURL}#${btoa(
       JSON.stringify({ wasmURL, workerURL })
     )}`,
+    pthreadPoolSize: initialThreads,
+    pthreadPoolMax: maxThreads,
+    INITIAL_MEMORY: initialMemory,
+    memoryLimit: maxMemory,
   });
   ffmpeg.setLogger((data) =>
     self.postMessage({ type: FFMessageType.LOG, data })
@@ -89,6 +148,12 @@ const load = async ({
       data,
     })
   );
+  ffmpeg.setMemory((data) =>
+    self.postMessage({
+      type: FFMessageType.MEMORY,
+      data,
+    })
+  );
   return first;
 };
 
@@ -100,6 +165,276 @@ const exec = ({ args, timeout = -1 }: FFMessageExecData): ExitCode => {
   return ret;
 };
 
+const clearProbeCache = (): OK => {
+  ffmpeg.clearProbeCache();
+  return true;
+};
+
+const ladder = (data: FFMessageLadderData): ExitCode => {
+  const { outputDir, rungs, format = "hls", timeout = -1 } = data;
+  const args = getLadderArgs(data);
+  const cwd = ffmpeg.FS.cwd();
+  const dir = (
+    outputDir.startsWith("/") ? outputDir : `${cwd === "/" ? "" : cwd}/${outputDir}`
+  ).replace(/\/+$/, "");
+
+  ffmpeg.FS.mkdirTree(dir);
+  if (format === "hls") {
+    for (const { name } of rungs) ffmpeg.FS.mkdirTree(`${dir}/${name}`);
+  }
+  ffmpeg.setFileWritten(({ path, size }) => {
+    const segment = getSegment(data, dir, path, size);
+    if (segment) self.postMessage({ type: FFMessageType.SEGMENT, data: segment });
+  });
+  ffmpeg.setTimeout(timeout);
+  ffmpeg.exec(...args);
+  const ret = ffmpeg.ret;
+  ffmpeg.reset();
+  ffmpeg.setFileWritten(() => {});
+  return ret;
+};
+
+const thumbnails = ({
+  input,
+  times,
+  output,
+  width,
+  height,
+  quality,
+  sprite,
+}: FFMessageThumbnailsData): ExitCode => {
+  const args = ["-i", input, "-t", times.join(",")];
+  if (width) args.push("-w", `${width}`);
+  if (height) args.push("-h", `${height}`);
+  if (quality !== undefined) args.push("-q", `${quality}`);
+  if (sprite) {
+    args.push("-sprite", `${sprite.columns}`);
+    if (sprite.vtt) args.push("-vtt", sprite.vtt);
+  }
+  args.push(output);
+
+  ffmpeg.thumbnails(...args);
+  const ret = ffmpeg.ret;
+  ffmpeg.reset();
+  return ret;
+};
+
+const cut = ({
+  input,
+  output,
+  start,
+  end,
+  audio = true,
+}: FFMessageCutData): ExitCode => {
+  const args = [];
+  if (start !== undefined) args.push("-ss", `${start}`);
+  if (end !== undefined) args.push("-to", `${end}`);
+  args.push("-i", input);
+  if (!audio) args.push("-an");
+  args.push(output);
+
+  ffmpeg.cut(...args);
+  const ret = ffmpeg.ret;
+  ffmpeg.reset();
+  return ret;
+};
+
+const probe = ({
+  input,
+  fast = false,
+  args = [],
+}: FFMessageProbeData): ProbeResult => {
+  const _args = ["-v", "error", "-of", "json", "-show_format", "-show_streams"];
+  if (fast) _args.push("-fast");
+  ffmpeg.ffprobe(..._args, ...args, input);
+  const ret = ffmpeg.ret;
+  const output = ffmpeg.probeOutput;
+  ffmpeg.reset();
+  if (ret !== 0) throw ERROR_PROBE_FAILURE;
+  return JSON.parse(output) as ProbeResult;
+};
+
+const peaks = (data: FFMessagePeaksData): Uint8Array => {
+  ffmpeg.peaks(...getPeaksArgs(data));
+  const ret = ffmpeg.ret;
+  const output = ffmpeg.peaksOutput;
+  ffmpeg.reset();
+  if (ret !== 0) throw ERROR_PEAKS_FAILURE;
+  return (data.output ? ffmpeg.FS.readFile(data.output) : output) as Uint8Array;
+};
+
+const index = (data: FFMessageIndexData): string => {
+  const args = getIndexArgs(data);
+  ffmpeg.index(...args);
+  const ret = ffmpeg.ret;
+  ffmpeg.reset();
+  if (ret !== 0) throw ERROR_INDEX_FAILURE;
+  return ffmpeg.FS.readFile(args[args.length - 1], {
+    encoding: "utf8",
+  }) as string;
+};
+
+const framesOpen = ({
+  input,
+  width,
+  height,
+  pixelFormat = "rgba",
+  batch = 8,
+}: FFMessageFramesOpenData): FrameReaderInfo => {
+  const reader = ffmpeg.openFrames(input, { width, height, pixelFormat, batch });
+  if (!reader) throw ERROR_FRAMES_OPEN_FAILURE;
+  const id = frameReaderID++;
+  frameReaders[id] = reader;
+  return {
+    id,
+    width: reader.width,
+    height: reader.height,
+    pixelFormat,
+    frameSize: reader.frameSize,
+  };
+};
+
+const framesRead = ({ id }: FFMessageFramesData): FrameBatchData => {
+  const { count, data, times } = frameReaders[id].read();
+  if (count < 0) throw ERROR_FRAMES_READ_FAILURE;
+  // copied out of wasm memory, so the buffer can be transferred
+  return { count, data: data.slice(), times: times.slice() };
+};
+
+const framesClose = ({ id }: FFMessageFramesData): OK => {
+  frameReaders[id]?.close();
+  delete frameReaders[id];
+  return true;
+};
+
+const frameWriterOpen = ({
+  output,
+  width,
+  height,
+  pixelFormat = "rgba",
+  frameRate = 30,
+  args = [],
+}: FFMessageFrameWriterOpenData): FrameWriterInfo => {
+  const writer = ffmpeg.openFrameWriter(output, {
+    width,
+    height,
+    pixelFormat,
+    frameRate,
+    args,
+  });
+  if (!writer) throw ERROR_FRAME_WRITER_OPEN_FAILURE;
+  const id = frameWriterID++;
+  frameWriters[id] = writer;
+  return { id, frameSize: writer.frameSize };
+};
+
+const frameWriterWrite = ({ id, data, time }: FFMessageFrameWriteData): OK => {
+  if (frameWriters[id].write(data, time) < 0) throw ERROR_FRAME_WRITE_FAILURE;
+  return true;
+};
+
+const frameWriterClose = ({ id }: FFMessageFramesData): OK => {
+  const writer = frameWriters[id];
+  delete frameWriters[id];
+  if (writer && writer.close() < 0) throw ERROR_FRAME_WRITE_FAILURE;
+  return true;
+};
+
+const samplesOpen = ({
+  input,
+  sampleRate,
+  channels,
+  planar = false,
+  chunk = 16384,
+}: FFMessageSamplesOpenData): SampleReaderInfo => {
+  const reader = ffmpeg.openSamples(input, {
+    sampleRate,
+    channels,
+    planar,
+    chunk,
+  });
+  if (!reader) throw ERROR_SAMPLES_OPEN_FAILURE;
+  const id = sampleReaderID++;
+  sampleReaders[id] = reader;
+  return { id, sampleRate: reader.sampleRate, channels: reader.channels };
+};
+
+const samplesRead = ({ id }: FFMessageFramesData): SampleChunkData => {
+  const reader = sampleReaders[id];
+  const { count, time, data } = reader.read();
+  if (count < 0) throw ERROR_SAMPLES_READ_FAILURE;
+  if (!reader.planar) return { count, time, data: data.slice() };
+  // copied out of wasm memory, planes are packed to count samples
+  const planes = new Float32Array(count * reader.channels);
+  for (let i = 0; i < reader.channels; i++) {
+    const plane = data.subarray(i * reader.chunk, i * reader.chunk + count);
+    planes.set(plane, i * count);
+  }
+  return { count, time, data: planes };
+};
+
+const samplesClose = ({ id }: FFMessageFramesData): OK => {
+  sampleReaders[id]?.close();
+  delete sampleReaders[id];
+  return true;
+};
+
+const sessionOpen = ({
+  input,
+  width,
+  height,
+  pixelFormat = "rgba",
+  sampleRate,
+  channels,
+}: FFMessageSessionOpenData): SessionInfo => {
+  const session = ffmpeg.openSession(input, {
+    width,
+    height,
+    pixelFormat,
+    sampleRate,
+    channels,
+  });
+  if (!session) throw ERROR_SESSION_OPEN_FAILURE;
+  const id = sessionID++;
+  sessions[id] = session;
+  return {
+    id,
+    width: session.width,
+    height: session.height,
+    pixelFormat,
+    frameSize: session.frameSize,
+    sampleRate: session.sampleRate,
+    channels: session.channels,
+    duration: session.duration,
+  };
+};
+
+const sessionFrame = ({
+  id,
+  time,
+}: FFMessageSessionFrameData): SessionFrameData => {
+  const frame = sessions[id].frame(time);
+  if (frame.ret < 0) throw ERROR_SESSION_READ_FAILURE;
+  // copied out of wasm memory, so the buffer can be transferred
+  return { time: frame.time, data: frame.data.slice() };
+};
+
+const sessionAudio = ({
+  id,
+  start,
+  duration,
+}: FFMessageSessionAudioData): SampleChunkData => {
+  const { count, time, data } = sessions[id].audio(start, duration);
+  if (count < 0) throw ERROR_SESSION_READ_FAILURE;
+  return { count, time, data: data.slice() };
+};
+
+const sessionClose = ({ id }: FFMessageFramesData): OK => {
+  sessions[id]?.close();
+  delete sessions[id];
+  return true;
+};
+
 const writeFile = ({ path, data }: FFMessageWriteFileData): OK => {
   ffmpeg.FS.writeFile(path, data);
   return true;
@@ -170,6 +505,81 @@ self.onmessage = async ({
       case FFMessageType.EXEC:
         data = exec(_data as FFMessageExecData);
         break;
+      case FFMessageType.CLEAR_PROBE_CACHE:
+        data = clearProbeCache();
+        break;
+      case FFMessageType.LADDER:
+        data = ladder(_data as FFMessageLadderData);
+        break;
+      case FFMessageType.THUMBNAILS:
+        data = thumbnails(_data as FFMessageThumbnailsData);
+        break;
+      case FFMessageType.CUT:
+        data = cut(_data as FFMessageCutData);
+        break;
+      case FFMessageType.PROBE:
+        data = probe(_data as FFMessageProbeData);
+        break;
+      case FFMessageType.INDEX:
+        data = index(_data as FFMessageIndexData);
+        break;
+      case FFMessageType.PEAKS: {
+        const pyramid = peaks(_data as FFMessagePeaksData);
+        trans.push(pyramid.buffer);
+        data = pyramid;
+        break;
+      }
+      case FFMessageType.FRAMES_OPEN:
+        data = framesOpen(_data as FFMessageFramesOpenData);
+        break;
+      case FFMessageType.FRAMES_READ: {
+        const batch = framesRead(_data as FFMessageFramesData);
+        trans.push(batch.data.buffer, batch.times.buffer);
+        data = batch;
+        break;
+      }
+      case FFMessageType.FRAMES_CLOSE:
+        data = framesClose(_data as FFMessageFramesData);
+        break;
+      case FFMessageType.FRAME_WRITER_OPEN:
+        data = frameWriterOpen(_data as FFMessageFrameWriterOpenData);
+        break;
+      case FFMessageType.FRAME_WRITER_WRITE:
+        data = frameWriterWrite(_data as FFMessageFrameWriteData);
+        break;
+      case FFMessageType.FRAME_WRITER_CLOSE:
+        data = frameWriterClose(_data as FFMessageFramesData);
+        break;
+      case FFMessageType.SAMPLES_OPEN:
+        data = samplesOpen(_data as FFMessageSamplesOpenData);
+        break;
+      case FFMessageType.SAMPLES_READ: {
+        const chunk = samplesRead(_data as FFMessageFramesData);
+        trans.push(chunk.data.buffer);
+        data = chunk;
+        break;
+      }
+      case FFMessageType.SAMPLES_CLOSE:
+        data = samplesClose(_data as FFMessageFramesData);
+        break;
+      case FFMessageType.SESSION_OPEN:
+        data = sessionOpen(_data as FFMessageSessionOpenData);
+        break;
+      case FFMessageType.SESSION_FRAME: {
+        const frame = sessionFrame(_data as FFMessageSessionFrameData);
+        trans.push(frame.data.buffer);
+        data = frame;
+        break;
+      }
+      case FFMessageType.SESSION_AUDIO: {
+        const chunk = sessionAudio(_data as FFMessageSessionAudioData);
+        trans.push(chunk.data.buffer);
+        data = chunk;
+        break;
+      }
+      case FFMessageType.SESSION_CLOSE:
+        data = sessionClose(_data as FFMessageFramesData);
+        break;
       case FFMessageType.WRITE_FILE:
         data = writeFile(_data as FFMessageWriteFileData);
         break;
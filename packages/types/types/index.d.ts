@@ -64,6 +64,9 @@ export type FSFilesystem =
  */
 export interface FS {
   mkdir: (path: string) => void;
+  /** creates parent directories as needed, like `mkdir -p` */
+  mkdirTree: (path: string) => void;
+  cwd: () => string;
   rmdir: (path: string) => void;
   rename: (oldPath: string, newPath: string) => void;
   writeFile: (path: string, data: Uint8Array | string) => void;
@@ -99,6 +102,204 @@ export interface Progress {
   time: number;
 }
 
+/**
+ * Arguments passed to setMemory callback function.
+ */
+export interface Memory {
+  /** size of wasm memory in bytes */
+  heapSize: number;
+  /** bytes allocated by ffmpeg */
+  inUse: number;
+  /** highest inUse observed in current exec */
+  peakInUse: number;
+  /** bytes held by the allocator but free */
+  freeBytes: number;
+  /** ratio of free bytes to all bytes held by the allocator, 0 to 1 */
+  fragmentation: number;
+  /** number of malloc / calloc / posix_memalign calls in current exec */
+  allocs: number;
+  /** number of realloc calls in current exec */
+  reallocs: number;
+  /** number of free calls in current exec */
+  frees: number;
+}
+
+/**
+ * Arguments passed to setFileWritten callback function.
+ */
+export interface FileWritten {
+  /** path of the file ffmpeg closed after writing it */
+  path: string;
+  /** size of the file in bytes */
+  size: number;
+}
+
+/**
+ * Options of openFrames().
+ */
+export interface FrameReaderOptions {
+  /** width of frames, computed from height when <= 0, default: decoded width */
+  width?: number;
+  /** height of frames, computed from width when <= 0, default: decoded height */
+  height?: number;
+  /** pixel format name of frames, default: rgba */
+  pixelFormat?: string;
+  /** maximum number of frames decoded by read(), default: 1 */
+  batch?: number;
+}
+
+/**
+ * Frames decoded by FrameReader.read().
+ */
+export interface FrameBatch {
+  /** number of frames, 0 at the end of the input, < 0 on error */
+  count: number;
+  /** frames packed one after another, frameSize bytes each */
+  data: Uint8Array;
+  /** time of every frame in seconds */
+  times: Float64Array;
+}
+
+/**
+ * Decoded frames of a video, returned by openFrames().
+ */
+export interface FrameReader {
+  width: number;
+  height: number;
+  pixelFormat: string;
+  /** bytes of a frame in data */
+  frameSize: number;
+  /** decode the next frames, views are valid until the next read() */
+  read: () => FrameBatch;
+  /** seek to time in seconds, returns < 0 on error */
+  seek: (time: number) => number;
+  close: () => void;
+}
+
+/**
+ * Options of openFrameWriter().
+ */
+export interface FrameWriterOptions {
+  /** width of written frames */
+  width: number;
+  /** height of written frames */
+  height: number;
+  /** pixel format name of written frames, default: rgba */
+  pixelFormat?: string;
+  /** frames per second, default: 30 */
+  frameRate?: number;
+  /** ffmpeg output args, ex: ["-c:v", "libx264", "-pix_fmt", "yuv420p"] */
+  args?: string[];
+}
+
+/**
+ * Encoder fed with frames from JS, returned by openFrameWriter().
+ */
+export interface FrameWriter {
+  /** bytes of a frame given to write() */
+  frameSize: number;
+  /**
+   * encode a frame at time in seconds, default: the frame after the previous
+   * one, returns < 0 on error
+   */
+  write: (data: Uint8Array, time?: number) => number;
+  /** flush the encoder and finish the file, returns < 0 on error */
+  close: () => number;
+}
+
+/**
+ * Options of openSamples().
+ */
+export interface SampleReaderOptions {
+  /** sample rate of samples, default: decoded sample rate */
+  sampleRate?: number;
+  /** number of channels, mixed down or up, default: decoded channels */
+  channels?: number;
+  /** one plane per channel instead of interleaved samples, default: false */
+  planar?: boolean;
+  /** samples per channel of a chunk, default: 16384 */
+  chunk?: number;
+}
+
+/**
+ * Samples decoded by SampleReader.read().
+ */
+export interface SampleChunk {
+  /** samples per channel, 0 at the end of the input, < 0 on error */
+  count: number;
+  /** time of the first sample in seconds */
+  time: number;
+  /**
+   * interleaved samples, or planes of chunk samples per channel when
+   * planar, only the first count samples of a plane are set
+   */
+  data: Float32Array;
+}
+
+/**
+ * Decoded audio of a media file, returned by openSamples().
+ */
+export interface SampleReader {
+  sampleRate: number;
+  channels: number;
+  planar: boolean;
+  chunk: number;
+  /** decode the next chunk, data is valid until the next read() */
+  read: () => SampleChunk;
+  close: () => void;
+}
+
+/**
+ * Options of openSession().
+ */
+export interface SessionOptions {
+  /** width of frames, computed from height when <= 0, default: decoded width */
+  width?: number;
+  /** height of frames, computed from width when <= 0, default: decoded height */
+  height?: number;
+  /** pixel format name of frames, default: rgba */
+  pixelFormat?: string;
+  /** sample rate of audio, default: decoded sample rate */
+  sampleRate?: number;
+  /** number of channels of audio, default: decoded channels */
+  channels?: number;
+}
+
+/**
+ * Frame returned by Session.frame().
+ */
+export interface SessionFrame {
+  /** frameSize, 0 without video frame, < 0 on error */
+  ret: number;
+  /** time of the frame in seconds */
+  time: number;
+  data: Uint8Array;
+}
+
+/**
+ * An input kept open between requests, returned by openSession(). Inputs
+ * without video have a frameSize of 0, inputs without audio 0 channels.
+ */
+export interface Session {
+  width: number;
+  height: number;
+  pixelFormat: string;
+  /** bytes of a frame */
+  frameSize: number;
+  sampleRate: number;
+  channels: number;
+  /** duration of the input in seconds, NaN when unknown */
+  duration: number;
+  /** the frame shown at time in seconds, data is valid until the next frame() */
+  frame: (time: number) => SessionFrame;
+  /**
+   * interleaved samples of duration seconds from start, data is valid until
+   * the next audio()
+   */
+  audio: (start: number, duration: number) => SampleChunk;
+  close: () => void;
+}
+
 /**
  * FFmpeg core module, an object to interact with ffmpeg.
  */
@@ -108,17 +309,62 @@ export interface FFmpegCoreModule {
   FS: FS;
   NULL: Pointer;
   SIZE_I32: number;
+  /** size of a pointer, 8 in wasm64 version */
+  SIZE_PTR: number;
 
   /** return code of the ffmpeg exec, error when ret != 0 */
   ret: number;
+  /** output of the last ffprobe() */
+  probeOutput: string;
+  /** pyramid of the last peaks() without output path */
+  peaksOutput: Uint8Array | null;
   timeout: number;
   mainScriptUrlOrBlob: string;
+  /** number of pthread workers spawned on load, multithread version only */
+  pthreadPoolSize: number;
+  /** maximum number of pthread workers, multithread version only */
+  pthreadPoolMax: number;
+  /** initial memory size in bytes, multithread version only */
+  INITIAL_MEMORY: number;
+  /** bytes ffmpeg can allocate in an exec() before it is stopped, -1 means no limit */
+  memoryLimit: number;
 
   exec: (...args: string[]) => number;
+  /** workers in the pthread pool, multithread version only */
+  getThreadPoolSize: () => number;
+  /** drop the stream info cached by exec() with -probe_cache */
+  clearProbeCache: () => void;
+  /** extract thumbnails, see src/fftools/ffthumb.c for args */
+  thumbnails: (...args: string[]) => number;
+  /** frame accurate smart cut, see src/fftools/ffcut.c for args */
+  cut: (...args: string[]) => number;
+  /** keyframe index sidecar, see src/fftools/ffindex.c for args */
+  index: (...args: string[]) => number;
+  /** waveform peak pyramid, see src/fftools/ffpeaks.c for args */
+  peaks: (...args: string[]) => number;
+  /** run ffprobe, its output is kept in probeOutput */
+  ffprobe: (...args: string[]) => number;
+  /** read decoded frames of a video, null on error */
+  openFrames: (path: string, options?: FrameReaderOptions) => FrameReader | null;
+  /** encode frames written from JS into path, null on error */
+  openFrameWriter: (
+    path: string,
+    options: FrameWriterOptions
+  ) => FrameWriter | null;
+  /** read decoded audio as float samples, null on error */
+  openSamples: (
+    path: string,
+    options?: SampleReaderOptions
+  ) => SampleReader | null;
+  /** keep an input open for frame and audio requests, null on error */
+  openSession: (path: string, options?: SessionOptions) => Session | null;
   reset: () => void;
   setLogger: (logger: (log: Log) => void) => void;
   setTimeout: (timeout: number) => void;
   setProgress: (handler: (progress: Progress) => void) => void;
+  setMemory: (handler: (memory: Memory) => void) => void;
+  /** called every time ffmpeg closes a file it wrote, ex: hls segments */
+  setFileWritten: (handler: (file: FileWritten) => void) => void;
 
   locateFile: (path: string, prefix: string) => string;
 }
@@ -0,0 +1,473 @@
+/**
+ * Benchmark ffmpeg-core with fixed workloads.
+ *
+ * Inputs are generated with lavfi sources inside ffmpeg-core before any case
+ * runs, so no extra asset is required and only the measured step of each case
+ * is timed. Results are printed in the same table format used in
+ * apps/website/docs/performance.md.
+ *
+ * Peak memory and allocation counts of the last run are reported by
+ * ffmpeg-core at the end of every exec, use them with --label to compare
+ * cores built with different FFMPEG_MALLOC backends.
+ *
+ * Usage:
+ *   node scripts/benchmark.js [--core=st|mt|mt64] [--label=name] [--runs=5] [group ...]
+ *
+ * ex:
+ *   node scripts/benchmark.js --core=mt swscale
+ *   node --experimental-wasm-memory64 scripts/benchmark.js --core=mt64 transcode
+ *   make prd-mt FFMPEG_MALLOC=mimalloc && \
+ *     node scripts/benchmark.js --core=mt --label=mt-mimalloc transcode
+ */
+const { performance } = require("perf_hooks");
+
+const CORES = {
+  st: "../packages/core",
+  mt: "../packages/core-mt",
+  mt64: "../packages/core-mt64",
+};
+
+const LAVFI_1080P = "testsrc2=size=1920x1080:rate=25";
+
+/**
+ * Inputs shared by benchmark cases, key is the file name in ffmpeg-core FS
+ * and value is the args to generate it.
+ */
+const INPUTS = {
+  "yuv420p-1080p.nut": [
+    "-f", "lavfi", "-i", LAVFI_1080P,
+    "-frames:v", "25", "-c:v", "rawvideo", "-pix_fmt", "yuv420p",
+  ],
+  "rgb24-1080p.nut": [
+    "-f", "lavfi", "-i", LAVFI_1080P,
+    "-frames:v", "25", "-c:v", "rawvideo", "-pix_fmt", "rgb24",
+  ],
+  "yuv420p10le-pq-1080p.nut": [
+    "-f", "lavfi", "-i", LAVFI_1080P,
+    "-frames:v", "25", "-c:v", "rawvideo", "-pix_fmt", "yuv420p10le",
+  ],
+  "pcm-48k-stereo.wav": [
+    "-f", "lavfi", "-i", "sine=frequency=440:sample_rate=48000:duration=60",
+    "-ac", "2",
+  ],
+  "h264-1080p.mp4": [
+    "-f", "lavfi", "-i", LAVFI_1080P,
+    "-frames:v", "50", "-c:v", "libx264", "-preset", "veryfast",
+  ],
+  "h264-1080p-10s.mp4": [
+    "-f", "lavfi", "-i", LAVFI_1080P,
+    "-frames:v", "250", "-c:v", "libx264", "-preset", "ultrafast", "-g", "25",
+  ],
+  "hevc-1080p.mp4": [
+    "-f", "lavfi", "-i", LAVFI_1080P,
+    "-frames:v", "50", "-c:v", "libx265", "-preset", "ultrafast",
+  ],
+  "vp9-1080p.webm": [
+    "-f", "lavfi", "-i", LAVFI_1080P,
+    "-frames:v", "50", "-c:v", "libvpx-vp9", "-deadline", "realtime",
+    "-cpu-used", "8",
+  ],
+};
+
+/**
+ * Filter heavy jobs, each one runs with 1, 2, 4 and 8 filtergraph slice
+ * threads to measure the scaling of libavfilter threading. ownThreads are the
+ * other threads of the job in the MT core (inputs, decoders, branches and
+ * encoder), cases needing more workers than the pthread pool are skipped.
+ */
+const FILTER_THREADS = [1, 2, 4, 8];
+const FILTER_JOBS = [
+  {
+    name: "scale 1920x1080 -> 1280x720 (lanczos)",
+    ownThreads: 3,
+    args: ["-vf", "scale=1280:720:flags=lanczos"],
+  },
+  {
+    name: "yadif 1080p",
+    ownThreads: 3,
+    args: ["-vf", "yadif"],
+  },
+  {
+    name: "colorspace bt601 -> bt709",
+    ownThreads: 3,
+    args: ["-vf", "colorspace=all=bt709:iall=bt601-6-625"],
+  },
+  {
+    name: "overlay 960x540 on 1080p",
+    complex: true,
+    ownThreads: 6,
+    args: [
+      "-i", "yuv420p-1080p.nut",
+      "-filter_complex", "[1:v]scale=960:540[pip];[0:v][pip]overlay=W/4:H/4",
+    ],
+  },
+  {
+    name: "hstack of two 1080p -> 960x540 scales",
+    complex: true,
+    ownThreads: 7,
+    args: [
+      "-i", "yuv420p-1080p.nut",
+      "-filter_complex",
+      "[0:v]scale=960:540[l];[1:v]scale=960:540[r];[l][r]hstack",
+    ],
+  },
+];
+
+/**
+ * Benchmark cases, every case discards the output with the null muxer, so the
+ * time is dominated by the kernel under test.
+ */
+const CASES = [
+  {
+    group: "thumbnail",
+    name: "10 thumbnails of h264 1080p (ffthumb)",
+    tool: "thumbnails",
+    args: [
+      "-i", "h264-1080p-10s.mp4", "-t", "0,1,2,3,4,5,6,7,8,9",
+      "thumb_%d.jpg",
+    ],
+  },
+  {
+    group: "thumbnail",
+    name: "10 thumbnails of h264 1080p (ffmpeg fps filter)",
+    args: [
+      "-i", "h264-1080p-10s.mp4", "-vf", "fps=1,scale=160:-2",
+      "thumb_%d.jpg",
+    ],
+  },
+  {
+    group: "thumbnail",
+    name: "10 thumbnails of h264 1080p in a sprite sheet (ffthumb)",
+    tool: "thumbnails",
+    args: [
+      "-i", "h264-1080p-10s.mp4", "-t", "0,1,2,3,4,5,6,7,8,9",
+      "-sprite", "5", "-vtt", "sprite.vtt", "sprite.jpg",
+    ],
+  },
+  {
+    group: "cut",
+    name: "cut 2.3s - 7.7s of h264 1080p (ffcut)",
+    tool: "cut",
+    args: ["-ss", "2.3", "-to", "7.7", "-i", "h264-1080p-10s.mp4", "cut.mp4"],
+  },
+  {
+    group: "cut",
+    name: "cut 2.3s - 7.7s of h264 1080p (ffmpeg re-encode)",
+    args: [
+      "-ss", "2.3", "-to", "7.7", "-i", "h264-1080p-10s.mp4",
+      "-c:v", "libx264", "cut.mp4",
+    ],
+  },
+  {
+    group: "swscale",
+    name: "hscale 1920x1080 -> 1280x1080 (bicubic)",
+    args: ["-i", "yuv420p-1080p.nut", "-vf", "scale=1280:1080", "-f", "null", "-"],
+  },
+  {
+    group: "swscale",
+    name: "vscale 1920x1080 -> 1920x720 (bicubic)",
+    args: ["-i", "yuv420p-1080p.nut", "-vf", "scale=1920:720", "-f", "null", "-"],
+  },
+  {
+    group: "swscale",
+    name: "scale 1920x1080 -> 1280x720 (bilinear)",
+    args: [
+      "-i", "yuv420p-1080p.nut",
+      "-vf", "scale=1280:720:flags=bilinear", "-f", "null", "-",
+    ],
+  },
+  {
+    group: "swscale",
+    name: "yuv2rgb yuv420p -> rgb24",
+    args: ["-i", "yuv420p-1080p.nut", "-vf", "format=rgb24", "-f", "null", "-"],
+  },
+  {
+    group: "swscale",
+    name: "yuv2rgb yuv420p -> rgba",
+    args: ["-i", "yuv420p-1080p.nut", "-vf", "format=rgba", "-f", "null", "-"],
+  },
+  {
+    group: "swscale",
+    name: "yuv2rgb yuv420p -> rgba (C, -cpuflags 0)",
+    args: [
+      "-cpuflags", "0",
+      "-i", "yuv420p-1080p.nut", "-vf", "format=rgba", "-f", "null", "-",
+    ],
+  },
+  {
+    group: "swscale",
+    name: "rgb2yuv rgb24 -> yuv420p",
+    args: ["-i", "rgb24-1080p.nut", "-vf", "format=yuv420p", "-f", "null", "-"],
+  },
+  {
+    group: "decode",
+    name: "h264 1080p decode",
+    args: ["-i", "h264-1080p.mp4", "-f", "null", "-"],
+  },
+  {
+    group: "decode",
+    name: "h264 1080p decode (C, -cpuflags 0)",
+    args: ["-cpuflags", "0", "-i", "h264-1080p.mp4", "-f", "null", "-"],
+  },
+  {
+    group: "decode",
+    name: "hevc 1080p decode",
+    args: ["-i", "hevc-1080p.mp4", "-f", "null", "-"],
+  },
+  {
+    group: "decode",
+    name: "vp9 1080p decode",
+    args: ["-i", "vp9-1080p.webm", "-f", "null", "-"],
+  },
+  {
+    group: "transcode",
+    name: "h264 1080p -> h264 720p (veryfast)",
+    args: [
+      "-i", "h264-1080p.mp4",
+      "-vf", "scale=1280:720", "-c:v", "libx264", "-preset", "veryfast", "output.mp4",
+    ],
+  },
+  {
+    group: "transcode",
+    name: "h264 1080p -> vp8 720p (realtime)",
+    args: [
+      "-i", "h264-1080p.mp4",
+      "-vf", "scale=1280:720", "-c:v", "libvpx", "-deadline", "realtime", "output.webm",
+    ],
+  },
+  {
+    group: "transcode",
+    name: "h264 1080p -> h264 1080p / 720p / 480p ladder (veryfast)",
+    args: [
+      "-i", "h264-1080p.mp4",
+      "-filter_complex", "[0:v]split=3[a][b][c];[b]scale=1280:720[b720];[c]scale=854:480[c480]",
+      "-map", "[a]", "-c:v", "libx264", "-preset", "veryfast", "output-1080p.mp4",
+      "-map", "[b720]", "-c:v", "libx264", "-preset", "veryfast", "output-720p.mp4",
+      "-map", "[c480]", "-c:v", "libx264", "-preset", "veryfast", "output-480p.mp4",
+    ],
+  },
+  {
+    group: "transcode",
+    name: "wav -> mp3 (192k)",
+    args: ["-i", "pcm-48k-stereo.wav", "-c:a", "libmp3lame", "-b:a", "192k", "output.mp3"],
+  },
+  {
+    group: "encode",
+    name: "x264 1080p encode (ultrafast)",
+    args: ["-i", "yuv420p-1080p.nut", "-c:v", "libx264", "-preset", "ultrafast", "-f", "null", "-"],
+  },
+  {
+    group: "encode",
+    name: "x264 1080p encode (veryfast)",
+    args: ["-i", "yuv420p-1080p.nut", "-c:v", "libx264", "-preset", "veryfast", "-f", "null", "-"],
+  },
+  {
+    group: "encode",
+    name: "x264 1080p encode (veryfast, C, -cpuflags 0)",
+    args: [
+      "-cpuflags", "0",
+      "-i", "yuv420p-1080p.nut", "-c:v", "libx264", "-preset", "veryfast", "-f", "null", "-",
+    ],
+  },
+  {
+    group: "encode",
+    name: "x264 1080p encode (medium)",
+    args: ["-i", "yuv420p-1080p.nut", "-c:v", "libx264", "-preset", "medium", "-f", "null", "-"],
+  },
+  {
+    group: "encode",
+    name: "x265 1080p encode (ultrafast)",
+    args: ["-i", "yuv420p-1080p.nut", "-c:v", "libx265", "-preset", "ultrafast", "-f", "null", "-"],
+  },
+  {
+    group: "encode",
+    name: "x265 1080p encode (ultrafast, C, -cpuflags 0)",
+    args: [
+      "-cpuflags", "0",
+      "-i", "yuv420p-1080p.nut", "-c:v", "libx265", "-preset", "ultrafast", "-f", "null", "-",
+    ],
+  },
+  {
+    group: "encode",
+    name: "vp8 1080p encode (realtime, cpu-used 8)",
+    args: [
+      "-i", "yuv420p-1080p.nut",
+      "-c:v", "libvpx", "-deadline", "realtime", "-cpu-used", "8", "-f", "null", "-",
+    ],
+  },
+  {
+    group: "encode",
+    name: "vp8 1080p encode (realtime, cpu-used 8, C, -cpuflags 0)",
+    args: [
+      "-cpuflags", "0", "-i", "yuv420p-1080p.nut",
+      "-c:v", "libvpx", "-deadline", "realtime", "-cpu-used", "8", "-f", "null", "-",
+    ],
+  },
+  {
+    group: "encode",
+    name: "vp9 1080p encode (realtime, cpu-used 8)",
+    args: [
+      "-i", "yuv420p-1080p.nut",
+      "-c:v", "libvpx-vp9", "-deadline", "realtime", "-cpu-used", "8", "-f", "null", "-",
+    ],
+  },
+  {
+    group: "zimg",
+    name: "zscale 1920x1080 -> 1280x720 (spline36)",
+    args: [
+      "-i", "yuv420p-1080p.nut",
+      "-vf", "zscale=w=1280:h=720:f=spline36", "-f", "null", "-",
+    ],
+  },
+  {
+    group: "zimg",
+    name: "zscale 1920x1080 -> 1280x720 (spline36, C, -cpuflags 0)",
+    args: [
+      "-cpuflags", "0", "-i", "yuv420p-1080p.nut",
+      "-vf", "zscale=w=1280:h=720:f=spline36", "-f", "null", "-",
+    ],
+  },
+  {
+    group: "zimg",
+    name: "zscale bt709 -> bt2020 colorspace",
+    args: [
+      "-i", "yuv420p-1080p.nut",
+      "-vf", "zscale=min=bt709:pin=bt709:m=bt2020nc:p=bt2020,format=yuv420p",
+      "-f", "null", "-",
+    ],
+  },
+  {
+    group: "zimg",
+    name: "zscale HDR (PQ) -> SDR tonemap",
+    args: [
+      "-i", "yuv420p10le-pq-1080p.nut",
+      "-vf", [
+        "zscale=tin=smpte2084:min=bt2020nc:pin=bt2020:t=linear:npl=100",
+        "format=gbrpf32le",
+        "zscale=p=bt709",
+        "tonemap=tonemap=hable:desat=0",
+        "zscale=t=bt709:m=bt709:r=tv",
+        "format=yuv420p",
+      ].join(","),
+      "-f", "null", "-",
+    ],
+  },
+  {
+    group: "audio",
+    name: "opus encode 60s 48kHz stereo (128k)",
+    args: ["-i", "pcm-48k-stereo.wav", "-c:a", "libopus", "-b:a", "128k", "-f", "null", "-"],
+  },
+  {
+    group: "audio",
+    name: "mp3 encode 60s 48kHz stereo (192k)",
+    args: ["-i", "pcm-48k-stereo.wav", "-c:a", "libmp3lame", "-b:a", "192k", "-f", "null", "-"],
+  },
+  ...FILTER_JOBS.flatMap(({ name, complex, ownThreads, args }) =>
+    FILTER_THREADS.map((threads) => ({
+      group: "filter",
+      name: `${name} (${threads} threads)`,
+      // the filtergraph thread takes one of the slices
+      workers: ownThreads + threads - 1,
+      args: [
+        complex ? "-filter_complex_threads" : "-filter_threads", `${threads}`,
+        "-i", "yuv420p-1080p.nut",
+        ...args, "-f", "null", "-",
+      ],
+    }))
+  ),
+];
+
+const parseArgs = (argv) => {
+  const opts = { core: "st", runs: 5, groups: [] };
+  for (const arg of argv) {
+    if (arg.startsWith("--")) {
+      const [key, value] = arg.slice(2).split("=");
+      opts[key] = key === "runs" ? parseInt(value, 10) : value;
+    } else {
+      opts.groups.push(arg);
+    }
+  }
+  return opts;
+};
+
+const exec = (core, args, tool = "exec") => {
+  core.reset();
+  const start = performance.now();
+  const ret = core[tool](...args);
+  const elapsed = performance.now() - start;
+  if (ret !== 0) {
+    throw new Error(`${tool} ${args.join(" ")} failed with exit code ${ret}`);
+  }
+  return elapsed;
+};
+
+const fmt = (ms) => `${(ms / 1000).toFixed(2)} sec`;
+
+const fmtBytes = (bytes) => `${(bytes / 1024 / 1024).toFixed(1)} MB`;
+
+const main = async () => {
+  const {
+    core: type,
+    label = `core-${type}`,
+    runs,
+    groups,
+  } = parseArgs(process.argv.slice(2));
+  const cases = CASES.filter(
+    ({ group }) => groups.length === 0 || groups.includes(group)
+  );
+  const createFFmpegCore = require(CORES[type]);
+  // spawn the whole pool on load (clamped to pthreadPoolMax), so that no case
+  // runs on a pool still growing
+  const core = await createFFmpegCore({ pthreadPoolSize: 32 });
+  const logs = [];
+  core.setLogger(({ message }) => logs.push(message));
+  let memory = null;
+  core.setMemory((m) => {
+    memory = m;
+  });
+
+  const inputs = new Set(cases.flatMap(({ args }) => args));
+  for (const [name, args] of Object.entries(INPUTS)) {
+    if (inputs.has(name)) {
+      exec(core, [...args, name]);
+    }
+  }
+
+  console.log(`| case | ${label} avg | max | min | peak mem | allocs |`);
+  console.log("| ---- | --- | --- | --- | --- | --- |");
+  for (const { name, tool, args, workers } of cases) {
+    // explicit thread counts fail with EAGAIN past the pool of the MT core
+    if (type !== "st" && workers > core.pthreadPoolMax) {
+      console.log(
+        `| ${name} | skipped, needs ${workers} of ${core.pthreadPoolMax} workers | - | - | - | - |`
+      );
+      continue;
+    }
+    const times = [];
+    for (let i = 0; i < runs; i++) {
+      logs.length = 0;
+      memory = null;
+      try {
+        times.push(exec(core, args, tool));
+      } catch (e) {
+        console.error(logs.join("\n"));
+        throw e;
+      }
+    }
+    const avg = times.reduce((a, b) => a + b, 0) / times.length;
+    console.log(
+      `| ${name} | ${fmt(avg)} | ${fmt(Math.max(...times))} | ${fmt(
+        Math.min(...times)
+      )} | ${memory ? fmtBytes(memory.peakInUse) : "-"} | ${
+        memory ? memory.allocs : "-"
+      } |`
+    );
+  }
+};
+
+main()
+  .then(() => process.exit(0))
+  .catch((e) => {
+    console.error(e);
+    process.exit(1);
+  });
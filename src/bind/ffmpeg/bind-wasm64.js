@@ -0,0 +1,6 @@
+/**
+ * Pointers are 64-bit in wasm64 (Memory64) version of ffmpeg-core, this file
+ * must be included before bind.js.
+ */
+
+Module["SIZE_PTR"] = BigUint64Array.BYTES_PER_ELEMENT;
@@ -4,10 +4,12 @@
 
 const NULL = 0;
 const SIZE_I32 = Uint32Array.BYTES_PER_ELEMENT;
+const SIZE_PTR = Module["SIZE_PTR"] || SIZE_I32;
 const DEFAULT_ARGS = ["./ffmpeg", "-nostdin", "-y"];
 
 Module["NULL"] = NULL;
 Module["SIZE_I32"] = SIZE_I32;
+Module["SIZE_PTR"] = SIZE_PTR;
 Module["DEFAULT_ARGS"] = DEFAULT_ARGS;
 
 /**
@@ -18,6 +20,25 @@ Module["ret"] = -1;
 Module["timeout"] = -1;
 Module["logger"] = () => {};
 Module["progress"] = () => {};
+Module["memory"] = () => {};
+Module["fileWritten"] = () => {};
+Module["probeOutput"] = "";
+Module["peaksOutput"] = null;
+Module["memoryLimit"] = Module["memoryLimit"] || -1;
+
+/**
+ * Pthread pool size (multithread version only), pthreadPoolSize workers are
+ * spawned when the core is loaded and the pool grows on demand up to
+ * pthreadPoolMax. The default initial size lets a single transcode use every
+ * core next to its input, decoder and encoder threads.
+ */
+Module["pthreadPoolMax"] = Module["pthreadPoolMax"] || getDefaultPoolMax();
+Module["pthreadPoolSize"] = Math.min(
+  Module["pthreadPoolSize"] || getCoreCount() + 4,
+  Module["pthreadPoolMax"]
+);
+Module["pthreadPoolLoading"] = 0;
+Module["pthreadPoolShortfall"] = 0;
 
 /**
  * Functions
@@ -33,14 +54,104 @@ function stringToPtr(str) {
 
 function stringsToPtr(strs) {
   const len = strs.length;
-  const ptr = Module["_malloc"](len * SIZE_I32);
+  const ptr = Module["_malloc"](len * SIZE_PTR);
   for (let i = 0; i < len; i++) {
-    Module["setValue"](ptr + SIZE_I32 * i, stringToPtr(strs[i]), "i32");
+    Module["setValue"](ptr + SIZE_PTR * i, stringToPtr(strs[i]), "*");
   }
 
   return ptr;
 }
 
+// A view on the current wasm memory. When another thread grew the memory,
+// Module["HEAPU8"] and co. still end at the old size until the runtime
+// refreshes them on a later call into JS.
+function heap(View) {
+  return new View(wasmMemory.buffer);
+}
+
+function getCoreCount() {
+  if (typeof navigator !== "undefined" && navigator.hardwareConcurrency) {
+    return navigator.hardwareConcurrency;
+  } else if (typeof require === "function") {
+    return require("os").cpus().length;
+  }
+  return 4;
+}
+
+function getDefaultPoolMax() {
+  return Math.min(getCoreCount() * 2, 32);
+}
+
+function getThreadPoolSize() {
+  if (typeof PThread === "undefined") return 0;
+  return (
+    PThread.unusedWorkers.length +
+    PThread.runningWorkers.length +
+    Module["pthreadPoolLoading"]
+  );
+}
+
+/**
+ * pthread_create() fails with EAGAIN when no worker is left, see
+ * PTHREAD_POOL_SIZE_STRICT in build/ffmpeg-wasm.sh. PThread.getNewWorker() is
+ * wrapped on the first exec() to count those threads, as PThread is not
+ * defined yet when this file runs.
+ */
+function watchThreadPool() {
+  if (typeof PThread === "undefined" || PThread.getNewWorker.watched) return;
+  const getNewWorker = PThread.getNewWorker;
+  PThread.getNewWorker = () => {
+    const worker = getNewWorker();
+    if (!worker) Module["pthreadPoolShortfall"]++;
+    return worker;
+  };
+  PThread.getNewWorker.watched = true;
+}
+
+/**
+ * A worker spawned while ffmpeg is running cannot start before exec() returns
+ * to the event loop, so instead of spawning workers when pthread_create() is
+ * called, the pool grows in between exec() calls by the workers the last
+ * exec() missed, and only loaded workers are handed out.
+ */
+function growThreadPool() {
+  if (typeof PThread === "undefined") return;
+  const size = getThreadPoolSize();
+  const target = Math.min(
+    size + Module["pthreadPoolShortfall"],
+    Module["pthreadPoolMax"]
+  );
+  Module["pthreadPoolShortfall"] = 0;
+  for (let i = size; i < target; i++) {
+    PThread.allocateUnusedWorker();
+    // keep the worker out of the pool until the wasm module is loaded.
+    const worker = PThread.unusedWorkers.pop();
+    Module["pthreadPoolLoading"]++;
+    new Promise((resolve) => {
+      const ret = PThread.loadWasmModuleToWorker(worker, resolve);
+      if (ret && ret.then) ret.then(resolve);
+    }).then(() => {
+      Module["pthreadPoolLoading"]--;
+      PThread.unusedWorkers.push(worker);
+    });
+  }
+}
+
+/**
+ * Number of idle workers ffmpeg sizes its threads with, see
+ * set_thread_budget() in src/fftools/ffmpeg.c. wanted is the number of
+ * threads the job would use, the missing ones count as a shortfall.
+ */
+function getThreadBudget(wanted) {
+  if (typeof PThread === "undefined") return 0;
+  const idle = PThread.unusedWorkers.length;
+  Module["pthreadPoolShortfall"] = Math.max(
+    Module["pthreadPoolShortfall"],
+    wanted - idle
+  );
+  return idle;
+}
+
 function print(message) {
   Module["logger"]({ type: "stdout", message });
 }
@@ -50,18 +161,336 @@ function printErr(message) {
     Module["logger"]({ type: "stderr", message });
 }
 
+/**
+ * Segmenting muxers like hls and dash write every segment to a file of its
+ * own, which is complete once ffmpeg closes it. FS.close() is wrapped on the
+ * first exec() to report files opened for writing, as FS is not defined yet
+ * when this file runs.
+ */
+function watchWrittenFiles() {
+  const FS = Module["FS"];
+  if (FS.close.watched) return;
+  const close = FS.close;
+  FS.close = (stream) => {
+    const { path, flags } = stream;
+    const ret = close(stream);
+    // O_WRONLY or O_RDWR, files unlinked while open are not reported
+    if (flags & 3 && FS.analyzePath(path).exists) {
+      Module["fileWritten"]({ path, size: FS.stat(path).size });
+    }
+    return ret;
+  };
+  FS.close.watched = true;
+}
+
 function exec(..._args) {
   const args = [...Module["DEFAULT_ARGS"], ..._args];
+  watchWrittenFiles();
+  watchThreadPool();
   try {
     Module["_ffmpeg"](args.length, stringsToPtr(args));
   } catch (e) {
     if (!e.message.startsWith("Aborted")) {
       throw e;
     }
+  } finally {
+    growThreadPool();
+  }
+  return Module["ret"];
+}
+
+/**
+ * Drop the stream info cached by exec() with -probe_cache, see
+ * src/fftools/ffmpeg_cache.c. Entries of changed files, or of files probed
+ * with other -probesize, -analyzeduration or -fpsprobesize, are already
+ * dropped when they are used, this frees the memory of all of them.
+ */
+function clearProbeCache() {
+  Module["_probe_cache_clear"]();
+}
+
+/**
+ * Run one of the single purpose tools exported next to ffmpeg, they follow
+ * the same exit convention.
+ */
+function runTool(name, _args) {
+  const args = [`./${name}`, ..._args];
+  watchWrittenFiles();
+  try {
+    Module[`_${name}`](args.length, stringsToPtr(args));
+  } catch (e) {
+    if (!e.message.startsWith("Aborted")) {
+      throw e;
+    }
   }
   return Module["ret"];
 }
 
+/**
+ * Extract thumbnails with ffthumb, see src/fftools/ffthumb.c for its args.
+ */
+function thumbnails(...args) {
+  return runTool("ffthumb", args);
+}
+
+/**
+ * Probe with ffprobe, its output is kept in Module["probeOutput"] instead of
+ * being printed, ex: ffprobe("-of", "json", "-show_streams", "video.mp4").
+ */
+function ffprobe(...args) {
+  Module["probeOutput"] = "";
+  return runTool("ffprobe", ["-hide_banner", ...args]);
+}
+
+function receiveProbeOutput(output) {
+  Module["probeOutput"] = output;
+}
+
+/**
+ * Build a keyframe index sidecar with ffindex, see src/fftools/ffindex.c for
+ * its args and format, exec() uses it with -seek_index.
+ */
+function index(...args) {
+  return runTool("ffindex", args);
+}
+
+/**
+ * Build a waveform peak pyramid with ffpeaks, see src/fftools/ffpeaks.c for
+ * its args and format. Without output path, the pyramid is kept in
+ * Module["peaksOutput"].
+ */
+function peaks(...args) {
+  Module["peaksOutput"] = null;
+  return runTool("ffpeaks", args);
+}
+
+function receivePeaks(data) {
+  Module["peaksOutput"] = data;
+}
+
+/**
+ * Frame accurate smart cut with ffcut, see src/fftools/ffcut.c for its args.
+ */
+function cut(...args) {
+  return runTool("ffcut", args);
+}
+
+/**
+ * Open a video and read its decoded frames without going through FS, see
+ * src/fftools/ffframes.c. Frames of a read() are views on a buffer of wasm
+ * memory reused by the next read(), copy them to keep them.
+ */
+function openFrames(
+  path,
+  { width = 0, height = 0, pixelFormat = "rgba", batch = 1 } = {}
+) {
+  const pathPtr = stringToPtr(path);
+  const pixFmtPtr = stringToPtr(pixelFormat);
+  const reader = Module["_frame_reader_open"](
+    pathPtr,
+    width,
+    height,
+    pixFmtPtr,
+    batch
+  );
+  Module["_free"](pathPtr);
+  Module["_free"](pixFmtPtr);
+  if (!reader) return null;
+
+  const frameSize = Module["_frame_reader_frame_size"](reader);
+  return {
+    width: Module["_frame_reader_width"](reader),
+    height: Module["_frame_reader_height"](reader),
+    pixelFormat,
+    frameSize,
+    read() {
+      const count = Module["_frame_reader_read"](reader);
+      if (count <= 0) {
+        return { count, data: new Uint8Array(0), times: new Float64Array(0) };
+      }
+      // views are taken after decoding, as memory may have grown
+      const data = Number(Module["_frame_reader_data"](reader));
+      const times = Number(Module["_frame_reader_times"](reader)) / 8;
+      return {
+        count,
+        data: heap(Uint8Array).subarray(data, data + count * frameSize),
+        times: heap(Float64Array).subarray(times, times + count),
+      };
+    },
+    seek(time) {
+      return Module["_frame_reader_seek"](reader, time);
+    },
+    close() {
+      Module["_frame_reader_close"](reader);
+    },
+  };
+}
+
+/**
+ * Open an encoder writing path, fed with frames from JS, see
+ * src/fftools/ffframes.c. args are ffmpeg output args, ex:
+ * ["-c:v", "libx264", "-pix_fmt", "yuv420p"]. write() encodes a frame before
+ * returning, time is in seconds and defaults to the frame after the previous
+ * one.
+ */
+function openFrameWriter(
+  path,
+  { width, height, pixelFormat = "rgba", frameRate = 30, args = [] }
+) {
+  const pathPtr = stringToPtr(path);
+  const pixFmtPtr = stringToPtr(pixelFormat);
+  const argsPtr = stringsToPtr(args);
+  const writer = Module["_frame_writer_open"](
+    pathPtr,
+    width,
+    height,
+    pixFmtPtr,
+    frameRate,
+    args.length,
+    argsPtr
+  );
+  Module["_free"](pathPtr);
+  Module["_free"](pixFmtPtr);
+  for (let i = 0; i < args.length; i++) {
+    Module["_free"](Module["getValue"](argsPtr + SIZE_PTR * i, "*"));
+  }
+  Module["_free"](argsPtr);
+  if (!writer) return null;
+
+  const frameSize = Module["_frame_writer_frame_size"](writer);
+  return {
+    frameSize,
+    write(data, time = NaN) {
+      if (data.length !== frameSize) {
+        throw new Error(`frame of ${data.length} bytes, ${frameSize} expected`);
+      }
+      const input = Number(Module["_frame_writer_input"](writer));
+      heap(Uint8Array).set(data, input);
+      return Module["_frame_writer_write"](writer, time);
+    },
+    close() {
+      return Module["_frame_writer_close"](writer);
+    },
+  };
+}
+
+/**
+ * Open a media file and read its audio as float samples without going
+ * through FS, see src/fftools/ffsamples.c. Planar chunks hold one plane of
+ * chunk samples per channel, only the first count samples of each are set.
+ * Chunks of a read() are views on a buffer of wasm memory reused by the next
+ * read(), copy them to keep them.
+ */
+function openSamples(
+  path,
+  { sampleRate = 0, channels = 0, planar = false, chunk = 16384 } = {}
+) {
+  const pathPtr = stringToPtr(path);
+  const reader = Module["_sample_reader_open"](
+    pathPtr,
+    sampleRate,
+    channels,
+    planar ? 1 : 0,
+    chunk
+  );
+  Module["_free"](pathPtr);
+  if (!reader) return null;
+
+  const info = {
+    sampleRate: Module["_sample_reader_sample_rate"](reader),
+    channels: Module["_sample_reader_channels"](reader),
+  };
+  return {
+    ...info,
+    planar,
+    chunk,
+    read() {
+      const count = Module["_sample_reader_read"](reader);
+      if (count <= 0) {
+        return { count, time: NaN, data: new Float32Array(0) };
+      }
+      // the view is taken after decoding, as memory may have grown
+      const data = Number(Module["_sample_reader_data"](reader)) / 4;
+      const length = planar ? chunk * info.channels : count * info.channels;
+      return {
+        count,
+        time: Module["_sample_reader_time"](reader),
+        data: heap(Float32Array).subarray(data, data + length),
+      };
+    },
+    close() {
+      Module["_sample_reader_close"](reader);
+    },
+  };
+}
+
+/**
+ * Open an input kept open between requests for the frame at a time or the
+ * audio of a range, see src/fftools/ffsession.c. Like readers, data of a
+ * request is a view on wasm memory reused by the next request of the same
+ * kind, copy it to keep it.
+ */
+function openSession(
+  path,
+  {
+    width = 0,
+    height = 0,
+    pixelFormat = "rgba",
+    sampleRate = 0,
+    channels = 0,
+  } = {}
+) {
+  const pathPtr = stringToPtr(path);
+  const pixFmtPtr = stringToPtr(pixelFormat);
+  const session = Module["_session_open"](
+    pathPtr,
+    width,
+    height,
+    pixFmtPtr,
+    sampleRate,
+    channels
+  );
+  Module["_free"](pathPtr);
+  Module["_free"](pixFmtPtr);
+  if (!session) return null;
+
+  const info = {
+    width: Module["_session_width"](session),
+    height: Module["_session_height"](session),
+    pixelFormat,
+    frameSize: Module["_session_frame_size"](session),
+    sampleRate: Module["_session_sample_rate"](session),
+    channels: Module["_session_channels"](session),
+    duration: Module["_session_duration"](session),
+  };
+  return {
+    ...info,
+    frame(time) {
+      const size = Module["_session_frame"](session, time);
+      if (size <= 0) return { ret: size, time: NaN, data: new Uint8Array(0) };
+      const data = Number(Module["_session_frame_data"](session));
+      return {
+        ret: size,
+        time: Module["_session_frame_time"](session),
+        data: heap(Uint8Array).subarray(data, data + size),
+      };
+    },
+    audio(start, duration) {
+      const count = Module["_session_audio"](session, start, duration);
+      if (count <= 0) return { count, time: NaN, data: new Float32Array(0) };
+      const data = Number(Module["_session_audio_data"](session)) / 4;
+      return {
+        count,
+        time: Module["_session_audio_time"](session),
+        data: heap(Float32Array).subarray(data, data + count * info.channels),
+      };
+    },
+    close() {
+      Module["_session_close"](session);
+    },
+  };
+}
+
 function setLogger(logger) {
   Module["logger"] = logger;
 }
@@ -78,6 +507,36 @@ function receiveProgress(progress, time) {
   Module["progress"]({ progress, time });
 }
 
+function setMemory(handler) {
+  Module["memory"] = handler;
+}
+
+function receiveMemory(
+  heapSize,
+  inUse,
+  peakInUse,
+  freeBytes,
+  arena,
+  allocs,
+  reallocs,
+  frees
+) {
+  Module["memory"]({
+    heapSize,
+    inUse,
+    peakInUse,
+    freeBytes,
+    fragmentation: arena > 0 ? freeBytes / arena : 0,
+    allocs,
+    reallocs,
+    frees,
+  });
+}
+
+function setFileWritten(handler) {
+  Module["fileWritten"] = handler;
+}
+
 function reset() {
   Module["ret"] = -1;
   Module["timeout"] = -1;
@@ -121,8 +580,25 @@ Module["printErr"] = printErr;
 Module["locateFile"] = _locateFile;
 
 Module["exec"] = exec;
+Module["clearProbeCache"] = clearProbeCache;
+Module["thumbnails"] = thumbnails;
+Module["cut"] = cut;
+Module["peaks"] = peaks;
+Module["index"] = index;
+Module["ffprobe"] = ffprobe;
+Module["openFrames"] = openFrames;
+Module["openFrameWriter"] = openFrameWriter;
+Module["openSamples"] = openSamples;
+Module["openSession"] = openSession;
 Module["setLogger"] = setLogger;
 Module["setTimeout"] = setTimeout;
 Module["setProgress"] = setProgress;
 Module["reset"] = reset;
 Module["receiveProgress"] = receiveProgress;
+Module["setMemory"] = setMemory;
+Module["receiveMemory"] = receiveMemory;
+Module["receiveProbeOutput"] = receiveProbeOutput;
+Module["receivePeaks"] = receivePeaks;
+Module["setFileWritten"] = setFileWritten;
+Module["getThreadBudget"] = getThreadBudget;
+Module["getThreadPoolSize"] = getThreadPoolSize;
@@ -3,6 +3,9 @@ const EXPORTED_RUNTIME_METHODS = [
   "setValue",
   "getValue",
   "UTF8ToString",
+  "HEAPU8",
+  "HEAPF32",
+  "HEAPF64",
   "lengthBytesUTF8",
   "stringToUTF8",
 ];
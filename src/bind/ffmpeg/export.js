@@ -1,3 +1,49 @@
-const EXPORTED_FUNCTIONS = ["_ffmpeg", "_abort", "_malloc"];
+const EXPORTED_FUNCTIONS = [
+  "_ffmpeg",
+  "_ffcut",
+  "_ffindex",
+  "_ffpeaks",
+  "_ffprobe",
+  "_ffthumb",
+  "_frame_reader_open",
+  "_frame_reader_read",
+  "_frame_reader_seek",
+  "_frame_reader_close",
+  "_frame_reader_data",
+  "_frame_reader_times",
+  "_frame_reader_width",
+  "_frame_reader_height",
+  "_frame_reader_frame_size",
+  "_frame_writer_open",
+  "_frame_writer_write",
+  "_frame_writer_close",
+  "_frame_writer_input",
+  "_frame_writer_frame_size",
+  "_sample_reader_open",
+  "_sample_reader_read",
+  "_sample_reader_close",
+  "_sample_reader_data",
+  "_sample_reader_time",
+  "_sample_reader_sample_rate",
+  "_sample_reader_channels",
+  "_session_open",
+  "_session_frame",
+  "_session_audio",
+  "_session_close",
+  "_session_frame_data",
+  "_session_frame_time",
+  "_session_width",
+  "_session_height",
+  "_session_frame_size",
+  "_session_audio_data",
+  "_session_audio_time",
+  "_session_sample_rate",
+  "_session_channels",
+  "_session_duration",
+  "_probe_cache_clear",
+  "_abort",
+  "_malloc",
+  "_free",
+];
 
 console.log(EXPORTED_FUNCTIONS.join(","));
@@ -0,0 +1,729 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * WebAssembly SIMD128 H.264 weighted prediction, loop filters and IDCT of
+ * 8-bit video.
+ *
+ * Every kernel computes the same integers as h264dsp_template.c and
+ * h264idct_template.c, including the int16_t stores between the IDCT
+ * passes, so the output is bit exact. They are selected when the library is
+ * built with -msimd128 and AV_CPU_FLAG_SIMD128 is set.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config.h"
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/wasm/cpu.h"
+#include "libavcodec/h264dsp.h"
+
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+
+/* weighted prediction */
+
+/* block[x] = clip((block[x] * weight + offset) >> log2_denom), 8 pixels */
+static av_always_inline v128_t weight8(v128_t p, v128_t weight, v128_t offset,
+                                       int log2_denom)
+{
+    v128_t lo = wasm_i32x4_add(wasm_i32x4_extmul_low_i16x8(p, weight), offset);
+    v128_t hi = wasm_i32x4_add(wasm_i32x4_extmul_high_i16x8(p, weight), offset);
+    v128_t v  = wasm_i16x8_narrow_i32x4(wasm_i32x4_shr(lo, log2_denom),
+                                        wasm_i32x4_shr(hi, log2_denom));
+
+    return wasm_u8x16_narrow_i16x8(v, v);
+}
+
+static av_always_inline void weight_pixels(uint8_t *block, ptrdiff_t stride,
+                                           int height, int log2_denom,
+                                           int weight, int offset, int w)
+{
+    v128_t vw, vo;
+
+    offset = (unsigned)offset << log2_denom;
+    if (log2_denom)
+        offset += 1 << (log2_denom - 1);
+    vw = wasm_i16x8_splat(weight);
+    vo = wasm_i32x4_splat(offset);
+
+    for (int y = 0; y < height; y++, block += stride) {
+        if (w == 4) {
+            v128_t p = wasm_u16x8_extend_low_u8x16(wasm_v128_load32_zero(block));
+            wasm_v128_store32_lane(block, weight8(p, vw, vo, log2_denom), 0);
+            continue;
+        }
+        for (int x = 0; x < w; x += 8)
+            wasm_v128_store64_lane(block + x,
+                                   weight8(wasm_u16x8_load8x8(block + x), vw, vo,
+                                           log2_denom), 0);
+    }
+}
+
+/* dst[x] = clip((src[x] * weights + dst[x] * weightd + offset) >> (log2_denom + 1)) */
+static av_always_inline v128_t biweight8(v128_t s, v128_t d, v128_t weights,
+                                         v128_t offset, int shift)
+{
+    v128_t lo = wasm_i32x4_dot_i16x8(wasm_i16x8_shuffle(s, d, 0, 8, 1, 9, 2, 10, 3, 11),
+                                     weights);
+    v128_t hi = wasm_i32x4_dot_i16x8(wasm_i16x8_shuffle(s, d, 4, 12, 5, 13, 6, 14, 7, 15),
+                                     weights);
+    v128_t v  = wasm_i16x8_narrow_i32x4(wasm_i32x4_shr(wasm_i32x4_add(lo, offset), shift),
+                                        wasm_i32x4_shr(wasm_i32x4_add(hi, offset), shift));
+
+    return wasm_u8x16_narrow_i16x8(v, v);
+}
+
+static av_always_inline void biweight_pixels(uint8_t *dst, uint8_t *src,
+                                             ptrdiff_t stride, int height,
+                                             int log2_denom, int weightd,
+                                             int weights, int offset, int w)
+{
+    v128_t vw, vo;
+
+    offset = (unsigned)((offset + 1) | 1) << log2_denom;
+    vw = wasm_i32x4_splat((weights & 0xffff) | ((unsigned)weightd << 16));
+    vo = wasm_i32x4_splat(offset);
+
+    for (int y = 0; y < height; y++, dst += stride, src += stride) {
+        if (w == 4) {
+            v128_t s = wasm_u16x8_extend_low_u8x16(wasm_v128_load32_zero(src));
+            v128_t d = wasm_u16x8_extend_low_u8x16(wasm_v128_load32_zero(dst));
+            wasm_v128_store32_lane(dst, biweight8(s, d, vw, vo, log2_denom + 1), 0);
+            continue;
+        }
+        for (int x = 0; x < w; x += 8)
+            wasm_v128_store64_lane(dst + x,
+                                   biweight8(wasm_u16x8_load8x8(src + x),
+                                             wasm_u16x8_load8x8(dst + x),
+                                             vw, vo, log2_denom + 1), 0);
+    }
+}
+
+#define H264_WEIGHT(W)                                                              \
+static void weight_h264_pixels ## W ## _simd128(uint8_t *block, ptrdiff_t stride,  \
+                                                 int height, int log2_denom,        \
+                                                 int weight, int offset)            \
+{                                                                                   \
+    weight_pixels(block, stride, height, log2_denom, weight, offset, W);            \
+}                                                                                   \
+                                                                                    \
+static void biweight_h264_pixels ## W ## _simd128(uint8_t *dst, uint8_t *src,       \
+                                                   ptrdiff_t stride, int height,    \
+                                                   int log2_denom, int weightd,     \
+                                                   int weights, int offset)         \
+{                                                                                   \
+    biweight_pixels(dst, src, stride, height, log2_denom, weightd, weights,        \
+                    offset, W);                                                     \
+}
+
+H264_WEIGHT(16)
+H264_WEIGHT(8)
+H264_WEIGHT(4)
+
+/* loop filters, on int16 lanes of the pixels across the edge */
+
+static av_always_inline v128_t absdiff_lt(v128_t a, v128_t b, v128_t limit)
+{
+    return wasm_i16x8_lt(wasm_i16x8_abs(wasm_i16x8_sub(a, b)), limit);
+}
+
+/* |p0 - q0| < alpha && |p1 - p0| < beta && |q1 - q0| < beta */
+static av_always_inline v128_t filter_mask(v128_t p1, v128_t p0, v128_t q0, v128_t q1,
+                                           v128_t alpha, v128_t beta)
+{
+    return wasm_v128_and(absdiff_lt(p0, q0, alpha),
+                         wasm_v128_and(absdiff_lt(p1, p0, beta),
+                                       absdiff_lt(q1, q0, beta)));
+}
+
+static av_always_inline v128_t clip3(v128_t v, v128_t tc)
+{
+    return wasm_i16x8_min(wasm_i16x8_max(v, wasm_i16x8_neg(tc)), tc);
+}
+
+/* ((q0 - p0) * 4 + (p1 - q1) + 4) >> 3 */
+static av_always_inline v128_t filter_delta(v128_t p1, v128_t p0, v128_t q0, v128_t q1)
+{
+    v128_t d = wasm_i16x8_add(wasm_i16x8_shl(wasm_i16x8_sub(q0, p0), 2),
+                              wasm_i16x8_sub(p1, q1));
+
+    return wasm_i16x8_shr(wasm_i16x8_add(d, wasm_i16x8_splat(4)), 3);
+}
+
+/* h264_loop_filter_luma(), tc is tc0 of each lane, < 0 to skip it */
+static av_always_inline void luma_filter8(v128_t p2, v128_t *p1, v128_t *p0,
+                                          v128_t *q0, v128_t *q1, v128_t q2,
+                                          v128_t alpha, v128_t beta, v128_t tc)
+{
+    v128_t mask = wasm_v128_and(filter_mask(*p1, *p0, *q0, *q1, alpha, beta),
+                                wasm_i16x8_ge(tc, wasm_i16x8_splat(0)));
+    v128_t ap   = wasm_v128_and(absdiff_lt(p2, *p0, beta), mask);
+    v128_t aq   = wasm_v128_and(absdiff_lt(q2, *q0, beta), mask);
+    v128_t avg  = wasm_u16x8_avgr(*p0, *q0);
+    v128_t np1  = wasm_i16x8_add(*p1, clip3(wasm_i16x8_sub(wasm_i16x8_shr(wasm_i16x8_add(p2, avg), 1),
+                                                           *p1), tc));
+    v128_t nq1  = wasm_i16x8_add(*q1, clip3(wasm_i16x8_sub(wasm_i16x8_shr(wasm_i16x8_add(q2, avg), 1),
+                                                           *q1), tc));
+    /* tc + 1 for each side whose p1 / q1 is filtered, ap and aq are -1 */
+    v128_t delta = clip3(filter_delta(*p1, *p0, *q0, *q1),
+                         wasm_i16x8_sub(wasm_i16x8_sub(tc, ap), aq));
+
+    *p0 = wasm_v128_bitselect(wasm_i16x8_add(*p0, delta), *p0, mask);
+    *q0 = wasm_v128_bitselect(wasm_i16x8_sub(*q0, delta), *q0, mask);
+    *p1 = wasm_v128_bitselect(np1, *p1, ap);
+    *q1 = wasm_v128_bitselect(nq1, *q1, aq);
+}
+
+/* h264_loop_filter_luma_intra() */
+static av_always_inline void luma_intra_filter8(v128_t p3, v128_t *p2, v128_t *p1,
+                                                v128_t *p0, v128_t *q0, v128_t *q1,
+                                                v128_t *q2, v128_t q3,
+                                                v128_t alpha, v128_t beta)
+{
+    const v128_t two = wasm_i16x8_splat(2), four = wasm_i16x8_splat(4);
+    v128_t mask   = filter_mask(*p1, *p0, *q0, *q1, alpha, beta);
+    v128_t strong = wasm_v128_and(absdiff_lt(*p0, *q0,
+                                             wasm_i16x8_add(wasm_i16x8_shr(alpha, 2), two)),
+                                  mask);
+    v128_t ap     = wasm_v128_and(absdiff_lt(*p2, *p0, beta), strong);
+    v128_t aq     = wasm_v128_and(absdiff_lt(*q2, *q0, beta), strong);
+    v128_t pq0    = wasm_i16x8_add(*p0, *q0);
+    v128_t sp     = wasm_i16x8_add(wasm_i16x8_add(*p1, pq0), *p2);  /* p2 + p1 + p0 + q0 */
+    v128_t sq     = wasm_i16x8_add(wasm_i16x8_add(*q1, pq0), *q2);  /* q2 + q1 + q0 + p0 */
+    /* ( p2 + 2*p1 + 2*p0 + 2*q0 + q1 + 4 ) >> 3 */
+    v128_t sp0    = wasm_i16x8_shr(wasm_i16x8_add(wasm_i16x8_add(sp, wasm_i16x8_sub(sp, *p2)),
+                                                  wasm_i16x8_add(*q1, four)), 3);
+    v128_t sq0    = wasm_i16x8_shr(wasm_i16x8_add(wasm_i16x8_add(sq, wasm_i16x8_sub(sq, *q2)),
+                                                  wasm_i16x8_add(*p1, four)), 3);
+    v128_t sp1    = wasm_i16x8_shr(wasm_i16x8_add(sp, two), 2);
+    v128_t sq1    = wasm_i16x8_shr(wasm_i16x8_add(sq, two), 2);
+    /* ( 2*p3 + 3*p2 + p1 + p0 + q0 + 4 ) >> 3 */
+    v128_t sp2    = wasm_i16x8_shr(wasm_i16x8_add(wasm_i16x8_add(sp, four),
+                                                  wasm_i16x8_shl(wasm_i16x8_add(p3, *p2), 1)), 3);
+    v128_t sq2    = wasm_i16x8_shr(wasm_i16x8_add(wasm_i16x8_add(sq, four),
+                                                  wasm_i16x8_shl(wasm_i16x8_add(q3, *q2), 1)), 3);
+    /* ( 2*p1 + p0 + q1 + 2 ) >> 2 */
+    v128_t wp0    = wasm_i16x8_shr(wasm_i16x8_add(wasm_i16x8_add(wasm_i16x8_shl(*p1, 1), *p0),
+                                                  wasm_i16x8_add(*q1, two)), 2);
+    v128_t wq0    = wasm_i16x8_shr(wasm_i16x8_add(wasm_i16x8_add(wasm_i16x8_shl(*q1, 1), *q0),
+                                                  wasm_i16x8_add(*p1, two)), 2);
+
+    *p0 = wasm_v128_bitselect(wasm_v128_bitselect(sp0, wp0, ap), *p0, mask);
+    *q0 = wasm_v128_bitselect(wasm_v128_bitselect(sq0, wq0, aq), *q0, mask);
+    *p1 = wasm_v128_bitselect(sp1, *p1, ap);
+    *q1 = wasm_v128_bitselect(sq1, *q1, aq);
+    *p2 = wasm_v128_bitselect(sp2, *p2, ap);
+    *q2 = wasm_v128_bitselect(sq2, *q2, aq);
+}
+
+/* h264_loop_filter_chroma(), tc is tc0 of each lane, <= 0 to skip it */
+static av_always_inline void chroma_filter8(v128_t p1, v128_t *p0, v128_t *q0, v128_t q1,
+                                            v128_t alpha, v128_t beta, v128_t tc)
+{
+    v128_t mask  = wasm_v128_and(filter_mask(p1, *p0, *q0, q1, alpha, beta),
+                                 wasm_i16x8_gt(tc, wasm_i16x8_splat(0)));
+    v128_t delta = clip3(filter_delta(p1, *p0, *q0, q1), tc);
+
+    *p0 = wasm_v128_bitselect(wasm_i16x8_add(*p0, delta), *p0, mask);
+    *q0 = wasm_v128_bitselect(wasm_i16x8_sub(*q0, delta), *q0, mask);
+}
+
+/* h264_loop_filter_chroma_intra() */
+static av_always_inline void chroma_intra_filter8(v128_t p1, v128_t *p0, v128_t *q0,
+                                                  v128_t q1, v128_t alpha, v128_t beta)
+{
+    const v128_t two = wasm_i16x8_splat(2);
+    v128_t mask = filter_mask(p1, *p0, *q0, q1, alpha, beta);
+    v128_t np0  = wasm_i16x8_shr(wasm_i16x8_add(wasm_i16x8_add(wasm_i16x8_shl(p1, 1), *p0),
+                                                wasm_i16x8_add(q1, two)), 2);
+    v128_t nq0  = wasm_i16x8_shr(wasm_i16x8_add(wasm_i16x8_add(wasm_i16x8_shl(q1, 1), *q0),
+                                                wasm_i16x8_add(p1, two)), 2);
+
+    *p0 = wasm_v128_bitselect(np0, *p0, mask);
+    *q0 = wasm_v128_bitselect(nq0, *q0, mask);
+}
+
+#define LO(v) wasm_u16x8_extend_low_u8x16(v)
+#define HI(v) wasm_u16x8_extend_high_u8x16(v)
+
+/* tc0[i] of the 16 / 4 luma pixels of each edge segment, as two int16 halves */
+static av_always_inline void load_tc_luma(const int8_t *tc0, v128_t *lo, v128_t *hi)
+{
+    v128_t tc = wasm_v128_load32_zero(tc0);
+
+    tc  = wasm_i8x16_shuffle(tc, tc, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3);
+    *lo = wasm_i16x8_extend_low_i8x16(tc);
+    *hi = wasm_i16x8_extend_high_i8x16(tc);
+}
+
+/* 16 pixels across the edge in p[0] (p3) to p[7] (q3) */
+static av_always_inline void luma_filter16(v128_t *p, int alpha, int beta,
+                                           const int8_t *tc0)
+{
+    const v128_t va = wasm_i16x8_splat(alpha), vb = wasm_i16x8_splat(beta);
+    v128_t tc_lo, tc_hi, l[4], h[4];
+
+    load_tc_luma(tc0, &tc_lo, &tc_hi);
+    for (int i = 0; i < 4; i++) {
+        l[i] = LO(p[i + 2]);
+        h[i] = HI(p[i + 2]);
+    }
+    luma_filter8(LO(p[1]), &l[0], &l[1], &l[2], &l[3], LO(p[6]), va, vb, tc_lo);
+    luma_filter8(HI(p[1]), &h[0], &h[1], &h[2], &h[3], HI(p[6]), va, vb, tc_hi);
+    for (int i = 0; i < 4; i++)
+        p[i + 2] = wasm_u8x16_narrow_i16x8(l[i], h[i]);
+}
+
+static av_always_inline void luma_intra_filter16(v128_t *p, int alpha, int beta)
+{
+    const v128_t va = wasm_i16x8_splat(alpha), vb = wasm_i16x8_splat(beta);
+    v128_t l[6], h[6];
+
+    for (int i = 0; i < 6; i++) {
+        l[i] = LO(p[i + 1]);
+        h[i] = HI(p[i + 1]);
+    }
+    luma_intra_filter8(LO(p[0]), &l[0], &l[1], &l[2], &l[3], &l[4], &l[5], LO(p[7]), va, vb);
+    luma_intra_filter8(HI(p[0]), &h[0], &h[1], &h[2], &h[3], &h[4], &h[5], HI(p[7]), va, vb);
+    for (int i = 0; i < 6; i++)
+        p[i + 1] = wasm_u8x16_narrow_i16x8(l[i], h[i]);
+}
+
+/* rows 0-15 of 8 pixels to the 8 columns of 16 pixels, and back */
+static av_always_inline void load_transpose16x8(const uint8_t *src, ptrdiff_t stride,
+                                                v128_t *col)
+{
+    v128_t r[8], a[8], b[8], c[8];
+
+    for (int i = 0; i < 8; i++)
+        r[i] = wasm_v128_load64_lane(src + (i + 8) * stride,
+                                     wasm_v128_load64_zero(src + i * stride), 1);
+    /* pairs of rows, 0-7 in a[2 * i] and 8-15 in a[2 * i + 1] */
+    for (int i = 0; i < 4; i++) {
+        a[2 * i]     = wasm_i8x16_shuffle(r[2 * i], r[2 * i + 1],
+                                          0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23);
+        a[2 * i + 1] = wasm_i8x16_shuffle(r[2 * i], r[2 * i + 1],
+                                          8, 24, 9, 25, 10, 26, 11, 27, 12, 28, 13, 29, 14, 30, 15, 31);
+    }
+    /* quads of rows 0-3, 4-7, 8-11 and 12-15, columns 0-3 then 4-7 */
+    for (int i = 0; i < 2; i++) {
+        b[4 * i]     = wasm_i16x8_shuffle(a[i], a[i + 2], 0, 8, 1, 9, 2, 10, 3, 11);
+        b[4 * i + 1] = wasm_i16x8_shuffle(a[i], a[i + 2], 4, 12, 5, 13, 6, 14, 7, 15);
+        b[4 * i + 2] = wasm_i16x8_shuffle(a[i + 4], a[i + 6], 0, 8, 1, 9, 2, 10, 3, 11);
+        b[4 * i + 3] = wasm_i16x8_shuffle(a[i + 4], a[i + 6], 4, 12, 5, 13, 6, 14, 7, 15);
+    }
+    /* octets of rows 0-7 and 8-15 of two columns each */
+    for (int i = 0; i < 2; i++) {
+        c[4 * i]     = wasm_i32x4_shuffle(b[i], b[i + 2], 0, 4, 1, 5);
+        c[4 * i + 1] = wasm_i32x4_shuffle(b[i], b[i + 2], 2, 6, 3, 7);
+        c[4 * i + 2] = wasm_i32x4_shuffle(b[i + 4], b[i + 6], 0, 4, 1, 5);
+        c[4 * i + 3] = wasm_i32x4_shuffle(b[i + 4], b[i + 6], 2, 6, 3, 7);
+    }
+    for (int i = 0; i < 2; i++) {
+        for (int j = 0; j < 2; j++) {
+            col[4 * i + 2 * j]     = wasm_i64x2_shuffle(c[4 * i + j], c[4 * i + j + 2], 0, 2);
+            col[4 * i + 2 * j + 1] = wasm_i64x2_shuffle(c[4 * i + j], c[4 * i + j + 2], 1, 3);
+        }
+    }
+}
+
+static av_always_inline void transpose8x16_store(uint8_t *dst, ptrdiff_t stride,
+                                                 const v128_t *col)
+{
+    v128_t a[8], b[8], r;
+
+    /* pairs of columns, rows 0-7 in a[2 * i] and 8-15 in a[2 * i + 1] */
+    for (int i = 0; i < 4; i++) {
+        a[2 * i]     = wasm_i8x16_shuffle(col[2 * i], col[2 * i + 1],
+                                          0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23);
+        a[2 * i + 1] = wasm_i8x16_shuffle(col[2 * i], col[2 * i + 1],
+                                          8, 24, 9, 25, 10, 26, 11, 27, 12, 28, 13, 29, 14, 30, 15, 31);
+    }
+    /* columns 0-3 and 4-7 of rows 0-3, 4-7, 8-11 and 12-15 */
+    for (int i = 0; i < 2; i++) {
+        b[4 * i]     = wasm_i16x8_shuffle(a[i], a[i + 2], 0, 8, 1, 9, 2, 10, 3, 11);
+        b[4 * i + 1] = wasm_i16x8_shuffle(a[i], a[i + 2], 4, 12, 5, 13, 6, 14, 7, 15);
+        b[4 * i + 2] = wasm_i16x8_shuffle(a[i + 4], a[i + 6], 0, 8, 1, 9, 2, 10, 3, 11);
+        b[4 * i + 3] = wasm_i16x8_shuffle(a[i + 4], a[i + 6], 4, 12, 5, 13, 6, 14, 7, 15);
+    }
+    /* b[4 * i + j] has columns 0-3 of 4 rows and b[4 * i + j + 2] columns 4-7 */
+    for (int i = 0; i < 2; i++) {
+        for (int j = 0; j < 2; j++) {
+            uint8_t *row = dst + (8 * i + 4 * j) * stride;
+
+            r = wasm_i32x4_shuffle(b[4 * i + j], b[4 * i + j + 2], 0, 4, 1, 5);
+            wasm_v128_store64_lane(row,              r, 0);
+            wasm_v128_store64_lane(row + stride,     r, 1);
+            r = wasm_i32x4_shuffle(b[4 * i + j], b[4 * i + j + 2], 2, 6, 3, 7);
+            wasm_v128_store64_lane(row + 2 * stride, r, 0);
+            wasm_v128_store64_lane(row + 3 * stride, r, 1);
+        }
+    }
+}
+
+static void h264_v_loop_filter_luma_simd128(uint8_t *pix, ptrdiff_t stride,
+                                            int alpha, int beta, int8_t *tc0)
+{
+    v128_t p[8];
+
+    if ((tc0[0] & tc0[1] & tc0[2] & tc0[3]) < 0)
+        return;
+    for (int i = 1; i < 7; i++)
+        p[i] = wasm_v128_load(pix + (i - 4) * stride);
+    luma_filter16(p, alpha, beta, tc0);
+    for (int i = 2; i < 6; i++)
+        wasm_v128_store(pix + (i - 4) * stride, p[i]);
+}
+
+static void h264_h_loop_filter_luma_simd128(uint8_t *pix, ptrdiff_t stride,
+                                            int alpha, int beta, int8_t *tc0)
+{
+    v128_t p[8];
+
+    if ((tc0[0] & tc0[1] & tc0[2] & tc0[3]) < 0)
+        return;
+    load_transpose16x8(pix - 4, stride, p);
+    luma_filter16(p, alpha, beta, tc0);
+    transpose8x16_store(pix - 4, stride, p);
+}
+
+static void h264_v_loop_filter_luma_intra_simd128(uint8_t *pix, ptrdiff_t stride,
+                                                  int alpha, int beta)
+{
+    v128_t p[8];
+
+    for (int i = 0; i < 8; i++)
+        p[i] = wasm_v128_load(pix + (i - 4) * stride);
+    luma_intra_filter16(p, alpha, beta);
+    for (int i = 1; i < 7; i++)
+        wasm_v128_store(pix + (i - 4) * stride, p[i]);
+}
+
+static void h264_h_loop_filter_luma_intra_simd128(uint8_t *pix, ptrdiff_t stride,
+                                                  int alpha, int beta)
+{
+    v128_t p[8];
+
+    load_transpose16x8(pix - 4, stride, p);
+    luma_intra_filter16(p, alpha, beta);
+    transpose8x16_store(pix - 4, stride, p);
+}
+
+/* tc0[i] of the 2 chroma pixels of each edge segment */
+static av_always_inline v128_t load_tc_chroma(const int8_t *tc0)
+{
+    v128_t tc = wasm_v128_load32_zero(tc0);
+
+    return wasm_i16x8_extend_low_i8x16(wasm_i8x16_shuffle(tc, tc, 0, 0, 1, 1, 2, 2, 3, 3,
+                                                          0, 0, 0, 0, 0, 0, 0, 0));
+}
+
+/* rows 0-7 of p1 p0 q0 q1 to 4 columns of 8 int16 pixels, and back */
+static av_always_inline void load_transpose8x4(const uint8_t *src, ptrdiff_t stride,
+                                               v128_t *col)
+{
+    v128_t r0 = wasm_v128_load32_zero(src), r1 = wasm_v128_load32_zero(src + 4 * stride);
+    v128_t a, b;
+
+    for (int i = 1; i < 4; i++) {
+        r0 = wasm_v128_load32_lane(src + i * stride, r0, i);
+        r1 = wasm_v128_load32_lane(src + (i + 4) * stride, r1, i);
+    }
+    a = wasm_i8x16_shuffle(r0, r1, 0, 4, 8, 12, 16, 20, 24, 28, 1, 5, 9, 13, 17, 21, 25, 29);
+    b = wasm_i8x16_shuffle(r0, r1, 2, 6, 10, 14, 18, 22, 26, 30, 3, 7, 11, 15, 19, 23, 27, 31);
+    col[0] = LO(a);
+    col[1] = HI(a);
+    col[2] = LO(b);
+    col[3] = HI(b);
+}
+
+static av_always_inline void transpose4x8_store(uint8_t *dst, ptrdiff_t stride,
+                                                const v128_t *col)
+{
+    v128_t a = wasm_u8x16_narrow_i16x8(col[0], col[1]);
+    v128_t b = wasm_u8x16_narrow_i16x8(col[2], col[3]);
+    v128_t r0 = wasm_i8x16_shuffle(a, b, 0, 8, 16, 24, 1, 9, 17, 25, 2, 10, 18, 26, 3, 11, 19, 27);
+    v128_t r1 = wasm_i8x16_shuffle(a, b, 4, 12, 20, 28, 5, 13, 21, 29, 6, 14, 22, 30, 7, 15, 23, 31);
+
+    wasm_v128_store32_lane(dst,              r0, 0);
+    wasm_v128_store32_lane(dst + stride,     r0, 1);
+    wasm_v128_store32_lane(dst + 2 * stride, r0, 2);
+    wasm_v128_store32_lane(dst + 3 * stride, r0, 3);
+    wasm_v128_store32_lane(dst + 4 * stride, r1, 0);
+    wasm_v128_store32_lane(dst + 5 * stride, r1, 1);
+    wasm_v128_store32_lane(dst + 6 * stride, r1, 2);
+    wasm_v128_store32_lane(dst + 7 * stride, r1, 3);
+}
+
+static av_always_inline void store_row8(uint8_t *dst, v128_t v)
+{
+    wasm_v128_store64_lane(dst, wasm_u8x16_narrow_i16x8(v, v), 0);
+}
+
+static void h264_v_loop_filter_chroma_simd128(uint8_t *pix, ptrdiff_t stride,
+                                              int alpha, int beta, int8_t *tc0)
+{
+    v128_t p1 = wasm_u16x8_load8x8(pix - 2 * stride), p0 = wasm_u16x8_load8x8(pix - stride);
+    v128_t q0 = wasm_u16x8_load8x8(pix),              q1 = wasm_u16x8_load8x8(pix + stride);
+
+    chroma_filter8(p1, &p0, &q0, q1, wasm_i16x8_splat(alpha), wasm_i16x8_splat(beta),
+                   load_tc_chroma(tc0));
+    store_row8(pix - stride, p0);
+    store_row8(pix, q0);
+}
+
+static void h264_h_loop_filter_chroma_simd128(uint8_t *pix, ptrdiff_t stride,
+                                              int alpha, int beta, int8_t *tc0)
+{
+    v128_t p[4];
+
+    load_transpose8x4(pix - 2, stride, p);
+    chroma_filter8(p[0], &p[1], &p[2], p[3], wasm_i16x8_splat(alpha), wasm_i16x8_splat(beta),
+                   load_tc_chroma(tc0));
+    transpose4x8_store(pix - 2, stride, p);
+}
+
+static void h264_v_loop_filter_chroma_intra_simd128(uint8_t *pix, ptrdiff_t stride,
+                                                    int alpha, int beta)
+{
+    v128_t p1 = wasm_u16x8_load8x8(pix - 2 * stride), p0 = wasm_u16x8_load8x8(pix - stride);
+    v128_t q0 = wasm_u16x8_load8x8(pix),              q1 = wasm_u16x8_load8x8(pix + stride);
+
+    chroma_intra_filter8(p1, &p0, &q0, q1, wasm_i16x8_splat(alpha), wasm_i16x8_splat(beta));
+    store_row8(pix - stride, p0);
+    store_row8(pix, q0);
+}
+
+static void h264_h_loop_filter_chroma_intra_simd128(uint8_t *pix, ptrdiff_t stride,
+                                                    int alpha, int beta)
+{
+    v128_t p[4];
+
+    load_transpose8x4(pix - 2, stride, p);
+    chroma_intra_filter8(p[0], &p[1], &p[2], p[3], wasm_i16x8_splat(alpha),
+                         wasm_i16x8_splat(beta));
+    transpose4x8_store(pix - 2, stride, p);
+}
+
+/* IDCT */
+
+/* dst[x] = clip(dst[x] + (lo, hi)[x]) for 8 pixels of int32 lanes */
+static av_always_inline void add_row8(uint8_t *dst, v128_t lo, v128_t hi)
+{
+    v128_t d = wasm_u16x8_load8x8(dst);
+    v128_t v = wasm_i16x8_narrow_i32x4(wasm_i32x4_add(wasm_i32x4_extend_low_i16x8(d), lo),
+                                       wasm_i32x4_add(wasm_i32x4_extend_high_i16x8(d), hi));
+
+    wasm_v128_store64_lane(dst, wasm_u8x16_narrow_i16x8(v, v), 0);
+}
+
+static void h264_idct_add_simd128(uint8_t *dst, int16_t *block, int stride)
+{
+    v128_t r0 = wasm_v128_load64_zero(block),     r1 = wasm_v128_load64_zero(block + 4);
+    v128_t r2 = wasm_v128_load64_zero(block + 8), r3 = wasm_v128_load64_zero(block + 12);
+    v128_t z0, z1, z2, z3, b01, b23, c01, c23, c0, c1, c2, c3, o0, o1, o2, o3, d;
+
+    r0 = wasm_i16x8_add(r0, wasm_i16x8_make(1 << 5, 0, 0, 0, 0, 0, 0, 0));
+
+    /* vertical pass on the rows, stored as int16_t */
+    z0  = wasm_i16x8_add(r0, r2);
+    z1  = wasm_i16x8_sub(r0, r2);
+    z2  = wasm_i16x8_sub(wasm_i16x8_shr(r1, 1), r3);
+    z3  = wasm_i16x8_add(r1, wasm_i16x8_shr(r3, 1));
+    b01 = wasm_i64x2_shuffle(wasm_i16x8_add(z0, z3), wasm_i16x8_add(z1, z2), 0, 2);
+    b23 = wasm_i64x2_shuffle(wasm_i16x8_sub(z1, z2), wasm_i16x8_sub(z0, z3), 0, 2);
+
+    /* horizontal pass on the columns, in int */
+    c01 = wasm_i16x8_shuffle(b01, b23, 0, 4, 8, 12, 1, 5, 9, 13);
+    c23 = wasm_i16x8_shuffle(b01, b23, 2, 6, 10, 14, 3, 7, 11, 15);
+    c0  = wasm_i32x4_extend_low_i16x8(c01);
+    c1  = wasm_i32x4_extend_high_i16x8(c01);
+    c2  = wasm_i32x4_extend_low_i16x8(c23);
+    c3  = wasm_i32x4_extend_high_i16x8(c23);
+    z0  = wasm_i32x4_add(c0, c2);
+    z1  = wasm_i32x4_sub(c0, c2);
+    z2  = wasm_i32x4_sub(wasm_i32x4_shr(c1, 1), c3);
+    z3  = wasm_i32x4_add(c1, wasm_i32x4_shr(c3, 1));
+    o0  = wasm_i32x4_shr(wasm_i32x4_add(z0, z3), 6);
+    o1  = wasm_i32x4_shr(wasm_i32x4_add(z1, z2), 6);
+    o2  = wasm_i32x4_shr(wasm_i32x4_sub(z1, z2), 6);
+    o3  = wasm_i32x4_shr(wasm_i32x4_sub(z0, z3), 6);
+
+    d  = wasm_v128_load32_zero(dst);
+    d  = wasm_v128_load32_lane(dst + stride, d, 1);
+    d  = wasm_v128_load32_lane(dst + 2 * stride, d, 2);
+    d  = wasm_v128_load32_lane(dst + 3 * stride, d, 3);
+    c01 = wasm_u16x8_extend_low_u8x16(d);
+    c23 = wasm_u16x8_extend_high_u8x16(d);
+    c01 = wasm_i16x8_narrow_i32x4(wasm_i32x4_add(wasm_i32x4_extend_low_i16x8(c01), o0),
+                                  wasm_i32x4_add(wasm_i32x4_extend_high_i16x8(c01), o1));
+    c23 = wasm_i16x8_narrow_i32x4(wasm_i32x4_add(wasm_i32x4_extend_low_i16x8(c23), o2),
+                                  wasm_i32x4_add(wasm_i32x4_extend_high_i16x8(c23), o3));
+    d  = wasm_u8x16_narrow_i16x8(c01, c23);
+    wasm_v128_store32_lane(dst,              d, 0);
+    wasm_v128_store32_lane(dst + stride,     d, 1);
+    wasm_v128_store32_lane(dst + 2 * stride, d, 2);
+    wasm_v128_store32_lane(dst + 3 * stride, d, 3);
+
+    wasm_v128_store(block,     wasm_i16x8_splat(0));
+    wasm_v128_store(block + 8, wasm_i16x8_splat(0));
+}
+
+/* one pass of ff_h264_idct8_add(), r[i] is coefficient i of 4 lanes */
+static av_always_inline void idct8_1d(v128_t *r)
+{
+    v128_t a0 = wasm_i32x4_add(r[0], r[4]);
+    v128_t a2 = wasm_i32x4_sub(r[0], r[4]);
+    v128_t a4 = wasm_i32x4_sub(wasm_i32x4_shr(r[2], 1), r[6]);
+    v128_t a6 = wasm_i32x4_add(wasm_i32x4_shr(r[6], 1), r[2]);
+    v128_t b0 = wasm_i32x4_add(a0, a6);
+    v128_t b2 = wasm_i32x4_add(a2, a4);
+    v128_t b4 = wasm_i32x4_sub(a2, a4);
+    v128_t b6 = wasm_i32x4_sub(a0, a6);
+    v128_t a1 = wasm_i32x4_sub(wasm_i32x4_sub(wasm_i32x4_sub(r[5], r[3]), r[7]),
+                               wasm_i32x4_shr(r[7], 1));
+    v128_t a3 = wasm_i32x4_sub(wasm_i32x4_sub(wasm_i32x4_add(r[1], r[7]), r[3]),
+                               wasm_i32x4_shr(r[3], 1));
+    v128_t a5 = wasm_i32x4_add(wasm_i32x4_add(wasm_i32x4_sub(r[7], r[1]), r[5]),
+                               wasm_i32x4_shr(r[5], 1));
+    v128_t a7 = wasm_i32x4_add(wasm_i32x4_add(wasm_i32x4_add(r[3], r[5]), r[1]),
+                               wasm_i32x4_shr(r[1], 1));
+    v128_t b1 = wasm_i32x4_add(wasm_i32x4_shr(a7, 2), a1);
+    v128_t b3 = wasm_i32x4_add(a3, wasm_i32x4_shr(a5, 2));
+    v128_t b5 = wasm_i32x4_sub(wasm_i32x4_shr(a3, 2), a5);
+    v128_t b7 = wasm_i32x4_sub(a7, wasm_i32x4_shr(a1, 2));
+
+    r[0] = wasm_i32x4_add(b0, b7);
+    r[7] = wasm_i32x4_sub(b0, b7);
+    r[1] = wasm_i32x4_add(b2, b5);
+    r[6] = wasm_i32x4_sub(b2, b5);
+    r[2] = wasm_i32x4_add(b4, b3);
+    r[5] = wasm_i32x4_sub(b4, b3);
+    r[3] = wasm_i32x4_add(b6, b1);
+    r[4] = wasm_i32x4_sub(b6, b1);
+}
+
+static av_always_inline void transpose8x8_i16(v128_t *r)
+{
+    v128_t a[8], b[8];
+
+    for (int i = 0; i < 4; i++) {
+        a[2 * i]     = wasm_i16x8_shuffle(r[2 * i], r[2 * i + 1], 0, 8, 1, 9, 2, 10, 3, 11);
+        a[2 * i + 1] = wasm_i16x8_shuffle(r[2 * i], r[2 * i + 1], 4, 12, 5, 13, 6, 14, 7, 15);
+    }
+    for (int i = 0; i < 2; i++) {
+        b[4 * i]     = wasm_i32x4_shuffle(a[4 * i],     a[4 * i + 2], 0, 4, 1, 5);
+        b[4 * i + 1] = wasm_i32x4_shuffle(a[4 * i],     a[4 * i + 2], 2, 6, 3, 7);
+        b[4 * i + 2] = wasm_i32x4_shuffle(a[4 * i + 1], a[4 * i + 3], 0, 4, 1, 5);
+        b[4 * i + 3] = wasm_i32x4_shuffle(a[4 * i + 1], a[4 * i + 3], 2, 6, 3, 7);
+    }
+    for (int i = 0; i < 4; i++) {
+        r[2 * i]     = wasm_i64x2_shuffle(b[i], b[i + 4], 0, 2);
+        r[2 * i + 1] = wasm_i64x2_shuffle(b[i], b[i + 4], 1, 3);
+    }
+}
+
+static void h264_idct8_add_simd128(uint8_t *dst, int16_t *block, int stride)
+{
+    v128_t r[8], lo[8], hi[8];
+
+    for (int i = 0; i < 8; i++)
+        r[i] = wasm_v128_load(block + 8 * i);
+    r[0] = wasm_i16x8_add(r[0], wasm_i16x8_make(32, 0, 0, 0, 0, 0, 0, 0));
+
+    /* vertical pass on the rows, stored as int16_t */
+    for (int i = 0; i < 8; i++) {
+        lo[i] = wasm_i32x4_extend_low_i16x8(r[i]);
+        hi[i] = wasm_i32x4_extend_high_i16x8(r[i]);
+    }
+    idct8_1d(lo);
+    idct8_1d(hi);
+    for (int i = 0; i < 8; i++)
+        r[i] = wasm_i16x8_shuffle(lo[i], hi[i], 0, 2, 4, 6, 8, 10, 12, 14);
+
+    /* horizontal pass on the columns, in int */
+    transpose8x8_i16(r);
+    for (int i = 0; i < 8; i++) {
+        lo[i] = wasm_i32x4_extend_low_i16x8(r[i]);
+        hi[i] = wasm_i32x4_extend_high_i16x8(r[i]);
+    }
+    idct8_1d(lo);
+    idct8_1d(hi);
+    for (int i = 0; i < 8; i++) {
+        add_row8(dst + i * stride, wasm_i32x4_shr(lo[i], 6), wasm_i32x4_shr(hi[i], 6));
+        wasm_v128_store(block + 8 * i, wasm_i16x8_splat(0));
+    }
+}
+
+static void h264_idct_dc_add_simd128(uint8_t *dst, int16_t *block, int stride)
+{
+    v128_t dc = wasm_i16x8_splat((block[0] + 32) >> 6);
+
+    block[0] = 0;
+    for (int i = 0; i < 4; i++, dst += stride) {
+        v128_t d = wasm_i16x8_add(wasm_u16x8_extend_low_u8x16(wasm_v128_load32_zero(dst)), dc);
+        wasm_v128_store32_lane(dst, wasm_u8x16_narrow_i16x8(d, d), 0);
+    }
+}
+
+static void h264_idct8_dc_add_simd128(uint8_t *dst, int16_t *block, int stride)
+{
+    v128_t dc = wasm_i16x8_splat((block[0] + 32) >> 6);
+
+    block[0] = 0;
+    for (int i = 0; i < 8; i++, dst += stride)
+        store_row8(dst, wasm_i16x8_add(wasm_u16x8_load8x8(dst), dc));
+}
+#endif /* __wasm_simd128__ */
+
+av_cold void ff_h264dsp_init_wasm(H264DSPContext *c, const int bit_depth,
+                                  const int chroma_format_idc)
+{
+#if defined(__wasm_simd128__)
+    int cpu_flags = av_get_cpu_flags();
+
+    if (!have_simd128(cpu_flags) || bit_depth != 8)
+        return;
+
+    c->weight_h264_pixels_tab[0]   = weight_h264_pixels16_simd128;
+    c->weight_h264_pixels_tab[1]   = weight_h264_pixels8_simd128;
+    c->weight_h264_pixels_tab[2]   = weight_h264_pixels4_simd128;
+    c->biweight_h264_pixels_tab[0] = biweight_h264_pixels16_simd128;
+    c->biweight_h264_pixels_tab[1] = biweight_h264_pixels8_simd128;
+    c->biweight_h264_pixels_tab[2] = biweight_h264_pixels4_simd128;
+
+    c->h264_v_loop_filter_luma         = h264_v_loop_filter_luma_simd128;
+    c->h264_h_loop_filter_luma         = h264_h_loop_filter_luma_simd128;
+    c->h264_v_loop_filter_luma_intra   = h264_v_loop_filter_luma_intra_simd128;
+    c->h264_h_loop_filter_luma_intra   = h264_h_loop_filter_luma_intra_simd128;
+    c->h264_v_loop_filter_chroma       = h264_v_loop_filter_chroma_simd128;
+    c->h264_v_loop_filter_chroma_intra = h264_v_loop_filter_chroma_intra_simd128;
+    if (chroma_format_idc <= 1) {
+        c->h264_h_loop_filter_chroma       = h264_h_loop_filter_chroma_simd128;
+        c->h264_h_loop_filter_chroma_intra = h264_h_loop_filter_chroma_intra_simd128;
+    }
+
+    c->h264_idct_add     = h264_idct_add_simd128;
+    c->h264_idct8_add    = h264_idct8_add_simd128;
+    c->h264_idct_dc_add  = h264_idct_dc_add_simd128;
+    c->h264_idct8_dc_add = h264_idct8_dc_add_simd128;
+#endif
+}
@@ -0,0 +1,362 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * WebAssembly SIMD128 H.264 quarter pixel motion compensation of 8-bit
+ * video, 16x16 and 8x8 blocks.
+ *
+ * The positions are composed from the half pixel planes like in
+ * h264qpel_template.c, with the first pass of the center plane kept in
+ * int16_t and not rounded, so the output is bit exact. They are selected
+ * when the library is built with -msimd128 and AV_CPU_FLAG_SIMD128 is set.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config.h"
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/mem_internal.h"
+#include "libavutil/wasm/cpu.h"
+#include "libavcodec/h264qpel.h"
+
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+
+/* (c + d) * 20 - (b + e) * 5 + (a + f), fits in int16_t for 8-bit input */
+static av_always_inline v128_t tap6(v128_t a, v128_t b, v128_t c,
+                                    v128_t d, v128_t e, v128_t f)
+{
+    v128_t v = wasm_i16x8_mul(wasm_i16x8_add(c, d), wasm_i16x8_splat(20));
+
+    v = wasm_i16x8_sub(v, wasm_i16x8_mul(wasm_i16x8_add(b, e), wasm_i16x8_splat(5)));
+    return wasm_i16x8_add(v, wasm_i16x8_add(a, f));
+}
+
+/* clip((v + 16) >> 5) in the low 8 bytes */
+static av_always_inline v128_t round6(v128_t v)
+{
+    v = wasm_i16x8_shr(wasm_i16x8_add(v, wasm_i16x8_splat(16)), 5);
+    return wasm_u8x16_narrow_i16x8(v, v);
+}
+
+static av_always_inline void store8(uint8_t *dst, v128_t v, int avg)
+{
+    if (avg)
+        v = wasm_u8x16_avgr(v, wasm_v128_load64_zero(dst));
+    wasm_v128_store64_lane(dst, v, 0);
+}
+
+static av_always_inline v128_t h_tap6(const uint8_t *src)
+{
+    return tap6(wasm_u16x8_load8x8(src - 2), wasm_u16x8_load8x8(src - 1),
+                wasm_u16x8_load8x8(src),     wasm_u16x8_load8x8(src + 1),
+                wasm_u16x8_load8x8(src + 2), wasm_u16x8_load8x8(src + 3));
+}
+
+static av_always_inline void h_lowpass(uint8_t *dst, ptrdiff_t dst_stride,
+                                       const uint8_t *src, ptrdiff_t src_stride,
+                                       int size, int avg)
+{
+    for (int y = 0; y < size; y++, dst += dst_stride, src += src_stride)
+        for (int x = 0; x < size; x += 8)
+            store8(dst + x, round6(h_tap6(src + x)), avg);
+}
+
+static av_always_inline void v_lowpass(uint8_t *dst, ptrdiff_t dst_stride,
+                                       const uint8_t *src, ptrdiff_t src_stride,
+                                       int size, int avg)
+{
+    for (int x = 0; x < size; x += 8) {
+        const uint8_t *s = src + x - 2 * src_stride;
+        uint8_t *d = dst + x;
+        v128_t r0 = wasm_u16x8_load8x8(s);
+        v128_t r1 = wasm_u16x8_load8x8(s + src_stride);
+        v128_t r2 = wasm_u16x8_load8x8(s + 2 * src_stride);
+        v128_t r3 = wasm_u16x8_load8x8(s + 3 * src_stride);
+        v128_t r4 = wasm_u16x8_load8x8(s + 4 * src_stride);
+
+        s += 5 * src_stride;
+        for (int y = 0; y < size; y++, s += src_stride, d += dst_stride) {
+            v128_t r5 = wasm_u16x8_load8x8(s);
+
+            store8(d, round6(tap6(r0, r1, r2, r3, r4, r5)), avg);
+            r0 = r1; r1 = r2; r2 = r3; r3 = r4; r4 = r5;
+        }
+    }
+}
+
+/* the vertical pass over the int16_t horizontal one, clip((v + 512) >> 10) */
+static av_always_inline v128_t v_tap6_i32(v128_t a, v128_t b, v128_t c,
+                                          v128_t d, v128_t e, v128_t f)
+{
+    const v128_t k20 = wasm_i16x8_splat(20), k5 = wasm_i16x8_splat(5);
+    v128_t cd = wasm_i16x8_add(c, d), be = wasm_i16x8_add(b, e);
+    v128_t af = wasm_i16x8_add(a, f);
+    v128_t lo = wasm_i32x4_sub(wasm_i32x4_extmul_low_i16x8(cd, k20),
+                               wasm_i32x4_extmul_low_i16x8(be, k5));
+    v128_t hi = wasm_i32x4_sub(wasm_i32x4_extmul_high_i16x8(cd, k20),
+                               wasm_i32x4_extmul_high_i16x8(be, k5));
+
+    lo = wasm_i32x4_add(lo, wasm_i32x4_add(wasm_i32x4_extend_low_i16x8(af),
+                                           wasm_i32x4_splat(512)));
+    hi = wasm_i32x4_add(hi, wasm_i32x4_add(wasm_i32x4_extend_high_i16x8(af),
+                                           wasm_i32x4_splat(512)));
+    lo = wasm_i16x8_narrow_i32x4(wasm_i32x4_shr(lo, 10), wasm_i32x4_shr(hi, 10));
+    return wasm_u8x16_narrow_i16x8(lo, lo);
+}
+
+static av_always_inline void hv_lowpass(uint8_t *dst, ptrdiff_t dst_stride,
+                                        const uint8_t *src, ptrdiff_t src_stride,
+                                        int size, int avg)
+{
+    int16_t tmp[(16 + 5) * 16];
+
+    src -= 2 * src_stride;
+    for (int y = 0; y < size + 5; y++, src += src_stride)
+        for (int x = 0; x < size; x += 8)
+            wasm_v128_store(tmp + y * size + x, h_tap6(src + x));
+
+    for (int x = 0; x < size; x += 8) {
+        const int16_t *t = tmp + x;
+        uint8_t *d = dst + x;
+        v128_t r0 = wasm_v128_load(t);
+        v128_t r1 = wasm_v128_load(t + size);
+        v128_t r2 = wasm_v128_load(t + 2 * size);
+        v128_t r3 = wasm_v128_load(t + 3 * size);
+        v128_t r4 = wasm_v128_load(t + 4 * size);
+
+        t += 5 * size;
+        for (int y = 0; y < size; y++, t += size, d += dst_stride) {
+            v128_t r5 = wasm_v128_load(t);
+
+            store8(d, v_tap6_i32(r0, r1, r2, r3, r4, r5), avg);
+            r0 = r1; r1 = r2; r2 = r3; r3 = r4; r4 = r5;
+        }
+    }
+}
+
+/* dst = (a + b + 1) >> 1, averaged with dst for avg */
+static av_always_inline void pixels_l2(uint8_t *dst, ptrdiff_t dst_stride,
+                                       const uint8_t *a, ptrdiff_t a_stride,
+                                       const uint8_t *b, ptrdiff_t b_stride,
+                                       int size, int avg)
+{
+    for (int y = 0; y < size; y++, dst += dst_stride, a += a_stride, b += b_stride)
+        for (int x = 0; x < size; x += 8)
+            store8(dst + x, wasm_u8x16_avgr(wasm_v128_load64_zero(a + x),
+                                            wasm_v128_load64_zero(b + x)), avg);
+}
+
+static av_always_inline void pixels(uint8_t *dst, const uint8_t *src,
+                                    ptrdiff_t stride, int size, int avg)
+{
+    for (int y = 0; y < size; y++, dst += stride, src += stride)
+        for (int x = 0; x < size; x += 8)
+            store8(dst + x, wasm_v128_load64_zero(src + x), avg);
+}
+
+#define H264_MC(OPNAME, SIZE, AVG)                                                  \
+static void OPNAME ## h264_qpel ## SIZE ## _mc00_simd128(uint8_t *dst,              \
+                                                         const uint8_t *src,        \
+                                                         ptrdiff_t stride)          \
+{                                                                                   \
+    pixels(dst, src, stride, SIZE, AVG);                                            \
+}                                                                                   \
+                                                                                    \
+static void OPNAME ## h264_qpel ## SIZE ## _mc10_simd128(uint8_t *dst,              \
+                                                         const uint8_t *src,        \
+                                                         ptrdiff_t stride)          \
+{                                                                                   \
+    LOCAL_ALIGNED_16(uint8_t, half, [SIZE * SIZE]);                                 \
+    h_lowpass(half, SIZE, src, stride, SIZE, 0);                                    \
+    pixels_l2(dst, stride, src, stride, half, SIZE, SIZE, AVG);                     \
+}                                                                                   \
+                                                                                    \
+static void OPNAME ## h264_qpel ## SIZE ## _mc20_simd128(uint8_t *dst,              \
+                                                         const uint8_t *src,        \
+                                                         ptrdiff_t stride)          \
+{                                                                                   \
+    h_lowpass(dst, stride, src, stride, SIZE, AVG);                                 \
+}                                                                                   \
+                                                                                    \
+static void OPNAME ## h264_qpel ## SIZE ## _mc30_simd128(uint8_t *dst,              \
+                                                         const uint8_t *src,        \
+                                                         ptrdiff_t stride)          \
+{                                                                                   \
+    LOCAL_ALIGNED_16(uint8_t, half, [SIZE * SIZE]);                                 \
+    h_lowpass(half, SIZE, src, stride, SIZE, 0);                                    \
+    pixels_l2(dst, stride, src + 1, stride, half, SIZE, SIZE, AVG);                 \
+}                                                                                   \
+                                                                                    \
+static void OPNAME ## h264_qpel ## SIZE ## _mc01_simd128(uint8_t *dst,              \
+                                                         const uint8_t *src,        \
+                                                         ptrdiff_t stride)          \
+{                                                                                   \
+    LOCAL_ALIGNED_16(uint8_t, half, [SIZE * SIZE]);                                 \
+    v_lowpass(half, SIZE, src, stride, SIZE, 0);                                    \
+    pixels_l2(dst, stride, src, stride, half, SIZE, SIZE, AVG);                     \
+}                                                                                   \
+                                                                                    \
+static void OPNAME ## h264_qpel ## SIZE ## _mc02_simd128(uint8_t *dst,              \
+                                                         const uint8_t *src,        \
+                                                         ptrdiff_t stride)          \
+{                                                                                   \
+    v_lowpass(dst, stride, src, stride, SIZE, AVG);                                 \
+}                                                                                   \
+                                                                                    \
+static void OPNAME ## h264_qpel ## SIZE ## _mc03_simd128(uint8_t *dst,              \
+                                                         const uint8_t *src,        \
+                                                         ptrdiff_t stride)          \
+{                                                                                   \
+    LOCAL_ALIGNED_16(uint8_t, half, [SIZE * SIZE]);                                 \
+    v_lowpass(half, SIZE, src, stride, SIZE, 0);                                    \
+    pixels_l2(dst, stride, src + stride, stride, half, SIZE, SIZE, AVG);            \
+}                                                                                   \
+                                                                                    \
+static av_always_inline void OPNAME ## h264_qpel ## SIZE ## _hv(uint8_t *dst,       \
+                                                                const uint8_t *src, \
+                                                                ptrdiff_t stride,   \
+                                                                int dx, int dy)     \
+{                                                                                   \
+    LOCAL_ALIGNED_16(uint8_t, half_h, [SIZE * SIZE]);                               \
+    LOCAL_ALIGNED_16(uint8_t, half_v, [SIZE * SIZE]);                               \
+    h_lowpass(half_h, SIZE, src + dy * stride, stride, SIZE, 0);                    \
+    v_lowpass(half_v, SIZE, src + dx, stride, SIZE, 0);                             \
+    pixels_l2(dst, stride, half_h, SIZE, half_v, SIZE, SIZE, AVG);                  \
+}                                                                                   \
+                                                                                    \
+static void OPNAME ## h264_qpel ## SIZE ## _mc11_simd128(uint8_t *dst,              \
+                                                         const uint8_t *src,        \
+                                                         ptrdiff_t stride)          \
+{                                                                                   \
+    OPNAME ## h264_qpel ## SIZE ## _hv(dst, src, stride, 0, 0);                     \
+}                                                                                   \
+                                                                                    \
+static void OPNAME ## h264_qpel ## SIZE ## _mc31_simd128(uint8_t *dst,              \
+                                                         const uint8_t *src,        \
+                                                         ptrdiff_t stride)          \
+{                                                                                   \
+    OPNAME ## h264_qpel ## SIZE ## _hv(dst, src, stride, 1, 0);                     \
+}                                                                                   \
+                                                                                    \
+static void OPNAME ## h264_qpel ## SIZE ## _mc13_simd128(uint8_t *dst,              \
+                                                         const uint8_t *src,        \
+                                                         ptrdiff_t stride)          \
+{                                                                                   \
+    OPNAME ## h264_qpel ## SIZE ## _hv(dst, src, stride, 0, 1);                     \
+}                                                                                   \
+                                                                                    \
+static void OPNAME ## h264_qpel ## SIZE ## _mc33_simd128(uint8_t *dst,              \
+                                                         const uint8_t *src,        \
+                                                         ptrdiff_t stride)          \
+{                                                                                   \
+    OPNAME ## h264_qpel ## SIZE ## _hv(dst, src, stride, 1, 1);                     \
+}                                                                                   \
+                                                                                    \
+static void OPNAME ## h264_qpel ## SIZE ## _mc22_simd128(uint8_t *dst,              \
+                                                         const uint8_t *src,        \
+                                                         ptrdiff_t stride)          \
+{                                                                                   \
+    hv_lowpass(dst, stride, src, stride, SIZE, AVG);                                \
+}                                                                                   \
+                                                                                    \
+static void OPNAME ## h264_qpel ## SIZE ## _mc21_simd128(uint8_t *dst,              \
+                                                         const uint8_t *src,        \
+                                                         ptrdiff_t stride)          \
+{                                                                                   \
+    LOCAL_ALIGNED_16(uint8_t, half_h, [SIZE * SIZE]);                               \
+    LOCAL_ALIGNED_16(uint8_t, half_hv, [SIZE * SIZE]);                              \
+    h_lowpass(half_h, SIZE, src, stride, SIZE, 0);                                  \
+    hv_lowpass(half_hv, SIZE, src, stride, SIZE, 0);                                \
+    pixels_l2(dst, stride, half_h, SIZE, half_hv, SIZE, SIZE, AVG);                 \
+}                                                                                   \
+                                                                                    \
+static void OPNAME ## h264_qpel ## SIZE ## _mc23_simd128(uint8_t *dst,              \
+                                                         const uint8_t *src,        \
+                                                         ptrdiff_t stride)          \
+{                                                                                   \
+    LOCAL_ALIGNED_16(uint8_t, half_h, [SIZE * SIZE]);                               \
+    LOCAL_ALIGNED_16(uint8_t, half_hv, [SIZE * SIZE]);                              \
+    h_lowpass(half_h, SIZE, src + stride, stride, SIZE, 0);                         \
+    hv_lowpass(half_hv, SIZE, src, stride, SIZE, 0);                                \
+    pixels_l2(dst, stride, half_h, SIZE, half_hv, SIZE, SIZE, AVG);                 \
+}                                                                                   \
+                                                                                    \
+static void OPNAME ## h264_qpel ## SIZE ## _mc12_simd128(uint8_t *dst,              \
+                                                         const uint8_t *src,        \
+                                                         ptrdiff_t stride)          \
+{                                                                                   \
+    LOCAL_ALIGNED_16(uint8_t, half_v, [SIZE * SIZE]);                               \
+    LOCAL_ALIGNED_16(uint8_t, half_hv, [SIZE * SIZE]);                              \
+    v_lowpass(half_v, SIZE, src, stride, SIZE, 0);                                  \
+    hv_lowpass(half_hv, SIZE, src, stride, SIZE, 0);                                \
+    pixels_l2(dst, stride, half_v, SIZE, half_hv, SIZE, SIZE, AVG);                 \
+}                                                                                   \
+                                                                                    \
+static void OPNAME ## h264_qpel ## SIZE ## _mc32_simd128(uint8_t *dst,              \
+                                                         const uint8_t *src,        \
+                                                         ptrdiff_t stride)          \
+{                                                                                   \
+    LOCAL_ALIGNED_16(uint8_t, half_v, [SIZE * SIZE]);                               \
+    LOCAL_ALIGNED_16(uint8_t, half_hv, [SIZE * SIZE]);                              \
+    v_lowpass(half_v, SIZE, src + 1, stride, SIZE, 0);                              \
+    hv_lowpass(half_hv, SIZE, src, stride, SIZE, 0);                                \
+    pixels_l2(dst, stride, half_v, SIZE, half_hv, SIZE, SIZE, AVG);                 \
+}
+
+H264_MC(put_, 16, 0)
+H264_MC(put_,  8, 0)
+H264_MC(avg_, 16, 1)
+H264_MC(avg_,  8, 1)
+#endif /* __wasm_simd128__ */
+
+av_cold void ff_h264qpel_init_wasm(H264QpelContext *c, int bit_depth)
+{
+#if defined(__wasm_simd128__)
+    int cpu_flags = av_get_cpu_flags();
+
+    if (!have_simd128(cpu_flags) || bit_depth != 8)
+        return;
+
+#define SET_QPEL(OPNAME, IDX, SIZE)                                                   \
+    c->OPNAME ## h264_qpel_pixels_tab[IDX][ 0] = OPNAME ## h264_qpel ## SIZE ## _mc00_simd128; \
+    c->OPNAME ## h264_qpel_pixels_tab[IDX][ 1] = OPNAME ## h264_qpel ## SIZE ## _mc10_simd128; \
+    c->OPNAME ## h264_qpel_pixels_tab[IDX][ 2] = OPNAME ## h264_qpel ## SIZE ## _mc20_simd128; \
+    c->OPNAME ## h264_qpel_pixels_tab[IDX][ 3] = OPNAME ## h264_qpel ## SIZE ## _mc30_simd128; \
+    c->OPNAME ## h264_qpel_pixels_tab[IDX][ 4] = OPNAME ## h264_qpel ## SIZE ## _mc01_simd128; \
+    c->OPNAME ## h264_qpel_pixels_tab[IDX][ 5] = OPNAME ## h264_qpel ## SIZE ## _mc11_simd128; \
+    c->OPNAME ## h264_qpel_pixels_tab[IDX][ 6] = OPNAME ## h264_qpel ## SIZE ## _mc21_simd128; \
+    c->OPNAME ## h264_qpel_pixels_tab[IDX][ 7] = OPNAME ## h264_qpel ## SIZE ## _mc31_simd128; \
+    c->OPNAME ## h264_qpel_pixels_tab[IDX][ 8] = OPNAME ## h264_qpel ## SIZE ## _mc02_simd128; \
+    c->OPNAME ## h264_qpel_pixels_tab[IDX][ 9] = OPNAME ## h264_qpel ## SIZE ## _mc12_simd128; \
+    c->OPNAME ## h264_qpel_pixels_tab[IDX][10] = OPNAME ## h264_qpel ## SIZE ## _mc22_simd128; \
+    c->OPNAME ## h264_qpel_pixels_tab[IDX][11] = OPNAME ## h264_qpel ## SIZE ## _mc32_simd128; \
+    c->OPNAME ## h264_qpel_pixels_tab[IDX][12] = OPNAME ## h264_qpel ## SIZE ## _mc03_simd128; \
+    c->OPNAME ## h264_qpel_pixels_tab[IDX][13] = OPNAME ## h264_qpel ## SIZE ## _mc13_simd128; \
+    c->OPNAME ## h264_qpel_pixels_tab[IDX][14] = OPNAME ## h264_qpel ## SIZE ## _mc23_simd128; \
+    c->OPNAME ## h264_qpel_pixels_tab[IDX][15] = OPNAME ## h264_qpel ## SIZE ## _mc33_simd128
+
+    SET_QPEL(put_, 0, 16);
+    SET_QPEL(put_, 1,  8);
+    SET_QPEL(avg_, 0, 16);
+    SET_QPEL(avg_, 1,  8);
+#undef SET_QPEL
+#endif
+}
@@ -0,0 +1,308 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * WebAssembly SIMD128 HEVC motion compensation, residual add and DC IDCT of
+ * 8-bit video.
+ *
+ * The qpel / epel functions cover the prediction block widths that are
+ * multiples of 8 (8, 16, 24, 32, 48 and 64), unweighted, to the intermediate
+ * int16_t plane and to pixels, alone or averaged with a second prediction.
+ * Every kernel computes the same integers as hevcdsp_template.c, including
+ * the int16_t truncation of the hv intermediate, so the output is bit exact.
+ * They are selected when the library is built with -msimd128 and
+ * AV_CPU_FLAG_SIMD128 is set.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config.h"
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/wasm/cpu.h"
+#include "libavcodec/hevcdsp.h"
+
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+
+enum { MC_PUT, MC_UNI, MC_BI };
+
+/* sum of filter[k] * src[(k - taps / 2 + 1) * step], 8 pixels in int16_t */
+static av_always_inline v128_t filter_u8(const uint8_t *src, ptrdiff_t step,
+                                         const int8_t *filter, int taps)
+{
+    v128_t sum = wasm_i16x8_splat(0);
+
+    src -= (taps / 2 - 1) * step;
+    for (int k = 0; k < taps; k++, src += step)
+        sum = wasm_i16x8_add(sum, wasm_i16x8_mul(wasm_u16x8_load8x8(src),
+                                                 wasm_i16x8_splat(filter[k])));
+    return sum;
+}
+
+/* the same over the int16_t rows of the hv first pass, in int32_t, >> 6 */
+static av_always_inline void filter_i16(const int16_t *src, const int8_t *filter,
+                                        int taps, v128_t *lo, v128_t *hi)
+{
+    v128_t sum_lo = wasm_i32x4_splat(0), sum_hi = wasm_i32x4_splat(0);
+
+    src -= (taps / 2 - 1) * MAX_PB_SIZE;
+    for (int k = 0; k < taps; k++, src += MAX_PB_SIZE) {
+        v128_t v = wasm_v128_load(src), f = wasm_i16x8_splat(filter[k]);
+
+        sum_lo = wasm_i32x4_add(sum_lo, wasm_i32x4_extmul_low_i16x8(v, f));
+        sum_hi = wasm_i32x4_add(sum_hi, wasm_i32x4_extmul_high_i16x8(v, f));
+    }
+    *lo = wasm_i32x4_shr(sum_lo, 6);
+    *hi = wasm_i32x4_shr(sum_hi, 6);
+}
+
+/*
+ * The int16_t prediction v of pixels x to x + 7 to the output. The sums of
+ * bi saturate, which only happens where the clip to pixels does.
+ */
+static av_always_inline void store_i16(int mode, int16_t *dst16, uint8_t *dst,
+                                       const int16_t *src2, int x, v128_t v)
+{
+    if (mode == MC_PUT) {
+        wasm_v128_store(dst16 + x, v);
+        return;
+    }
+    if (mode == MC_UNI) {
+        v = wasm_i16x8_shr(wasm_i16x8_add(v, wasm_i16x8_splat(32)), 6);
+    } else {
+        v = wasm_i16x8_add_sat(v, wasm_v128_load(src2 + x));
+        v = wasm_i16x8_shr(wasm_i16x8_add_sat(v, wasm_i16x8_splat(64)), 7);
+    }
+    wasm_v128_store64_lane(dst + x, wasm_u8x16_narrow_i16x8(v, v), 0);
+}
+
+/* the same for the int32_t prediction of hv, truncated to int16_t by put */
+static av_always_inline void store_i32(int mode, int16_t *dst16, uint8_t *dst,
+                                       const int16_t *src2, int x, v128_t lo, v128_t hi)
+{
+    v128_t v;
+
+    if (mode == MC_PUT) {
+        wasm_v128_store(dst16 + x, wasm_i16x8_shuffle(lo, hi, 0, 2, 4, 6, 8, 10, 12, 14));
+        return;
+    }
+    if (mode == MC_UNI) {
+        lo = wasm_i32x4_shr(wasm_i32x4_add(lo, wasm_i32x4_splat(32)), 6);
+        hi = wasm_i32x4_shr(wasm_i32x4_add(hi, wasm_i32x4_splat(32)), 6);
+    } else {
+        v128_t s = wasm_v128_load(src2 + x);
+
+        lo = wasm_i32x4_add(lo, wasm_i32x4_extend_low_i16x8(s));
+        hi = wasm_i32x4_add(hi, wasm_i32x4_extend_high_i16x8(s));
+        lo = wasm_i32x4_shr(wasm_i32x4_add(lo, wasm_i32x4_splat(64)), 7);
+        hi = wasm_i32x4_shr(wasm_i32x4_add(hi, wasm_i32x4_splat(64)), 7);
+    }
+    v = wasm_i16x8_narrow_i32x4(lo, hi);
+    wasm_v128_store64_lane(dst + x, wasm_u8x16_narrow_i16x8(v, v), 0);
+}
+
+/* to the next row of the outputs of mode */
+static av_always_inline void next_row(int mode, int16_t **dst16, uint8_t **dst,
+                                      ptrdiff_t dststride, const int16_t **src2)
+{
+    if (mode == MC_PUT)
+        *dst16 += MAX_PB_SIZE;
+    else
+        *dst += dststride;
+    if (mode == MC_BI)
+        *src2 += MAX_PB_SIZE;
+}
+
+/*
+ * One prediction of width x height, fx / fy are the horizontal and vertical
+ * filters, NULL for none. dst16 and src2 have a stride of MAX_PB_SIZE.
+ */
+static av_always_inline void hevc_mc(int mode, int16_t *dst16, uint8_t *dst,
+                                     ptrdiff_t dststride, const uint8_t *src,
+                                     ptrdiff_t srcstride, const int16_t *src2,
+                                     int height, int width, const int8_t *fx,
+                                     const int8_t *fy, int taps)
+{
+    if (fx && fy) {
+        int16_t tmp_array[(MAX_PB_SIZE + 7) * MAX_PB_SIZE];
+        const int16_t *tmp = tmp_array + (taps / 2 - 1) * MAX_PB_SIZE;
+
+        src -= (taps / 2 - 1) * srcstride;
+        for (int y = 0; y < height + taps - 1; y++, src += srcstride)
+            for (int x = 0; x < width; x += 8)
+                wasm_v128_store(tmp_array + y * MAX_PB_SIZE + x,
+                                filter_u8(src + x, 1, fx, taps));
+
+        for (int y = 0; y < height; y++, tmp += MAX_PB_SIZE) {
+            for (int x = 0; x < width; x += 8) {
+                v128_t lo, hi;
+
+                filter_i16(tmp + x, fy, taps, &lo, &hi);
+                store_i32(mode, dst16, dst, src2, x, lo, hi);
+            }
+            next_row(mode, &dst16, &dst, dststride, &src2);
+        }
+        return;
+    }
+
+    for (int y = 0; y < height; y++, src += srcstride) {
+        for (int x = 0; x < width; x += 8) {
+            v128_t v = fx ? filter_u8(src + x, 1, fx, taps) :
+                       fy ? filter_u8(src + x, srcstride, fy, taps) :
+                            wasm_i16x8_shl(wasm_u16x8_load8x8(src + x), 6);
+
+            store_i16(mode, dst16, dst, src2, x, v);
+        }
+        next_row(mode, &dst16, &dst, dststride, &src2);
+    }
+}
+
+#define HEVC_MC(PEL, TYPE, TAPS, FX, FY)                                            \
+static void put_hevc_ ## PEL ## _ ## TYPE ## _simd128(int16_t *dst, uint8_t *src,   \
+                                                      ptrdiff_t srcstride,          \
+                                                      int height, intptr_t mx,      \
+                                                      intptr_t my, int width)       \
+{                                                                                   \
+    hevc_mc(MC_PUT, dst, NULL, 0, src, srcstride, NULL, height, width,              \
+            FX, FY, TAPS);                                                          \
+}                                                                                   \
+                                                                                    \
+static void put_hevc_ ## PEL ## _uni_ ## TYPE ## _simd128(uint8_t *dst,             \
+                                                          ptrdiff_t dststride,      \
+                                                          uint8_t *src,             \
+                                                          ptrdiff_t srcstride,      \
+                                                          int height, intptr_t mx,  \
+                                                          intptr_t my, int width)   \
+{                                                                                   \
+    hevc_mc(MC_UNI, NULL, dst, dststride, src, srcstride, NULL, height, width,      \
+            FX, FY, TAPS);                                                          \
+}                                                                                   \
+                                                                                    \
+static void put_hevc_ ## PEL ## _bi_ ## TYPE ## _simd128(uint8_t *dst,              \
+                                                         ptrdiff_t dststride,       \
+                                                         uint8_t *src,              \
+                                                         ptrdiff_t srcstride,       \
+                                                         int16_t *src2, int height, \
+                                                         intptr_t mx, intptr_t my,  \
+                                                         int width)                 \
+{                                                                                   \
+    hevc_mc(MC_BI, NULL, dst, dststride, src, srcstride, src2, height, width,       \
+            FX, FY, TAPS);                                                          \
+}
+
+HEVC_MC(pel,  pixels, 0, NULL, NULL)
+HEVC_MC(qpel, h,      8, ff_hevc_qpel_filters[mx - 1], NULL)
+HEVC_MC(qpel, v,      8, NULL, ff_hevc_qpel_filters[my - 1])
+HEVC_MC(qpel, hv,     8, ff_hevc_qpel_filters[mx - 1], ff_hevc_qpel_filters[my - 1])
+HEVC_MC(epel, h,      4, ff_hevc_epel_filters[mx - 1], NULL)
+HEVC_MC(epel, v,      4, NULL, ff_hevc_epel_filters[my - 1])
+HEVC_MC(epel, hv,     4, ff_hevc_epel_filters[mx - 1], ff_hevc_epel_filters[my - 1])
+
+/* dst = clip(dst + res) */
+static av_always_inline void add_residual(uint8_t *dst, const int16_t *res,
+                                          ptrdiff_t stride, int size)
+{
+    for (int y = 0; y < size; y++, dst += stride, res += size) {
+        if (size == 4) {
+            v128_t v = wasm_u16x8_extend_low_u8x16(wasm_v128_load32_zero(dst));
+
+            v = wasm_i16x8_add_sat(v, wasm_v128_load64_zero(res));
+            wasm_v128_store32_lane(dst, wasm_u8x16_narrow_i16x8(v, v), 0);
+            continue;
+        }
+        for (int x = 0; x < size; x += 8) {
+            v128_t v = wasm_i16x8_add_sat(wasm_u16x8_load8x8(dst + x),
+                                          wasm_v128_load(res + x));
+
+            wasm_v128_store64_lane(dst + x, wasm_u8x16_narrow_i16x8(v, v), 0);
+        }
+    }
+}
+
+static av_always_inline void idct_dc(int16_t *coeffs, int size)
+{
+    v128_t dc = wasm_i16x8_splat((((coeffs[0] + 1) >> 1) + 32) >> 6);
+
+    for (int i = 0; i < size * size; i += 8)
+        wasm_v128_store(coeffs + i, dc);
+}
+
+#define HEVC_TRANSFORM(SIZE)                                                        \
+static void add_residual ## SIZE ## x ## SIZE ## _simd128(uint8_t *dst,             \
+                                                          int16_t *res,             \
+                                                          ptrdiff_t stride)         \
+{                                                                                   \
+    add_residual(dst, res, stride, SIZE);                                           \
+}                                                                                   \
+                                                                                    \
+static void idct_ ## SIZE ## x ## SIZE ## _dc_simd128(int16_t *coeffs)              \
+{                                                                                   \
+    idct_dc(coeffs, SIZE);                                                          \
+}
+
+HEVC_TRANSFORM(4)
+HEVC_TRANSFORM(8)
+HEVC_TRANSFORM(16)
+HEVC_TRANSFORM(32)
+#endif /* __wasm_simd128__ */
+
+av_cold void ff_hevc_dsp_init_wasm(HEVCDSPContext *c, const int bit_depth)
+{
+#if defined(__wasm_simd128__)
+    /* the block widths of the put_hevc_qpel / epel index */
+    static const uint8_t widths[10] = { 2, 4, 6, 8, 12, 16, 24, 32, 48, 64 };
+    int cpu_flags = av_get_cpu_flags();
+
+    if (!have_simd128(cpu_flags) || bit_depth != 8)
+        return;
+
+#define SET_MC(PEL, IDX, MY, MX, TYPE)                                               \
+    c->put_hevc_ ## PEL[IDX][MY][MX]          = put_hevc_ ## PEL ## _ ## TYPE ## _simd128;     \
+    c->put_hevc_ ## PEL ## _uni[IDX][MY][MX]  = put_hevc_ ## PEL ## _uni_ ## TYPE ## _simd128;  \
+    c->put_hevc_ ## PEL ## _bi[IDX][MY][MX]   = put_hevc_ ## PEL ## _bi_ ## TYPE ## _simd128
+    for (int i = 0; i < 10; i++) {
+        if (widths[i] % 8)
+            continue;
+        c->put_hevc_qpel[i][0][0]     = put_hevc_pel_pixels_simd128;
+        c->put_hevc_qpel_uni[i][0][0] = put_hevc_pel_uni_pixels_simd128;
+        c->put_hevc_qpel_bi[i][0][0]  = put_hevc_pel_bi_pixels_simd128;
+        c->put_hevc_epel[i][0][0]     = put_hevc_pel_pixels_simd128;
+        c->put_hevc_epel_uni[i][0][0] = put_hevc_pel_uni_pixels_simd128;
+        c->put_hevc_epel_bi[i][0][0]  = put_hevc_pel_bi_pixels_simd128;
+        SET_MC(qpel, i, 0, 1, h);
+        SET_MC(qpel, i, 1, 0, v);
+        SET_MC(qpel, i, 1, 1, hv);
+        SET_MC(epel, i, 0, 1, h);
+        SET_MC(epel, i, 1, 0, v);
+        SET_MC(epel, i, 1, 1, hv);
+    }
+#undef SET_MC
+
+    c->add_residual[0] = add_residual4x4_simd128;
+    c->add_residual[1] = add_residual8x8_simd128;
+    c->add_residual[2] = add_residual16x16_simd128;
+    c->add_residual[3] = add_residual32x32_simd128;
+
+    c->idct_dc[0] = idct_4x4_dc_simd128;
+    c->idct_dc[1] = idct_8x8_dc_simd128;
+    c->idct_dc[2] = idct_16x16_dc_simd128;
+    c->idct_dc[3] = idct_32x32_dc_simd128;
+#endif
+}
@@ -0,0 +1,195 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * WebAssembly SIMD128 VP9 motion compensation of 8-bit video: the 8-tap
+ * smooth, regular and sharp filters and the averaging full pixel copy, of
+ * 64x64 to 8x8 blocks.
+ *
+ * Like vp9dsp_template.c, the 2D filters clip the horizontal pass to pixels
+ * before the vertical one, so the output is bit exact. They are selected
+ * when the library is built with -msimd128 and AV_CPU_FLAG_SIMD128 is set.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config.h"
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/wasm/cpu.h"
+#include "libavcodec/vp9dsp.h"
+
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+
+/* clip((sum of F[k] * src[(k - 3) * step] + 64) >> 7), 8 pixels */
+static av_always_inline v128_t filter8(const uint8_t *src, ptrdiff_t step,
+                                       const int16_t *F)
+{
+    v128_t lo = wasm_i32x4_splat(64), hi = lo, v;
+
+    src -= 3 * step;
+    for (int k = 0; k < 8; k++, src += step) {
+        v128_t p = wasm_u16x8_load8x8(src), f = wasm_i16x8_splat(F[k]);
+
+        lo = wasm_i32x4_add(lo, wasm_i32x4_extmul_low_i16x8(p, f));
+        hi = wasm_i32x4_add(hi, wasm_i32x4_extmul_high_i16x8(p, f));
+    }
+    v = wasm_i16x8_narrow_i32x4(wasm_i32x4_shr(lo, 7), wasm_i32x4_shr(hi, 7));
+    return wasm_u8x16_narrow_i16x8(v, v);
+}
+
+static av_always_inline void store8(uint8_t *dst, v128_t v, int avg)
+{
+    if (avg)
+        v = wasm_u8x16_avgr(v, wasm_v128_load64_zero(dst));
+    wasm_v128_store64_lane(dst, v, 0);
+}
+
+static av_always_inline void do_8tap_1d(uint8_t *dst, ptrdiff_t dst_stride,
+                                        const uint8_t *src, ptrdiff_t src_stride,
+                                        int w, int h, ptrdiff_t ds,
+                                        const int16_t *filter, int avg)
+{
+    for (int y = 0; y < h; y++, dst += dst_stride, src += src_stride)
+        for (int x = 0; x < w; x += 8)
+            store8(dst + x, filter8(src + x, ds, filter), avg);
+}
+
+static av_always_inline void do_8tap_2d(uint8_t *dst, ptrdiff_t dst_stride,
+                                        const uint8_t *src, ptrdiff_t src_stride,
+                                        int w, int h, const int16_t *filterx,
+                                        const int16_t *filtery, int avg)
+{
+    uint8_t tmp[64 * 71];
+
+    src -= 3 * src_stride;
+    for (int y = 0; y < h + 7; y++, src += src_stride)
+        for (int x = 0; x < w; x += 8)
+            wasm_v128_store64_lane(tmp + y * 64 + x, filter8(src + x, 1, filterx), 0);
+    do_8tap_1d(dst, dst_stride, tmp + 3 * 64, 64, w, h, 64, filtery, avg);
+}
+
+#define FILTER_8TAP(avg, type, type_idx, sz)                                        \
+static void avg ## _8tap_ ## type ## _ ## sz ## h_simd128(uint8_t *dst,             \
+                                                          ptrdiff_t dst_stride,     \
+                                                          const uint8_t *src,       \
+                                                          ptrdiff_t src_stride,     \
+                                                          int h, int mx, int my)    \
+{                                                                                   \
+    do_8tap_1d(dst, dst_stride, src, src_stride, sz, h, 1,                          \
+               ff_vp9_subpel_filters[type_idx][mx], avg ## _avg);                   \
+}                                                                                   \
+                                                                                    \
+static void avg ## _8tap_ ## type ## _ ## sz ## v_simd128(uint8_t *dst,             \
+                                                          ptrdiff_t dst_stride,     \
+                                                          const uint8_t *src,       \
+                                                          ptrdiff_t src_stride,     \
+                                                          int h, int mx, int my)    \
+{                                                                                   \
+    do_8tap_1d(dst, dst_stride, src, src_stride, sz, h, src_stride,                 \
+               ff_vp9_subpel_filters[type_idx][my], avg ## _avg);                   \
+}                                                                                   \
+                                                                                    \
+static void avg ## _8tap_ ## type ## _ ## sz ## hv_simd128(uint8_t *dst,            \
+                                                           ptrdiff_t dst_stride,    \
+                                                           const uint8_t *src,      \
+                                                           ptrdiff_t src_stride,    \
+                                                           int h, int mx, int my)   \
+{                                                                                   \
+    do_8tap_2d(dst, dst_stride, src, src_stride, sz, h,                             \
+               ff_vp9_subpel_filters[type_idx][mx],                                 \
+               ff_vp9_subpel_filters[type_idx][my], avg ## _avg);                   \
+}
+
+#define put_avg 0
+#define avg_avg 1
+
+#define FILTER_8TAP_SIZES(avg, type, type_idx) \
+    FILTER_8TAP(avg, type, type_idx, 64)       \
+    FILTER_8TAP(avg, type, type_idx, 32)       \
+    FILTER_8TAP(avg, type, type_idx, 16)       \
+    FILTER_8TAP(avg, type, type_idx,  8)
+
+FILTER_8TAP_SIZES(put, smooth,  FILTER_8TAP_SMOOTH)
+FILTER_8TAP_SIZES(put, regular, FILTER_8TAP_REGULAR)
+FILTER_8TAP_SIZES(put, sharp,   FILTER_8TAP_SHARP)
+FILTER_8TAP_SIZES(avg, smooth,  FILTER_8TAP_SMOOTH)
+FILTER_8TAP_SIZES(avg, regular, FILTER_8TAP_REGULAR)
+FILTER_8TAP_SIZES(avg, sharp,   FILTER_8TAP_SHARP)
+
+#define AVG(sz)                                                                     \
+static void avg ## sz ## _simd128(uint8_t *dst, ptrdiff_t dst_stride,               \
+                                  const uint8_t *src, ptrdiff_t src_stride,         \
+                                  int h, int mx, int my)                            \
+{                                                                                   \
+    for (int y = 0; y < h; y++, dst += dst_stride, src += src_stride)               \
+        for (int x = 0; x < sz; x += 8)                                             \
+            store8(dst + x, wasm_v128_load64_zero(src + x), 1);                     \
+}
+
+AVG(64)
+AVG(32)
+AVG(16)
+AVG(8)
+#endif /* __wasm_simd128__ */
+
+av_cold void ff_vp9dsp_init_wasm(VP9DSPContext *dsp, int bpp, int bitexact)
+{
+#if defined(__wasm_simd128__)
+    int cpu_flags = av_get_cpu_flags();
+
+    if (!have_simd128(cpu_flags) || bpp != 8)
+        return;
+
+#define init_fpel(idx, sz)                                          \
+    dsp->mc[idx][FILTER_8TAP_SMOOTH ][1][0][0] = avg ## sz ## _simd128; \
+    dsp->mc[idx][FILTER_8TAP_REGULAR][1][0][0] = avg ## sz ## _simd128; \
+    dsp->mc[idx][FILTER_8TAP_SHARP  ][1][0][0] = avg ## sz ## _simd128; \
+    dsp->mc[idx][FILTER_BILINEAR    ][1][0][0] = avg ## sz ## _simd128
+
+#define init_subpel1(idx1, idx2, idxh, idxv, sz, dir, type)                                    \
+    dsp->mc[idx1][FILTER_8TAP_SMOOTH ][idx2][idxh][idxv] = type ## _8tap_smooth_  ## sz ## dir ## _simd128; \
+    dsp->mc[idx1][FILTER_8TAP_REGULAR][idx2][idxh][idxv] = type ## _8tap_regular_ ## sz ## dir ## _simd128; \
+    dsp->mc[idx1][FILTER_8TAP_SHARP  ][idx2][idxh][idxv] = type ## _8tap_sharp_   ## sz ## dir ## _simd128
+
+#define init_subpel2(idx, idxh, idxv, dir, type)       \
+    init_subpel1(0, idx, idxh, idxv, 64, dir, type);   \
+    init_subpel1(1, idx, idxh, idxv, 32, dir, type);   \
+    init_subpel1(2, idx, idxh, idxv, 16, dir, type);   \
+    init_subpel1(3, idx, idxh, idxv,  8, dir, type)
+
+#define init_subpel3(idx, type)         \
+    init_subpel2(idx, 1, 1, hv, type);  \
+    init_subpel2(idx, 0, 1, v, type);   \
+    init_subpel2(idx, 1, 0, h, type)
+
+    init_fpel(0, 64);
+    init_fpel(1, 32);
+    init_fpel(2, 16);
+    init_fpel(3,  8);
+    init_subpel3(0, put);
+    init_subpel3(1, avg);
+
+#undef init_fpel
+#undef init_subpel1
+#undef init_subpel2
+#undef init_subpel3
+#endif
+}
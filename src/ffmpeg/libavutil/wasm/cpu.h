@@ -0,0 +1,39 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVUTIL_WASM_CPU_H
+#define AVUTIL_WASM_CPU_H
+
+#include "libavutil/cpu.h"
+
+/*
+ * WebAssembly SIMD128, set when the library is built with -msimd128. n5.1.4
+ * has no wasm flags, the bit is unused by every other arch. Clearing it with
+ * av_force_cpu_flags(), ex: -cpuflags 0, selects the C functions.
+ */
+#define AV_CPU_FLAG_SIMD128 (1 << 30)
+
+#if defined(__wasm_simd128__)
+#define have_simd128(flags) ((flags) & AV_CPU_FLAG_SIMD128)
+#else
+#define have_simd128(flags) 0
+#endif
+
+int ff_get_cpu_flags_wasm(void);
+
+#endif /* AVUTIL_WASM_CPU_H */
@@ -0,0 +1,257 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * WebAssembly SIMD128 RGB to YUV input converters of packed 8-bit RGB.
+ *
+ * 4 pixels are converted at once: a swizzle spreads R and G, then B, of
+ * every pixel into 16-bit lanes and a dot product with the coefficients of
+ * rgb2yuv gives the same sums as C. The 32-bit formats are converted by C
+ * with the coefficients and rounding scaled by 256, which gives the same
+ * results as the 24-bit formula used here.
+ */
+
+#include "config.h"
+#include "libavutil/attributes.h"
+#include "libswscale/swscale_internal.h"
+#include "swscale_wasm.h"
+
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+
+#define Y_RND  ((32 << (RGB2YUV_SHIFT - 1)) + (1 << (RGB2YUV_SHIFT - 7)))
+#define UV_RND ((256 << (RGB2YUV_SHIFT - 1)) + (1 << (RGB2YUV_SHIFT - 7)))
+#define UV_HALF_RND ((256 << RGB2YUV_SHIFT) + (1 << (RGB2YUV_SHIFT - 6)))
+
+/* the dot products take the coefficients as int16_t */
+static av_always_inline int fit_i16(const uint32_t *rgb2yuv, int r, int g, int b)
+{
+    return (int32_t)rgb2yuv[r] == (int16_t)rgb2yuv[r] &&
+           (int32_t)rgb2yuv[g] == (int16_t)rgb2yuv[g] &&
+           (int32_t)rgb2yuv[b] == (int16_t)rgb2yuv[b];
+}
+
+/* swizzle of R and G of 4 pixels into (R, G) pairs of 16-bit lanes */
+static av_always_inline v128_t rg_index(int bpp, int ro, int go)
+{
+    return wasm_u8x16_make(ro,           0x80, go,           0x80,
+                           ro + bpp,     0x80, go + bpp,     0x80,
+                           ro + 2 * bpp, 0x80, go + 2 * bpp, 0x80,
+                           ro + 3 * bpp, 0x80, go + 3 * bpp, 0x80);
+}
+
+/* swizzle of B of 4 pixels into (B, 0) pairs of 16-bit lanes */
+static av_always_inline v128_t b_index(int bpp, int bo)
+{
+    return wasm_u8x16_make(bo,           0x80, 0x80, 0x80,
+                           bo + bpp,     0x80, 0x80, 0x80,
+                           bo + 2 * bpp, 0x80, 0x80, 0x80,
+                           bo + 3 * bpp, 0x80, 0x80, 0x80);
+}
+
+/* cr * R + cg * G + cb * B of the 4 pixels of px */
+static av_always_inline v128_t dot_rgb(v128_t px, v128_t rg_idx, v128_t b_idx,
+                                       v128_t crg, v128_t cb)
+{
+    return wasm_i32x4_add(wasm_i32x4_dot_i16x8(wasm_i8x16_swizzle(px, rg_idx), crg),
+                          wasm_i32x4_dot_i16x8(wasm_i8x16_swizzle(px, b_idx), cb));
+}
+
+static av_always_inline v128_t coeffs_rg(const uint32_t *rgb2yuv, int r, int g)
+{
+    return wasm_i16x8_make(rgb2yuv[r], rgb2yuv[g], rgb2yuv[r], rgb2yuv[g],
+                           rgb2yuv[r], rgb2yuv[g], rgb2yuv[r], rgb2yuv[g]);
+}
+
+static av_always_inline v128_t coeffs_b(const uint32_t *rgb2yuv, int b)
+{
+    return wasm_i16x8_make(rgb2yuv[b], 0, rgb2yuv[b], 0, rgb2yuv[b], 0, rgb2yuv[b], 0);
+}
+
+static av_always_inline void store_i32x4_as_i16(int16_t *dst, v128_t v)
+{
+    wasm_v128_store64_lane(dst, wasm_i16x8_shuffle(v, v, 0, 2, 4, 6, 0, 2, 4, 6), 0);
+}
+
+static av_always_inline void rgb_to_y(int16_t *dst, const uint8_t *src, int width,
+                                      const uint32_t *rgb2yuv,
+                                      int bpp, int ro, int go, int bo)
+{
+    int32_t ry = rgb2yuv[RY_IDX], gy = rgb2yuv[GY_IDX], by = rgb2yuv[BY_IDX];
+    int i = 0;
+
+    if (fit_i16(rgb2yuv, RY_IDX, GY_IDX, BY_IDX)) {
+        const v128_t rg_idx = rg_index(bpp, ro, go), b_idx = b_index(bpp, bo);
+        const v128_t crg = coeffs_rg(rgb2yuv, RY_IDX, GY_IDX);
+        const v128_t cb  = coeffs_b(rgb2yuv, BY_IDX);
+        const v128_t rnd = wasm_i32x4_splat(Y_RND);
+
+        /* loads are 16 bytes, past the 4 pixels of 24-bit formats */
+        for (; i * bpp + 16 <= width * bpp; i += 4) {
+            v128_t px = wasm_v128_load(src + i * bpp);
+            v128_t y  = wasm_i32x4_add(dot_rgb(px, rg_idx, b_idx, crg, cb), rnd);
+            store_i32x4_as_i16(dst + i, wasm_i32x4_shr(y, RGB2YUV_SHIFT - 6));
+        }
+    }
+    for (; i < width; i++) {
+        int r = src[i * bpp + ro];
+        int g = src[i * bpp + go];
+        int b = src[i * bpp + bo];
+
+        dst[i] = (ry * r + gy * g + by * b + Y_RND) >> (RGB2YUV_SHIFT - 6);
+    }
+}
+
+static av_always_inline void rgb_to_uv(int16_t *dstU, int16_t *dstV,
+                                       const uint8_t *src, int width,
+                                       const uint32_t *rgb2yuv,
+                                       int bpp, int ro, int go, int bo)
+{
+    int32_t ru = rgb2yuv[RU_IDX], gu = rgb2yuv[GU_IDX], bu = rgb2yuv[BU_IDX];
+    int32_t rv = rgb2yuv[RV_IDX], gv = rgb2yuv[GV_IDX], bv = rgb2yuv[BV_IDX];
+    int i = 0;
+
+    if (fit_i16(rgb2yuv, RU_IDX, GU_IDX, BU_IDX) &&
+        fit_i16(rgb2yuv, RV_IDX, GV_IDX, BV_IDX)) {
+        const v128_t rg_idx = rg_index(bpp, ro, go), b_idx = b_index(bpp, bo);
+        const v128_t cu_rg = coeffs_rg(rgb2yuv, RU_IDX, GU_IDX);
+        const v128_t cu_b  = coeffs_b(rgb2yuv, BU_IDX);
+        const v128_t cv_rg = coeffs_rg(rgb2yuv, RV_IDX, GV_IDX);
+        const v128_t cv_b  = coeffs_b(rgb2yuv, BV_IDX);
+        const v128_t rnd   = wasm_i32x4_splat(UV_RND);
+
+        for (; i * bpp + 16 <= width * bpp; i += 4) {
+            v128_t px = wasm_v128_load(src + i * bpp);
+            v128_t u  = wasm_i32x4_add(dot_rgb(px, rg_idx, b_idx, cu_rg, cu_b), rnd);
+            v128_t v  = wasm_i32x4_add(dot_rgb(px, rg_idx, b_idx, cv_rg, cv_b), rnd);
+            store_i32x4_as_i16(dstU + i, wasm_i32x4_shr(u, RGB2YUV_SHIFT - 6));
+            store_i32x4_as_i16(dstV + i, wasm_i32x4_shr(v, RGB2YUV_SHIFT - 6));
+        }
+    }
+    for (; i < width; i++) {
+        int r = src[i * bpp + ro];
+        int g = src[i * bpp + go];
+        int b = src[i * bpp + bo];
+
+        dstU[i] = (ru * r + gu * g + bu * b + UV_RND) >> (RGB2YUV_SHIFT - 6);
+        dstV[i] = (rv * r + gv * g + bv * b + UV_RND) >> (RGB2YUV_SHIFT - 6);
+    }
+}
+
+/*
+ * Chroma of horizontally subsampled outputs, from the sums of 2 pixels. The
+ * formula is linear, so the sums of the products of each pixel are added.
+ */
+static av_always_inline void rgb_to_uv_half(int16_t *dstU, int16_t *dstV,
+                                            const uint8_t *src, int width,
+                                            const uint32_t *rgb2yuv,
+                                            int bpp, int ro, int go, int bo)
+{
+    int32_t ru = rgb2yuv[RU_IDX], gu = rgb2yuv[GU_IDX], bu = rgb2yuv[BU_IDX];
+    int32_t rv = rgb2yuv[RV_IDX], gv = rgb2yuv[GV_IDX], bv = rgb2yuv[BV_IDX];
+    int i = 0;
+
+    if (fit_i16(rgb2yuv, RU_IDX, GU_IDX, BU_IDX) &&
+        fit_i16(rgb2yuv, RV_IDX, GV_IDX, BV_IDX)) {
+        const v128_t rg_idx = rg_index(bpp, ro, go), b_idx = b_index(bpp, bo);
+        const v128_t cu_rg = coeffs_rg(rgb2yuv, RU_IDX, GU_IDX);
+        const v128_t cu_b  = coeffs_b(rgb2yuv, BU_IDX);
+        const v128_t cv_rg = coeffs_rg(rgb2yuv, RV_IDX, GV_IDX);
+        const v128_t cv_b  = coeffs_b(rgb2yuv, BV_IDX);
+        const v128_t rnd   = wasm_i32x4_splat(UV_HALF_RND);
+
+        for (; (2 * i + 4) * bpp + 16 <= 2 * width * bpp; i += 4) {
+            v128_t px0 = wasm_v128_load(src + 2 * i * bpp);
+            v128_t px1 = wasm_v128_load(src + (2 * i + 4) * bpp);
+            v128_t u0  = dot_rgb(px0, rg_idx, b_idx, cu_rg, cu_b);
+            v128_t u1  = dot_rgb(px1, rg_idx, b_idx, cu_rg, cu_b);
+            v128_t v0  = dot_rgb(px0, rg_idx, b_idx, cv_rg, cv_b);
+            v128_t v1  = dot_rgb(px1, rg_idx, b_idx, cv_rg, cv_b);
+            v128_t u   = wasm_i32x4_add(wasm_i32x4_add(wasm_i32x4_shuffle(u0, u1, 0, 2, 4, 6),
+                                                       wasm_i32x4_shuffle(u0, u1, 1, 3, 5, 7)), rnd);
+            v128_t v   = wasm_i32x4_add(wasm_i32x4_add(wasm_i32x4_shuffle(v0, v1, 0, 2, 4, 6),
+                                                       wasm_i32x4_shuffle(v0, v1, 1, 3, 5, 7)), rnd);
+            store_i32x4_as_i16(dstU + i, wasm_i32x4_shr(u, RGB2YUV_SHIFT - 5));
+            store_i32x4_as_i16(dstV + i, wasm_i32x4_shr(v, RGB2YUV_SHIFT - 5));
+        }
+    }
+    for (; i < width; i++) {
+        int r = src[2 * i * bpp + ro] + src[(2 * i + 1) * bpp + ro];
+        int g = src[2 * i * bpp + go] + src[(2 * i + 1) * bpp + go];
+        int b = src[2 * i * bpp + bo] + src[(2 * i + 1) * bpp + bo];
+
+        dstU[i] = (ru * r + gu * g + bu * b + UV_HALF_RND) >> (RGB2YUV_SHIFT - 5);
+        dstV[i] = (rv * r + gv * g + bv * b + UV_HALF_RND) >> (RGB2YUV_SHIFT - 5);
+    }
+}
+
+#define RGB_FUNCS(name, bpp, ro, go, bo)                                            \
+static void name ## ToY_simd128(uint8_t *dst, const uint8_t *src,                   \
+                                const uint8_t *unused1, const uint8_t *unused2,     \
+                                int width, uint32_t *rgb2yuv)                       \
+{                                                                                   \
+    rgb_to_y((int16_t *)dst, src, width, rgb2yuv, bpp, ro, go, bo);                 \
+}                                                                                   \
+                                                                                    \
+static void name ## ToUV_simd128(uint8_t *dstU, uint8_t *dstV,                      \
+                                 const uint8_t *unused0, const uint8_t *src1,       \
+                                 const uint8_t *src2, int width, uint32_t *rgb2yuv) \
+{                                                                                   \
+    rgb_to_uv((int16_t *)dstU, (int16_t *)dstV, src1, width, rgb2yuv,               \
+              bpp, ro, go, bo);                                                     \
+}                                                                                   \
+                                                                                    \
+static void name ## ToUV_half_simd128(uint8_t *dstU, uint8_t *dstV,                 \
+                                      const uint8_t *unused0, const uint8_t *src1,  \
+                                      const uint8_t *src2, int width,               \
+                                      uint32_t *rgb2yuv)                            \
+{                                                                                   \
+    rgb_to_uv_half((int16_t *)dstU, (int16_t *)dstV, src1, width, rgb2yuv,          \
+                   bpp, ro, go, bo);                                                \
+}
+
+RGB_FUNCS(rgb24, 3, 0, 1, 2)
+RGB_FUNCS(bgr24, 3, 2, 1, 0)
+RGB_FUNCS(rgba,  4, 0, 1, 2)
+RGB_FUNCS(bgra,  4, 2, 1, 0)
+RGB_FUNCS(argb,  4, 1, 2, 3)
+RGB_FUNCS(abgr,  4, 3, 2, 1)
+
+#define ASSIGN_RGB_FUNCS(fmt, name)                                       \
+    case fmt:                                                             \
+        c->lumToYV12 = name ## ToY_simd128;                               \
+        c->chrToYV12 = c->chrSrcHSubSample ? name ## ToUV_half_simd128    \
+                                           : name ## ToUV_simd128;        \
+        break;
+#endif /* __wasm_simd128__ */
+
+av_cold void ff_sws_init_input_wasm(SwsContext *c)
+{
+#if defined(__wasm_simd128__)
+    switch (c->srcFormat) {
+    ASSIGN_RGB_FUNCS(AV_PIX_FMT_RGB24, rgb24)
+    ASSIGN_RGB_FUNCS(AV_PIX_FMT_BGR24, bgr24)
+    ASSIGN_RGB_FUNCS(AV_PIX_FMT_RGBA,  rgba)
+    ASSIGN_RGB_FUNCS(AV_PIX_FMT_BGRA,  bgra)
+    ASSIGN_RGB_FUNCS(AV_PIX_FMT_ARGB,  argb)
+    ASSIGN_RGB_FUNCS(AV_PIX_FMT_ABGR,  abgr)
+    default:
+        break;
+    }
+#endif
+}
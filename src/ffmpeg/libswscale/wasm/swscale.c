@@ -0,0 +1,218 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * WebAssembly SIMD128 horizontal and vertical scalers.
+ *
+ * Every kernel computes the same integers as the C function it replaces,
+ * including the wrap-around of the int accumulators, so the output is bit
+ * exact. They are selected when the library is built with -msimd128 and
+ * AV_CPU_FLAG_SIMD128 is set, builds without it keep the C code.
+ */
+
+#include "config.h"
+#include "libavutil/attributes.h"
+#include "libavutil/common.h"
+#include "libavutil/cpu.h"
+#include "libavutil/wasm/cpu.h"
+#include "libswscale/swscale_internal.h"
+#include "swscale_wasm.h"
+
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+
+/* sums of the lanes of a, b, c and d, in this order */
+static av_always_inline v128_t hadd4(v128_t a, v128_t b, v128_t c, v128_t d)
+{
+    v128_t ab = wasm_i32x4_add(wasm_i32x4_shuffle(a, b, 0, 2, 4, 6),
+                               wasm_i32x4_shuffle(a, b, 1, 3, 5, 7));
+    v128_t cd = wasm_i32x4_add(wasm_i32x4_shuffle(c, d, 0, 2, 4, 6),
+                               wasm_i32x4_shuffle(c, d, 1, 3, 5, 7));
+
+    return wasm_i32x4_add(wasm_i32x4_shuffle(ab, cd, 0, 2, 4, 6),
+                          wasm_i32x4_shuffle(ab, cd, 1, 3, 5, 7));
+}
+
+/* low 16 bits of the 4 lanes of v, like the int to int16_t assignment of C */
+static av_always_inline void store_i32x4_as_i16(int16_t *dst, v128_t v)
+{
+    wasm_v128_store64_lane(dst, wasm_i16x8_shuffle(v, v, 0, 2, 4, 6, 0, 2, 4, 6), 0);
+}
+
+static av_always_inline int hscale_c(const uint8_t *src, const int16_t *filter,
+                                     int filterSize)
+{
+    int val = 0;
+
+    for (int j = 0; j < filterSize; j++)
+        val += ((int)src[j]) * filter[j];
+    return FFMIN(val >> 7, (1 << 15) - 1);
+}
+
+/* filterSize 4, one dot product covers two output pixels */
+static void hscale8to15_4_simd128(SwsContext *c, int16_t *dst, int dstW,
+                                  const uint8_t *src, const int16_t *filter,
+                                  const int32_t *filterPos, int filterSize)
+{
+    const v128_t max = wasm_i32x4_splat((1 << 15) - 1);
+    int i;
+
+    for (i = 0; i + 3 < dstW; i += 4) {
+        v128_t s01 = wasm_v128_load32_lane(src + filterPos[i + 1],
+                                           wasm_v128_load32_zero(src + filterPos[i]), 1);
+        v128_t s23 = wasm_v128_load32_lane(src + filterPos[i + 3],
+                                           wasm_v128_load32_zero(src + filterPos[i + 2]), 1);
+        v128_t d01 = wasm_i32x4_dot_i16x8(wasm_u16x8_extend_low_u8x16(s01),
+                                          wasm_v128_load(filter + 4 * i));
+        v128_t d23 = wasm_i32x4_dot_i16x8(wasm_u16x8_extend_low_u8x16(s23),
+                                          wasm_v128_load(filter + 4 * i + 8));
+        v128_t val = wasm_i32x4_add(wasm_i32x4_shuffle(d01, d23, 0, 2, 4, 6),
+                                    wasm_i32x4_shuffle(d01, d23, 1, 3, 5, 7));
+
+        store_i32x4_as_i16(dst + i, wasm_i32x4_min(wasm_i32x4_shr(val, 7), max));
+    }
+    for (; i < dstW; i++)
+        dst[i] = hscale_c(src + filterPos[i], filter + 4 * i, 4);
+}
+
+/* filterSize over 4, 8 taps per dot product, the last 1 to 3 taps in C */
+static void hscale8to15_x_simd128(SwsContext *c, int16_t *dst, int dstW,
+                                  const uint8_t *src, const int16_t *filter,
+                                  const int32_t *filterPos, int filterSize)
+{
+    const v128_t max = wasm_i32x4_splat((1 << 15) - 1);
+    int i;
+
+    for (i = 0; i + 3 < dstW; i += 4) {
+        v128_t sum[4];
+        int32_t rest[4];
+
+        for (int k = 0; k < 4; k++) {
+            const uint8_t *s = src + filterPos[i + k];
+            const int16_t *f = filter + filterSize * (i + k);
+            v128_t acc = wasm_i32x4_splat(0);
+            int j;
+
+            for (j = 0; j + 8 <= filterSize; j += 8)
+                acc = wasm_i32x4_add(acc, wasm_i32x4_dot_i16x8(wasm_u16x8_load8x8(s + j),
+                                                               wasm_v128_load(f + j)));
+            if (j + 4 <= filterSize) {
+                v128_t s4 = wasm_u16x8_extend_low_u8x16(wasm_v128_load32_zero(s + j));
+                acc = wasm_i32x4_add(acc, wasm_i32x4_dot_i16x8(s4, wasm_v128_load64_zero(f + j)));
+                j += 4;
+            }
+            sum[k]  = acc;
+            rest[k] = 0;
+            for (; j < filterSize; j++)
+                rest[k] += s[j] * f[j];
+        }
+        store_i32x4_as_i16(dst + i,
+                           wasm_i32x4_min(wasm_i32x4_shr(wasm_i32x4_add(hadd4(sum[0], sum[1], sum[2], sum[3]),
+                                                                        wasm_v128_load(rest)), 7),
+                                          max));
+    }
+    for (; i < dstW; i++)
+        dst[i] = hscale_c(src + filterPos[i], filter + filterSize * i, filterSize);
+}
+
+static void yuv2planeX_8_simd128(const int16_t *filter, int filterSize,
+                                 const int16_t **src, uint8_t *dest, int dstW,
+                                 const uint8_t *dither, int offset)
+{
+    int32_t dith[8];
+    v128_t dith_lo, dith_hi;
+    int i;
+
+    /* blocks start at multiples of 8, so lane k always takes the same dither */
+    for (int k = 0; k < 8; k++)
+        dith[k] = dither[(k + offset) & 7] << 12;
+    dith_lo = wasm_v128_load(dith);
+    dith_hi = wasm_v128_load(dith + 4);
+
+    for (i = 0; i + 7 < dstW; i += 8) {
+        v128_t lo = dith_lo, hi = dith_hi, v;
+
+        for (int j = 0; j < filterSize; j++) {
+            v128_t s = wasm_v128_load(src[j] + i);
+            v128_t f = wasm_i16x8_splat(filter[j]);
+
+            lo = wasm_i32x4_add(lo, wasm_i32x4_extmul_low_i16x8(s, f));
+            hi = wasm_i32x4_add(hi, wasm_i32x4_extmul_high_i16x8(s, f));
+        }
+        v = wasm_i16x8_narrow_i32x4(wasm_i32x4_shr(lo, 19), wasm_i32x4_shr(hi, 19));
+        wasm_v128_store64_lane(dest + i, wasm_u8x16_narrow_i16x8(v, v), 0);
+    }
+    for (; i < dstW; i++) {
+        int val = dither[(i + offset) & 7] << 12;
+
+        for (int j = 0; j < filterSize; j++)
+            val += src[j][i] * filter[j];
+        dest[i] = av_clip_uint8(val >> 19);
+    }
+}
+
+static void yuv2plane1_8_simd128(const int16_t *src, uint8_t *dest, int dstW,
+                                 const uint8_t *dither, int offset)
+{
+    int16_t dith[8];
+    v128_t d;
+    int i;
+
+    for (int k = 0; k < 8; k++)
+        dith[k] = dither[(k + offset) & 7];
+    d = wasm_v128_load(dith);
+
+    /* saturating past INT16_MAX keeps the result at 255 like the int sum */
+    for (i = 0; i + 7 < dstW; i += 8) {
+        v128_t v = wasm_i16x8_shr(wasm_i16x8_add_sat(wasm_v128_load(src + i), d), 7);
+        wasm_v128_store64_lane(dest + i, wasm_u8x16_narrow_i16x8(v, v), 0);
+    }
+    for (; i < dstW; i++)
+        dest[i] = av_clip_uint8((src[i] + dither[(i + offset) & 7]) >> 7);
+}
+
+static void init_hscale(void (**hscale)(SwsContext *c, int16_t *dst, int dstW,
+                                        const uint8_t *src, const int16_t *filter,
+                                        const int32_t *filterPos, int filterSize),
+                        int filterSize)
+{
+    if (filterSize == 4)
+        *hscale = hscale8to15_4_simd128;
+    else if (filterSize > 4)
+        *hscale = hscale8to15_x_simd128;
+}
+#endif /* __wasm_simd128__ */
+
+av_cold void ff_sws_init_swscale_wasm(SwsContext *c)
+{
+#if defined(__wasm_simd128__)
+    int cpu_flags = av_get_cpu_flags();
+
+    if (!have_simd128(cpu_flags))
+        return;
+    if (c->srcBpc == 8 && c->dstBpc <= 14) {
+        init_hscale(&c->hyScale, c->hLumFilterSize);
+        init_hscale(&c->hcScale, c->hChrFilterSize);
+    }
+    if (c->dstBpc == 8) {
+        c->yuv2planeX = yuv2planeX_8_simd128;
+        c->yuv2plane1 = yuv2plane1_8_simd128;
+    }
+    ff_sws_init_input_wasm(c);
+#endif
+}
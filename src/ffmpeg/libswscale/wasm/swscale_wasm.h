@@ -0,0 +1,33 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef SWSCALE_WASM_SWSCALE_WASM_H
+#define SWSCALE_WASM_SWSCALE_WASM_H
+
+#include "libswscale/swscale_internal.h"
+
+/* scalers, see swscale.c */
+void ff_sws_init_swscale_wasm(SwsContext *c);
+
+/* RGB to YUV input converters, see input.c */
+void ff_sws_init_input_wasm(SwsContext *c);
+
+/* YUV to RGB converters, see yuv2rgb.c */
+SwsFunc ff_yuv2rgb_init_wasm(SwsContext *c);
+
+#endif /* SWSCALE_WASM_SWSCALE_WASM_H */
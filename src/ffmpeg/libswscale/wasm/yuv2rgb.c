@@ -0,0 +1,380 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * WebAssembly SIMD128 YUV420P to RGB24 / RGB32 converters.
+ *
+ * The converters of C look every channel up in c->yuvTable, whose entries are
+ * av_clip_uint8((yb + 0x8000) >> 16) of a yb growing by cy per entry, so a
+ * channel is av_clip_uint8((Y * cy + K) >> 16) where K only depends on the
+ * chroma. At every call the entries the call can reach are checked against
+ * this formula, tables it does not match take the lookups of C instead.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "config.h"
+#include "libavutil/attributes.h"
+#include "libavutil/common.h"
+#include "libavutil/cpu.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/pixfmt.h"
+#include "libavutil/wasm/cpu.h"
+#include "libswscale/swscale_internal.h"
+#include "swscale_wasm.h"
+
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+
+enum { CH_R, CH_G, CH_B, CH_A };
+
+typedef struct YUV2RGBParams {
+    int32_t kr[256];
+    int32_t kgu[256];
+    int32_t kgv[256];
+    int32_t kb[256];
+    int32_t cy;
+    int bpp;                    /* 3 or 4 bytes */
+    int order[4];               /* channel of every byte of a pixel */
+} YUV2RGBParams;
+
+static int format_order(enum AVPixelFormat fmt, int order[4])
+{
+    static const struct {
+        enum AVPixelFormat fmt;
+        int order[4];
+    } formats[] = {
+        { AV_PIX_FMT_RGB24, { CH_R, CH_G, CH_B, CH_A } },
+        { AV_PIX_FMT_BGR24, { CH_B, CH_G, CH_R, CH_A } },
+        { AV_PIX_FMT_RGBA,  { CH_R, CH_G, CH_B, CH_A } },
+        { AV_PIX_FMT_BGRA,  { CH_B, CH_G, CH_R, CH_A } },
+        { AV_PIX_FMT_ARGB,  { CH_A, CH_R, CH_G, CH_B } },
+        { AV_PIX_FMT_ABGR,  { CH_A, CH_B, CH_G, CH_R } },
+    };
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(formats); i++) {
+        if (formats[i].fmt == fmt) {
+            memcpy(order, formats[i].order, sizeof(formats[i].order));
+            return fmt == AV_PIX_FMT_RGB24 || fmt == AV_PIX_FMT_BGR24 ? 3 : 4;
+        }
+    }
+    return 0;
+}
+
+/* element index of every entry of a chroma table, elements are elem bytes */
+static int table_offsets(int64_t off[256], uint8_t *const *table,
+                         const uint8_t *base, int elem)
+{
+    for (int i = 0; i < 256; i++) {
+        ptrdiff_t d = table[i + YUVRGB_TABLE_HEADROOM] - base;
+        if (d % elem)
+            return AVERROR(EINVAL);
+        off[i] = d / elem;
+    }
+    return 0;
+}
+
+static void min_max(const int64_t *v, int64_t *lo, int64_t *hi)
+{
+    *lo = *hi = v[0];
+    for (int i = 1; i < 256; i++) {
+        *lo = FFMIN(*lo, v[i]);
+        *hi = FFMAX(*hi, v[i]);
+    }
+}
+
+/*
+ * Checks entries first to last of a plane starting at element plane, the
+ * entries of 32-bit tables hold their channel at byte pos, and the alpha of
+ * the R plane.
+ */
+static int check_plane(SwsContext *c, const YUV2RGBParams *p, int64_t yb,
+                       int64_t plane, int64_t first, int64_t last,
+                       int pos, uint32_t alpha)
+{
+    const uint8_t  *t8  = c->yuvTable;
+    const uint32_t *t32 = c->yuvTable;
+
+    if (first < plane || last - first > 4096)
+        return AVERROR(EINVAL);
+    for (int64_t i = first; i <= last; i++) {
+        unsigned v = av_clip_uint8((yb + (i - plane) * p->cy + 0x8000) >> 16);
+        if (p->bpp == 3 ? t8[i] != v : t32[i] != (v << 8 * pos) + alpha)
+            return AVERROR(EINVAL);
+    }
+    return 0;
+}
+
+static int fit_i32(int64_t k, int32_t cy)
+{
+    return k >= INT32_MIN && k <= INT32_MAX &&
+           k + 255 * cy >= INT32_MIN && k + 255 * cy <= INT32_MAX;
+}
+
+/* fills p from the tables, returns < 0 if they are not the linear ones */
+static int init_params(SwsContext *c, YUV2RGBParams *p)
+{
+    const int planes = p->bpp == 4, elem = p->bpp == 4 ? 4 : 1;
+    const int64_t plane_size = 1024 + 2 * YUVRGB_TABLE_LUMA_HEADROOM;
+    const uint8_t *base = c->yuvTable;
+    int64_t offr[256], offgu[256], offgv[256], offb[256];
+    int64_t cy = 1 << 16, oy = 0, yb, lo, hi, lo2, hi2;
+    int pos[4];
+
+    /* cy and the first yb of ff_yuv2rgb_c_init_tables() */
+    if (!c->srcRange) {
+        cy = (cy * 255) / 219;
+        oy = 16 << 16;
+    }
+    cy  = (cy * c->contrast) >> 16;
+    oy -= 256LL * c->brightness;
+    yb  = -(384 << 16) - YUVRGB_TABLE_LUMA_HEADROOM * cy - oy;
+    if (cy <= 0 || cy > (1 << 20) || !base)
+        return AVERROR(EINVAL);
+    p->cy = cy;
+
+    for (int i = 0; i < p->bpp; i++)
+        pos[p->order[i]] = i;
+
+    if (table_offsets(offr,  c->table_rV, base, elem) < 0 ||
+        table_offsets(offgu, c->table_gU, base, elem) < 0 ||
+        table_offsets(offb,  c->table_bU, base, elem) < 0)
+        return AVERROR(EINVAL);
+    for (int i = 0; i < 256; i++) {
+        int gv = c->table_gV[i + YUVRGB_TABLE_HEADROOM];
+        if (gv % elem)
+            return AVERROR(EINVAL);
+        offgv[i] = gv / elem;
+    }
+
+    min_max(offr, &lo, &hi);
+    if (check_plane(c, p, yb, 0, lo, hi + 255, pos[CH_R],
+                    p->bpp == 4 ? 255u << 8 * pos[CH_A] : 0) < 0)
+        return AVERROR(EINVAL);
+    min_max(offgu, &lo, &hi);
+    min_max(offgv, &lo2, &hi2);
+    if (check_plane(c, p, yb, planes * plane_size, lo + lo2, hi + hi2 + 255,
+                    pos[CH_G], 0) < 0)
+        return AVERROR(EINVAL);
+    min_max(offb, &lo, &hi);
+    if (check_plane(c, p, yb, 2 * planes * plane_size, lo, hi + 255,
+                    pos[CH_B], 0) < 0)
+        return AVERROR(EINVAL);
+
+    for (int i = 0; i < 256; i++) {
+        int64_t kr  = yb + 0x8000 + offr[i] * cy;
+        int64_t kgu = yb + 0x8000 + (offgu[i] - planes * plane_size) * cy;
+        int64_t kgv = offgv[i] * cy;
+        int64_t kb  = yb + 0x8000 + (offb[i] - 2 * planes * plane_size) * cy;
+        if (!fit_i32(kr, cy) || !fit_i32(kgu, 0) || !fit_i32(kgv, 0) || !fit_i32(kb, cy))
+            return AVERROR(EINVAL);
+        p->kr[i]  = kr;
+        p->kgu[i] = kgu;
+        p->kgv[i] = kgv;
+        p->kb[i]  = kb;
+    }
+    /* every K of G lies between the sums of the extremes of both tables */
+    min_max(offgu, &lo, &hi);
+    if (!fit_i32(yb + 0x8000 + (lo + lo2 - planes * plane_size) * cy, cy) ||
+        !fit_i32(yb + 0x8000 + (hi + hi2 - planes * plane_size) * cy, cy))
+        return AVERROR(EINVAL);
+    return 0;
+}
+
+/* the lookups of the converters of C, for tables init_params() rejects */
+static void convert_rows_lut(SwsContext *c, int bpp, const int order[4],
+                             uint8_t *dst1, uint8_t *dst2,
+                             const uint8_t *py1, const uint8_t *py2,
+                             const uint8_t *pu, const uint8_t *pv, int width)
+{
+    for (int x = 0; x + 1 < width; x += 2) {
+        int U = pu[x >> 1], V = pv[x >> 1];
+        const uint8_t *r = c->table_rV[V + YUVRGB_TABLE_HEADROOM];
+        const uint8_t *g = c->table_gU[U + YUVRGB_TABLE_HEADROOM] +
+                           c->table_gV[V + YUVRGB_TABLE_HEADROOM];
+        const uint8_t *b = c->table_bU[U + YUVRGB_TABLE_HEADROOM];
+
+        for (int k = 0; k < 4; k++) {
+            int Y = (k < 2 ? py1 : py2)[x + (k & 1)];
+            uint8_t *d = (k < 2 ? dst1 : dst2) + (x + (k & 1)) * bpp;
+
+            if (bpp == 3) {
+                uint8_t ch[3] = { r[Y], g[Y], b[Y] };
+                for (int i = 0; i < 3; i++)
+                    d[i] = ch[order[i]];
+            } else {
+                AV_WN32A(d, ((const uint32_t *)r)[Y] + ((const uint32_t *)g)[Y] +
+                            ((const uint32_t *)b)[Y]);
+            }
+        }
+    }
+}
+
+/* av_clip_uint8((Y * cy + k) >> 16) of 16 pixels, k of pixels 4 * i + j in k[i] */
+static av_always_inline v128_t channel(const v128_t ycy[4], const v128_t k[4])
+{
+    v128_t lo = wasm_i16x8_narrow_i32x4(wasm_i32x4_shr(wasm_i32x4_add(ycy[0], k[0]), 16),
+                                        wasm_i32x4_shr(wasm_i32x4_add(ycy[1], k[1]), 16));
+    v128_t hi = wasm_i16x8_narrow_i32x4(wasm_i32x4_shr(wasm_i32x4_add(ycy[2], k[2]), 16),
+                                        wasm_i32x4_shr(wasm_i32x4_add(ycy[3], k[3]), 16));
+
+    return wasm_u8x16_narrow_i16x8(lo, hi);
+}
+
+/* k of 8 chroma samples, each repeated for its 2 pixels */
+static av_always_inline void repeat_chroma(v128_t k[4], const int32_t *src)
+{
+    v128_t a = wasm_v128_load(src), b = wasm_v128_load(src + 4);
+
+    k[0] = wasm_i32x4_shuffle(a, a, 0, 0, 1, 1);
+    k[1] = wasm_i32x4_shuffle(a, a, 2, 2, 3, 3);
+    k[2] = wasm_i32x4_shuffle(b, b, 0, 0, 1, 1);
+    k[3] = wasm_i32x4_shuffle(b, b, 2, 2, 3, 3);
+}
+
+static av_always_inline void store_rgb24(uint8_t *dst, const v128_t ch[3])
+{
+    v128_t a0 = wasm_i8x16_shuffle(ch[0], ch[1], 0, 16, 0, 1, 17, 0, 2, 18, 0, 3, 19, 0, 4, 20, 0, 5);
+    v128_t a1 = wasm_i8x16_shuffle(ch[0], ch[1], 21, 0, 6, 22, 0, 7, 23, 0, 8, 24, 0, 9, 25, 0, 10, 26);
+    v128_t a2 = wasm_i8x16_shuffle(ch[0], ch[1], 0, 11, 27, 0, 12, 28, 0, 13, 29, 0, 14, 30, 0, 15, 31, 0);
+
+    wasm_v128_store(dst,      wasm_i8x16_shuffle(a0, ch[2], 0, 1, 16, 3, 4, 17, 6, 7, 18, 9, 10, 19, 12, 13, 20, 15));
+    wasm_v128_store(dst + 16, wasm_i8x16_shuffle(a1, ch[2], 0, 21, 2, 3, 22, 5, 6, 23, 8, 9, 24, 11, 12, 25, 14, 15));
+    wasm_v128_store(dst + 32, wasm_i8x16_shuffle(a2, ch[2], 26, 1, 2, 27, 4, 5, 28, 7, 8, 29, 10, 11, 30, 13, 14, 31));
+}
+
+static av_always_inline void store_rgb32(uint8_t *dst, const v128_t ch[4])
+{
+    v128_t b01_lo = wasm_i8x16_shuffle(ch[0], ch[1], 0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23);
+    v128_t b01_hi = wasm_i8x16_shuffle(ch[0], ch[1], 8, 24, 9, 25, 10, 26, 11, 27, 12, 28, 13, 29, 14, 30, 15, 31);
+    v128_t b23_lo = wasm_i8x16_shuffle(ch[2], ch[3], 0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23);
+    v128_t b23_hi = wasm_i8x16_shuffle(ch[2], ch[3], 8, 24, 9, 25, 10, 26, 11, 27, 12, 28, 13, 29, 14, 30, 15, 31);
+
+    wasm_v128_store(dst,      wasm_i16x8_shuffle(b01_lo, b23_lo, 0, 8, 1, 9, 2, 10, 3, 11));
+    wasm_v128_store(dst + 16, wasm_i16x8_shuffle(b01_lo, b23_lo, 4, 12, 5, 13, 6, 14, 7, 15));
+    wasm_v128_store(dst + 32, wasm_i16x8_shuffle(b01_hi, b23_hi, 0, 8, 1, 9, 2, 10, 3, 11));
+    wasm_v128_store(dst + 48, wasm_i16x8_shuffle(b01_hi, b23_hi, 4, 12, 5, 13, 6, 14, 7, 15));
+}
+
+static av_always_inline void convert_row(const YUV2RGBParams *p, uint8_t *dst,
+                                         const uint8_t *py, const v128_t cy,
+                                         const v128_t kr[4], const v128_t kg[4],
+                                         const v128_t kb[4])
+{
+    v128_t y = wasm_v128_load(py), ycy[4], ch[4], out[4];
+    v128_t lo = wasm_u16x8_extend_low_u8x16(y), hi = wasm_u16x8_extend_high_u8x16(y);
+
+    ycy[0] = wasm_i32x4_mul(wasm_u32x4_extend_low_u16x8(lo),  cy);
+    ycy[1] = wasm_i32x4_mul(wasm_u32x4_extend_high_u16x8(lo), cy);
+    ycy[2] = wasm_i32x4_mul(wasm_u32x4_extend_low_u16x8(hi),  cy);
+    ycy[3] = wasm_i32x4_mul(wasm_u32x4_extend_high_u16x8(hi), cy);
+    ch[CH_R] = channel(ycy, kr);
+    ch[CH_G] = channel(ycy, kg);
+    ch[CH_B] = channel(ycy, kb);
+    ch[CH_A] = wasm_u8x16_splat(0xff);
+
+    for (int i = 0; i < p->bpp; i++)
+        out[i] = ch[p->order[i]];
+    if (p->bpp == 3)
+        store_rgb24(dst, out);
+    else
+        store_rgb32(dst, out);
+}
+
+/* pixels x to width of both rows, one pair after the other */
+static void convert_tail(const YUV2RGBParams *p, uint8_t *dst1, uint8_t *dst2,
+                         const uint8_t *py1, const uint8_t *py2,
+                         const uint8_t *pu, const uint8_t *pv, int x, int width)
+{
+    for (; x + 1 < width; x += 2) {
+        int U = pu[x >> 1], V = pv[x >> 1];
+        int32_t k[3] = { p->kr[V], p->kgu[U] + p->kgv[V], p->kb[U] };
+
+        for (int j = 0; j < 4; j++) {
+            int Y = (j < 2 ? py1 : py2)[x + (j & 1)];
+            uint8_t *d = (j < 2 ? dst1 : dst2) + (x + (j & 1)) * p->bpp;
+
+            for (int i = 0; i < p->bpp; i++) {
+                int ch = p->order[i];
+                d[i] = ch == CH_A ? 0xff : av_clip_uint8((Y * p->cy + k[ch]) >> 16);
+            }
+        }
+    }
+}
+
+static int yuv420p_to_rgb_simd128(SwsContext *c, const uint8_t *src[],
+                                  int srcStride[], int srcSliceY, int srcSliceH,
+                                  uint8_t *dst[], int dstStride[])
+{
+    YUV2RGBParams p;
+    const int width = c->dstW;
+    int linear;
+
+    p.bpp  = format_order(c->dstFormat, p.order);
+    linear = init_params(c, &p) >= 0;
+
+    /* rows go by pairs sharing a chroma row, like the C converters */
+    for (int y = 0; y < srcSliceH; y += 2) {
+        int yd = y + srcSliceY;
+        uint8_t *dst1 = dst[0] + yd * dstStride[0];
+        uint8_t *dst2 = dst1 + dstStride[0];
+        const uint8_t *py1 = src[0] + y * srcStride[0];
+        const uint8_t *py2 = py1 + srcStride[0];
+        const uint8_t *pu  = src[1] + (y >> 1) * srcStride[1];
+        const uint8_t *pv  = src[2] + (y >> 1) * srcStride[2];
+        const v128_t cy = wasm_i32x4_splat(p.cy);
+        int x = 0;
+
+        if (!linear) {
+            convert_rows_lut(c, p.bpp, p.order, dst1, dst2, py1, py2, pu, pv, width);
+            continue;
+        }
+        for (; x + 16 <= width; x += 16) {
+            int32_t kr[8], kg[8], kb[8];
+            v128_t vkr[4], vkg[4], vkb[4];
+
+            for (int j = 0; j < 8; j++) {
+                int U = pu[(x >> 1) + j], V = pv[(x >> 1) + j];
+                kr[j] = p.kr[V];
+                kg[j] = p.kgu[U] + p.kgv[V];
+                kb[j] = p.kb[U];
+            }
+            repeat_chroma(vkr, kr);
+            repeat_chroma(vkg, kg);
+            repeat_chroma(vkb, kb);
+            convert_row(&p, dst1 + x * p.bpp, py1 + x, cy, vkr, vkg, vkb);
+            convert_row(&p, dst2 + x * p.bpp, py2 + x, cy, vkr, vkg, vkb);
+        }
+        convert_tail(&p, dst1, dst2, py1, py2, pu, pv, x, width);
+    }
+    return srcSliceH;
+}
+#endif /* __wasm_simd128__ */
+
+av_cold SwsFunc ff_yuv2rgb_init_wasm(SwsContext *c)
+{
+#if defined(__wasm_simd128__)
+    int order[4];
+
+    if (have_simd128(av_get_cpu_flags()) && c->srcFormat == AV_PIX_FMT_YUV420P &&
+        format_order(c->dstFormat, order) * 8 == c->dstFormatBpp)
+        return yuv420p_to_rgb_simd128;
+#endif
+    return NULL;
+}
@@ -0,0 +1,170 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Usage: checkasm [--bench] [--test=<name>] [seed]
+ *
+ * Returns 1 when a kernel differs from C, --bench also times every kernel
+ * and its C function.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/cpu.h"
+#include "libavutil/log.h"
+#include "libavutil/random_seed.h"
+#include "libavutil/wasm/cpu.h"
+#include "checkasm.h"
+
+static const struct {
+    const char *name;
+    void (*func)(void);
+} tests[] = {
+    { "h264dsp",    checkasm_check_h264dsp },
+    { "h264qpel",   checkasm_check_h264qpel },
+    { "hevcdsp",    checkasm_check_hevcdsp },
+    { "sw_scale",   checkasm_check_sw_scale },
+    { "sw_yuv2rgb", checkasm_check_sw_yuv2rgb },
+    { "vp9dsp",     checkasm_check_vp9dsp },
+};
+
+AVLFG checkasm_lfg;
+
+static struct {
+    const char *test;
+    char func[64];
+    int func_failed;
+    int nb_funcs;               /* of the current report */
+    int nb_failed;
+    int total_funcs;
+    int total_failed;
+    int bench;
+} state;
+
+void checkasm_set_simd128(int enabled)
+{
+    av_force_cpu_flags(enabled ? AV_CPU_FLAG_SIMD128 : 0);
+}
+
+int checkasm_check_func(const void *ref, const void *new, const char *name, ...)
+{
+    char buf[sizeof(state.func)];
+    va_list ap;
+
+    if (ref == new)
+        return 0;
+    va_start(ap, name);
+    vsnprintf(buf, sizeof(buf), name, ap);
+    va_end(ap);
+    if (strcmp(buf, state.func)) {
+        av_strlcpy(state.func, buf, sizeof(state.func));
+        state.func_failed = 0;
+        state.nb_funcs++;
+        state.total_funcs++;
+    }
+    return 1;
+}
+
+void checkasm_fail_func(const char *msg, ...)
+{
+    va_list ap;
+
+    if (state.func_failed)
+        return;
+    state.func_failed = 1;
+    state.nb_failed++;
+    state.total_failed++;
+    fprintf(stderr, "   %s (", state.func);
+    va_start(ap, msg);
+    vfprintf(stderr, msg, ap);
+    va_end(ap);
+    fprintf(stderr, ")\n");
+}
+
+void checkasm_report(const char *name, ...)
+{
+    char buf[64];
+    va_list ap;
+
+    if (!state.nb_funcs)
+        return;
+    va_start(ap, name);
+    vsnprintf(buf, sizeof(buf), name, ap);
+    va_end(ap);
+    printf(" - %s.%s [%s] (%d functions)\n", state.test, buf,
+           state.nb_failed ? "FAILED" : "OK", state.nb_funcs);
+    state.nb_funcs  = 0;
+    state.nb_failed = 0;
+    state.func[0]   = 0;
+}
+
+int checkasm_bench_func(void)
+{
+    return state.bench && !state.func_failed;
+}
+
+void checkasm_bench_report(int runs, int64_t ref_us, int64_t new_us)
+{
+    double ref_ns = ref_us * 1000.0 / runs, new_ns = new_us * 1000.0 / runs;
+
+    printf("   %-40s c: %10.1f ns  simd128: %10.1f ns  %6.2fx\n",
+           state.func, ref_ns, new_ns, new_ns > 0 ? ref_ns / new_ns : 0);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned seed = av_get_random_seed();
+    const char *test = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--bench"))
+            state.bench = 1;
+        else if (av_strstart(argv[i], "--test=", &test))
+            ;
+        else
+            seed = strtoul(argv[i], NULL, 10);
+    }
+
+    if (!have_simd128(av_get_cpu_flags())) {
+        fprintf(stderr, "checkasm: built without -msimd128, no kernel to test\n");
+        return 0;
+    }
+    av_log_set_level(AV_LOG_ERROR);
+    printf("checkasm: using random seed %u\n", seed);
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(tests); i++) {
+        if (test && strcmp(test, tests[i].name))
+            continue;
+        state.test = tests[i].name;
+        av_lfg_init(&checkasm_lfg, seed);
+        tests[i].func();
+    }
+    av_force_cpu_flags(-1);
+
+    if (state.total_failed) {
+        fprintf(stderr, "checkasm: %d of %d tested functions FAILED\n",
+                state.total_failed, state.total_funcs);
+        return 1;
+    }
+    printf("checkasm: all %d tested functions ok\n", state.total_funcs);
+    return 0;
+}
@@ -0,0 +1,97 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Tests of the WebAssembly SIMD128 kernels of src/ffmpeg, in the manner of
+ * tests/checkasm: every kernel runs against the C function it replaces on
+ * random inputs, which are selected by initializing the same context with
+ * and without AV_CPU_FLAG_SIMD128.
+ */
+
+#ifndef TESTS_WASM_CHECKASM_H
+#define TESTS_WASM_CHECKASM_H
+
+#include <stdint.h>
+
+#include "libavutil/attributes.h"
+#include "libavutil/avstring.h"
+#include "libavutil/lfg.h"
+#include "libavutil/time.h"
+
+void checkasm_check_h264dsp(void);
+void checkasm_check_h264qpel(void);
+void checkasm_check_hevcdsp(void);
+void checkasm_check_sw_scale(void);
+void checkasm_check_sw_yuv2rgb(void);
+void checkasm_check_vp9dsp(void);
+
+extern AVLFG checkasm_lfg;
+#define rnd() av_lfg_get(&checkasm_lfg)
+
+/* selects the C (0) or the SIMD128 (1) functions of the next init */
+void checkasm_set_simd128(int enabled);
+
+/*
+ * Starts the test of function name, returns 0 when ref and new are the same,
+ * ex: no kernel for these parameters. Consecutive calls with the same name
+ * test one function.
+ */
+int checkasm_check_func(const void *ref, const void *new, const char *name, ...)
+    av_printf_format(3, 4);
+void checkasm_fail_func(const char *msg, ...) av_printf_format(1, 2);
+void checkasm_report(const char *name, ...) av_printf_format(1, 2);
+int checkasm_bench_func(void);
+void checkasm_bench_report(int runs, int64_t ref_us, int64_t new_us);
+
+#define declare_func(ret, ...)      \
+    ret (*func_ref)(__VA_ARGS__);   \
+    ret (*func_new)(__VA_ARGS__)
+
+#define check_func(ref, new, ...)                                   \
+    (func_ref = (ref), func_new = (new),                            \
+     checkasm_check_func((const void *)func_ref,                    \
+                         (const void *)func_new, __VA_ARGS__))
+
+#define call_ref(...) func_ref(__VA_ARGS__)
+#define call_new(...) func_new(__VA_ARGS__)
+#define fail() checkasm_fail_func("%s:%d", av_basename(__FILE__), __LINE__)
+#define report checkasm_report
+
+/* times both functions over as many runs as the C one takes 2 ms for */
+#define bench(...)                                                  \
+    do {                                                            \
+        if (checkasm_bench_func()) {                                \
+            int64_t t_ref, t_new;                                   \
+            int runs = 1;                                           \
+                                                                    \
+            do {                                                    \
+                runs *= 2;                                          \
+                t_ref = av_gettime_relative();                      \
+                for (int ti = 0; ti < runs; ti++)                   \
+                    func_ref(__VA_ARGS__);                          \
+                t_ref = av_gettime_relative() - t_ref;              \
+            } while (t_ref < 2000 && runs < (1 << 24));             \
+            t_new = av_gettime_relative();                          \
+            for (int ti = 0; ti < runs; ti++)                       \
+                func_new(__VA_ARGS__);                              \
+            t_new = av_gettime_relative() - t_new;                  \
+            checkasm_bench_report(runs, t_ref, t_new);              \
+        }                                                           \
+    } while (0)
+
+#endif /* TESTS_WASM_CHECKASM_H */
@@ -0,0 +1,248 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavcodec/h264dsp.h"
+#include "checkasm.h"
+
+#define STRIDE 32
+#define TRIES  32
+
+static uint8_t buf[3][STRIDE * 32];
+static int16_t coeffs[3][64];
+
+static void randomize(uint8_t *dst, int size)
+{
+    for (int i = 0; i < size; i++)
+        dst[i] = rnd();
+}
+
+static void init_contexts(H264DSPContext *ref, H264DSPContext *new)
+{
+    checkasm_set_simd128(0);
+    ff_h264dsp_init(ref, 8, 1);
+    checkasm_set_simd128(1);
+    ff_h264dsp_init(new, 8, 1);
+}
+
+static void check_weight(const H264DSPContext *ref, const H264DSPContext *new)
+{
+    for (int i = 0; i < 3; i++) {
+        const int w = 16 >> i;
+
+        {
+            declare_func(void, uint8_t *block, ptrdiff_t stride, int height,
+                         int log2_denom, int weight, int offset);
+
+            if (check_func(ref->weight_h264_pixels_tab[i], new->weight_h264_pixels_tab[i],
+                           "weight_h264_pixels%d", w)) {
+                for (int t = 0; t < TRIES; t++) {
+                    int h = w >> (rnd() % 2), log2_denom = rnd() % 8;
+                    int weight = (int)(rnd() % 256) - 128, offset = (int)(rnd() % 256) - 128;
+
+                    randomize(buf[0], sizeof(buf[0]));
+                    memcpy(buf[1], buf[0], sizeof(buf[0]));
+                    call_ref(buf[0], STRIDE, h, log2_denom, weight, offset);
+                    call_new(buf[1], STRIDE, h, log2_denom, weight, offset);
+                    if (memcmp(buf[0], buf[1], sizeof(buf[0])))
+                        fail();
+                }
+                bench(buf[1], STRIDE, w, 5, 77, 3);
+            }
+        }
+
+        {
+            declare_func(void, uint8_t *dst, uint8_t *src, ptrdiff_t stride, int height,
+                         int log2_denom, int weightd, int weights, int offset);
+
+            if (check_func(ref->biweight_h264_pixels_tab[i], new->biweight_h264_pixels_tab[i],
+                           "biweight_h264_pixels%d", w)) {
+                for (int t = 0; t < TRIES; t++) {
+                    int h = w >> (rnd() % 2), log2_denom = rnd() % 8;
+                    int weightd = (int)(rnd() % 256) - 128, weights = (int)(rnd() % 256) - 128;
+                    int offset  = (int)(rnd() % 256) - 128;
+
+                    randomize(buf[0], sizeof(buf[0]));
+                    randomize(buf[2], sizeof(buf[2]));
+                    memcpy(buf[1], buf[0], sizeof(buf[0]));
+                    call_ref(buf[0], buf[2], STRIDE, h, log2_denom, weightd, weights, offset);
+                    call_new(buf[1], buf[2], STRIDE, h, log2_denom, weightd, weights, offset);
+                    if (memcmp(buf[0], buf[1], sizeof(buf[0])))
+                        fail();
+                }
+                bench(buf[1], buf[2], STRIDE, w, 5, 40, 24, 3);
+            }
+        }
+    }
+    report("weight");
+}
+
+/*
+ * Random pixels around an edge of 16 lines at buf[16 * STRIDE + 8], with
+ * steps and noise of the order of alpha and beta so that every branch of
+ * the filters is taken.
+ */
+static uint8_t *randomize_edge(uint8_t *dst, ptrdiff_t xstride, ptrdiff_t ystride,
+                               int alpha, int beta)
+{
+    uint8_t *pix = dst + 16 * STRIDE + 8;
+
+    randomize(dst, sizeof(buf[0]));
+    for (int l = 0; l < 16; l++) {
+        int base  = rnd() & 0xff;
+        int step  = (int)(rnd() % (2 * alpha + 3)) - alpha - 1;
+        int noise = 1 + rnd() % (beta + 2);
+
+        for (int x = -4; x < 4; x++) {
+            int v = base + (x >= 0 ? step : 0) + (int)(rnd() % (2 * noise + 1)) - noise;
+            pix[x * xstride + l * ystride] = av_clip_uint8(v);
+        }
+    }
+    return pix;
+}
+
+typedef void (*loop_filter_func)(uint8_t *pix, ptrdiff_t stride, int alpha, int beta,
+                                 int8_t *tc0);
+typedef void (*loop_filter_intra_func)(uint8_t *pix, ptrdiff_t stride, int alpha, int beta);
+
+static void check_loop_filter_func(loop_filter_func ref, loop_filter_func new,
+                                   const char *name, int vertical)
+{
+    const int xstride = vertical ? STRIDE : 1, ystride = vertical ? 1 : STRIDE;
+    declare_func(void, uint8_t *pix, ptrdiff_t stride, int alpha, int beta, int8_t *tc0);
+
+    if (!check_func(ref, new, "%s", name))
+        return;
+    for (int t = 0; t < TRIES; t++) {
+        int alpha = rnd() % 256, beta = rnd() % 19;
+        int8_t tc0[4];
+        uint8_t *pix = randomize_edge(buf[0], xstride, ystride, alpha, beta);
+
+        for (int j = 0; j < 4; j++)
+            tc0[j] = (int)(rnd() % 27) - 1;
+        memcpy(buf[1], buf[0], sizeof(buf[0]));
+        call_ref(pix, STRIDE, alpha, beta, tc0);
+        call_new(pix - buf[0] + buf[1], STRIDE, alpha, beta, tc0);
+        if (memcmp(buf[0], buf[1], sizeof(buf[0])))
+            fail();
+    }
+    {
+        int8_t tc0[4] = { 1, 4, 9, 16 };
+        uint8_t *pix = randomize_edge(buf[1], xstride, ystride, 64, 8);
+
+        bench(pix, STRIDE, 64, 8, tc0);
+    }
+}
+
+static void check_loop_filter_intra_func(loop_filter_intra_func ref,
+                                         loop_filter_intra_func new,
+                                         const char *name, int vertical)
+{
+    const int xstride = vertical ? STRIDE : 1, ystride = vertical ? 1 : STRIDE;
+    declare_func(void, uint8_t *pix, ptrdiff_t stride, int alpha, int beta);
+
+    if (!check_func(ref, new, "%s", name))
+        return;
+    for (int t = 0; t < TRIES; t++) {
+        int alpha = rnd() % 256, beta = rnd() % 19;
+        uint8_t *pix = randomize_edge(buf[0], xstride, ystride, alpha, beta);
+
+        memcpy(buf[1], buf[0], sizeof(buf[0]));
+        call_ref(pix, STRIDE, alpha, beta);
+        call_new(pix - buf[0] + buf[1], STRIDE, alpha, beta);
+        if (memcmp(buf[0], buf[1], sizeof(buf[0])))
+            fail();
+    }
+    {
+        uint8_t *pix = randomize_edge(buf[1], xstride, ystride, 64, 8);
+
+        bench(pix, STRIDE, 64, 8);
+    }
+}
+
+static void check_loop_filter(const H264DSPContext *ref, const H264DSPContext *new)
+{
+#define CHECK(name, vertical) \
+    check_loop_filter_func(ref->name, new->name, #name, vertical)
+#define CHECK_INTRA(name, vertical) \
+    check_loop_filter_intra_func(ref->name, new->name, #name, vertical)
+    CHECK(h264_v_loop_filter_luma, 1);
+    CHECK(h264_h_loop_filter_luma, 0);
+    CHECK_INTRA(h264_v_loop_filter_luma_intra, 1);
+    CHECK_INTRA(h264_h_loop_filter_luma_intra, 0);
+    CHECK(h264_v_loop_filter_chroma, 1);
+    CHECK(h264_h_loop_filter_chroma, 0);
+    CHECK_INTRA(h264_v_loop_filter_chroma_intra, 1);
+    CHECK_INTRA(h264_h_loop_filter_chroma_intra, 0);
+#undef CHECK
+#undef CHECK_INTRA
+    report("loop_filter");
+}
+
+static void randomize_coeffs(int16_t *dst, int n)
+{
+    /* mostly small coefficients like in real streams, some at full range */
+    for (int i = 0; i < n; i++)
+        dst[i] = rnd() % 8 ? (int)(rnd() % 1024) - 512 : (int16_t)rnd();
+}
+
+typedef void (*idct_func)(uint8_t *dst, int16_t *block, int stride);
+
+static void check_idct_func(idct_func ref, idct_func new, const char *name, int size)
+{
+    declare_func(void, uint8_t *dst, int16_t *block, int stride);
+
+    if (!check_func(ref, new, "%s", name))
+        return;
+    for (int t = 0; t < TRIES; t++) {
+        randomize(buf[0], sizeof(buf[0]));
+        memcpy(buf[1], buf[0], sizeof(buf[0]));
+        randomize_coeffs(coeffs[0], size * size);
+        memcpy(coeffs[1], coeffs[0], sizeof(coeffs[0]));
+        call_ref(buf[0] + STRIDE, coeffs[0], STRIDE);
+        call_new(buf[1] + STRIDE, coeffs[1], STRIDE);
+        if (memcmp(buf[0], buf[1], sizeof(buf[0])) ||
+            memcmp(coeffs[0], coeffs[1], sizeof(coeffs[0])))
+            fail();
+    }
+    /* the block is cleared by every call, so it is an IDCT of zeros */
+    bench(buf[1] + STRIDE, coeffs[1], STRIDE);
+}
+
+static void check_idct(const H264DSPContext *ref, const H264DSPContext *new)
+{
+#define CHECK(name, size) check_idct_func(ref->name, new->name, #name, size)
+    CHECK(h264_idct_add,     4);
+    CHECK(h264_idct8_add,    8);
+    CHECK(h264_idct_dc_add,  4);
+    CHECK(h264_idct8_dc_add, 8);
+#undef CHECK
+    report("idct");
+}
+
+void checkasm_check_h264dsp(void)
+{
+    H264DSPContext ref, new;
+
+    init_contexts(&ref, &new);
+    check_weight(&ref, &new);
+    check_loop_filter(&ref, &new);
+    check_idct(&ref, &new);
+}
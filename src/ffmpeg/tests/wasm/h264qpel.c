@@ -0,0 +1,76 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+
+#include "libavcodec/h264qpel.h"
+#include "checkasm.h"
+
+#define STRIDE 32
+#define TRIES  16
+
+/* 16x16 blocks at (4, 3), with the 2 + 3 rows and columns of the 6-tap filter */
+static uint8_t src[STRIDE * 24];
+static uint8_t dst[2][STRIDE * 16];
+
+static void randomize(uint8_t *buf, int size)
+{
+    for (int i = 0; i < size; i++)
+        buf[i] = rnd();
+}
+
+void checkasm_check_h264qpel(void)
+{
+    static const char *const op_names[] = { "put", "avg" };
+    H264QpelContext ref, new;
+    uint8_t *const s = src + 3 * STRIDE + 4;
+    declare_func(void, uint8_t *dst, const uint8_t *src, ptrdiff_t stride);
+
+    checkasm_set_simd128(0);
+    ff_h264qpel_init(&ref, 8);
+    checkasm_set_simd128(1);
+    ff_h264qpel_init(&new, 8);
+
+    for (int op = 0; op < 2; op++) {
+        qpel_mc_func (*const tab_ref)[16] = op ? ref.avg_h264_qpel_pixels_tab
+                                               : ref.put_h264_qpel_pixels_tab;
+        qpel_mc_func (*const tab_new)[16] = op ? new.avg_h264_qpel_pixels_tab
+                                               : new.put_h264_qpel_pixels_tab;
+
+        for (int i = 0; i < 2; i++) {
+            const int size = 16 >> i;
+
+            for (int mc = 0; mc < 16; mc++) {
+                if (!check_func(tab_ref[i][mc], tab_new[i][mc], "%s_h264_qpel%d_mc%d%d",
+                                op_names[op], size, mc & 3, mc >> 2))
+                    continue;
+                for (int t = 0; t < TRIES; t++) {
+                    randomize(src, sizeof(src));
+                    randomize(dst[0], sizeof(dst[0]));
+                    memcpy(dst[1], dst[0], sizeof(dst[0]));
+                    call_ref(dst[0], s, STRIDE);
+                    call_new(dst[1], s, STRIDE);
+                    if (memcmp(dst[0], dst[1], sizeof(dst[0])))
+                        fail();
+                }
+                bench(dst[1], s, STRIDE);
+            }
+        }
+        report("%s", op_names[op]);
+    }
+}
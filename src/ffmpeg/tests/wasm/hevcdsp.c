@@ -0,0 +1,228 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavcodec/hevcdsp.h"
+#include "checkasm.h"
+
+#define STRIDE 80
+#define TRIES  8
+
+/* 64x64 blocks at (8, 3), with the 3 + 4 rows and columns of the qpel filter */
+static uint8_t src[STRIDE * 72];
+static uint8_t dst[2][STRIDE * 64];
+static int16_t dst16[2][MAX_PB_SIZE * 64];
+static int16_t src2[MAX_PB_SIZE * 64];
+static int16_t coeffs[2][32 * 32];
+
+static const int widths[10] = { 2, 4, 6, 8, 12, 16, 24, 32, 48, 64 };
+static const char *const types[2][2] = { { "pixels", "h" }, { "v", "hv" } };
+
+static void randomize(uint8_t *buf, int size)
+{
+    for (int i = 0; i < size; i++)
+        buf[i] = rnd();
+}
+
+static void randomize_i16(int16_t *buf, int size)
+{
+    for (int i = 0; i < size; i++)
+        buf[i] = rnd();
+}
+
+typedef void (*put_func)(int16_t *dst, uint8_t *src, ptrdiff_t srcstride,
+                         int height, intptr_t mx, intptr_t my, int width);
+typedef void (*uni_func)(uint8_t *dst, ptrdiff_t dststride, uint8_t *src,
+                         ptrdiff_t srcstride, int height, intptr_t mx, intptr_t my,
+                         int width);
+typedef void (*bi_func)(uint8_t *dst, ptrdiff_t dststride, uint8_t *src,
+                        ptrdiff_t srcstride, int16_t *src2, int height,
+                        intptr_t mx, intptr_t my, int width);
+
+/* random fractions of the filters of the type, 0 where it does not filter */
+static void random_mv(int qpel, int mx_on, int my_on, intptr_t *mx, intptr_t *my)
+{
+    const int n = qpel ? 3 : 7;
+
+    *mx = mx_on ? 1 + rnd() % n : 0;
+    *my = my_on ? 1 + rnd() % n : 0;
+}
+
+static void check_put_func(put_func ref, put_func new, int qpel, int mx_on,
+                           int my_on, int width)
+{
+    uint8_t *const s = src + 3 * STRIDE + 8;
+    declare_func(void, int16_t *dst, uint8_t *src, ptrdiff_t srcstride,
+                 int height, intptr_t mx, intptr_t my, int width);
+
+    if (!check_func(ref, new, "put_hevc_%s_%s%d", qpel ? "qpel" : "epel",
+                    types[my_on][mx_on], width))
+        return;
+    for (int t = 0; t < TRIES; t++) {
+        int height = 1 + rnd() % 64;
+        intptr_t mx, my;
+
+        random_mv(qpel, mx_on, my_on, &mx, &my);
+        randomize(src, sizeof(src));
+        randomize_i16(dst16[0], FF_ARRAY_ELEMS(dst16[0]));
+        memcpy(dst16[1], dst16[0], sizeof(dst16[0]));
+        call_ref(dst16[0], s, STRIDE, height, mx, my, width);
+        call_new(dst16[1], s, STRIDE, height, mx, my, width);
+        if (memcmp(dst16[0], dst16[1], sizeof(dst16[0])))
+            fail();
+    }
+    bench(dst16[1], s, STRIDE, width, mx_on, my_on, width);
+}
+
+static void check_uni_func(uni_func ref, uni_func new, int qpel, int mx_on,
+                           int my_on, int width)
+{
+    uint8_t *const s = src + 3 * STRIDE + 8;
+    declare_func(void, uint8_t *dst, ptrdiff_t dststride, uint8_t *src,
+                 ptrdiff_t srcstride, int height, intptr_t mx, intptr_t my, int width);
+
+    if (!check_func(ref, new, "put_hevc_%s_uni_%s%d", qpel ? "qpel" : "epel",
+                    types[my_on][mx_on], width))
+        return;
+    for (int t = 0; t < TRIES; t++) {
+        int height = 1 + rnd() % 64;
+        intptr_t mx, my;
+
+        random_mv(qpel, mx_on, my_on, &mx, &my);
+        randomize(src, sizeof(src));
+        randomize(dst[0], sizeof(dst[0]));
+        memcpy(dst[1], dst[0], sizeof(dst[0]));
+        call_ref(dst[0], STRIDE, s, STRIDE, height, mx, my, width);
+        call_new(dst[1], STRIDE, s, STRIDE, height, mx, my, width);
+        if (memcmp(dst[0], dst[1], sizeof(dst[0])))
+            fail();
+    }
+    bench(dst[1], STRIDE, s, STRIDE, width, mx_on, my_on, width);
+}
+
+static void check_bi_func(bi_func ref, bi_func new, int qpel, int mx_on,
+                          int my_on, int width)
+{
+    uint8_t *const s = src + 3 * STRIDE + 8;
+    declare_func(void, uint8_t *dst, ptrdiff_t dststride, uint8_t *src,
+                 ptrdiff_t srcstride, int16_t *src2, int height,
+                 intptr_t mx, intptr_t my, int width);
+
+    if (!check_func(ref, new, "put_hevc_%s_bi_%s%d", qpel ? "qpel" : "epel",
+                    types[my_on][mx_on], width))
+        return;
+    for (int t = 0; t < TRIES; t++) {
+        int height = 1 + rnd() % 64;
+        intptr_t mx, my;
+
+        random_mv(qpel, mx_on, my_on, &mx, &my);
+        randomize(src, sizeof(src));
+        randomize_i16(src2, FF_ARRAY_ELEMS(src2));
+        randomize(dst[0], sizeof(dst[0]));
+        memcpy(dst[1], dst[0], sizeof(dst[0]));
+        call_ref(dst[0], STRIDE, s, STRIDE, src2, height, mx, my, width);
+        call_new(dst[1], STRIDE, s, STRIDE, src2, height, mx, my, width);
+        if (memcmp(dst[0], dst[1], sizeof(dst[0])))
+            fail();
+    }
+    bench(dst[1], STRIDE, s, STRIDE, src2, width, mx_on, my_on, width);
+}
+
+static void check_mc(const HEVCDSPContext *ref, const HEVCDSPContext *new, int qpel)
+{
+    for (int i = 0; i < 10; i++) {
+        for (int my = 0; my < 2; my++) {
+            for (int mx = 0; mx < 2; mx++) {
+                if (qpel) {
+                    check_put_func(ref->put_hevc_qpel[i][my][mx],
+                                   new->put_hevc_qpel[i][my][mx], 1, mx, my, widths[i]);
+                    check_uni_func(ref->put_hevc_qpel_uni[i][my][mx],
+                                   new->put_hevc_qpel_uni[i][my][mx], 1, mx, my, widths[i]);
+                    check_bi_func(ref->put_hevc_qpel_bi[i][my][mx],
+                                  new->put_hevc_qpel_bi[i][my][mx], 1, mx, my, widths[i]);
+                } else {
+                    check_put_func(ref->put_hevc_epel[i][my][mx],
+                                   new->put_hevc_epel[i][my][mx], 0, mx, my, widths[i]);
+                    check_uni_func(ref->put_hevc_epel_uni[i][my][mx],
+                                   new->put_hevc_epel_uni[i][my][mx], 0, mx, my, widths[i]);
+                    check_bi_func(ref->put_hevc_epel_bi[i][my][mx],
+                                  new->put_hevc_epel_bi[i][my][mx], 0, mx, my, widths[i]);
+                }
+            }
+        }
+    }
+    report("%s", qpel ? "qpel" : "epel");
+}
+
+static void check_transform(const HEVCDSPContext *ref, const HEVCDSPContext *new)
+{
+    for (int i = 0; i < 4; i++) {
+        const int size = 4 << i;
+
+        {
+            declare_func(void, uint8_t *dst, int16_t *res, ptrdiff_t stride);
+
+            if (check_func(ref->add_residual[i], new->add_residual[i],
+                           "add_residual%dx%d", size, size)) {
+                for (int t = 0; t < TRIES; t++) {
+                    randomize(dst[0], sizeof(dst[0]));
+                    memcpy(dst[1], dst[0], sizeof(dst[0]));
+                    randomize_i16(coeffs[0], size * size);
+                    call_ref(dst[0], coeffs[0], STRIDE);
+                    call_new(dst[1], coeffs[0], STRIDE);
+                    if (memcmp(dst[0], dst[1], sizeof(dst[0])))
+                        fail();
+                }
+                bench(dst[1], coeffs[0], STRIDE);
+            }
+        }
+
+        {
+            declare_func(void, int16_t *coeffs);
+
+            if (check_func(ref->idct_dc[i], new->idct_dc[i], "idct_%dx%d_dc", size, size)) {
+                for (int t = 0; t < TRIES; t++) {
+                    randomize_i16(coeffs[0], FF_ARRAY_ELEMS(coeffs[0]));
+                    memcpy(coeffs[1], coeffs[0], sizeof(coeffs[0]));
+                    call_ref(coeffs[0]);
+                    call_new(coeffs[1]);
+                    if (memcmp(coeffs[0], coeffs[1], sizeof(coeffs[0])))
+                        fail();
+                }
+                bench(coeffs[1]);
+            }
+        }
+    }
+    report("transform");
+}
+
+void checkasm_check_hevcdsp(void)
+{
+    HEVCDSPContext ref, new;
+
+    checkasm_set_simd128(0);
+    ff_hevc_dsp_init(&ref, 8);
+    checkasm_set_simd128(1);
+    ff_hevc_dsp_init(&new, 8);
+
+    check_mc(&ref, &new, 1);
+    check_mc(&ref, &new, 0);
+    check_transform(&ref, &new);
+}
@@ -0,0 +1,258 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/mem.h"
+#include "libavutil/pixdesc.h"
+#include "libswscale/swscale.h"
+#include "libswscale/swscale_internal.h"
+#include "checkasm.h"
+
+#define MAX_WIDTH  1920
+#define MAX_FILTER 24
+#define TRIES      8
+
+static uint8_t  src8[MAX_WIDTH * 2 * 4 + MAX_FILTER + 64];
+static int16_t  filter[MAX_WIDTH * MAX_FILTER];
+static int32_t  filter_pos[MAX_WIDTH];
+static int16_t  planes[16][MAX_WIDTH];
+static int16_t  dst16[4][MAX_WIDTH];
+static uint8_t  dst8[2][MAX_WIDTH];
+
+static void randomize(uint8_t *buf, int size)
+{
+    for (int i = 0; i < size; i++)
+        buf[i] = rnd();
+}
+
+/* a default context, whose functions are reinitialized by every check */
+static SwsContext *alloc_context(void)
+{
+    SwsContext *c = sws_alloc_context();
+
+    if (!c || sws_init_context(c, NULL, NULL) < 0) {
+        fail();
+        sws_freeContext(c);
+        return NULL;
+    }
+    return c;
+}
+
+static void check_hscale(SwsContext *c)
+{
+    declare_func(void, SwsContext *c, int16_t *dst, int dstW,
+                 const uint8_t *src, const int16_t *filter,
+                 const int32_t *filterPos, int filterSize);
+
+    for (int size = 1; size <= MAX_FILTER; size++) {
+        void (*ref)(SwsContext *, int16_t *, int, const uint8_t *,
+                    const int16_t *, const int32_t *, int);
+
+        c->srcBpc = c->dstBpc = 8;
+        c->hLumFilterSize = c->hChrFilterSize = size;
+        checkasm_set_simd128(0);
+        ff_sws_init_scale(c);
+        ref = c->hyScale;
+        checkasm_set_simd128(1);
+        ff_sws_init_scale(c);
+
+        if (check_func(ref, c->hyScale, "hscale_8_to_15_%d", size)) {
+            for (int t = 0; t < TRIES; t++) {
+                int w = t ? 1 + rnd() % MAX_WIDTH : MAX_WIDTH;
+
+                randomize(src8, MAX_WIDTH + size);
+                for (int i = 0; i < w * size; i++)
+                    filter[i] = (int)(rnd() % (1 << 15)) - (1 << 14);
+                for (int i = 0; i < w; i++)
+                    filter_pos[i] = rnd() % (MAX_WIDTH + 1);
+                call_ref(c, dst16[0], w, src8, filter, filter_pos, size);
+                call_new(c, dst16[1], w, src8, filter, filter_pos, size);
+                if (memcmp(dst16[0], dst16[1], w * sizeof(dst16[0][0])))
+                    fail();
+            }
+            bench(c, dst16[1], MAX_WIDTH, src8, filter, filter_pos, size);
+        }
+    }
+    report("hscale");
+}
+
+static void check_vscale(SwsContext *c)
+{
+    const int16_t *src[16];
+    uint8_t dither[8];
+    declare_func(void, const int16_t *filter, int filterSize,
+                 const int16_t **src, uint8_t *dest, int dstW,
+                 const uint8_t *dither, int offset);
+
+    c->srcBpc = c->dstBpc = 8;
+    checkasm_set_simd128(0);
+    ff_sws_init_scale(c);
+    func_ref = c->yuv2planeX;
+    checkasm_set_simd128(1);
+    ff_sws_init_scale(c);
+
+    for (int i = 0; i < 16; i++)
+        src[i] = planes[i];
+    if (check_func(func_ref, c->yuv2planeX, "yuv2planeX_8")) {
+        for (int size = 1; size <= 16; size++) {
+            for (int t = 0; t < TRIES; t++) {
+                int w = t ? 1 + rnd() % MAX_WIDTH : MAX_WIDTH, offset = rnd() & 7;
+
+                randomize(dither, sizeof(dither));
+                for (int j = 0; j < size; j++) {
+                    filter[j] = (int)(rnd() % 4000) - 2000;
+                    for (int i = 0; i < w; i++)
+                        planes[j][i] = rnd() & 0x7fff;
+                }
+                call_ref(filter, size, src, dst8[0], w, dither, offset);
+                call_new(filter, size, src, dst8[1], w, dither, offset);
+                if (memcmp(dst8[0], dst8[1], w))
+                    fail();
+            }
+        }
+        bench(filter, 8, src, dst8[1], MAX_WIDTH, dither, 0);
+    }
+
+    {
+        declare_func(void, const int16_t *src, uint8_t *dest, int dstW,
+                     const uint8_t *dither, int offset);
+
+        checkasm_set_simd128(0);
+        ff_sws_init_scale(c);
+        func_ref = c->yuv2plane1;
+        checkasm_set_simd128(1);
+        ff_sws_init_scale(c);
+
+        if (check_func(func_ref, c->yuv2plane1, "yuv2plane1_8")) {
+            for (int t = 0; t < TRIES; t++) {
+                int w = t ? 1 + rnd() % MAX_WIDTH : MAX_WIDTH, offset = rnd() & 7;
+
+                randomize(dither, sizeof(dither));
+                randomize((uint8_t *)planes[0], w * sizeof(planes[0][0]));
+                call_ref(planes[0], dst8[0], w, dither, offset);
+                call_new(planes[0], dst8[1], w, dither, offset);
+                if (memcmp(dst8[0], dst8[1], w))
+                    fail();
+            }
+            bench(planes[0], dst8[1], MAX_WIDTH, dither, 0);
+        }
+    }
+    report("vscale");
+}
+
+/* coefficients of RGB to YUV with kr and kb, like fill_rgb2yuv_table() */
+static void rgb2yuv_coeffs(int32_t *t, double kr, double kb, int full)
+{
+    const double kg = 1 - kr - kb, s = 1 << RGB2YUV_SHIFT;
+    const double ys = full ? 1 : 219 / 255.0, cs = full ? 1 : 224 / 255.0;
+
+    t[RY_IDX] = lrint(kr * ys * s);
+    t[GY_IDX] = lrint(kg * ys * s);
+    t[BY_IDX] = lrint(kb * ys * s);
+    t[RU_IDX] = lrint(-kr / (2 * (1 - kb)) * cs * s);
+    t[GU_IDX] = lrint(-kg / (2 * (1 - kb)) * cs * s);
+    t[BU_IDX] = lrint(0.5 * cs * s);
+    t[RV_IDX] = lrint(0.5 * cs * s);
+    t[GV_IDX] = lrint(-kg / (2 * (1 - kr)) * cs * s);
+    t[BV_IDX] = lrint(-kb / (2 * (1 - kr)) * cs * s);
+}
+
+static void check_input(SwsContext *c)
+{
+    static const enum AVPixelFormat formats[] = {
+        AV_PIX_FMT_RGB24, AV_PIX_FMT_BGR24, AV_PIX_FMT_RGBA,
+        AV_PIX_FMT_BGRA,  AV_PIX_FMT_ARGB,  AV_PIX_FMT_ABGR,
+    };
+    static const double kr_kb[][2] = { { 0.299, 0.114 }, { 0.2126, 0.0722 }, { 0.2627, 0.0593 } };
+    int32_t table[16 + 40 * 4] = { 0 };
+
+    for (int f = 0; f < FF_ARRAY_ELEMS(formats); f++) {
+        const char *name = av_get_pix_fmt_name(formats[f]);
+        int bpp = av_get_bits_per_pixel(av_pix_fmt_desc_get(formats[f])) >> 3;
+
+        c->srcFormat = formats[f];
+        c->srcBpc = c->dstBpc = 8;
+
+        for (int half = 0; half < 2; half++) {
+            void (*ref_y)(uint8_t *, const uint8_t *, const uint8_t *,
+                          const uint8_t *, int, uint32_t *);
+            declare_func(void, uint8_t *dstU, uint8_t *dstV,
+                         const uint8_t *src1, const uint8_t *src2,
+                         const uint8_t *src3, int width, uint32_t *pal);
+
+            c->chrSrcHSubSample = half;
+            checkasm_set_simd128(0);
+            ff_sws_init_scale(c);
+            ref_y    = c->lumToYV12;
+            func_ref = c->chrToYV12;
+            checkasm_set_simd128(1);
+            ff_sws_init_scale(c);
+
+            if (!half) {
+                declare_func(void, uint8_t *dst, const uint8_t *src,
+                             const uint8_t *src2, const uint8_t *src3,
+                             int width, uint32_t *pal);
+
+                if (check_func(ref_y, c->lumToYV12, "%sToY", name)) {
+                    for (int t = 0; t < TRIES; t++) {
+                        int w = t ? 1 + rnd() % MAX_WIDTH : MAX_WIDTH;
+
+                        rgb2yuv_coeffs(table, kr_kb[t % 3][0], kr_kb[t % 3][1], t & 1);
+                        randomize(src8, w * bpp);
+                        call_ref((uint8_t *)dst16[0], src8, NULL, NULL, w, (uint32_t *)table);
+                        call_new((uint8_t *)dst16[1], src8, NULL, NULL, w, (uint32_t *)table);
+                        if (memcmp(dst16[0], dst16[1], w * sizeof(dst16[0][0])))
+                            fail();
+                    }
+                    bench((uint8_t *)dst16[1], src8, NULL, NULL, MAX_WIDTH, (uint32_t *)table);
+                }
+            }
+
+            if (check_func(func_ref, c->chrToYV12, "%sToUV%s", name, half ? "_half" : "")) {
+                for (int t = 0; t < TRIES; t++) {
+                    int w = t ? 1 + rnd() % MAX_WIDTH : MAX_WIDTH;
+
+                    rgb2yuv_coeffs(table, kr_kb[t % 3][0], kr_kb[t % 3][1], t & 1);
+                    randomize(src8, (w << half) * bpp);
+                    call_ref((uint8_t *)dst16[0], (uint8_t *)dst16[2], NULL, src8, src8, w, (uint32_t *)table);
+                    call_new((uint8_t *)dst16[1], (uint8_t *)dst16[3], NULL, src8, src8, w, (uint32_t *)table);
+                    if (memcmp(dst16[0], dst16[1], w * sizeof(dst16[0][0])) ||
+                        memcmp(dst16[2], dst16[3], w * sizeof(dst16[0][0])))
+                        fail();
+                }
+                bench((uint8_t *)dst16[1], (uint8_t *)dst16[3], NULL, src8, src8, MAX_WIDTH, (uint32_t *)table);
+            }
+        }
+    }
+    report("input");
+}
+
+void checkasm_check_sw_scale(void)
+{
+    SwsContext *c = alloc_context();
+
+    if (!c)
+        return;
+    check_hscale(c);
+    check_vscale(c);
+    check_input(c);
+    sws_freeContext(c);
+}
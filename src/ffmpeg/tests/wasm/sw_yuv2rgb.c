@@ -0,0 +1,117 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/pixdesc.h"
+#include "libswscale/swscale.h"
+#include "libswscale/swscale_internal.h"
+#include "checkasm.h"
+
+#define MAX_WIDTH  1280
+#define MAX_HEIGHT 16
+#define TRIES      8
+
+/* strides are padded with up to 32 bytes for luma and RGB, 16 for chroma */
+static uint8_t src_y[(MAX_WIDTH + 32) * MAX_HEIGHT];
+static uint8_t src_u[(MAX_WIDTH / 2 + 16) * MAX_HEIGHT / 2];
+static uint8_t src_v[(MAX_WIDTH / 2 + 16) * MAX_HEIGHT / 2];
+static uint8_t dst[2][(MAX_WIDTH * 4 + 32) * MAX_HEIGHT];
+
+static void randomize(uint8_t *buf, int size)
+{
+    for (int i = 0; i < size; i++)
+        buf[i] = rnd();
+}
+
+/* the first try is the default colorspace at the largest size, for bench */
+static SwsContext *random_context(enum AVPixelFormat format, int t, int *w, int *h)
+{
+    static const int colorspaces[] = { SWS_CS_ITU601, SWS_CS_ITU709, SWS_CS_BT2020 };
+    SwsContext *c;
+
+    *w = t ? 2 + rnd() % (MAX_WIDTH - 1) : MAX_WIDTH;
+    *h = t ? 2 * (1 + rnd() % (MAX_HEIGHT / 2)) : MAX_HEIGHT;
+    c = sws_getContext(*w, *h, AV_PIX_FMT_YUV420P, *w, *h, format,
+                       SWS_BILINEAR, NULL, NULL, NULL);
+    if (c && t) {
+        int brightness = t & 1 ? (int)(rnd() % (1 << 13)) - (1 << 12) : 0;
+        int contrast   = t & 2 ? (1 << 16) + (int)(rnd() % (1 << 15)) - (1 << 14) : 1 << 16;
+        int saturation = t & 4 ? (1 << 16) + (int)(rnd() % (1 << 15)) - (1 << 14) : 1 << 16;
+
+        sws_setColorspaceDetails(c, sws_getCoefficients(colorspaces[t % 3]), rnd() & 1,
+                                 sws_getCoefficients(SWS_CS_DEFAULT), 0,
+                                 brightness, contrast, saturation);
+    }
+    return c;
+}
+
+static void check_yuv2rgb(enum AVPixelFormat format)
+{
+    const int bpp = av_get_bits_per_pixel(av_pix_fmt_desc_get(format)) >> 3;
+    declare_func(int, SwsContext *c, const uint8_t *src[], int srcStride[],
+                 int srcSliceY, int srcSliceH, uint8_t *dst[], int dstStride[]);
+
+    for (int t = 0; t < TRIES; t++) {
+        const uint8_t *src[4] = { src_y, src_u, src_v, NULL };
+        uint8_t *dst0[4] = { dst[0] }, *dst1[4] = { dst[1] };
+        int src_stride[4], dst_stride[4], w, h, ret0, ret1;
+        SwsContext *c = random_context(format, t, &w, &h);
+        SwsFunc ref, new;
+
+        if (!c) {
+            fail();
+            return;
+        }
+        checkasm_set_simd128(0);
+        ref = ff_yuv2rgb_get_func_ptr(c);
+        checkasm_set_simd128(1);
+        new = ff_yuv2rgb_get_func_ptr(c);
+
+        if (check_func(ref, new, "yuv420p_to_%s", av_get_pix_fmt_name(format))) {
+            src_stride[0] = w + (t ? rnd() % 32 : 0);
+            src_stride[1] = src_stride[2] = (w + 1) / 2 + (t ? rnd() % 16 : 0);
+            dst_stride[0] = w * bpp + (t ? rnd() % 32 : 0);
+            randomize(src_y, src_stride[0] * h);
+            randomize(src_u, src_stride[1] * h / 2);
+            randomize(src_v, src_stride[2] * h / 2);
+            memset(dst[0], 0, sizeof(dst[0]));
+            memset(dst[1], 0, sizeof(dst[1]));
+            ret0 = call_ref(c, src, src_stride, 0, h, dst0, dst_stride);
+            ret1 = call_new(c, src, src_stride, 0, h, dst1, dst_stride);
+            if (ret0 != ret1 || memcmp(dst[0], dst[1], sizeof(dst[0])))
+                fail();
+            if (!t)
+                bench(c, src, src_stride, 0, h, dst1, dst_stride);
+        }
+        sws_freeContext(c);
+    }
+}
+
+void checkasm_check_sw_yuv2rgb(void)
+{
+    static const enum AVPixelFormat formats[] = {
+        AV_PIX_FMT_RGB24, AV_PIX_FMT_BGR24, AV_PIX_FMT_RGBA,
+        AV_PIX_FMT_BGRA,  AV_PIX_FMT_ARGB,  AV_PIX_FMT_ABGR,
+    };
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(formats); i++)
+        check_yuv2rgb(formats[i]);
+    report("yuv2rgb");
+}
@@ -0,0 +1,98 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+
+#include "libavcodec/vp9dsp.h"
+#include "checkasm.h"
+
+#define STRIDE 80
+#define TRIES  8
+
+/* 64x64 blocks at (8, 3), with the 3 + 4 rows and columns of the 8-tap filters */
+static uint8_t src[STRIDE * 72];
+static uint8_t dst[2][STRIDE * 64];
+
+static void randomize(uint8_t *buf, int size)
+{
+    for (int i = 0; i < size; i++)
+        buf[i] = rnd();
+}
+
+void checkasm_check_vp9dsp(void)
+{
+    static const char *const op_names[] = { "put", "avg" };
+    static const char *const filter_names[N_FILTERS] = {
+        [FILTER_8TAP_SMOOTH]  = "smooth",
+        [FILTER_8TAP_REGULAR] = "regular",
+        [FILTER_8TAP_SHARP]   = "sharp",
+        [FILTER_BILINEAR]     = "bilin",
+    };
+    static const char *const dirs[2][2] = { { "", "v" }, { "h", "hv" } };
+    VP9DSPContext ref, new;
+    uint8_t *const s = src + 3 * STRIDE + 8;
+    declare_func(void, uint8_t *dst, ptrdiff_t dst_stride, const uint8_t *ref,
+                 ptrdiff_t ref_stride, int h, int mx, int my);
+
+    checkasm_set_simd128(0);
+    ff_vp9dsp_init(&ref, 8, 0);
+    checkasm_set_simd128(1);
+    ff_vp9dsp_init(&new, 8, 0);
+
+    for (int op = 0; op < 2; op++) {
+        for (int i = 0; i < 5; i++) {
+            const int size = 64 >> i;
+
+            for (int f = 0; f < N_FILTERS; f++) {
+                for (int dx = 0; dx < 2; dx++) {
+                    for (int dy = 0; dy < 2; dy++) {
+                        int found;
+
+                        /* the full pixel functions are the same for every filter */
+                        if (!dx && !dy)
+                            found = !f && check_func(ref.mc[i][f][op][0][0],
+                                                     new.mc[i][f][op][0][0],
+                                                     "vp9_%s%d", op_names[op], size);
+                        else
+                            found = check_func(ref.mc[i][f][op][dx][dy],
+                                               new.mc[i][f][op][dx][dy],
+                                               "vp9_%s_8tap_%s_%d%s", op_names[op],
+                                               filter_names[f], size, dirs[dx][dy]);
+                        if (!found)
+                            continue;
+                        for (int t = 0; t < TRIES; t++) {
+                            int h  = size >> (rnd() % 2);
+                            int mx = dx ? 1 + rnd() % 15 : 0;
+                            int my = dy ? 1 + rnd() % 15 : 0;
+
+                            randomize(src, sizeof(src));
+                            randomize(dst[0], sizeof(dst[0]));
+                            memcpy(dst[1], dst[0], sizeof(dst[0]));
+                            call_ref(dst[0], STRIDE, s, STRIDE, h, mx, my);
+                            call_new(dst[1], STRIDE, s, STRIDE, h, mx, my);
+                            if (memcmp(dst[0], dst[1], sizeof(dst[0])))
+                                fail();
+                        }
+                        bench(dst[1], STRIDE, s, STRIDE, size, dx * 8, dy * 8);
+                    }
+                }
+            }
+        }
+        report("%s", op_names[op]);
+    }
+}
@@ -0,0 +1,707 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * ffcut, frame accurate smart cut of ffmpeg.wasm.
+ *
+ * Video packets are read one GOP at a time. A GOP lying within [start, end)
+ * is copied as is, only the GOPs crossing start or end are decoded and their
+ * frames within the range re-encoded with the codec, size, pixel format,
+ * profile, level and bit rate of the input, so the cost of a cut does not
+ * depend on its length. The audio stream is copied.
+ *
+ * Re-encoded frames carry their own parameter sets in-band and no B-frames,
+ * their dts are shifted by the reordering delay of the copied GOPs to keep
+ * dts increasing across the joins. GOPs are expected to be closed, which is
+ * the default of x264 and most encoders.
+ *
+ * As the parameter sets change within the stream, avcC / hvcC streams are
+ * written as avc3 / hev1 where the muxer supports it, and the parameter sets
+ * of the input are repeated in-band at the first GOP copied after encoded
+ * frames.
+ *
+ * usage: ffcut [-ss start] [-to end | -t duration] -i input [-an] output
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cmdutils.h"
+
+#include "libavcodec/avcodec.h"
+#include "libavformat/avformat.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/opt.h"
+#include "libavutil/parseutils.h"
+
+static const char *input_path;
+static const char *output_path;
+static int64_t start_time, end_time, duration;
+static int no_audio;
+
+static AVFormatContext *ifmt_ctx;
+static AVFormatContext *ofmt_ctx;
+static AVCodecContext *dec_ctx;
+static AVCodecContext *enc_ctx;
+static AVPacket *pkt;
+static AVFrame *frame;
+static AVPacket **gop;          /* packets of the current GOP */
+static int nb_gop;
+
+static int video_index, audio_index;
+static int64_t video_start, video_end;  /* in the video time base */
+static int64_t audio_start, audio_end;  /* in the audio time base */
+static int64_t reorder_delay;   /* pts - dts of the copied keyframes */
+static int nal_length_size;     /* for avcC / hvcC streams */
+static uint8_t *param_sets;     /* of the input, length prefixed */
+static int param_sets_size;
+static int video_done, audio_done;
+
+static void free_gop(void)
+{
+    for (int i = 0; i < nb_gop; i++)
+        av_packet_free(&gop[i]);
+    nb_gop = 0;
+}
+
+static void cut_cleanup(int ret)
+{
+    free_gop();
+    av_freep(&gop);
+    avformat_close_input(&ifmt_ctx);
+    if (ofmt_ctx && !(ofmt_ctx->oformat->flags & AVFMT_NOFILE))
+        avio_closep(&ofmt_ctx->pb);
+    avformat_free_context(ofmt_ctx);
+    ofmt_ctx = NULL;
+    avcodec_free_context(&dec_ctx);
+    avcodec_free_context(&enc_ctx);
+    av_packet_free(&pkt);
+    av_frame_free(&frame);
+    av_freep(&param_sets);
+    param_sets_size = 0;
+}
+
+static void init_globals(void)
+{
+    input_path    = NULL;
+    output_path   = NULL;
+    start_time    = 0;
+    end_time      = INT64_MAX;
+    duration      = INT64_MAX;
+    no_audio      = 0;
+    video_index   = -1;
+    audio_index   = -1;
+    reorder_delay = 0;
+    nal_length_size = 0;
+    video_done    = 0;
+    audio_done    = 0;
+}
+
+static int64_t parse_cut_time(const char *opt, const char *arg)
+{
+    int64_t t;
+
+    if (av_parse_time(&t, arg, 1) < 0 || t < 0) {
+        av_log(NULL, AV_LOG_FATAL, "Invalid time '%s' for option '%s'\n", arg, opt);
+        exit_program(1);
+    }
+    return t;
+}
+
+static void parse_args(int argc, char **argv)
+{
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        const char *opt = argv[i];
+
+        if (opt[0] != '-' || !opt[1]) {
+            output_path = opt;
+            continue;
+        }
+        if (!strcmp(opt, "-an")) {
+            no_audio = 1;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            av_log(NULL, AV_LOG_FATAL, "Missing argument for option '%s'\n", opt);
+            exit_program(1);
+        }
+
+        if (!strcmp(opt, "-i"))
+            input_path = argv[++i];
+        else if (!strcmp(opt, "-ss"))
+            start_time = parse_cut_time(opt, argv[++i]);
+        else if (!strcmp(opt, "-to"))
+            end_time = parse_cut_time(opt, argv[++i]);
+        else if (!strcmp(opt, "-t"))
+            duration = parse_cut_time(opt, argv[++i]);
+        else {
+            av_log(NULL, AV_LOG_FATAL, "Unrecognized option '%s'\n", opt);
+            exit_program(1);
+        }
+    }
+
+    if (!input_path || !output_path) {
+        av_log(NULL, AV_LOG_FATAL, "usage: ffcut [-ss start] "
+               "[-to end | -t duration] -i input [-an] output\n");
+        exit_program(1);
+    }
+    if (duration != INT64_MAX)
+        end_time = FFMIN(end_time, start_time + duration);
+    if (end_time <= start_time) {
+        av_log(NULL, AV_LOG_FATAL, "The end of the cut must be after its start\n");
+        exit_program(1);
+    }
+}
+
+/* append_param_set adds a NAL unit of the avcC / hvcC record to param_sets,
+ * returns the bytes read from p */
+static int append_param_set(const uint8_t *p, const uint8_t *end)
+{
+    int size, ret;
+
+    if (end - p < 2 || end - p - 2 < (size = AV_RB16(p)))
+        return AVERROR_INVALIDDATA;
+    ret = av_reallocp(&param_sets, param_sets_size + nal_length_size + size);
+    if (ret < 0)
+        return ret;
+    for (int i = nal_length_size - 1; i >= 0; i--)
+        param_sets[param_sets_size++] = size >> (8 * i);
+    memcpy(param_sets + param_sets_size, p + 2, size);
+    param_sets_size += size;
+    return size + 2;
+}
+
+/* parse_param_sets reads the parameter sets of an avcC / hvcC record */
+static int parse_param_sets(const AVCodecParameters *par)
+{
+    const uint8_t *p = par->extradata, *end = p + par->extradata_size;
+    int ret;
+
+    if (par->codec_id == AV_CODEC_ID_H264) {
+        /* SPS, then PPS */
+        p += 5;
+        for (int i = 0; i < 2 && p < end; i++) {
+            int nb = *p++ & (i ? 0xff : 0x1f);
+            for (int j = 0; j < nb; j++) {
+                if ((ret = append_param_set(p, end)) < 0)
+                    return ret;
+                p += ret;
+            }
+        }
+    } else {
+        /* arrays of VPS, SPS, PPS and SEI */
+        int nb_arrays;
+
+        p += 22;
+        nb_arrays = p < end ? *p++ : 0;
+        for (int i = 0; i < nb_arrays; i++) {
+            int nb;
+
+            if (end - p < 3)
+                return AVERROR_INVALIDDATA;
+            nb = AV_RB16(p + 1);
+            p += 3;
+            for (int j = 0; j < nb; j++) {
+                if ((ret = append_param_set(p, end)) < 0)
+                    return ret;
+                p += ret;
+            }
+        }
+    }
+    return 0;
+}
+
+static int add_output_stream(AVStream *ist)
+{
+    AVStream *ost = avformat_new_stream(ofmt_ctx, NULL);
+    int ret;
+
+    if (!ost)
+        return AVERROR(ENOMEM);
+    ret = avcodec_parameters_copy(ost->codecpar, ist->codecpar);
+    if (ret < 0)
+        return ret;
+    /* let the muxer pick its own tag */
+    ost->codecpar->codec_tag = 0;
+    ost->time_base = ist->time_base;
+    ost->sample_aspect_ratio = ist->sample_aspect_ratio;
+    return ost->index;
+}
+
+static int open_files(void)
+{
+    const AVCodec *dec;
+    AVStream *st;
+    AVCodecParameters *par;
+    int64_t origin, ts;
+    int ret;
+
+    ret = avformat_open_input(&ifmt_ctx, input_path, NULL, NULL);
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_FATAL, "%s: %s\n", input_path, av_err2str(ret));
+        return ret;
+    }
+    ret = avformat_find_stream_info(ifmt_ctx, NULL);
+    if (ret < 0)
+        return ret;
+
+    ret = av_find_best_stream(ifmt_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, &dec, 0);
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_FATAL, "%s: no decodable video stream\n", input_path);
+        return ret;
+    }
+    video_index = ret;
+    if (!no_audio)
+        audio_index = av_find_best_stream(ifmt_ctx, AVMEDIA_TYPE_AUDIO, -1,
+                                          video_index, NULL, 0);
+    if (audio_index < 0)
+        audio_index = -1;
+    for (int i = 0; i < ifmt_ctx->nb_streams; i++)
+        if (i != video_index && i != audio_index)
+            ifmt_ctx->streams[i]->discard = AVDISCARD_ALL;
+
+    st  = ifmt_ctx->streams[video_index];
+    par = st->codecpar;
+    dec_ctx = avcodec_alloc_context3(dec);
+    if (!dec_ctx)
+        return AVERROR(ENOMEM);
+    ret = avcodec_parameters_to_context(dec_ctx, par);
+    if (ret < 0)
+        return ret;
+    dec_ctx->pkt_timebase = st->time_base;
+    ret = avcodec_open2(dec_ctx, dec, NULL);
+    if (ret < 0)
+        return ret;
+
+    /* both streams are cut at the same instant */
+    origin = ifmt_ctx->start_time != AV_NOPTS_VALUE ? ifmt_ctx->start_time : 0;
+    video_start = av_rescale_q(origin + start_time, AV_TIME_BASE_Q, st->time_base);
+    video_end   = end_time == INT64_MAX ? INT64_MAX :
+                  av_rescale_q(origin + end_time, AV_TIME_BASE_Q, st->time_base);
+    if (audio_index >= 0) {
+        AVRational tb = ifmt_ctx->streams[audio_index]->time_base;
+        audio_start = av_rescale_q(origin + start_time, AV_TIME_BASE_Q, tb);
+        audio_end   = end_time == INT64_MAX ? INT64_MAX :
+                      av_rescale_q(origin + end_time, AV_TIME_BASE_Q, tb);
+    } else
+        audio_done = 1;
+
+    /* encoded edges are spliced into avcC / hvcC streams, their Annex B
+     * output is converted to the length prefix size of the stream */
+    if (par->extradata_size > 0 && par->extradata[0] == 1) {
+        if (par->codec_id == AV_CODEC_ID_H264 && par->extradata_size >= 7)
+            nal_length_size = (par->extradata[4] & 3) + 1;
+        else if (par->codec_id == AV_CODEC_ID_HEVC && par->extradata_size >= 23)
+            nal_length_size = (par->extradata[21] & 3) + 1;
+    }
+    if (nal_length_size && (ret = parse_param_sets(par)) < 0) {
+        av_log(NULL, AV_LOG_FATAL, "%s: invalid %s extradata\n", input_path,
+               avcodec_get_name(par->codec_id));
+        return ret;
+    }
+
+    ret = avformat_alloc_output_context2(&ofmt_ctx, NULL, NULL, output_path);
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_FATAL, "%s: %s\n", output_path, av_err2str(ret));
+        return ret;
+    }
+    if ((ret = add_output_stream(st)) < 0)
+        return ret;
+    /* the parameter sets are not only in the sample entry anymore */
+    if (nal_length_size) {
+        uint32_t tag = par->codec_id == AV_CODEC_ID_H264 ? MKTAG('a','v','c','3') :
+                                                           MKTAG('h','e','v','1');
+        if (avformat_query_codec(ofmt_ctx->oformat, par->codec_id, tag) == 1)
+            ofmt_ctx->streams[ret]->codecpar->codec_tag = tag;
+    }
+    if (audio_index >= 0 &&
+        (ret = add_output_stream(ifmt_ctx->streams[audio_index])) < 0)
+        return ret;
+    if (!(ofmt_ctx->oformat->flags & AVFMT_NOFILE)) {
+        ret = avio_open(&ofmt_ctx->pb, output_path, AVIO_FLAG_WRITE);
+        if (ret < 0) {
+            av_log(NULL, AV_LOG_FATAL, "%s: %s\n", output_path, av_err2str(ret));
+            return ret;
+        }
+    }
+    ret = avformat_write_header(ofmt_ctx, NULL);
+    if (ret < 0)
+        return ret;
+
+    if (!start_time)
+        return 0;
+    /* start from the keyframe before start */
+    ts  = video_start;
+    ret = avformat_seek_file(ifmt_ctx, video_index, INT64_MIN, ts, ts, 0);
+    if (ret < 0)
+        ret = avformat_seek_file(ifmt_ctx, video_index, INT64_MIN, ts, INT64_MAX, 0);
+    return ret;
+}
+
+/* write_packet shifts pkt from its input stream to the start of the cut */
+static int write_packet(AVPacket *p, int ost_index, int64_t shift)
+{
+    AVStream *ist = ifmt_ctx->streams[ost_index ? audio_index : video_index];
+
+    if (p->pts != AV_NOPTS_VALUE)
+        p->pts -= shift;
+    if (p->dts != AV_NOPTS_VALUE)
+        p->dts -= shift;
+    p->stream_index = ost_index;
+    av_packet_rescale_ts(p, ist->time_base, ofmt_ctx->streams[ost_index]->time_base);
+    return av_interleaved_write_frame(ofmt_ctx, p);
+}
+
+static const uint8_t *find_start_code(const uint8_t *p, const uint8_t *end)
+{
+    for (; p + 2 < end; p++)
+        if (!p[0] && !p[1] && p[2] == 1)
+            return p;
+    return end;
+}
+
+/* annexb_to_length_prefixed replaces the start codes of p by NAL unit sizes
+ * of nal_length_size bytes */
+static int annexb_to_length_prefixed(AVPacket *p)
+{
+    const uint8_t *end = p->data + p->size;
+    const uint8_t *nal = find_start_code(p->data, end);
+    AVPacket *out;
+    uint8_t *dst;
+    int ret;
+
+    /* a NAL unit grows by at most one byte, and takes at least four */
+    out = av_packet_alloc();
+    if (!out)
+        return AVERROR(ENOMEM);
+    ret = av_new_packet(out, p->size + p->size / 4 + nal_length_size);
+    if (ret < 0)
+        goto fail;
+    dst = out->data;
+
+    while (nal < end) {
+        const uint8_t *next, *nal_end;
+        int64_t size;
+
+        nal += 3;
+        next = nal_end = find_start_code(nal, end);
+        while (nal_end > nal && !nal_end[-1])
+            nal_end--;
+        size = nal_end - nal;
+        if (size >> (8 * nal_length_size)) {
+            ret = AVERROR(ERANGE);
+            goto fail;
+        }
+        for (int i = nal_length_size - 1; i >= 0; i--)
+            *dst++ = size >> (8 * i);
+        memcpy(dst, nal, size);
+        dst += size;
+        nal = next;
+    }
+    av_shrink_packet(out, dst - out->data);
+
+    ret = av_packet_copy_props(out, p);
+    if (ret < 0)
+        goto fail;
+    av_packet_unref(p);
+    av_packet_move_ref(p, out);
+fail:
+    av_packet_free(&out);
+    return ret;
+}
+
+/* prepend_param_sets puts the parameter sets of the input before the NAL
+ * units of p, for a copied keyframe following encoded frames */
+static int prepend_param_sets(AVPacket *p)
+{
+    AVPacket *out = av_packet_alloc();
+    int ret;
+
+    if (!out)
+        return AVERROR(ENOMEM);
+    ret = av_new_packet(out, param_sets_size + p->size);
+    if (ret < 0)
+        goto fail;
+    memcpy(out->data, param_sets, param_sets_size);
+    memcpy(out->data + param_sets_size, p->data, p->size);
+
+    ret = av_packet_copy_props(out, p);
+    if (ret < 0)
+        goto fail;
+    av_packet_unref(p);
+    av_packet_move_ref(p, out);
+fail:
+    av_packet_free(&out);
+    return ret;
+}
+
+static int receive_packets(void)
+{
+    int ret;
+
+    while ((ret = avcodec_receive_packet(enc_ctx, pkt)) >= 0) {
+        /* no B-frames, dts == pts */
+        if (pkt->pts != AV_NOPTS_VALUE)
+            pkt->dts = pkt->pts - reorder_delay;
+        if (nal_length_size && (ret = annexb_to_length_prefixed(pkt)) < 0)
+            return ret;
+        ret = write_packet(pkt, 0, video_start);
+        if (ret < 0)
+            return ret;
+    }
+    return ret == AVERROR(EAGAIN) || ret == AVERROR_EOF ? 0 : ret;
+}
+
+static const char *x264_profile(int profile)
+{
+    switch (profile) {
+    case FF_PROFILE_H264_BASELINE:
+    case FF_PROFILE_H264_CONSTRAINED_BASELINE: return "baseline";
+    case FF_PROFILE_H264_MAIN:                 return "main";
+    case FF_PROFILE_H264_HIGH:                 return "high";
+    default:                                   return NULL;
+    }
+}
+
+/* open_encoder matches the encoder to the copied stream, from the first
+ * frame to re-encode */
+static int open_encoder(const AVFrame *f)
+{
+    AVStream *st = ifmt_ctx->streams[video_index];
+    const AVCodecParameters *par = st->codecpar;
+    const AVCodec *enc = avcodec_find_encoder(par->codec_id);
+    const char *profile;
+
+    if (!enc) {
+        av_log(NULL, AV_LOG_FATAL, "No %s encoder to re-encode the edges of "
+               "the cut\n", avcodec_get_name(par->codec_id));
+        return AVERROR_ENCODER_NOT_FOUND;
+    }
+
+    enc_ctx = avcodec_alloc_context3(enc);
+    if (!enc_ctx)
+        return AVERROR(ENOMEM);
+    enc_ctx->width                  = f->width;
+    enc_ctx->height                 = f->height;
+    enc_ctx->pix_fmt                = f->format;
+    enc_ctx->sample_aspect_ratio    = f->sample_aspect_ratio;
+    enc_ctx->color_range            = f->color_range;
+    enc_ctx->color_primaries        = f->color_primaries;
+    enc_ctx->color_trc              = f->color_trc;
+    enc_ctx->colorspace             = f->colorspace;
+    enc_ctx->chroma_sample_location = f->chroma_location;
+    enc_ctx->time_base              = st->time_base;
+    enc_ctx->framerate              = av_guess_frame_rate(ifmt_ctx, st, NULL);
+    enc_ctx->bit_rate               = par->bit_rate;
+    enc_ctx->level                  = par->level;
+    enc_ctx->max_b_frames           = 0;
+
+    if (enc->id == AV_CODEC_ID_H264 && (profile = x264_profile(par->profile)))
+        av_opt_set(enc_ctx->priv_data, "profile", profile, 0);
+
+    return avcodec_open2(enc_ctx, enc, NULL);
+}
+
+/* close_encoder writes the frames left in the encoder, before a copied GOP
+ * or at the end of the cut */
+static int close_encoder(void)
+{
+    int ret;
+
+    if (!enc_ctx)
+        return 0;
+    ret = avcodec_send_frame(enc_ctx, NULL);
+    if (ret >= 0)
+        ret = receive_packets();
+    avcodec_free_context(&enc_ctx);
+    return ret;
+}
+
+static int encode_frame(AVFrame *f)
+{
+    int ret;
+
+    if (!enc_ctx && (ret = open_encoder(f)) < 0)
+        return ret;
+    f->pts       = f->best_effort_timestamp;
+    f->pict_type = AV_PICTURE_TYPE_NONE;
+    ret = avcodec_send_frame(enc_ctx, f);
+    if (ret >= 0)
+        ret = receive_packets();
+    return ret;
+}
+
+/* reencode_gop decodes the GOP and re-encodes its frames within the cut */
+static int reencode_gop(void)
+{
+    int ret = 0;
+
+    for (int i = 0; i <= nb_gop && ret >= 0; i++) {
+        ret = avcodec_send_packet(dec_ctx, i < nb_gop ? gop[i] : NULL);
+        if (ret == AVERROR_INVALIDDATA)
+            ret = 0;
+
+        while (ret >= 0) {
+            int64_t pts;
+
+            ret = avcodec_receive_frame(dec_ctx, frame);
+            if (ret < 0)
+                break;
+            pts = frame->best_effort_timestamp;
+            if (pts != AV_NOPTS_VALUE && pts >= video_start && pts < video_end)
+                ret = encode_frame(frame);
+            av_frame_unref(frame);
+        }
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
+            ret = 0;
+    }
+    avcodec_flush_buffers(dec_ctx);
+    return ret;
+}
+
+static int copy_gop(void)
+{
+    /* the encoded frames replaced the parameter sets of the input */
+    int resume = enc_ctx && param_sets_size;
+    int ret = close_encoder();
+
+    if (ret >= 0 && resume)
+        ret = prepend_param_sets(gop[0]);
+    for (int i = 0; i < nb_gop && ret >= 0; i++)
+        ret = write_packet(gop[i], 0, video_start);
+    return ret;
+}
+
+/* flush_gop copies or re-encodes the GOP read so far, next_key is the pts of
+ * the keyframe ending it or INT64_MAX at the end of the input */
+static int flush_gop(int64_t next_key)
+{
+    int64_t key = nb_gop ? gop[0]->pts : AV_NOPTS_VALUE;
+    int ret = 0;
+
+    if (key == AV_NOPTS_VALUE || key >= video_end) {
+        video_done = key != AV_NOPTS_VALUE;
+    } else if (next_key > video_start) {
+        if (key >= video_start && next_key <= video_end)
+            ret = copy_gop();
+        else
+            ret = reencode_gop();
+        video_done = next_key >= video_end;
+    }
+    free_gop();
+    return ret;
+}
+
+static int read_video(AVPacket *p)
+{
+    AVPacket **slot;
+    int key = p->flags & AV_PKT_FLAG_KEY;
+    int ret;
+
+    if (key && nb_gop) {
+        ret = flush_gop(p->pts != AV_NOPTS_VALUE ? p->pts : INT64_MAX);
+        if (ret < 0 || video_done)
+            return ret;
+    }
+    /* packets before the first keyframe cannot be decoded */
+    if (!key && !nb_gop)
+        return 0;
+    if (key && p->pts != AV_NOPTS_VALUE && p->dts != AV_NOPTS_VALUE)
+        reorder_delay = FFMAX(reorder_delay, p->pts - p->dts);
+
+    slot = av_dynarray2_add((void **)&gop, &nb_gop, sizeof(*gop), NULL);
+    if (!slot)
+        return AVERROR(ENOMEM);
+    *slot = av_packet_alloc();
+    if (!*slot)
+        return AVERROR(ENOMEM);
+    av_packet_move_ref(*slot, p);
+    return 0;
+}
+
+static int read_audio(AVPacket *p)
+{
+    if (p->pts == AV_NOPTS_VALUE)
+        return 0;
+    if (p->pts >= audio_end) {
+        audio_done = 1;
+        return 0;
+    }
+    if (p->pts + p->duration <= audio_start)
+        return 0;
+    return write_packet(p, 1, audio_start);
+}
+
+static int cut(void)
+{
+    int ret;
+
+    pkt   = av_packet_alloc();
+    frame = av_frame_alloc();
+    if (!pkt || !frame)
+        return AVERROR(ENOMEM);
+
+    if ((ret = open_files()) < 0)
+        return ret;
+
+    while (!video_done || !audio_done) {
+        ret = av_read_frame(ifmt_ctx, pkt);
+        if (ret == AVERROR_EOF)
+            break;
+        if (ret < 0)
+            return ret;
+
+        if (pkt->stream_index == video_index && !video_done)
+            ret = read_video(pkt);
+        else if (pkt->stream_index == audio_index && !audio_done)
+            ret = read_audio(pkt);
+        av_packet_unref(pkt);
+        if (ret < 0)
+            return ret;
+    }
+
+    if (!video_done && (ret = flush_gop(INT64_MAX)) < 0)
+        return ret;
+    if ((ret = close_encoder()) < 0)
+        return ret;
+    return av_write_trailer(ofmt_ctx);
+}
+
+/* ffcut() is exported next to ffmpeg() and follows the same convention,
+ * it returns through exit_program() which sets Module.ret.
+ */
+int ffcut(int argc, char **argv)
+{
+    int ret;
+
+    init_globals();
+    register_exit(cut_cleanup);
+    av_log_set_flags(AV_LOG_SKIP_REPEATED);
+
+    parse_args(argc, argv);
+
+    ret = cut();
+    if (ret < 0)
+        av_log(NULL, AV_LOG_ERROR, "ffcut failed: %s\n", av_err2str(ret));
+
+    exit_program(ret < 0);
+    return ret < 0;
+}
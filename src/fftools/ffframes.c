@@ -0,0 +1,693 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Frame reader and writer of ffmpeg.wasm, video frames between JS and
+ * FFmpeg without FS.
+ *
+ * A reader keeps its input open between calls: every frame_reader_read()
+ * decodes up to batch frames, scales and converts them straight into one
+ * buffer of wasm memory reused by every call, where JS reads them through
+ * typed array views. Frames are packed one after another without padding,
+ * frame_reader_times() gives the time of each of them in seconds from the
+ * start of the stream.
+ *
+ * A writer does the opposite: JS writes a packed frame into the input buffer
+ * of frame_writer_input() and frame_writer_write() pushes it through a
+ * filtergraph into an encoder and muxer configured with ffmpeg style output
+ * args. Every frame is encoded before the call returns, so a writer holds at
+ * most the encoder delay and JS is held back as long as encoding takes.
+ *
+ * Unlike ffmpeg() and the other tools, readers and writers outlive a call, so
+ * errors are returned instead of going through exit_program().
+ */
+
+#include <math.h>
+
+#include "libavcodec/avcodec.h"
+#include "libavfilter/buffersink.h"
+#include "libavfilter/buffersrc.h"
+#include "libavformat/avformat.h"
+#include "libavutil/avstring.h"
+#include "libavutil/imgutils.h"
+#include "libavutil/pixdesc.h"
+#include "libswscale/swscale.h"
+
+typedef struct FrameReader {
+    AVFormatContext *fmt_ctx;
+    AVCodecContext *dec_ctx;
+    struct SwsContext *sws_ctx;
+    AVPacket *pkt;
+    AVFrame *frame;
+    int video_index;
+    int flushing;               /* the decoder was sent EOF */
+    int64_t skip_until;         /* frames before a seek target are dropped */
+    int64_t start;              /* start time of the stream */
+
+    int width, height;
+    enum AVPixelFormat format;
+    int frame_size;
+    int batch;
+    uint8_t *data;              /* batch frames of frame_size bytes */
+    double *times;              /* batch times in seconds */
+} FrameReader;
+
+void frame_reader_close(FrameReader *r)
+{
+    if (!r)
+        return;
+    avformat_close_input(&r->fmt_ctx);
+    avcodec_free_context(&r->dec_ctx);
+    sws_freeContext(r->sws_ctx);
+    av_packet_free(&r->pkt);
+    av_frame_free(&r->frame);
+    av_free(r->data);
+    av_free(r->times);
+    av_free(r);
+}
+
+static int open_decoder(FrameReader *r, const char *path)
+{
+    const AVCodec *dec;
+    AVStream *st;
+    int ret;
+
+    ret = avformat_open_input(&r->fmt_ctx, path, NULL, NULL);
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_ERROR, "%s: %s\n", path, av_err2str(ret));
+        return ret;
+    }
+    ret = avformat_find_stream_info(r->fmt_ctx, NULL);
+    if (ret < 0)
+        return ret;
+
+    ret = av_find_best_stream(r->fmt_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, &dec, 0);
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_ERROR, "%s: no decodable video stream\n", path);
+        return ret;
+    }
+    r->video_index = ret;
+    for (int i = 0; i < r->fmt_ctx->nb_streams; i++)
+        if (i != r->video_index)
+            r->fmt_ctx->streams[i]->discard = AVDISCARD_ALL;
+    st = r->fmt_ctx->streams[r->video_index];
+
+    r->dec_ctx = avcodec_alloc_context3(dec);
+    if (!r->dec_ctx)
+        return AVERROR(ENOMEM);
+    ret = avcodec_parameters_to_context(r->dec_ctx, st->codecpar);
+    if (ret < 0)
+        return ret;
+    r->dec_ctx->pkt_timebase = st->time_base;
+    r->start = st->start_time != AV_NOPTS_VALUE ? st->start_time : 0;
+    return avcodec_open2(r->dec_ctx, dec, NULL);
+}
+
+/* set_size keeps the display aspect ratio when one dimension is missing */
+static void set_size(FrameReader *r, int width, int height)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(r->format);
+    AVRational sar = r->dec_ctx->sample_aspect_ratio;
+
+    if (!sar.num || !sar.den)
+        sar = (AVRational){ 1, 1 };
+    if (width <= 0 && height <= 0) {
+        width  = r->dec_ctx->width;
+        height = r->dec_ctx->height;
+    } else if (width <= 0) {
+        width  = av_rescale(height, r->dec_ctx->width * (int64_t)sar.num,
+                            r->dec_ctx->height * (int64_t)sar.den);
+    } else if (height <= 0) {
+        height = av_rescale(width, r->dec_ctx->height * (int64_t)sar.den,
+                            r->dec_ctx->width * (int64_t)sar.num);
+    }
+    /* subsampled chroma planes need even dimensions */
+    r->width  = FFMAX(width  & ~((1 << desc->log2_chroma_w) - 1), 1 << desc->log2_chroma_w);
+    r->height = FFMAX(height & ~((1 << desc->log2_chroma_h) - 1), 1 << desc->log2_chroma_h);
+}
+
+/**
+ * Open path and decode its best video stream into frames of pix_fmt, ex:
+ * "rgba" for canvas ImageData, scaled to width x height. A width or height
+ * <= 0 is computed from the other one, both <= 0 keep the decoded size.
+ *
+ * @return the reader, NULL on error
+ */
+FrameReader *frame_reader_open(const char *path, int width, int height,
+                               const char *pix_fmt, int batch)
+{
+    FrameReader *r = av_mallocz(sizeof(*r));
+    int ret;
+
+    if (!r)
+        return NULL;
+    r->skip_until = AV_NOPTS_VALUE;
+    r->batch      = FFMAX(batch, 1);
+    r->format     = av_get_pix_fmt(pix_fmt);
+    if (r->format == AV_PIX_FMT_NONE ||
+        av_pix_fmt_desc_get(r->format)->flags & AV_PIX_FMT_FLAG_HWACCEL) {
+        av_log(NULL, AV_LOG_ERROR, "Invalid pixel format '%s'\n", pix_fmt);
+        goto fail;
+    }
+
+    ret = open_decoder(r, path);
+    if (ret < 0)
+        goto fail;
+    set_size(r, width, height);
+
+    r->frame_size = av_image_get_buffer_size(r->format, r->width, r->height, 1);
+    if (r->frame_size < 0 || r->frame_size > INT_MAX / r->batch)
+        goto fail;
+    r->data  = av_malloc((size_t)r->frame_size * r->batch);
+    r->times = av_malloc_array(r->batch, sizeof(*r->times));
+    r->pkt   = av_packet_alloc();
+    r->frame = av_frame_alloc();
+    if (!r->data || !r->times || !r->pkt || !r->frame)
+        goto fail;
+
+    return r;
+fail:
+    frame_reader_close(r);
+    return NULL;
+}
+
+/* send_packet feeds the decoder with the next packet of the video stream,
+ * or with EOF at the end of the input */
+static int send_packet(FrameReader *r)
+{
+    int ret;
+
+    while ((ret = av_read_frame(r->fmt_ctx, r->pkt)) >= 0) {
+        if (r->pkt->stream_index == r->video_index)
+            break;
+        av_packet_unref(r->pkt);
+    }
+    if (ret == AVERROR_EOF) {
+        r->flushing = 1;
+        return avcodec_send_packet(r->dec_ctx, NULL);
+    }
+    if (ret < 0)
+        return ret;
+
+    ret = avcodec_send_packet(r->dec_ctx, r->pkt);
+    av_packet_unref(r->pkt);
+    /* skip corrupt packets like ffmpeg does */
+    return ret == AVERROR_INVALIDDATA ? 0 : ret;
+}
+
+static int convert_frame(FrameReader *r, int index)
+{
+    AVFrame *f = r->frame;
+    uint8_t *dst_data[4];
+    int dst_linesize[4];
+    int ret;
+
+    ret = av_image_fill_arrays(dst_data, dst_linesize,
+                               r->data + (size_t)index * r->frame_size,
+                               r->format, r->width, r->height, 1);
+    if (ret < 0)
+        return ret;
+
+    if (f->width == r->width && f->height == r->height && f->format == r->format) {
+        av_image_copy(dst_data, dst_linesize, (const uint8_t **)f->data,
+                      f->linesize, r->format, r->width, r->height);
+        return 0;
+    }
+
+    r->sws_ctx = sws_getCachedContext(r->sws_ctx, f->width, f->height, f->format,
+                                      r->width, r->height, r->format,
+                                      SWS_BICUBIC, NULL, NULL, NULL);
+    if (!r->sws_ctx)
+        return AVERROR(EINVAL);
+    sws_scale(r->sws_ctx, (const uint8_t * const *)f->data, f->linesize,
+              0, f->height, dst_data, dst_linesize);
+    return 0;
+}
+
+/**
+ * Decode the next frames into frame_reader_data() and frame_reader_times(),
+ * overwriting the previous ones.
+ *
+ * @return the number of frames, up to batch, 0 at the end of the input or a
+ *         negative AVERROR
+ */
+int frame_reader_read(FrameReader *r)
+{
+    AVRational tb = r->fmt_ctx->streams[r->video_index]->time_base;
+    int n = 0, ret;
+
+    while (n < r->batch) {
+        int64_t pts;
+
+        ret = avcodec_receive_frame(r->dec_ctx, r->frame);
+        if (ret == AVERROR(EAGAIN) && !r->flushing) {
+            if ((ret = send_packet(r)) < 0)
+                return ret;
+            continue;
+        }
+        if (ret == AVERROR_EOF)
+            break;
+        if (ret < 0)
+            return ret;
+
+        pts = r->frame->best_effort_timestamp;
+        if (r->skip_until != AV_NOPTS_VALUE && pts != AV_NOPTS_VALUE &&
+            pts < r->skip_until) {
+            av_frame_unref(r->frame);
+            continue;
+        }
+        r->skip_until = AV_NOPTS_VALUE;
+
+        ret = convert_frame(r, n);
+        av_frame_unref(r->frame);
+        if (ret < 0)
+            return ret;
+        r->times[n++] = pts != AV_NOPTS_VALUE ? (pts - r->start) * av_q2d(tb) : NAN;
+    }
+    return n;
+}
+
+/**
+ * Seek to time in seconds, the next frame read is the first one at or after
+ * time.
+ */
+int frame_reader_seek(FrameReader *r, double time)
+{
+    AVStream *st = r->fmt_ctx->streams[r->video_index];
+    int64_t ts = llrint(time / av_q2d(st->time_base)) + r->start;
+    int ret;
+
+    ret = avformat_seek_file(r->fmt_ctx, r->video_index, INT64_MIN, ts, ts, 0);
+    if (ret < 0)
+        ret = avformat_seek_file(r->fmt_ctx, r->video_index, INT64_MIN, ts, INT64_MAX, 0);
+    if (ret < 0)
+        return ret;
+
+    avcodec_flush_buffers(r->dec_ctx);
+    r->flushing   = 0;
+    r->skip_until = ts;
+    return 0;
+}
+
+uint8_t *frame_reader_data(FrameReader *r)
+{
+    return r->data;
+}
+
+double *frame_reader_times(FrameReader *r)
+{
+    return r->times;
+}
+
+int frame_reader_width(FrameReader *r)
+{
+    return r->width;
+}
+
+int frame_reader_height(FrameReader *r)
+{
+    return r->height;
+}
+
+int frame_reader_frame_size(FrameReader *r)
+{
+    return r->frame_size;
+}
+
+typedef struct FrameWriter {
+    AVFormatContext *fmt_ctx;
+    AVCodecContext *enc_ctx;
+    AVFilterGraph *graph;
+    AVFilterContext *src;
+    AVFilterContext *sink;
+    AVFrame *frame;
+    AVFrame *filtered;
+    AVPacket *pkt;
+    AVStream *st;
+
+    int width, height;
+    enum AVPixelFormat format;
+    AVRational time_base;       /* 1 / frame rate */
+    int64_t next_pts;
+    int frame_size;
+    uint8_t *input;             /* a frame of frame_size bytes written by JS */
+} FrameWriter;
+
+static void frame_writer_free(FrameWriter *w)
+{
+    if (!w)
+        return;
+    if (w->fmt_ctx && !(w->fmt_ctx->oformat->flags & AVFMT_NOFILE))
+        avio_closep(&w->fmt_ctx->pb);
+    avformat_free_context(w->fmt_ctx);
+    avcodec_free_context(&w->enc_ctx);
+    avfilter_graph_free(&w->graph);
+    av_frame_free(&w->frame);
+    av_frame_free(&w->filtered);
+    av_packet_free(&w->pkt);
+    av_free(w->input);
+    av_free(w);
+}
+
+/* parse_args splits ffmpeg style output args, the video codec, filters,
+ * pixel format and output format are handled here, every other option is
+ * given to the encoder, then to the muxer, as ffmpeg does. Stream
+ * specifiers are dropped as there is only one stream. */
+static int parse_args(int argc, char **argv, const char **codec,
+                      const char **vf, const char **pix_fmt,
+                      const char **format, AVDictionary **opts)
+{
+    for (int i = 0; i < argc; i += 2) {
+        char key[64];
+        const char *arg = argv[i], *val = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (arg[0] != '-' || !val) {
+            av_log(NULL, AV_LOG_ERROR, "Expected '-option value' pairs, "
+                   "found '%s'\n", arg);
+            return AVERROR(EINVAL);
+        }
+        av_strlcpy(key, arg + 1, sizeof(key));
+        key[strcspn(key, ":")] = 0;
+
+        if (!strcmp(key, "c") || !strcmp(key, "codec") || !strcmp(key, "vcodec"))
+            *codec = val;
+        else if (!strcmp(key, "vf") || !strcmp(key, "filter"))
+            *vf = val;
+        else if (!strcmp(key, "pix_fmt"))
+            *pix_fmt = val;
+        else if (!strcmp(key, "f"))
+            *format = val;
+        else if (av_dict_set(opts, key, val, 0) < 0)
+            return AVERROR(ENOMEM);
+    }
+    return 0;
+}
+
+/* init_filters builds buffer -> [vf,]format -> buffersink, the format filter
+ * converts frames to the pixel format of the encoder */
+static int init_filters(FrameWriter *w, const AVCodec *enc, const char *vf,
+                        const char *pix_fmt)
+{
+    enum AVPixelFormat enc_fmt = pix_fmt ? av_get_pix_fmt(pix_fmt) : AV_PIX_FMT_NONE;
+    AVFilterInOut *outputs = avfilter_inout_alloc();
+    AVFilterInOut *inputs  = avfilter_inout_alloc();
+    char args[256], *desc = NULL;
+    int ret;
+
+    if (pix_fmt && enc_fmt == AV_PIX_FMT_NONE) {
+        av_log(NULL, AV_LOG_ERROR, "Invalid pixel format '%s'\n", pix_fmt);
+        ret = AVERROR(EINVAL);
+        goto end;
+    }
+    /* same choice as ffmpeg when -pix_fmt is not set */
+    if (enc_fmt == AV_PIX_FMT_NONE)
+        enc_fmt = enc->pix_fmts ?
+                  avcodec_find_best_pix_fmt_of_list(enc->pix_fmts, w->format, 0, NULL) :
+                  w->format;
+
+    w->graph = avfilter_graph_alloc();
+    if (!outputs || !inputs || !w->graph) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    snprintf(args, sizeof(args),
+             "video_size=%dx%d:pix_fmt=%d:time_base=%d/%d:pixel_aspect=1/1:frame_rate=%d/%d",
+             w->width, w->height, w->format, w->time_base.num, w->time_base.den,
+             w->time_base.den, w->time_base.num);
+    ret = avfilter_graph_create_filter(&w->src, avfilter_get_by_name("buffer"),
+                                       "in", args, NULL, w->graph);
+    if (ret < 0)
+        goto end;
+    ret = avfilter_graph_create_filter(&w->sink, avfilter_get_by_name("buffersink"),
+                                       "out", NULL, NULL, w->graph);
+    if (ret < 0)
+        goto end;
+
+    desc = av_asprintf("%s%sformat=pix_fmts=%s", vf ? vf : "", vf ? "," : "",
+                       av_get_pix_fmt_name(enc_fmt));
+    if (!desc) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    outputs->name       = av_strdup("in");
+    outputs->filter_ctx = w->src;
+    inputs->name        = av_strdup("out");
+    inputs->filter_ctx  = w->sink;
+    if (!outputs->name || !inputs->name) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    ret = avfilter_graph_parse_ptr(w->graph, desc, &inputs, &outputs, NULL);
+    if (ret >= 0)
+        ret = avfilter_graph_config(w->graph, NULL);
+end:
+    av_free(desc);
+    avfilter_inout_free(&inputs);
+    avfilter_inout_free(&outputs);
+    return ret;
+}
+
+static int open_encoder(FrameWriter *w, const AVCodec *enc, AVDictionary **opts)
+{
+    int ret;
+
+    w->enc_ctx = avcodec_alloc_context3(enc);
+    if (!w->enc_ctx)
+        return AVERROR(ENOMEM);
+    w->enc_ctx->width               = av_buffersink_get_w(w->sink);
+    w->enc_ctx->height              = av_buffersink_get_h(w->sink);
+    w->enc_ctx->pix_fmt             = av_buffersink_get_format(w->sink);
+    w->enc_ctx->sample_aspect_ratio = av_buffersink_get_sample_aspect_ratio(w->sink);
+    w->enc_ctx->time_base           = av_buffersink_get_time_base(w->sink);
+    w->enc_ctx->framerate           = av_buffersink_get_frame_rate(w->sink);
+    if (w->fmt_ctx->oformat->flags & AVFMT_GLOBALHEADER)
+        w->enc_ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+
+    ret = avcodec_open2(w->enc_ctx, enc, opts);
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_ERROR, "Error opening encoder %s: %s\n",
+               enc->name, av_err2str(ret));
+        return ret;
+    }
+
+    w->st = avformat_new_stream(w->fmt_ctx, NULL);
+    if (!w->st)
+        return AVERROR(ENOMEM);
+    w->st->time_base = w->enc_ctx->time_base;
+    w->st->avg_frame_rate = w->enc_ctx->framerate;
+    w->st->sample_aspect_ratio = w->enc_ctx->sample_aspect_ratio;
+    return avcodec_parameters_from_context(w->st->codecpar, w->enc_ctx);
+}
+
+/**
+ * Open an encoder writing path, fed with frames of width x height in pix_fmt
+ * written by JS at frame_rate. argv holds ffmpeg style output args, ex:
+ * -c:v libx264 -crf 23 -pix_fmt yuv420p -vf scale=640:-2.
+ *
+ * @return the writer, NULL on error
+ */
+FrameWriter *frame_writer_open(const char *path, int width, int height,
+                               const char *pix_fmt, double frame_rate,
+                               int argc, char **argv)
+{
+    FrameWriter *w = av_mallocz(sizeof(*w));
+    const char *codec = NULL, *vf = NULL, *enc_pix_fmt = NULL, *format = NULL;
+    AVDictionary *opts = NULL;
+    const AVDictionaryEntry *e = NULL;
+    const AVCodec *enc;
+    AVRational rate;
+    int ret;
+
+    if (!w)
+        return NULL;
+    w->width  = width;
+    w->height = height;
+    w->format = av_get_pix_fmt(pix_fmt);
+    rate = av_d2q(frame_rate, 1001000);
+    if (w->format == AV_PIX_FMT_NONE || width <= 0 || height <= 0 ||
+        rate.num <= 0 || rate.den <= 0) {
+        av_log(NULL, AV_LOG_ERROR, "Invalid frames: %dx%d %s at %f fps\n",
+               width, height, pix_fmt, frame_rate);
+        goto fail;
+    }
+    w->time_base = av_inv_q(rate);
+
+    if (parse_args(argc, argv, &codec, &vf, &enc_pix_fmt, &format, &opts) < 0)
+        goto fail;
+
+    ret = avformat_alloc_output_context2(&w->fmt_ctx, NULL, format, path);
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_ERROR, "%s: %s\n", path, av_err2str(ret));
+        goto fail;
+    }
+    enc = codec ? avcodec_find_encoder_by_name(codec) :
+                  avcodec_find_encoder(w->fmt_ctx->oformat->video_codec);
+    if (!enc || enc->type != AVMEDIA_TYPE_VIDEO) {
+        av_log(NULL, AV_LOG_ERROR, "Unknown video encoder '%s'\n",
+               codec ? codec : avcodec_get_name(w->fmt_ctx->oformat->video_codec));
+        goto fail;
+    }
+
+    if (init_filters(w, enc, vf, enc_pix_fmt) < 0 ||
+        open_encoder(w, enc, &opts) < 0)
+        goto fail;
+
+    if (!(w->fmt_ctx->oformat->flags & AVFMT_NOFILE)) {
+        ret = avio_open(&w->fmt_ctx->pb, path, AVIO_FLAG_WRITE);
+        if (ret < 0) {
+            av_log(NULL, AV_LOG_ERROR, "%s: %s\n", path, av_err2str(ret));
+            goto fail;
+        }
+    }
+    /* options left by the encoder are muxer options */
+    ret = avformat_write_header(w->fmt_ctx, &opts);
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_ERROR, "Error writing header of %s: %s\n",
+               path, av_err2str(ret));
+        goto fail;
+    }
+    while ((e = av_dict_get(opts, "", e, AV_DICT_IGNORE_SUFFIX)))
+        av_log(NULL, AV_LOG_WARNING, "Option %s not used.\n", e->key);
+    av_dict_free(&opts);
+
+    w->frame_size = av_image_get_buffer_size(w->format, width, height, 1);
+    w->input      = av_malloc(w->frame_size);
+    w->frame      = av_frame_alloc();
+    w->filtered   = av_frame_alloc();
+    w->pkt        = av_packet_alloc();
+    if (w->frame_size < 0 || !w->input || !w->frame || !w->filtered || !w->pkt)
+        goto fail;
+
+    return w;
+fail:
+    av_dict_free(&opts);
+    frame_writer_free(w);
+    return NULL;
+}
+
+static int write_packets(FrameWriter *w)
+{
+    int ret;
+
+    while ((ret = avcodec_receive_packet(w->enc_ctx, w->pkt)) >= 0) {
+        w->pkt->stream_index = w->st->index;
+        av_packet_rescale_ts(w->pkt, w->enc_ctx->time_base, w->st->time_base);
+        ret = av_interleaved_write_frame(w->fmt_ctx, w->pkt);
+        if (ret < 0)
+            return ret;
+    }
+    return ret == AVERROR(EAGAIN) || ret == AVERROR_EOF ? 0 : ret;
+}
+
+/* encode_filtered encodes the frames out of the filtergraph, and flushes the
+ * encoder once the filtergraph reached EOF */
+static int encode_filtered(FrameWriter *w)
+{
+    int ret;
+
+    for (;;) {
+        ret = av_buffersink_get_frame(w->sink, w->filtered);
+        if (ret == AVERROR(EAGAIN))
+            return 0;
+        if (ret == AVERROR_EOF) {
+            ret = avcodec_send_frame(w->enc_ctx, NULL);
+            return ret < 0 ? ret : write_packets(w);
+        }
+        if (ret < 0)
+            return ret;
+
+        w->filtered->pict_type = AV_PICTURE_TYPE_NONE;
+        ret = avcodec_send_frame(w->enc_ctx, w->filtered);
+        av_frame_unref(w->filtered);
+        if (ret < 0 || (ret = write_packets(w)) < 0)
+            return ret;
+    }
+}
+
+/**
+ * Encode the frame written by JS in frame_writer_input(), at time in seconds,
+ * or right after the previous frame when time is NaN. Frames are encoded
+ * before returning, so a writer never holds more than the encoder delay.
+ *
+ * @return 0 or a negative AVERROR
+ */
+int frame_writer_write(FrameWriter *w, double time)
+{
+    uint8_t *src_data[4];
+    int src_linesize[4];
+    int64_t pts = isnan(time) ? w->next_pts : llrint(time / av_q2d(w->time_base));
+    int ret;
+
+    /* times are rounded to the frame rate, keep them increasing */
+    pts = FFMAX(pts, w->next_pts);
+    w->next_pts = pts + 1;
+
+    /* the filtergraph may keep the frame, so each write gets its own buffer */
+    w->frame->format = w->format;
+    w->frame->width  = w->width;
+    w->frame->height = w->height;
+    ret = av_frame_get_buffer(w->frame, 0);
+    if (ret < 0)
+        return ret;
+    av_image_fill_arrays(src_data, src_linesize, w->input, w->format,
+                         w->width, w->height, 1);
+    av_image_copy(w->frame->data, w->frame->linesize, (const uint8_t **)src_data,
+                  src_linesize, w->format, w->width, w->height);
+    w->frame->pts = pts;
+
+    ret = av_buffersrc_add_frame(w->src, w->frame);
+    av_frame_unref(w->frame);
+    if (ret < 0)
+        return ret;
+    return encode_filtered(w);
+}
+
+/**
+ * Flush the encoder, finish the output file and free the writer.
+ *
+ * @return 0 or a negative AVERROR
+ */
+int frame_writer_close(FrameWriter *w)
+{
+    int ret;
+
+    if (!w)
+        return AVERROR(EINVAL);
+    ret = av_buffersrc_add_frame(w->src, NULL);
+    if (ret >= 0)
+        ret = encode_filtered(w);
+    if (ret >= 0)
+        ret = av_write_trailer(w->fmt_ctx);
+    if (ret < 0)
+        av_log(NULL, AV_LOG_ERROR, "Error finishing the output: %s\n",
+               av_err2str(ret));
+    frame_writer_free(w);
+    return ret;
+}
+
+uint8_t *frame_writer_input(FrameWriter *w)
+{
+    return w->input;
+}
+
+int frame_writer_frame_size(FrameWriter *w)
+{
+    return w->frame_size;
+}
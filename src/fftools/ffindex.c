@@ -0,0 +1,414 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * ffindex, keyframe index sidecar of ffmpeg.wasm.
+ *
+ * Formats like MPEG-TS or Matroska without cues have no index, so every
+ * -ss searches the input for a keyframe again. ffindex reads the packets of
+ * the input once, without decoding, and writes the timestamps, byte offset
+ * and GOP size of every keyframe of each stream. ffmpeg -seek_index loads
+ * the index to seek straight to the byte offset of a keyframe, and the
+ * index is plain text so JS can plan segments from it.
+ *
+ * The offset is where the demuxer can resume reading: the packet for most
+ * formats, the cluster holding the keyframe for Matroska. Inputs with an
+ * index of their own, ex: MP4, are indexed too for JS, but -seek_index
+ * leaves their index alone.
+ *
+ * usage: ffindex -i input [-interval seconds] [output]
+ *
+ * output defaults to input.ffindex. Every packet of audio and other non
+ * video streams is a keyframe, their entries are at least -interval
+ * seconds apart (default 1). The format is, one record per line:
+ *
+ *   ffindex <version> <input size> <streams>
+ *   stream <index> <v|a|s|d|t> <time base num> <time base den>
+ *   key <stream> <dts> <pts> <pos> <gop packets> <gop bytes>
+ *
+ * Timestamps are in the time base of the stream, pts is dts when unknown,
+ * a GOP covers the packets from a key entry up to the next one.
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cmdutils.h"
+#include "ffindex.h"
+
+#include "libavformat/avformat.h"
+#include "libavutil/avstring.h"
+#include "libavutil/bprint.h"
+#include "libavutil/mathematics.h"
+
+#define INDEX_VERSION 1
+
+typedef struct IndexEntry {
+    int stream;
+    int64_t dts;
+    int64_t pts;
+    int64_t pos;
+    int64_t packets;            /* packets of the GOP */
+    int64_t bytes;              /* bytes of the GOP */
+} IndexEntry;
+
+static const char *input_path;
+static const char *output_path;
+static double interval;
+
+static AVFormatContext *ifmt_ctx;
+static AVPacket *pkt;
+static IndexEntry *entries;
+static int nb_entries;
+static int *last_entry;         /* per stream, entry of the current GOP */
+static int nb_streams;          /* streams in last_entry */
+static char *default_output;
+
+static void index_cleanup(int ret)
+{
+    avformat_close_input(&ifmt_ctx);
+    av_packet_free(&pkt);
+    av_freep(&entries);
+    nb_entries = 0;
+    av_freep(&last_entry);
+    nb_streams = 0;
+    av_freep(&default_output);
+}
+
+static void init_globals(void)
+{
+    input_path  = NULL;
+    output_path = NULL;
+    interval    = 1;
+}
+
+static void parse_args(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++) {
+        const char *opt = argv[i];
+
+        if (opt[0] != '-' || !opt[1]) {
+            output_path = opt;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            av_log(NULL, AV_LOG_FATAL, "Missing argument for option '%s'\n", opt);
+            exit_program(1);
+        }
+
+        if (!strcmp(opt, "-i"))
+            input_path = argv[++i];
+        else if (!strcmp(opt, "-interval"))
+            interval = strtod(argv[++i], NULL);
+        else {
+            av_log(NULL, AV_LOG_FATAL, "Unrecognized option '%s'\n", opt);
+            exit_program(1);
+        }
+    }
+
+    if (!input_path) {
+        av_log(NULL, AV_LOG_FATAL, "usage: ffindex -i input [-interval seconds] "
+               "[output]\n");
+        exit_program(1);
+    }
+    if (!output_path) {
+        default_output = av_asprintf("%s.ffindex", input_path);
+        if (!default_output)
+            exit_program(1);
+        output_path = default_output;
+    }
+}
+
+static int is_matroska(const AVFormatContext *ic)
+{
+    return !strcmp(ic->iformat->name, "matroska,webm");
+}
+
+/* keyframe_pos gives the offset a seek to the keyframe resumes from.
+ * Matroska resyncs on clusters only: its demuxer indexes the cluster of
+ * every keyframe by pts while reading, before returning the packet. */
+static int64_t keyframe_pos(AVStream *st, const AVPacket *packet)
+{
+    const AVIndexEntry *e;
+
+    if (!is_matroska(ifmt_ctx))
+        return packet->pos;
+    if (packet->pts == AV_NOPTS_VALUE)
+        return -1;
+    e = avformat_index_get_entry(st, av_index_search_timestamp(st, packet->pts,
+                                                               AVSEEK_FLAG_BACKWARD));
+    return e && e->timestamp == packet->pts ? e->pos : -1;
+}
+
+/* add_packet starts a new entry at a keyframe, or adds the packet to the
+ * GOP of the current entry of its stream */
+static int add_packet(const AVPacket *packet)
+{
+    AVStream *st = ifmt_ctx->streams[packet->stream_index];
+    int64_t dts = packet->dts != AV_NOPTS_VALUE ? packet->dts : packet->pts;
+    int cur = last_entry[packet->stream_index];
+    int64_t pos = -1;
+    IndexEntry *e;
+
+    if (packet->flags & AV_PKT_FLAG_KEY && dts != AV_NOPTS_VALUE)
+        pos = keyframe_pos(st, packet);
+    if (pos >= 0 &&
+        (cur < 0 || st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO ||
+         (dts - entries[cur].dts) * av_q2d(st->time_base) >= interval)) {
+        e = av_dynarray2_add((void **)&entries, &nb_entries, sizeof(*entries), NULL);
+        if (!e)
+            return AVERROR(ENOMEM);
+        e->stream  = packet->stream_index;
+        e->dts     = dts;
+        e->pts     = packet->pts != AV_NOPTS_VALUE ? packet->pts : dts;
+        e->pos     = pos;
+        e->packets = 0;
+        e->bytes   = 0;
+        cur = last_entry[packet->stream_index] = nb_entries - 1;
+    }
+    /* packets before the first keyframe cannot be seeked to */
+    if (cur < 0)
+        return 0;
+    entries[cur].packets++;
+    entries[cur].bytes += packet->size;
+    return 0;
+}
+
+static int write_index(void)
+{
+    AVIOContext *pb;
+    AVBPrint bp;
+    int ret;
+
+    av_bprint_init(&bp, 0, AV_BPRINT_SIZE_UNLIMITED);
+    av_bprintf(&bp, "ffindex %d %"PRId64" %d\n", INDEX_VERSION,
+               avio_size(ifmt_ctx->pb), ifmt_ctx->nb_streams);
+    for (int i = 0; i < ifmt_ctx->nb_streams; i++) {
+        AVStream *st = ifmt_ctx->streams[i];
+        const char *type = av_get_media_type_string(st->codecpar->codec_type);
+
+        av_bprintf(&bp, "stream %d %c %d %d\n", i, type ? type[0] : 'd',
+                   st->time_base.num, st->time_base.den);
+    }
+    for (int i = 0; i < nb_entries; i++) {
+        const IndexEntry *e = &entries[i];
+        av_bprintf(&bp, "key %d %"PRId64" %"PRId64" %"PRId64" %"PRId64" %"PRId64"\n",
+                   e->stream, e->dts, e->pts, e->pos, e->packets, e->bytes);
+    }
+    if (!av_bprint_is_complete(&bp)) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    ret = avio_open(&pb, output_path, AVIO_FLAG_WRITE);
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_FATAL, "%s: %s\n", output_path, av_err2str(ret));
+        goto end;
+    }
+    avio_write(pb, bp.str, bp.len);
+    ret = avio_closep(&pb);
+end:
+    av_bprint_finalize(&bp, NULL);
+    return ret;
+}
+
+static int build_index(void)
+{
+    int ret;
+
+    ret = avformat_open_input(&ifmt_ctx, input_path, NULL, NULL);
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_FATAL, "%s: %s\n", input_path, av_err2str(ret));
+        return ret;
+    }
+    ret = avformat_find_stream_info(ifmt_ctx, NULL);
+    if (ret < 0)
+        return ret;
+
+    pkt = av_packet_alloc();
+    if (!pkt)
+        return AVERROR(ENOMEM);
+
+    while ((ret = av_read_frame(ifmt_ctx, pkt)) >= 0) {
+        /* streams may show up while reading, ex: MPEG-TS */
+        if (pkt->stream_index >= nb_streams) {
+            int *tmp = av_realloc_array(last_entry, ifmt_ctx->nb_streams, sizeof(*tmp));
+            if (!tmp) {
+                av_packet_unref(pkt);
+                return AVERROR(ENOMEM);
+            }
+            last_entry = tmp;
+            for (; nb_streams < ifmt_ctx->nb_streams; nb_streams++)
+                last_entry[nb_streams] = -1;
+        }
+        ret = add_packet(pkt);
+        av_packet_unref(pkt);
+        if (ret < 0)
+            return ret;
+    }
+    if (ret != AVERROR_EOF)
+        return ret;
+
+    return write_index();
+}
+
+/**
+ * Lines of the index are checked against the input, so an index of another
+ * file or a file changed since it was built is rejected instead of sending
+ * seeks to wrong offsets.
+ *
+ * Only streams the demuxer has no index entries for after its header are
+ * loaded. For formats like MP4 the index is the sample table itself, which
+ * foreign entries would corrupt.
+ */
+int ffindex_load(AVFormatContext *ic, const char *path,
+                 const int *nb_entries, int nb_streams)
+{
+    AVIOContext *pb = NULL;
+    AVBPrint bp;
+    char *line, *ptr;
+    int64_t size;
+    int version, streams, nb_keys = 0, ret;
+    uint8_t *indexed;
+
+    /* streams found by probing had no header to index them */
+    indexed = av_calloc(ic->nb_streams, sizeof(*indexed));
+    if (!indexed)
+        return AVERROR(ENOMEM);
+    for (int i = 0; i < FFMIN(nb_streams, ic->nb_streams); i++)
+        indexed[i] = nb_entries[i] > 0;
+
+    av_bprint_init(&bp, 0, AV_BPRINT_SIZE_UNLIMITED);
+    ret = avio_open(&pb, path, AVIO_FLAG_READ);
+    if (ret < 0)
+        goto end;
+    ret = avio_read_to_bprint(pb, &bp, INT_MAX);
+    if (ret < 0)
+        goto end;
+    if (!av_bprint_is_complete(&bp)) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    ret = AVERROR_INVALIDDATA;
+    line = av_strtok(bp.str, "\n", &ptr);
+    if (!line || sscanf(line, "ffindex %d %"SCNd64" %d", &version, &size, &streams) != 3 ||
+        version != INDEX_VERSION)
+        goto end;
+    if (size != avio_size(ic->pb) || streams > ic->nb_streams) {
+        av_log(NULL, AV_LOG_WARNING, "%s was built from another input\n", path);
+        goto end;
+    }
+
+    while ((line = av_strtok(NULL, "\n", &ptr))) {
+        int64_t dts, pts, pos, packets, bytes;
+        int index, num, den;
+        char type;
+
+        if (sscanf(line, "stream %d %c %d %d", &index, &type, &num, &den) == 4) {
+            AVStream *st;
+
+            if (index < 0 || index >= ic->nb_streams)
+                goto end;
+            st = ic->streams[index];
+            if (st->time_base.num != num || st->time_base.den != den) {
+                av_log(NULL, AV_LOG_WARNING, "%s was built from another input\n", path);
+                goto end;
+            }
+        } else if (sscanf(line, "key %d %"SCNd64" %"SCNd64" %"SCNd64" %"SCNd64" %"SCNd64,
+                          &index, &dts, &pts, &pos, &packets, &bytes) == 6) {
+            if (index < 0 || index >= ic->nb_streams)
+                goto end;
+            if (indexed[index])
+                continue;
+            /* lavf indexes keyframes by dts, the Matroska demuxer by pts */
+            if (av_add_index_entry(ic->streams[index], pos,
+                                   is_matroska(ic) ? pts : dts, 0, 0,
+                                   AVINDEX_KEYFRAME) >= 0)
+                nb_keys++;
+        } else
+            goto end;
+    }
+    for (int i = 0; i < ic->nb_streams; i++)
+        if (indexed[i])
+            av_log(NULL, AV_LOG_VERBOSE, "Stream #%d has its own index, "
+                   "ignoring %s for it\n", i, path);
+    av_log(NULL, AV_LOG_VERBOSE, "Loaded %d keyframes from %s\n", nb_keys, path);
+    ret = 0;
+end:
+    avio_closep(&pb);
+    av_bprint_finalize(&bp, NULL);
+    av_free(indexed);
+    return ret;
+}
+
+/**
+ * Byte seeks only suit formats resyncing on any packet, ex: MPEG-TS and
+ * MPEG-PS. Others, ex: Matroska, keep their own seek, which looks the
+ * target up in the loaded index entries before searching the input.
+ */
+int ffindex_seek(AVFormatContext *ic, int64_t timestamp)
+{
+    const AVIndexEntry *e;
+    AVStream *st = NULL;
+    int64_t ts;
+    int index;
+
+    if (!(ic->iformat->flags & AVFMT_TS_DISCONT) ||
+        ic->iformat->flags & AVFMT_NO_BYTE_SEEK)
+        return AVERROR(ENOSYS);
+
+    for (int i = 0; i < ic->nb_streams; i++) {
+        AVStream *s = ic->streams[i];
+        if (!avformat_index_get_entries_count(s))
+            continue;
+        if (!st || (s->codecpar->codec_type == AVMEDIA_TYPE_VIDEO &&
+                    st->codecpar->codec_type != AVMEDIA_TYPE_VIDEO))
+            st = s;
+    }
+    if (!st)
+        return AVERROR(ENOENT);
+
+    ts    = av_rescale_q(timestamp, AV_TIME_BASE_Q, st->time_base);
+    index = av_index_search_timestamp(st, ts, AVSEEK_FLAG_BACKWARD);
+    e     = avformat_index_get_entry(st, index);
+    if (!e)
+        return AVERROR(ENOENT);
+    return avformat_seek_file(ic, -1, e->pos, e->pos, e->pos, AVSEEK_FLAG_BYTE);
+}
+
+int ffindex(int argc, char **argv)
+{
+    int ret;
+
+    init_globals();
+    register_exit(index_cleanup);
+    av_log_set_flags(AV_LOG_SKIP_REPEATED);
+
+    parse_args(argc, argv);
+
+    ret = build_index();
+    if (ret < 0)
+        av_log(NULL, AV_LOG_ERROR, "ffindex failed: %s\n", av_err2str(ret));
+
+    exit_program(ret < 0);
+    return ret < 0;
+}
@@ -0,0 +1,52 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef FFTOOLS_FFINDEX_H
+#define FFTOOLS_FFINDEX_H
+
+#include <stdint.h>
+
+#include "libavformat/avformat.h"
+
+/*
+ * Keyframe index sidecar built by ffindex, see ffindex.c, used by ffmpeg
+ * with -seek_index to seek without searching the input for keyframes.
+ */
+
+/**
+ * Add the keyframes of the index at path to the streams of ic the demuxer
+ * has no index for, after checking the index was built from the same file.
+ *
+ * @param nb_entries the index entries count of the first nb_streams streams
+ *                   of ic right after avformat_open_input(), before
+ *                   avformat_find_stream_info() reads packets, which some
+ *                   demuxers index, ex: Matroska without cues
+ */
+int ffindex_load(AVFormatContext *ic, const char *path,
+                 const int *nb_entries, int nb_streams);
+
+/**
+ * Seek ic to the byte offset of the last indexed keyframe at or before
+ * timestamp, in AV_TIME_BASE, of its first indexed video stream.
+ *
+ * @return >= 0 on success, < 0 when the format or the index cannot serve
+ *         the seek, avformat_seek_file() still uses the loaded keyframes
+ */
+int ffindex_seek(AVFormatContext *ic, int64_t timestamp);
+
+#endif /* FFTOOLS_FFINDEX_H */
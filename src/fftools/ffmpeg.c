@@ -33,6 +33,10 @@
 #include <stdatomic.h>
 #include <stdint.h>
 #include <emscripten.h>
+#include <emscripten/heap.h>
+#ifdef __EMSCRIPTEN_PTHREADS__
+#include <emscripten/threading.h>
+#endif
 
 #if HAVE_IO_H
 #include <io.h>
@@ -61,6 +65,7 @@
 #include "libavutil/imgutils.h"
 #include "libavutil/timestamp.h"
 #include "libavutil/bprint.h"
+#include "libavutil/cpu.h"
 #include "libavutil/time.h"
 #include "libavutil/thread.h"
 #include "libavutil/threadmessage.h"
@@ -158,6 +163,19 @@ int         nb_output_files   = 0;
 FilterGraph **filtergraphs;
 int        nb_filtergraphs;
 
+ObjPool *packet_pool;
+ObjPool *frame_pool;
+/* planes of the frames of video decoders, see get_buffer() */
+static BufPool *buffer_pool;
+
+/* slice threads of a video filtergraph without -filter_threads or
+ * -filter_complex_threads, set from the thread budget in the MT core */
+int filter_auto_nbthreads;
+/* threads of an encoder without -threads, set from the thread budget too */
+static int enc_auto_nbthreads;
+/* the cpu count forced before this call of ffmpeg(), restored on exit */
+static int prev_cpu_count;
+
 #if HAVE_TERMIOS_H
 
 /* init terminal so that we can grab keys */
@@ -346,6 +364,8 @@ static atomic_int transcode_init_done = ATOMIC_VAR_INIT(0);
 static volatile int ffmpeg_exited = 0;
 int main_return_code = 0;
 static int64_t copy_ts_first_pts = AV_NOPTS_VALUE;
+static size_t last_heap_size = 0;
+static int64_t last_memory_check = 0;
 
 static void
 sigterm_handler(int sig)
@@ -521,6 +541,12 @@ static void ffmpeg_cleanup(int ret)
         av_log(NULL, AV_LOG_INFO, "bench: maxrss=%ikB\n", maxrss);
     }
 
+    /* undo the cpu count of set_thread_budget() and -cpucount for ffprobe,
+     * ffthumb, sessions and the next exec */
+    force_cpu_count(prev_cpu_count);
+    /* -cpuflags only applies to current exec */
+    av_force_cpu_flags(-1);
+
     for (i = 0; i < nb_filtergraphs; i++) {
         FilterGraph *fg = filtergraphs[i];
         avfilter_graph_free(&fg->graph);
@@ -531,7 +557,7 @@ static void ffmpeg_cleanup(int ret)
             if (ifilter->frame_queue) {
                 AVFrame *frame;
                 while (av_fifo_read(ifilter->frame_queue, &frame, 1) >= 0)
-                    av_frame_free(&frame);
+                    objpool_release(frame_pool, (void**)&frame);
                 av_fifo_freep2(&ifilter->frame_queue);
             }
             av_freep(&ifilter->displaymatrix);
@@ -555,6 +581,11 @@ static void ffmpeg_cleanup(int ret)
             av_freep(&fg->outputs[j]);
         }
         av_freep(&fg->outputs);
+#if HAVE_THREADS
+        for (j = 0; j < fg->nb_branches; j++)
+            branch_free(&fg->branches[j]);
+        av_freep(&fg->branches);
+#endif
         av_freep(&fg->graph_desc);
 
         av_freep(&filtergraphs[i]);
@@ -591,13 +622,16 @@ static void ffmpeg_cleanup(int ret)
         av_dict_free(&ost->sws_dict);
         av_dict_free(&ost->swr_opts);
 
+#if HAVE_THREADS
+        enc_thread_stop(ost);
+#endif
         avcodec_free_context(&ost->enc_ctx);
         avcodec_parameters_free(&ost->ref_par);
 
         if (ost->muxing_queue) {
             AVPacket *pkt;
             while (av_fifo_read(ost->muxing_queue, &pkt, 1) >= 0)
-                av_packet_free(&pkt);
+                objpool_release(packet_pool, (void**)&pkt);
             av_fifo_freep2(&ost->muxing_queue);
         }
 
@@ -614,6 +648,9 @@ static void ffmpeg_cleanup(int ret)
     for (i = 0; i < nb_input_streams; i++) {
         InputStream *ist = input_streams[i];
 
+#if HAVE_THREADS
+        dec_thread_stop(ist);
+#endif
         av_frame_free(&ist->decoded_frame);
         av_packet_free(&ist->pkt);
         av_dict_free(&ist->decoder_opts);
@@ -644,6 +681,10 @@ static void ffmpeg_cleanup(int ret)
 
     uninit_opts();
 
+    objpool_free(&packet_pool);
+    objpool_free(&frame_pool);
+    bufpool_free(&buffer_pool);
+
     avformat_network_deinit();
 
     if (received_sigterm) {
@@ -912,6 +953,11 @@ static int encode_frame(OutputFile *of, OutputStream *ost, AVFrame *frame)
 
     update_benchmark(NULL);
 
+#if HAVE_THREADS
+    if (ost->enc_thread)
+        ret = enc_thread_send_frame(ost, frame);
+    else
+#endif
     ret = avcodec_send_frame(enc, frame);
     if (ret < 0 && !(ret == AVERROR_EOF && !frame)) {
         av_log(NULL, AV_LOG_ERROR, "Error submitting %s frame to the encoder\n",
@@ -920,6 +966,11 @@ static int encode_frame(OutputFile *of, OutputStream *ost, AVFrame *frame)
     }
 
     while (1) {
+#if HAVE_THREADS
+        if (ost->enc_thread)
+            ret = enc_thread_receive_packet(ost, pkt);
+        else
+#endif
         ret = avcodec_receive_packet(enc, pkt);
         update_benchmark("%s_%s %d.%d", action, type_desc,
                          ost->file_index, ost->index);
@@ -1891,11 +1942,11 @@ static void do_streamcopy(InputStream *ist, OutputStream *ost, const AVPacket *p
     if (pkt->dts == AV_NOPTS_VALUE) {
         opkt->dts = av_rescale_q(ist->dts, AV_TIME_BASE_Q, ost->mux_timebase);
     } else if (ost->st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO) {
-        int duration = av_get_audio_frame_duration(ist->dec_ctx, pkt->size);
+        int duration = av_get_audio_frame_duration2(ist->st->codecpar, pkt->size);
         if(!duration)
-            duration = ist->dec_ctx->frame_size;
+            duration = ist->dec_state.frame_size;
         opkt->dts = av_rescale_delta(ist->st->time_base, pkt->dts,
-                                    (AVRational){1, ist->dec_ctx->sample_rate}, duration,
+                                    (AVRational){1, ist->dec_state.sample_rate}, duration,
                                     &ist->filter_in_rescale_delta_last, ost->mux_timebase);
         /* dts will be set immediately afterwards to what pts is now */
         opkt->pts = opkt->dts - ost_tb_start_time;
@@ -1961,7 +2012,7 @@ static int ifilter_has_all_input_formats(FilterGraph *fg)
     return 1;
 }
 
-static int ifilter_send_frame(InputFilter *ifilter, AVFrame *frame, int keep_reference)
+static int ifilter_push_frame(InputFilter *ifilter, AVFrame *frame, int keep_reference)
 {
     FilterGraph *fg = ifilter->graph;
     AVFrameSideData *sd;
@@ -2007,13 +2058,17 @@ static int ifilter_send_frame(InputFilter *ifilter, AVFrame *frame, int keep_ref
     /* (re)init the graph if possible, otherwise buffer the frame and return */
     if (need_reinit || !fg->graph) {
         if (!ifilter_has_all_input_formats(fg)) {
-            AVFrame *tmp = av_frame_clone(frame);
-            if (!tmp)
-                return AVERROR(ENOMEM);
+            AVFrame *tmp;
+
+            ret = objpool_get(frame_pool, (void**)&tmp);
+            if (ret < 0)
+                return ret;
 
-            ret = av_fifo_write(ifilter->frame_queue, &tmp, 1);
+            ret = av_frame_ref(tmp, frame);
+            if (ret >= 0)
+                ret = av_fifo_write(ifilter->frame_queue, &tmp, 1);
             if (ret < 0)
-                av_frame_free(&tmp);
+                objpool_release(frame_pool, (void**)&tmp);
 
             return ret;
         }
@@ -2041,13 +2096,69 @@ static int ifilter_send_frame(InputFilter *ifilter, AVFrame *frame, int keep_ref
     return 0;
 }
 
+#if HAVE_THREADS
+/* ifilter_send_branch sends frame through the branch of ifilter, NULL flushes
+ * it, and pushes the frames the branch already filtered to the graph */
+static int ifilter_send_branch(InputFilter *ifilter, AVFrame *frame, int keep_reference)
+{
+    AVFrame *filtered;
+    AVRational tb, fr;
+    int ret;
+
+    ret = branch_send_frame(ifilter->branch, frame, keep_reference);
+    if (ret < 0)
+        return ret;
+
+    ret = objpool_get(frame_pool, (void**)&filtered);
+    if (ret < 0)
+        return ret;
+
+    while ((ret = branch_receive_frame(ifilter->branch, filtered, &tb, &fr)) >= 0) {
+        /* the graph input takes the timing of the chain, ex: after fps; it
+         * only changes with the frame parameters, which reinit the graph */
+        ifilter->time_base  = tb;
+        ifilter->frame_rate = fr;
+        ret = ifilter_push_frame(ifilter, filtered, 0);
+        av_frame_unref(filtered);
+        if (ret < 0)
+            break;
+    }
+    objpool_release(frame_pool, (void**)&filtered);
+
+    if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
+        return 0;
+    av_log(NULL, AV_LOG_ERROR, "Error while filtering: %s\n", av_err2str(ret));
+    return ret;
+}
+#endif
+
+static int ifilter_send_frame(InputFilter *ifilter, AVFrame *frame, int keep_reference)
+{
+#if HAVE_THREADS
+    if (ifilter->branch)
+        return ifilter_send_branch(ifilter, frame, keep_reference);
+#endif
+    return ifilter_push_frame(ifilter, frame, keep_reference);
+}
+
 static int ifilter_send_eof(InputFilter *ifilter, int64_t pts)
 {
     int ret;
 
+#if HAVE_THREADS
+    /* push the frames still in the branch before closing the input */
+    if (ifilter->branch && !ifilter->eof) {
+        ret = ifilter_send_branch(ifilter, NULL, 0);
+        if (ret < 0)
+            return ret;
+    }
+#endif
+
     ifilter->eof = 1;
 
     if (ifilter->filter) {
+        if (ifilter->time_base.num)
+            pts = av_rescale_q(pts, ifilter->ist->st->time_base, ifilter->time_base);
         ret = av_buffersrc_close(ifilter->filter, pts, AV_BUFFERSRC_FLAG_PUSH);
         if (ret < 0)
             return ret;
@@ -2067,14 +2178,34 @@ static int ifilter_send_eof(InputFilter *ifilter, int64_t pts)
     return 0;
 }
 
+void dec_state_update(DecoderState *s, const AVCodecContext *avctx)
+{
+    s->width           = avctx->width;
+    s->height          = avctx->height;
+    s->pix_fmt         = avctx->pix_fmt;
+    s->has_b_frames    = avctx->has_b_frames;
+    s->framerate       = avctx->framerate;
+    s->ticks_per_frame = avctx->ticks_per_frame;
+    s->sample_rate     = avctx->sample_rate;
+    s->frame_size      = avctx->frame_size;
+
+    s->bits_per_raw_sample = avctx->bits_per_raw_sample;
+}
+
 // This does not quite work like avcodec_decode_audio4/avcodec_decode_video2.
 // There is the following difference: if you got a frame, you must call
 // it again with pkt=NULL. pkt==NULL is treated differently from pkt->size==0
 // (pkt==NULL means get more output, pkt->size==0 is a flush/drain packet)
-static int decode(AVCodecContext *avctx, AVFrame *frame, int *got_frame, AVPacket *pkt)
+static int decode(InputStream *ist, AVFrame *frame, int *got_frame, AVPacket *pkt)
 {
+    AVCodecContext *avctx = ist->dec_ctx;
     int ret;
 
+#if HAVE_THREADS
+    if (ist->dec_thread)
+        return dec_thread_decode(ist, frame, got_frame, pkt);
+#endif
+
     *got_frame = 0;
 
     if (pkt) {
@@ -2086,6 +2217,7 @@ static int decode(AVCodecContext *avctx, AVFrame *frame, int *got_frame, AVPacke
     }
 
     ret = avcodec_receive_frame(avctx, frame);
+    dec_state_update(&ist->dec_state, avctx);
     if (ret < 0 && ret != AVERROR(EAGAIN))
         return ret;
     if (ret >= 0)
@@ -2117,17 +2249,18 @@ static int decode_audio(InputStream *ist, AVPacket *pkt, int *got_output,
 {
     AVFrame *decoded_frame = ist->decoded_frame;
     AVCodecContext *avctx = ist->dec_ctx;
+    const DecoderState *ds = &ist->dec_state;
     int ret, err = 0;
     AVRational decoded_frame_tb;
 
     update_benchmark(NULL);
-    ret = decode(avctx, decoded_frame, got_output, pkt);
+    ret = decode(ist, decoded_frame, got_output, pkt);
     update_benchmark("decode_audio %d.%d", ist->file_index, ist->st->index);
     if (ret < 0)
         *decode_failed = 1;
 
-    if (ret >= 0 && avctx->sample_rate <= 0) {
-        av_log(avctx, AV_LOG_ERROR, "Sample rate %d invalid\n", avctx->sample_rate);
+    if (ret >= 0 && ds->sample_rate <= 0) {
+        av_log(avctx, AV_LOG_ERROR, "Sample rate %d invalid\n", ds->sample_rate);
         ret = AVERROR_INVALIDDATA;
     }
 
@@ -2143,9 +2276,9 @@ static int decode_audio(InputStream *ist, AVPacket *pkt, int *got_output,
     /* increment next_dts to use for the case where the input stream does not
        have timestamps or there are multiple frames in the packet */
     ist->next_pts += ((int64_t)AV_TIME_BASE * decoded_frame->nb_samples) /
-                     avctx->sample_rate;
+                     ds->sample_rate;
     ist->next_dts += ((int64_t)AV_TIME_BASE * decoded_frame->nb_samples) /
-                     avctx->sample_rate;
+                     ds->sample_rate;
 
     if (decoded_frame->pts != AV_NOPTS_VALUE) {
         decoded_frame_tb   = ist->st->time_base;
@@ -2163,8 +2296,8 @@ static int decode_audio(InputStream *ist, AVPacket *pkt, int *got_output,
         ist->prev_pkt_pts = pkt->pts;
     if (decoded_frame->pts != AV_NOPTS_VALUE)
         decoded_frame->pts = av_rescale_delta(decoded_frame_tb, decoded_frame->pts,
-                                              (AVRational){1, avctx->sample_rate}, decoded_frame->nb_samples, &ist->filter_in_rescale_delta_last,
-                                              (AVRational){1, avctx->sample_rate});
+                                              (AVRational){1, ds->sample_rate}, decoded_frame->nb_samples, &ist->filter_in_rescale_delta_last,
+                                              (AVRational){1, ds->sample_rate});
     ist->nb_samples = decoded_frame->nb_samples;
     err = send_frame_to_filters(ist, decoded_frame);
 
@@ -2203,23 +2336,23 @@ static int decode_video(InputStream *ist, AVPacket *pkt, int *got_output, int64_
     }
 
     update_benchmark(NULL);
-    ret = decode(ist->dec_ctx, decoded_frame, got_output, pkt);
+    ret = decode(ist, decoded_frame, got_output, pkt);
     update_benchmark("decode_video %d.%d", ist->file_index, ist->st->index);
     if (ret < 0)
         *decode_failed = 1;
 
     // The following line may be required in some cases where there is no parser
     // or the parser does not has_b_frames correctly
-    if (ist->st->codecpar->video_delay < ist->dec_ctx->has_b_frames) {
+    if (ist->st->codecpar->video_delay < ist->dec_state.has_b_frames) {
         if (ist->dec_ctx->codec_id == AV_CODEC_ID_H264) {
-            ist->st->codecpar->video_delay = ist->dec_ctx->has_b_frames;
+            ist->st->codecpar->video_delay = ist->dec_state.has_b_frames;
         } else
             av_log(ist->dec_ctx, AV_LOG_WARNING,
                    "video_delay is larger in decoder than demuxer %d > %d.\n"
                    "If you want to help, upload a sample "
                    "of this file to https://streams.videolan.org/upload/ "
                    "and contact the ffmpeg-devel mailing list. (ffmpeg-devel@ffmpeg.org)\n",
-                   ist->dec_ctx->has_b_frames,
+                   ist->dec_state.has_b_frames,
                    ist->st->codecpar->video_delay);
     }
 
@@ -2227,16 +2360,16 @@ static int decode_video(InputStream *ist, AVPacket *pkt, int *got_output, int64_
         check_decode_result(ist, got_output, ret);
 
     if (*got_output && ret >= 0) {
-        if (ist->dec_ctx->width  != decoded_frame->width ||
-            ist->dec_ctx->height != decoded_frame->height ||
-            ist->dec_ctx->pix_fmt != decoded_frame->format) {
+        if (ist->dec_state.width  != decoded_frame->width ||
+            ist->dec_state.height != decoded_frame->height ||
+            ist->dec_state.pix_fmt != decoded_frame->format) {
             av_log(NULL, AV_LOG_DEBUG, "Frame parameters mismatch context %d,%d,%d != %d,%d,%d\n",
                 decoded_frame->width,
                 decoded_frame->height,
                 decoded_frame->format,
-                ist->dec_ctx->width,
-                ist->dec_ctx->height,
-                ist->dec_ctx->pix_fmt);
+                ist->dec_state.width,
+                ist->dec_state.height,
+                ist->dec_state.pix_fmt);
         }
     }
 
@@ -2398,7 +2531,7 @@ static int process_input_packet(InputStream *ist, const AVPacket *pkt, int no_eo
 
     if (!ist->saw_first_ts) {
         ist->first_dts =
-        ist->dts = ist->st->avg_frame_rate.num ? - ist->dec_ctx->has_b_frames * AV_TIME_BASE / av_q2d(ist->st->avg_frame_rate) : 0;
+        ist->dts = ist->st->avg_frame_rate.num ? - ist->dec_state.has_b_frames * AV_TIME_BASE / av_q2d(ist->st->avg_frame_rate) : 0;
         ist->pts = 0;
         if (pkt && pkt->pts != AV_NOPTS_VALUE && !ist->decoding_needed) {
             ist->first_dts =
@@ -2448,11 +2581,11 @@ static int process_input_packet(InputStream *ist, const AVPacket *pkt, int no_eo
             if (!repeating || !pkt || got_output) {
                 if (pkt && pkt->duration) {
                     duration_dts = av_rescale_q(pkt->duration, ist->st->time_base, AV_TIME_BASE_Q);
-                } else if(ist->dec_ctx->framerate.num != 0 && ist->dec_ctx->framerate.den != 0) {
-                    int ticks= av_stream_get_parser(ist->st) ? av_stream_get_parser(ist->st)->repeat_pict+1 : ist->dec_ctx->ticks_per_frame;
+                } else if(ist->dec_state.framerate.num != 0 && ist->dec_state.framerate.den != 0) {
+                    int ticks= av_stream_get_parser(ist->st) ? av_stream_get_parser(ist->st)->repeat_pict+1 : ist->dec_state.ticks_per_frame;
                     duration_dts = ((int64_t)AV_TIME_BASE *
-                                    ist->dec_ctx->framerate.den * ticks) /
-                                    ist->dec_ctx->framerate.num / ist->dec_ctx->ticks_per_frame;
+                                    ist->dec_state.framerate.den * ticks) /
+                                    ist->dec_state.framerate.num / ist->dec_state.ticks_per_frame;
                 }
 
                 if(ist->dts != AV_NOPTS_VALUE && duration_dts) {
@@ -2536,9 +2669,9 @@ static int process_input_packet(InputStream *ist, const AVPacket *pkt, int no_eo
         switch (ist->dec_ctx->codec_type) {
         case AVMEDIA_TYPE_AUDIO:
             av_assert1(pkt->duration >= 0);
-            if (ist->dec_ctx->sample_rate) {
-                ist->next_dts += ((int64_t)AV_TIME_BASE * ist->dec_ctx->frame_size) /
-                                  ist->dec_ctx->sample_rate;
+            if (ist->dec_state.sample_rate) {
+                ist->next_dts += ((int64_t)AV_TIME_BASE * ist->dec_state.frame_size) /
+                                  ist->dec_state.sample_rate;
             } else {
                 ist->next_dts += av_rescale_q(pkt->duration, ist->st->time_base, AV_TIME_BASE_Q);
             }
@@ -2551,11 +2684,11 @@ static int process_input_packet(InputStream *ist, const AVPacket *pkt, int no_eo
                 ist->next_dts = av_rescale_q(next_dts + 1, av_inv_q(ist->framerate), time_base_q);
             } else if (pkt->duration) {
                 ist->next_dts += av_rescale_q(pkt->duration, ist->st->time_base, AV_TIME_BASE_Q);
-            } else if(ist->dec_ctx->framerate.num != 0) {
-                int ticks= av_stream_get_parser(ist->st) ? av_stream_get_parser(ist->st)->repeat_pict + 1 : ist->dec_ctx->ticks_per_frame;
+            } else if(ist->dec_state.framerate.num != 0) {
+                int ticks= av_stream_get_parser(ist->st) ? av_stream_get_parser(ist->st)->repeat_pict + 1 : ist->dec_state.ticks_per_frame;
                 ist->next_dts += ((int64_t)AV_TIME_BASE *
-                                  ist->dec_ctx->framerate.den * ticks) /
-                                  ist->dec_ctx->framerate.num / ist->dec_ctx->ticks_per_frame;
+                                  ist->dec_state.framerate.den * ticks) /
+                                  ist->dec_state.framerate.num / ist->dec_state.ticks_per_frame;
             }
             break;
         }
@@ -2625,11 +2758,62 @@ static enum AVPixelFormat get_format(AVCodecContext *s, const enum AVPixelFormat
     return *p;
 }
 
+/* get_buffer lays out the frames of video decoders like
+ * avcodec_default_get_buffer2() does, with planes from buffer_pool */
+static int get_buffer(AVCodecContext *s, AVFrame *frame, int flags)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(frame->format);
+    int linesize_align[AV_NUM_DATA_POINTERS];
+    ptrdiff_t linesizes[4];
+    size_t sizes[4];
+    int w = frame->width, h = frame->height, unaligned, i, ret;
+
+    if (s->codec_type != AVMEDIA_TYPE_VIDEO || s->hw_frames_ctx || !desc ||
+        (desc->flags & AV_PIX_FMT_FLAG_HWACCEL) ||
+        !(s->codec->capabilities & AV_CODEC_CAP_DR1))
+        return avcodec_default_get_buffer2(s, frame, flags);
+
+    avcodec_align_dimensions2(s, &w, &h, linesize_align);
+    do {
+        /* widen the frame until all the planes get aligned lines */
+        ret = av_image_fill_linesizes(frame->linesize, frame->format, w);
+        if (ret < 0)
+            return ret;
+        w += w & ~(w - 1);
+
+        unaligned = 0;
+        for (i = 0; i < 4; i++)
+            unaligned |= frame->linesize[i] % linesize_align[i];
+    } while (unaligned);
+
+    for (i = 0; i < 4; i++)
+        linesizes[i] = frame->linesize[i];
+    ret = av_image_fill_plane_sizes(sizes, frame->format, h, linesizes);
+    if (ret < 0)
+        return ret;
+
+    for (i = 0; i < 4 && sizes[i]; i++) {
+        /* the padding of the decoders reading past the end of a plane */
+        frame->buf[i] = bufpool_get(buffer_pool, sizes[i] + 16 + 64 - 1);
+        if (!frame->buf[i]) {
+            av_frame_unref(frame);
+            return AVERROR(ENOMEM);
+        }
+        frame->data[i] = frame->buf[i]->data;
+    }
+    frame->extended_data = frame->data;
+
+    return 0;
+}
+
 static int init_input_stream(int ist_index, char *error, int error_len)
 {
     int ret;
     InputStream *ist = input_streams[ist_index];
 
+    /* as demuxed, then updated once the decoder is open and with its frames */
+    dec_state_update(&ist->dec_state, ist->dec_ctx);
+
     if (ist->decoding_needed) {
         const AVCodec *codec = ist->dec;
         if (!codec) {
@@ -2640,6 +2824,7 @@ static int init_input_stream(int ist_index, char *error, int error_len)
 
         ist->dec_ctx->opaque                = ist;
         ist->dec_ctx->get_format            = get_format;
+        ist->dec_ctx->get_buffer2           = get_buffer;
 #if LIBAVCODEC_VERSION_MAJOR < 60
         AV_NOWARN_DEPRECATED({
         ist->dec_ctx->thread_safe_callbacks = 1;
@@ -2682,6 +2867,17 @@ static int init_input_stream(int ist_index, char *error, int error_len)
             return ret;
         }
         assert_avoptions(ist->decoder_opts);
+        dec_state_update(&ist->dec_state, ist->dec_ctx);
+
+#ifdef __EMSCRIPTEN_PTHREADS__
+        ret = dec_thread_start(ist);
+        if (ret < 0) {
+            snprintf(error, error_len, "Error while starting decoder thread "
+                     "for input stream #%d:%d : %s",
+                     ist->file_index, ist->st->index, av_err2str(ret));
+            return ret;
+        }
+#endif
     }
 
     ist->next_pts = AV_NOPTS_VALUE;
@@ -2982,7 +3178,7 @@ static int init_output_stream_encode(OutputStream *ost, AVFrame *frame)
 {
     InputStream *ist = get_input_stream(ost);
     AVCodecContext *enc_ctx = ost->enc_ctx;
-    AVCodecContext *dec_ctx = NULL;
+    const DecoderState *dec_state = NULL;
     OutputFile      *of = output_files[ost->file_index];
     AVFormatContext *oc = of->ctx;
     int ret;
@@ -2990,7 +3186,7 @@ static int init_output_stream_encode(OutputStream *ost, AVFrame *frame)
     set_encoder_id(output_files[ost->file_index], ost);
 
     if (ist) {
-        dec_ctx = ist->dec_ctx;
+        dec_state = &ist->dec_state;
     }
 
     if (enc_ctx->codec_type == AVMEDIA_TYPE_VIDEO) {
@@ -3032,8 +3228,8 @@ static int init_output_stream_encode(OutputStream *ost, AVFrame *frame)
 
         if (ost->bits_per_raw_sample)
             enc_ctx->bits_per_raw_sample = ost->bits_per_raw_sample;
-        else if (dec_ctx && ost->filter->graph->is_meta)
-            enc_ctx->bits_per_raw_sample = FFMIN(dec_ctx->bits_per_raw_sample,
+        else if (dec_state && ost->filter->graph->is_meta)
+            enc_ctx->bits_per_raw_sample = FFMIN(dec_state->bits_per_raw_sample,
                                                  av_get_bytes_per_sample(enc_ctx->sample_fmt) << 3);
 
         init_encoder_time_base(ost, av_make_q(1, enc_ctx->sample_rate));
@@ -3063,8 +3259,8 @@ static int init_output_stream_encode(OutputStream *ost, AVFrame *frame)
 
         if (ost->bits_per_raw_sample)
             enc_ctx->bits_per_raw_sample = ost->bits_per_raw_sample;
-        else if (dec_ctx && ost->filter->graph->is_meta)
-            enc_ctx->bits_per_raw_sample = FFMIN(dec_ctx->bits_per_raw_sample,
+        else if (dec_state && ost->filter->graph->is_meta)
+            enc_ctx->bits_per_raw_sample = FFMIN(dec_state->bits_per_raw_sample,
                                                  av_pix_fmt_desc_get(enc_ctx->pix_fmt)->comp[0].depth);
 
         if (frame) {
@@ -3165,8 +3361,16 @@ static int init_output_stream(OutputStream *ost, AVFrame *frame,
             memcpy(ost->enc_ctx->subtitle_header, dec->subtitle_header, dec->subtitle_header_size);
             ost->enc_ctx->subtitle_header_size = dec->subtitle_header_size;
         }
-        if (!av_dict_get(ost->encoder_opts, "threads", NULL, 0))
+        if (!av_dict_get(ost->encoder_opts, "threads", NULL, 0)) {
+            ost->encoder_auto_threads = 1;
+#ifdef __EMSCRIPTEN_PTHREADS__
+            /* external encoders like libx264 count cpus on their own, pass
+             * the share of the thread budget explicitly instead of "auto". */
+            av_dict_set_int(&ost->encoder_opts, "threads", enc_auto_nbthreads, 0);
+#else
             av_dict_set(&ost->encoder_opts, "threads", "auto", 0);
+#endif
+        }
 
         ret = hw_device_setup_for_encode(ost);
         if (ret < 0) {
@@ -3208,6 +3412,15 @@ static int init_output_stream(OutputStream *ost, AVFrame *frame,
             av_buffersink_set_frame_size(ost->filter->filter,
                                             ost->enc_ctx->frame_size);
         assert_avoptions(ost->encoder_opts);
+#ifdef __EMSCRIPTEN_PTHREADS__
+        ret = enc_thread_start(ost);
+        if (ret < 0) {
+            snprintf(error, error_len, "Error while starting encoder thread "
+                     "for output stream #%d:%d : %s",
+                     ost->file_index, ost->index, av_err2str(ret));
+            return ret;
+        }
+#endif
         if (ost->enc_ctx->bit_rate && ost->enc_ctx->bit_rate < 1000 &&
             ost->enc_ctx->codec_id != AV_CODEC_ID_CODEC2 /* don't complain about 700 bit/s modes */)
             av_log(NULL, AV_LOG_WARNING, "The bitrate parameter is set too low."
@@ -3667,6 +3880,49 @@ static int check_keyboard_interaction(int64_t cur_time)
 }
 
 #if HAVE_THREADS
+/* bounds of the adaptive read-ahead of the MT core */
+#define READ_AHEAD_MIN_PACKETS  8
+#define READ_AHEAD_MAX_PACKETS  256
+#define READ_AHEAD_MAX_BYTES    (64 << 20)
+/* the main thread is stalled when it waits longer than this for a packet */
+#define READ_AHEAD_STALL_US     1000
+
+/* read_ahead_wait blocks the input thread while enough packets are queued,
+ * returns 1 when the thread is asked to stop */
+static int read_ahead_wait(InputFile *f, int size)
+{
+    int abort;
+
+    pthread_mutex_lock(&f->queue_lock);
+    while (!f->queue_abort &&
+           (f->nb_queued >= f->queue_limit ||
+            (f->nb_queued && f->queued_bytes + size > READ_AHEAD_MAX_BYTES)))
+        pthread_cond_wait(&f->queue_cond, &f->queue_lock);
+    f->nb_queued++;
+    f->queued_bytes += size;
+    abort = f->queue_abort;
+    pthread_mutex_unlock(&f->queue_lock);
+
+    return abort;
+}
+
+/* read_ahead_consumed releases the slot of a dequeued packet and doubles the
+ * read-ahead when the main thread was blocked waiting for it */
+static void read_ahead_consumed(InputFile *f, const AVPacket *pkt, int stalled)
+{
+    pthread_mutex_lock(&f->queue_lock);
+    f->nb_queued--;
+    f->queued_bytes -= pkt->size;
+    if (stalled && f->queue_limit < READ_AHEAD_MAX_PACKETS &&
+        f->queued_bytes < READ_AHEAD_MAX_BYTES / 2) {
+        f->queue_limit = FFMIN(f->queue_limit * 2, READ_AHEAD_MAX_PACKETS);
+        av_log(f->ctx, AV_LOG_DEBUG, "read-ahead raised to %d packets\n",
+               f->queue_limit);
+    }
+    pthread_cond_signal(&f->queue_cond);
+    pthread_mutex_unlock(&f->queue_lock);
+}
+
 static void *input_thread(void *arg)
 {
     InputFile *f = arg;
@@ -3685,10 +3941,16 @@ static void *input_thread(void *arg)
             av_thread_message_queue_set_err_recv(f->in_thread_queue, ret);
             break;
         }
-        queue_pkt = av_packet_alloc();
-        if (!queue_pkt) {
+        ret = objpool_get(packet_pool, (void**)&queue_pkt);
+        if (ret < 0) {
             av_packet_unref(pkt);
-            av_thread_message_queue_set_err_recv(f->in_thread_queue, AVERROR(ENOMEM));
+            av_thread_message_queue_set_err_recv(f->in_thread_queue, ret);
+            break;
+        }
+        if (f->read_ahead && read_ahead_wait(f, pkt->size)) {
+            av_packet_unref(pkt);
+            objpool_release(packet_pool, (void**)&queue_pkt);
+            av_thread_message_queue_set_err_recv(f->in_thread_queue, AVERROR_EOF);
             break;
         }
         av_packet_move_ref(queue_pkt, pkt);
@@ -3706,7 +3968,7 @@ static void *input_thread(void *arg)
                 av_log(f->ctx, AV_LOG_ERROR,
                        "Unable to send packet to main thread: %s\n",
                        av_err2str(ret));
-            av_packet_free(&queue_pkt);
+            objpool_release(packet_pool, (void**)&queue_pkt);
             av_thread_message_queue_set_err_recv(f->in_thread_queue, ret);
             break;
         }
@@ -3723,12 +3985,22 @@ static void free_input_thread(int i)
     if (!f || !f->in_thread_queue)
         return;
     av_thread_message_queue_set_err_send(f->in_thread_queue, AVERROR_EOF);
+    if (f->read_ahead) {
+        pthread_mutex_lock(&f->queue_lock);
+        f->queue_abort = 1;
+        pthread_cond_signal(&f->queue_cond);
+        pthread_mutex_unlock(&f->queue_lock);
+    }
     while (av_thread_message_queue_recv(f->in_thread_queue, &pkt, 0) >= 0)
-        av_packet_free(&pkt);
+        objpool_release(packet_pool, (void**)&pkt);
 
     pthread_join(f->thread, NULL);
     f->joined = 1;
     av_thread_message_queue_free(&f->in_thread_queue);
+    if (f->read_ahead) {
+        pthread_mutex_destroy(&f->queue_lock);
+        pthread_cond_destroy(&f->queue_cond);
+    }
 }
 
 static void free_input_threads(void)
@@ -3744,6 +4016,14 @@ static int init_input_thread(int i)
     int ret;
     InputFile *f = input_files[i];
 
+#ifdef __EMSCRIPTEN_PTHREADS__
+    /* demux every input in its own thread, so that I/O and demuxing
+     * overlap with decoding and encoding even for a single input */
+    if (f->thread_queue_size < 0) {
+        f->read_ahead = 1;
+        f->thread_queue_size = READ_AHEAD_MAX_PACKETS;
+    }
+#endif
     if (f->thread_queue_size < 0)
         f->thread_queue_size = (nb_input_files > 1 ? 8 : 0);
     if (!f->thread_queue_size)
@@ -3757,9 +4037,32 @@ static int init_input_thread(int i)
     if (ret < 0)
         return ret;
 
+    if (f->read_ahead) {
+        /* the thread is started again after the seek of -stream_loop, the
+         * packets queued by the previous one were dropped */
+        f->queue_abort  = 0;
+        f->nb_queued    = 0;
+        f->queued_bytes = 0;
+        f->queue_limit  = READ_AHEAD_MIN_PACKETS;
+        pthread_mutex_init(&f->queue_lock, NULL);
+        pthread_cond_init(&f->queue_cond, NULL);
+    }
+    f->joined = 0;
+
     if ((ret = pthread_create(&f->thread, NULL, input_thread, f))) {
-        av_log(NULL, AV_LOG_ERROR, "pthread_create failed: %s. Try to increase `ulimit -v` or decrease `ulimit -s`.\n", strerror(ret));
         av_thread_message_queue_free(&f->in_thread_queue);
+        if (f->read_ahead) {
+            /* the pthread pool is exhausted, demux on the main thread */
+            av_log(f->ctx, AV_LOG_VERBOSE, "No thread left for read-ahead: %s\n",
+                   strerror(ret));
+            pthread_mutex_destroy(&f->queue_lock);
+            pthread_cond_destroy(&f->queue_cond);
+            f->read_ahead = 0;
+            f->thread_queue_size = 0;
+            f->non_blocking = 0;
+            return 0;
+        }
+        av_log(NULL, AV_LOG_ERROR, "pthread_create failed: %s. Try to increase `ulimit -v` or decrease `ulimit -s`.\n", strerror(ret));
         return AVERROR(ret);
     }
 
@@ -3780,9 +4083,17 @@ static int init_input_threads(void)
 
 static int get_input_packet_mt(InputFile *f, AVPacket **pkt)
 {
-    return av_thread_message_queue_recv(f->in_thread_queue, pkt,
-                                        f->non_blocking ?
-                                        AV_THREAD_MESSAGE_NONBLOCK : 0);
+    int64_t start = f->read_ahead ? av_gettime_relative() : 0;
+    int ret = av_thread_message_queue_recv(f->in_thread_queue, pkt,
+                                           f->non_blocking ?
+                                           AV_THREAD_MESSAGE_NONBLOCK : 0);
+
+    /* an empty non-blocking poll is no stall, the main thread just moves on
+     * to another input */
+    if (f->read_ahead && ret >= 0)
+        read_ahead_consumed(f, *pkt, !f->non_blocking &&
+                            av_gettime_relative() - start > READ_AHEAD_STALL_US);
+    return ret;
 }
 #endif
 
@@ -3946,8 +4257,12 @@ static int process_input(int file_index)
                 ret = process_input_packet(ist, NULL, 1);
                 if (ret>0)
                     return 0;
-                if (ist->decoding_needed)
+                if (ist->decoding_needed) {
                     avcodec_flush_buffers(avctx);
+#if HAVE_THREADS
+                    dec_thread_flush(ist);
+#endif
+                }
             }
         }
 #if HAVE_THREADS
@@ -4200,7 +4515,7 @@ static int process_input(int file_index)
 discard_packet:
 #if HAVE_THREADS
     if (ifile->thread_queue_size)
-        av_packet_free(&pkt);
+        objpool_release(packet_pool, (void**)&pkt);
     else
 #endif
     av_packet_unref(pkt);
@@ -4358,6 +4673,133 @@ EM_JS(int, is_timeout, (int64_t diff), {
     }
 });
 
+EM_JS(void, send_memory, (double heap_size, double in_use, double peak_in_use,
+                          double free_bytes, double arena, double allocs,
+                          double reallocs, double frees), {
+    Module.receiveMemory(heap_size, in_use, peak_in_use, free_bytes, arena,
+                         allocs, reallocs, frees);
+});
+
+EM_JS(double, get_memory_limit, (), {
+    return Module.memoryLimit;
+});
+
+/* check_memory reports growth of the wasm heap together with allocation
+ * telemetry of this job, and returns 1 when the bytes allocated by ffmpeg are
+ * above Module.memoryLimit.
+ *
+ * It runs at most every 100ms unless force is set, force also reports when
+ * the heap did not grow.
+ */
+static int check_memory(int64_t cur_time, int force)
+{
+    MallocStats stats;
+    size_t heap_size;
+    double limit;
+
+    if (!force && cur_time - last_memory_check < 100000)
+        return 0;
+    last_memory_check = cur_time;
+
+    malloc_stats_get(&stats);
+    heap_size = emscripten_get_heap_size();
+    if (force || heap_size != last_heap_size) {
+        last_heap_size = heap_size;
+        send_memory(heap_size, stats.in_use, stats.peak_in_use,
+                    stats.arena > stats.in_use ? stats.arena - stats.in_use : 0,
+                    stats.arena, stats.nb_allocs, stats.nb_reallocs,
+                    stats.nb_frees);
+    }
+
+    limit = get_memory_limit();
+    if (limit > 0 && stats.in_use > limit) {
+        av_log(NULL, AV_LOG_FATAL, "Memory limit exceeded: %zu bytes in use, limit is %.0f bytes\n",
+               stats.in_use, limit);
+        return 1;
+    }
+    return 0;
+}
+
+#ifdef __EMSCRIPTEN_PTHREADS__
+/* get_thread_budget returns the number of idle workers in the pthread pool,
+ * the ones missing for the wanted threads are added after exec() returns.
+ *
+ * The pool only grows in between exec() calls, and creating a thread when
+ * it is exhausted fails with EAGAIN (-sPTHREAD_POOL_SIZE_STRICT=2) instead
+ * of blocking forever, so threads must be sized within this budget.
+ */
+EM_JS(int, get_thread_budget, (int wanted), {
+    return Module.getThreadBudget(wanted);
+});
+#endif
+
+/* set_thread_budget shares the idle pthread workers among input threads,
+ * decoders, filtergraphs and encoders by overriding the cpu count used to
+ * resolve "auto" threads.
+ */
+static void set_thread_budget(void)
+{
+#ifdef __EMSCRIPTEN_PTHREADS__
+    int i, budget, share, nb_fixed = 0, nb_users = nb_filtergraphs;
+
+    /* inputs are read in threads unless -thread_queue_size 0 */
+    for (i = 0; i < nb_input_files; i++)
+        nb_fixed += !!input_files[i]->thread_queue_size;
+    for (i = 0; i < nb_input_streams; i++) {
+        InputStream *ist = input_streams[i];
+        enum AVMediaType type = ist->dec_ctx->codec_type;
+
+        nb_users += !!ist->decoding_needed;
+        /* decoder threads, see dec_thread_start() */
+        nb_fixed += ist->decoding_needed &&
+                    (type == AVMEDIA_TYPE_AUDIO || type == AVMEDIA_TYPE_VIDEO) &&
+                    !(ist->st->disposition & AV_DISPOSITION_ATTACHED_PIC);
+    }
+    for (i = 0; i < nb_output_streams; i++) {
+        OutputStream *ost = output_streams[i];
+        enum AVMediaType type = ost->enc_ctx->codec_type;
+
+        nb_users += ost->encoding_needed;
+        /* encoder threads, see enc_thread_start() */
+        nb_fixed += ost->encoding_needed && !ost->logfile &&
+                    (type == AVMEDIA_TYPE_AUDIO || type == AVMEDIA_TYPE_VIDEO);
+    }
+    for (i = 0; i < nb_filtergraphs; i++) {
+        FilterGraph *fg = filtergraphs[i];
+        int threads = filtergraph_is_simple(fg) ?
+                      (filter_nbthreads ? atoi(filter_nbthreads) : 0) :
+                      filter_complex_nbthreads;
+
+        /* -filter_threads and -filter_complex_threads are not shared */
+        if (threads > 0) {
+            nb_fixed += threads - 1;
+            nb_users--;
+        }
+        /* filtergraph branches, see branch_split_graph() */
+        nb_fixed += fg->nb_branches;
+        nb_users += fg->nb_branches;
+    }
+
+    /* the job would use one worker per core on top of its own threads */
+    budget = get_thread_budget(nb_fixed + (nb_users ?
+                               FFMAX(emscripten_num_logical_cores(), nb_users) : 0));
+    share  = (budget - nb_fixed) / FFMAX(nb_users, 1);
+
+    /* the thread running a filtergraph works on slices too */
+    filter_auto_nbthreads = FFMAX(share, 1);
+    /* "auto" resolves to cpu count + 1 threads, keep one for it; a count of
+     * 1 resolves to no thread at all. The count is process wide, it is reset
+     * in ffmpeg_cleanup() and left alone when -cpucount is given. */
+    if (!forced_cpu_count)
+        force_cpu_count(FFMAX(share - 1, 1));
+    /* libx264 adds a lookahead thread, and threads / 6 more of them from 12
+     * threads on */
+    enc_auto_nbthreads = FFMAX(share - 1, 1);
+    if (enc_auto_nbthreads >= 12)
+        enc_auto_nbthreads = enc_auto_nbthreads * 6 / 7;
+#endif
+}
+
 /*
  * The following code is the main loop of the file converter
  */
@@ -4389,6 +4831,7 @@ static int transcode(void)
         int64_t cur_time= av_gettime_relative();
 
         if (is_timeout((cur_time - timer_start) / 1000) == 1) exit_program(1);
+        if (check_memory(cur_time, 0) == 1) exit_program(1);
 
         /* if 'q' pressed, exits */
         if (stdin_interaction)
@@ -4434,6 +4877,7 @@ static int transcode(void)
 
     /* dump report by using the first video and audio streams */
     print_report(1, timer_start, av_gettime_relative());
+    check_memory(av_gettime_relative(), 1);
 
     /* close the output files */
     for (i = 0; i < nb_output_files; i++) {
@@ -4469,6 +4913,9 @@ static int transcode(void)
     for (i = 0; i < nb_input_streams; i++) {
         ist = input_streams[i];
         if (ist->decoding_needed) {
+#if HAVE_THREADS
+            dec_thread_stop(ist);
+#endif
             avcodec_close(ist->dec_ctx);
             if (ist->hwaccel_uninit)
                 ist->hwaccel_uninit(ist->dec_ctx);
@@ -4587,6 +5034,14 @@ void init_globals() {
   ffmpeg_exited = 0;
   main_return_code = 0;
   copy_ts_first_pts = AV_NOPTS_VALUE;
+  last_heap_size = 0;
+  last_memory_check = 0;
+  filter_complex_nbthreads = 0;
+  filter_auto_nbthreads = 0;
+  enc_auto_nbthreads = 0;
+  forced_cpu_count = 0;
+  prev_cpu_count = get_forced_cpu_count();
+  malloc_stats_reset();
 }
 
 /* ffmpeg() is simply a rename of main(), but it makes things easier to
@@ -4608,6 +5063,12 @@ int ffmpeg(int argc, char **argv)
 
     register_exit(ffmpeg_cleanup);
 
+    packet_pool = objpool_alloc_packets();
+    frame_pool  = objpool_alloc_frames();
+    buffer_pool = bufpool_alloc();
+    if (!packet_pool || !frame_pool || !buffer_pool)
+        exit_program(1);
+
     setvbuf(stderr,NULL,_IONBF,0); /* win32 runtime needs this */
 
     av_log_set_flags(AV_LOG_SKIP_REPEATED);
@@ -4642,6 +5103,8 @@ int ffmpeg(int argc, char **argv)
             want_sdp = 0;
     }
 
+    set_thread_budget();
+
     current_time = ti = get_benchmark_time_stamps();
     if (transcode() < 0)
         exit_program(1);
@@ -26,6 +26,7 @@
 #include <signal.h>
 
 #include "cmdutils.h"
+#include "objpool.h"
 
 #include "libavformat/avformat.h"
 #include "libavformat/avio.h"
@@ -119,6 +120,8 @@ typedef struct OptionsContext {
     int accurate_seek;
     int thread_queue_size;
     int input_sync_ref;
+    const char *seek_index;
+    int probe_cache;
 
     SpecifierOpt *ts_scale;
     int        nb_ts_scale;
@@ -239,6 +242,8 @@ typedef struct OptionsContext {
     int        nb_bits_per_raw_sample;
 } OptionsContext;
 
+typedef struct FilterBranch FilterBranch;
+
 typedef struct InputFilter {
     AVFilterContext    *filter;
     struct InputStream *ist;
@@ -261,6 +266,14 @@ typedef struct InputFilter {
     int32_t *displaymatrix;
 
     int eof;
+
+#if HAVE_THREADS
+    /* chain of the graph filtering ist in its own thread, see ffmpeg_branch.c */
+    FilterBranch *branch;
+#endif
+    /* of the frames output by the branch, 0/0 to use those of ist */
+    AVRational time_base;
+    AVRational frame_rate;
 } InputFilter;
 
 typedef struct OutputFilter {
@@ -301,8 +314,31 @@ typedef struct FilterGraph {
     int          nb_inputs;
     OutputFilter **outputs;
     int         nb_outputs;
+
+#if HAVE_THREADS
+    FilterBranch **branches;
+    int         nb_branches;
+#endif
 } FilterGraph;
 
+typedef struct DecoderThread DecoderThread;
+typedef struct EncoderThread EncoderThread;
+
+/* fields of the decoder context read on the transcode thread, as of the last
+ * decoded frame: a decoder thread may be writing the context meanwhile */
+typedef struct DecoderState {
+    int width, height;
+    enum AVPixelFormat pix_fmt;
+    int has_b_frames;
+    AVRational framerate;
+    int ticks_per_frame;
+
+    int sample_rate;
+    int frame_size;
+
+    int bits_per_raw_sample;
+} DecoderState;
+
 typedef struct InputStream {
     int file_index;
     AVStream *st;
@@ -314,6 +350,7 @@ typedef struct InputStream {
     int processing_needed;   /* non zero if the packets must be processed */
 
     AVCodecContext *dec_ctx;
+    DecoderState dec_state;
     const AVCodec *dec;
     AVFrame *decoded_frame;
     AVPacket *pkt;
@@ -399,6 +436,11 @@ typedef struct InputStream {
     int nb_dts_buffer;
 
     int got_output;
+
+#if HAVE_THREADS
+    /* decoder thread of the MT core, see ffmpeg_dec.c */
+    DecoderThread *dec_thread;
+#endif
 } InputStream;
 
 typedef struct InputFile {
@@ -432,6 +474,16 @@ typedef struct InputFile {
     int non_blocking;           /* reading packets from the thread should not block */
     int joined;                 /* the thread has been joined */
     int thread_queue_size;      /* maximum number of queued packets */
+
+    /* adaptive read-ahead, the MT core reads every input in a thread and
+     * grows the number of queued packets when the main thread waits for them */
+    int read_ahead;
+    int queue_limit;            /* current number of packets to read ahead */
+    int nb_queued;
+    int64_t queued_bytes;
+    int queue_abort;
+    pthread_mutex_t queue_lock;
+    pthread_cond_t queue_cond;
 #endif
 } InputFile;
 
@@ -526,6 +578,7 @@ typedef struct OutputStream {
     char *filters_script;  ///< filtergraph script associated to the -filter_script option
 
     AVDictionary *encoder_opts;
+    int encoder_auto_threads;    /* "threads" of encoder_opts was set by ffmpeg, not -threads */
     AVDictionary *sws_dict;
     AVDictionary *swr_opts;
     char *apad;
@@ -581,6 +634,11 @@ typedef struct OutputStream {
 
     /* frame encode sum of squared error values */
     int64_t error[4];
+
+#if HAVE_THREADS
+    /* encoder thread of the MT core, see ffmpeg_enc.c */
+    EncoderThread *enc_thread;
+#endif
 } OutputStream;
 
 typedef struct OutputFile {
@@ -613,6 +671,10 @@ extern int         nb_output_files;
 extern FilterGraph **filtergraphs;
 extern int        nb_filtergraphs;
 
+/* shells of packets and frames queued between threads and stages */
+extern ObjPool *packet_pool;
+extern ObjPool *frame_pool;
+
 extern char *vstats_filename;
 extern char *sdp_filename;
 
@@ -645,6 +707,7 @@ extern float max_error_rate;
 
 extern char *filter_nbthreads;
 extern int filter_complex_nbthreads;
+extern int filter_auto_nbthreads;
 extern int vstats_version;
 extern int auto_conversion_filters;
 
@@ -704,4 +767,61 @@ void of_close(OutputFile **pof);
 void of_write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost,
                      int unqueue);
 
+typedef struct MallocStats {
+    size_t   in_use;        // bytes allocated and not freed yet
+    size_t   peak_in_use;   // highest in_use since malloc_stats_reset()
+    size_t   arena;         // bytes obtained from sbrk() by the backend
+    uint64_t nb_allocs;
+    uint64_t nb_reallocs;
+    uint64_t nb_frees;
+} MallocStats;
+
+/* copy the fields of avctx the transcode thread reads to s */
+void dec_state_update(DecoderState *s, const AVCodecContext *avctx);
+
+#if HAVE_THREADS
+/* start a decoder thread for ist, decoding stays on the calling thread when
+ * the stream is not suitable or no thread is left */
+int  dec_thread_start(InputStream *ist);
+void dec_thread_stop(InputStream *ist);
+/* resume decoding after avcodec_flush_buffers(), only valid once
+ * dec_thread_decode() returned EOF */
+void dec_thread_flush(InputStream *ist);
+/* same contract as decode() in ffmpeg.c, frames may come back for packets
+ * sent by previous calls; ist->dec_state is updated with each message */
+int  dec_thread_decode(InputStream *ist, AVFrame *frame, int *got_frame,
+                       AVPacket *pkt);
+
+/* start an encoder thread for ost once its encoder is open, encoding stays
+ * on the calling thread when the stream is not suitable or no thread is left */
+int  enc_thread_start(OutputStream *ost);
+void enc_thread_stop(OutputStream *ost);
+/* same contract as avcodec_send_frame() and avcodec_receive_packet(), except
+ * that receiving waits for the encoder thread once it is flushed or behind */
+int  enc_thread_send_frame(OutputStream *ost, const AVFrame *frame);
+int  enc_thread_receive_packet(OutputStream *ost, AVPacket *pkt);
+
+/* move the chains of fg->graph_desc going from an input stream to a single
+ * link of the graph to branches filtered in their own threads */
+int  branch_split_graph(FilterGraph *fg);
+/* the branch feeding the graph input label, with its input stream */
+FilterBranch *branch_find(FilterGraph *fg, const char *label, InputStream **ist);
+/* frame NULL flushes the branch, branch_receive_frame() then returns
+ * AVERROR_EOF once all frames were received, each frame comes with the time
+ * base and frame rate the chain output them with */
+int  branch_send_frame(FilterBranch *b, AVFrame *frame, int keep_reference);
+int  branch_receive_frame(FilterBranch *b, AVFrame *frame,
+                          AVRational *time_base, AVRational *frame_rate);
+void branch_free(FilterBranch **b);
+#endif
+
+/* allocation counters of the current job, see ffmpeg_malloc.c */
+void malloc_stats_reset(void);
+void malloc_stats_get(MallocStats *stats);
+
+/* stream info of inputs probed by earlier runs, see ffmpeg_cache.c */
+int  probe_cache_restore(AVFormatContext *ic, const char *filename);
+int  probe_cache_store(const AVFormatContext *ic, const char *filename);
+void probe_cache_clear(void);
+
 #endif /* FFTOOLS_FFMPEG_H */
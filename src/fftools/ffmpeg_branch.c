@@ -0,0 +1,985 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Filtergraph branches of the MT core.
+ *
+ * A chain of a complex filtergraph that starts from an input stream and only
+ * goes through single input, single output filters until a link of the rest
+ * of the graph, ex: "[1:v]scale=960:540[pip]" in
+ * "[1:v]scale=960:540[pip];[0:v][pip]overlay", is split into a graph of its
+ * own running in a thread of its own. Independent branches are then filtered
+ * concurrently and only join at the multi-input filters of the remaining
+ * graph, which still runs on the transcode thread.
+ *
+ * The outputs of a split of an input stream are chains of their own too, ex:
+ * "[0:v]split[a][b];[b]scale=1280:720[b720]": the stream is sent to the
+ * branch like to any other filtergraph input, and the split keeps the
+ * outputs left. A branch ending into an output of the graph, like [b720],
+ * goes through a null filter of the remaining graph.
+ */
+
+#include "config.h"
+
+#if HAVE_THREADS
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ffmpeg.h"
+
+#include "libavfilter/avfilter.h"
+#include "libavfilter/buffersink.h"
+#include "libavfilter/buffersrc.h"
+
+#include "libavutil/avstring.h"
+#include "libavutil/bprint.h"
+#include "libavutil/fifo.h"
+#include "libavutil/samplefmt.h"
+
+/* frames queued to a branch before the transcode thread waits */
+#define BRANCH_MAX_FRAMES_IN  4
+/* filtered frames waiting for the transcode thread */
+#define BRANCH_MAX_FRAMES_OUT 4
+
+#define WHITESPACES " \n\t\r"
+
+typedef struct BranchMsg {
+    AVFrame *frame;             /* NULL when ret carries an error or EOF */
+    AVRational time_base;       /* of frame, and its rate for video */
+    AVRational frame_rate;
+    int ret;
+} BranchMsg;
+
+struct FilterBranch {
+    char *in_label;             /* input stream, ex: "1:v" */
+    char *out_label;            /* link of the remaining graph, ex: "pip" */
+    char *desc;                 /* filters of the chain, without labels */
+    enum AVMediaType type;
+    InputStream *ist;
+
+    /* only accessed by the thread filtering the branch */
+    AVFilterGraph *graph;
+    AVFilterContext *src, *sink;
+    AVRational time_base;       /* of the frames sent to the branch */
+    AVRational frame_rate;
+    int format, width, height, sample_rate;
+    AVChannelLayout ch_layout;
+    int sink_eof;               /* the chain ended before its input */
+
+    int started;
+    int threaded;               /* filtered in thread, 0 when filtered inline */
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    AVFifo *frames_in;          /* AVFrame*, NULL for EOF */
+    AVFifo *frames_out;         /* BranchMsg */
+    int finished;               /* the branch thread is asked to stop */
+
+    /* only accessed by the transcode thread */
+    int flushing;
+};
+
+/*
+ * Parsing of the graph description, only what is needed to find chains:
+ * chains are separated by ';', filters by ',', and labels, quotes and
+ * escapes are skipped like libavfilter does.
+ */
+
+typedef struct ChainFilter {
+    char *spec;                 /* filter name and arguments */
+    char *label_in, *label_out; /* first input / output label */
+    int nb_in, nb_out;
+    int out_idx;                /* of label_out in the produced labels */
+} ChainFilter;
+
+typedef struct Chain {
+    const char *text;
+    int len;
+    ChainFilter *filters;
+    int nb_filters;
+
+    InputStream *split_ist;     /* the chain only splits this input stream */
+    struct Chain *split;        /* the split the branch of the chain replaces */
+    FilterBranch *branch;
+} Chain;
+
+typedef struct Labels {
+    char **labels;
+    int nb_labels;
+} Labels;
+
+/* find_sep returns the first character of seps in s outside of quotes and
+ * labels, the end of s when there is none, NULL when s is malformed */
+static const char *find_sep(const char *s, const char *seps)
+{
+    for (; *s; s++) {
+        if (strchr(seps, *s))
+            return s;
+        if (*s == '\\' && s[1]) {
+            s++;
+        } else if (*s == '\'' || *s == '[') {
+            s = strchr(s + 1, *s == '[' ? ']' : '\'');
+            if (!s)
+                return NULL;
+        }
+    }
+    return s;
+}
+
+static int count_label(const Labels *l, const char *label)
+{
+    int i, n = 0;
+
+    for (i = 0; i < l->nb_labels; i++)
+        n += !strcmp(l->labels[i], label);
+    return n;
+}
+
+static int parse_labels(const char **pp, char **first, int *nb, Labels *all)
+{
+    const char *p = *pp + strspn(*pp, WHITESPACES);
+
+    while (*p == '[') {
+        const char *end = strchr(p, ']');
+        char *label;
+        int ret;
+
+        if (!end)
+            return AVERROR(EINVAL);
+        label = av_strndup(p + 1, end - p - 1);
+        if (!label)
+            return AVERROR(ENOMEM);
+        ret = av_dynarray_add_nofree(&all->labels, &all->nb_labels, label);
+        if (ret < 0) {
+            av_free(label);
+            return ret;
+        }
+        if (!(*nb)++)
+            *first = label;
+        p = end + 1 + strspn(end + 1, WHITESPACES);
+    }
+
+    *pp = p;
+    return 0;
+}
+
+static int parse_filter(const char *s, int len, ChainFilter *f,
+                        Labels *consumed, Labels *produced)
+{
+    char *buf = av_strndup(s, len);
+    const char *p = buf, *end;
+    int ret;
+
+    if (!buf)
+        return AVERROR(ENOMEM);
+
+    ret = parse_labels(&p, &f->label_in, &f->nb_in, consumed);
+    if (ret < 0)
+        goto fail;
+
+    end = find_sep(p, "[");
+    if (!end) {
+        ret = AVERROR(EINVAL);
+        goto fail;
+    }
+    f->spec = av_strndup(p, end - p);
+    if (!f->spec) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    while (*f->spec && strchr(WHITESPACES, f->spec[strlen(f->spec) - 1]))
+        f->spec[strlen(f->spec) - 1] = 0;
+
+    p = end;
+    f->out_idx = produced->nb_labels;
+    ret = parse_labels(&p, &f->label_out, &f->nb_out, produced);
+    if (ret >= 0 && (*p || !*f->spec))
+        ret = AVERROR(EINVAL);
+
+fail:
+    av_free(buf);
+    return ret;
+}
+
+static int parse_chain(Chain *c, Labels *consumed, Labels *produced)
+{
+    const char *p = c->text, *end = c->text + c->len;
+
+    while (p < end) {
+        const char *sep = find_sep(p, ",;");
+        ChainFilter *f;
+
+        if (!sep)
+            return AVERROR(EINVAL);
+        if (sep > end)
+            sep = end;
+
+        f = av_dynarray2_add((void **)&c->filters, &c->nb_filters,
+                             sizeof(*c->filters), NULL);
+        if (!f)
+            return AVERROR(ENOMEM);
+        memset(f, 0, sizeof(*f));
+
+        if (parse_filter(p, sep - p, f, consumed, produced) < 0)
+            return AVERROR(EINVAL);
+        p = sep + 1;
+    }
+
+    return 0;
+}
+
+static const AVFilter *get_filter(const char *spec)
+{
+    char name[128];
+
+    av_strlcpy(name, spec, FFMIN(strcspn(spec, "@=" WHITESPACES) + 1, sizeof(name)));
+    return avfilter_get_by_name(name);
+}
+
+/* find_input_stream resolves a stream specifier label like
+ * init_input_filter() does, without failing */
+static InputStream *find_input_stream(const char *label, enum AVMediaType type)
+{
+    AVFormatContext *s;
+    InputStream *ist;
+    char *p;
+    int i, file_idx = strtol(label, &p, 0);
+
+    if (p == label || file_idx < 0 || file_idx >= nb_input_files)
+        return NULL;
+    s = input_files[file_idx]->ctx;
+
+    for (i = 0; i < s->nb_streams; i++) {
+        if (s->streams[i]->codecpar->codec_type != type)
+            continue;
+        if (check_stream_specifier(s, s->streams[i], *p == ':' ? p + 1 : p) == 1) {
+            ist = input_streams[input_files[file_idx]->ist_index + i];
+            return ist->user_set_discard == AVDISCARD_ALL ? NULL : ist;
+        }
+    }
+    return NULL;
+}
+
+/* can_branch returns 1 when the frames of ist can be filtered before the
+ * graph input: configure_input_video_filter() and
+ * configure_input_audio_filter() insert hwaccel, autorotation, -async, -vol
+ * and the trim of -ss / -t there, those must come before the chain */
+static int can_branch(const InputStream *ist)
+{
+    const InputFile *f = input_files[ist->file_index];
+
+    if (f->start_time != AV_NOPTS_VALUE || f->recording_time != INT64_MAX)
+        return 0;
+    if (ist->st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO)
+        return audio_sync_method <= 0 && audio_volume == 256;
+    return ist->hwaccel_id == HWACCEL_NONE &&
+           !(ist->autorotate &&
+             av_stream_get_side_data(ist->st, AV_PKT_DATA_DISPLAYMATRIX, NULL));
+}
+
+/* split_count returns the number of outputs of a split / asplit, -1 when
+ * the arguments are not understood */
+static int split_count(const char *spec)
+{
+    const char *p = strchr(spec, '=');
+    char *end;
+    long n;
+
+    if (!p)
+        return 2;
+    p++;
+    av_strstart(p, "outputs=", &p);
+    n = strtol(p, &end, 10);
+    return end == p || *end || n < 1 || n > INT_MAX ? -1 : n;
+}
+
+/* chain_split_stream returns the input stream c duplicates when it is a
+ * single split / asplit of an input stream, each output going to one other
+ * chain or out of the graph, NULL otherwise */
+static InputStream *chain_split_stream(const Chain *c, const Labels *consumed,
+                                       const Labels *produced)
+{
+    const ChainFilter *f = &c->filters[0];
+    const AVFilter *filter = get_filter(f->spec);
+    InputStream *ist;
+    int i;
+
+    if (c->nb_filters != 1 || f->nb_in != 1 || !filter ||
+        (strcmp(filter->name, "split") && strcmp(filter->name, "asplit")) ||
+        split_count(f->spec) != f->nb_out || count_label(produced, f->label_in))
+        return NULL;
+
+    for (i = 0; i < f->nb_out; i++) {
+        const char *label = produced->labels[f->out_idx + i];
+        if (count_label(produced, label) != 1 || count_label(consumed, label) > 1)
+            return NULL;
+    }
+
+    ist = find_input_stream(f->label_in, avfilter_pad_get_type(filter->inputs, 0));
+    return ist && can_branch(ist) ? ist : NULL;
+}
+
+/* find_split returns the split of an input stream producing label */
+static Chain *find_split(Chain *chains, int nb_chains, const Labels *produced,
+                         const char *label)
+{
+    int i, j;
+
+    for (i = 0; i < nb_chains; i++) {
+        const ChainFilter *f = &chains[i].filters[0];
+
+        if (!chains[i].split_ist)
+            continue;
+        for (j = 0; j < f->nb_out; j++)
+            if (!strcmp(produced->labels[f->out_idx + j], label))
+                return &chains[i];
+    }
+    return NULL;
+}
+
+/* chain_input_stream returns the input stream of c when c can run as a
+ * branch, NULL otherwise, with the split it replaces in *split */
+static InputStream *chain_input_stream(const Chain *c, Chain *chains, int nb_chains,
+                                       const Labels *consumed, const Labels *produced,
+                                       Chain **split)
+{
+    const ChainFilter *first = &c->filters[0];
+    const ChainFilter *last  = &c->filters[c->nb_filters - 1];
+    enum AVMediaType type = AVMEDIA_TYPE_UNKNOWN;
+    InputStream *ist;
+    int i;
+
+    *split = NULL;
+    if (first->nb_in != 1 || last->nb_out != 1)
+        return NULL;
+
+    for (i = 0; i < c->nb_filters; i++) {
+        const ChainFilter *f = &c->filters[i];
+        const AVFilter *filter = get_filter(f->spec);
+
+        if ((i > 0 && f->nb_in) || (i < c->nb_filters - 1 && f->nb_out))
+            return NULL;
+        if (!filter ||
+            (filter->flags & (AVFILTER_FLAG_DYNAMIC_INPUTS |
+                              AVFILTER_FLAG_DYNAMIC_OUTPUTS)) ||
+            avfilter_filter_pad_count(filter, 0) != 1 ||
+            avfilter_filter_pad_count(filter, 1) != 1)
+            return NULL;
+
+        if (type == AVMEDIA_TYPE_UNKNOWN)
+            type = avfilter_pad_get_type(filter->inputs, 0);
+        if (avfilter_pad_get_type(filter->inputs, 0)  != type ||
+            avfilter_pad_get_type(filter->outputs, 0) != type)
+            return NULL;
+    }
+    if (type != AVMEDIA_TYPE_VIDEO && type != AVMEDIA_TYPE_AUDIO)
+        return NULL;
+
+    /* the chain must end into at most one filter, or an output of the graph */
+    if (count_label(produced, last->label_out) != 1 ||
+        count_label(consumed, last->label_out) > 1)
+        return NULL;
+
+    /* and start from a stream, or from an output of a split of one */
+    if (count_label(produced, first->label_in)) {
+        *split = find_split(chains, nb_chains, produced, first->label_in);
+        ist = *split ? (*split)->split_ist : NULL;
+        return ist && ist->st->codecpar->codec_type == type ? ist : NULL;
+    }
+
+    ist = find_input_stream(first->label_in, type);
+    return ist && can_branch(ist) ? ist : NULL;
+}
+
+static int add_branch(FilterGraph *fg, Chain *c, InputStream *ist,
+                      const char *out_label)
+{
+    FilterBranch *b;
+    AVBPrint desc;
+    int i, ret;
+
+    b = av_mallocz(sizeof(*b));
+    if (!b)
+        return AVERROR(ENOMEM);
+
+    av_bprint_init(&desc, 0, AV_BPRINT_SIZE_UNLIMITED);
+    for (i = 0; i < c->nb_filters; i++)
+        av_bprintf(&desc, "%s%s", i ? "," : "", c->filters[i].spec);
+
+    b->in_label  = av_strdup(c->split ? c->split->filters[0].label_in :
+                                        c->filters[0].label_in);
+    b->out_label = av_strdup(out_label);
+    ret = av_bprint_finalize(&desc, &b->desc);
+    b->ist  = ist;
+    b->type = ist->st->codecpar->codec_type;
+    b->format = -1;
+
+    if (ret < 0 || !b->in_label || !b->out_label ||
+        av_dynarray_add_nofree(&fg->branches, &fg->nb_branches, b) < 0) {
+        branch_free(&b);
+        return AVERROR(ENOMEM);
+    }
+    c->branch = b;
+
+    av_log(NULL, AV_LOG_VERBOSE, "Filtergraph %d: filtering [%s]%s[%s] "
+           "in its own thread\n", fg->index, b->in_label, b->desc,
+           c->filters[c->nb_filters - 1].label_out);
+    return 0;
+}
+
+/* split_kept returns the number of outputs of the split c left to the
+ * remaining graph, and prints them to desc when desc is not NULL */
+static int split_kept(const Chain *c, const Chain *chains, int nb_chains,
+                      const Labels *produced, AVBPrint *desc)
+{
+    const ChainFilter *f = &c->filters[0];
+    int i, j, kept = 0;
+
+    for (i = 0; i < f->nb_out; i++) {
+        const char *label = produced->labels[f->out_idx + i];
+
+        for (j = 0; j < nb_chains; j++)
+            if (chains[j].split == c && !strcmp(chains[j].filters[0].label_in, label))
+                break;
+        if (j < nb_chains)
+            continue;
+        if (desc)
+            av_bprintf(desc, "[%s]", label);
+        kept++;
+    }
+    return kept;
+}
+
+int branch_split_graph(FilterGraph *fg)
+{
+    Labels consumed = { 0 }, produced = { 0 };
+    Chain *chains = NULL;
+    int i, nb_chains = 0, nb_out = 0, ret = 0;
+    const char *p = fg->graph_desc;
+    AVBPrint desc;
+
+    av_bprint_init(&desc, 0, AV_BPRINT_SIZE_UNLIMITED);
+
+    while (*p) {
+        const char *end = find_sep(p, ";");
+        Chain *c;
+
+        if (!end)
+            goto end;
+
+        if (end - p != strspn(p, WHITESPACES)) {
+            c = av_dynarray2_add((void **)&chains, &nb_chains, sizeof(*chains), NULL);
+            if (!c) {
+                ret = AVERROR(ENOMEM);
+                goto end;
+            }
+            memset(c, 0, sizeof(*c));
+            c->text = p;
+            c->len  = end - p;
+            /* leave malformed graphs to libavfilter to report */
+            ret = parse_chain(c, &consumed, &produced);
+            if (ret < 0) {
+                ret = ret == AVERROR(ENOMEM) ? ret : 0;
+                goto end;
+            }
+        }
+        p = *end ? end + 1 : end;
+    }
+
+    for (i = 0; i < nb_chains; i++)
+        chains[i].split_ist = chain_split_stream(&chains[i], &consumed, &produced);
+
+    for (i = 0; i < nb_chains && nb_chains > 1; i++) {
+        Chain *c = &chains[i];
+        const char *label = c->filters[c->nb_filters - 1].label_out;
+        InputStream *ist = chain_input_stream(c, chains, nb_chains,
+                                              &consumed, &produced, &c->split);
+        char out[32];
+
+        if (!ist)
+            continue;
+        /* the link of a branch ending into an output of the graph */
+        if (!count_label(&consumed, label)) {
+            do {
+                snprintf(out, sizeof(out), "branch%d", nb_out++);
+            } while (count_label(&consumed, out) || count_label(&produced, out));
+            label = out;
+        }
+        ret = add_branch(fg, c, ist, label);
+        if (ret < 0)
+            goto end;
+    }
+
+    for (i = 0; i < nb_chains; i++) {
+        const Chain *c = &chains[i];
+        const ChainFilter *f = &c->filters[0];
+        int kept;
+
+        if (c->branch) {
+            const ChainFilter *last = &c->filters[c->nb_filters - 1];
+            if (strcmp(c->branch->out_label, last->label_out))
+                av_bprintf(&desc, "%s[%s]%s[%s]", desc.len ? ";" : "",
+                           c->branch->out_label,
+                           c->branch->type == AVMEDIA_TYPE_VIDEO ? "null" : "anull",
+                           last->label_out);
+            continue;
+        }
+
+        kept = c->split_ist ? split_kept(c, chains, nb_chains, &produced, NULL) :
+                              f->nb_out;
+        if (kept == f->nb_out) {
+            av_bprintf(&desc, "%s%.*s", desc.len ? ";" : "", c->len, c->text);
+        } else if (kept) {
+            av_bprintf(&desc, "%s[%s]%s=%d", desc.len ? ";" : "",
+                       f->label_in, get_filter(f->spec)->name, kept);
+            split_kept(c, chains, nb_chains, &produced, &desc);
+        }
+    }
+
+    if (fg->nb_branches) {
+        char *graph_desc;
+
+        ret = av_bprint_finalize(&desc, &graph_desc);
+        if (ret < 0)
+            goto end;
+        av_freep(&fg->graph_desc);
+        fg->graph_desc = graph_desc;
+    }
+
+end:
+    av_bprint_finalize(&desc, NULL);
+    for (i = 0; i < nb_chains; i++) {
+        int j;
+        for (j = 0; j < chains[i].nb_filters; j++)
+            av_freep(&chains[i].filters[j].spec);
+        av_freep(&chains[i].filters);
+    }
+    av_freep(&chains);
+    for (i = 0; i < consumed.nb_labels; i++)
+        av_freep(&consumed.labels[i]);
+    for (i = 0; i < produced.nb_labels; i++)
+        av_freep(&produced.labels[i]);
+    av_freep(&consumed.labels);
+    av_freep(&produced.labels);
+    return ret;
+}
+
+FilterBranch *branch_find(FilterGraph *fg, const char *label, InputStream **ist)
+{
+    int i;
+
+    for (i = 0; i < fg->nb_branches; i++) {
+        if (!strcmp(fg->branches[i]->out_label, label)) {
+            *ist = fg->branches[i]->ist;
+            return fg->branches[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Filtering, on the branch thread or inline when no thread is left.
+ */
+
+static int branch_configure(FilterBranch *b, const AVFrame *frame)
+{
+    int video = b->type == AVMEDIA_TYPE_VIDEO;
+    AVFilterInOut *inputs = NULL, *outputs = NULL;
+    AVBPrint args;
+    int ret;
+
+    b->graph = avfilter_graph_alloc();
+    if (!b->graph)
+        return AVERROR(ENOMEM);
+    b->graph->nb_threads = video ? filter_auto_nbthreads : 1;
+
+    av_bprint_init(&args, 0, AV_BPRINT_SIZE_AUTOMATIC);
+    if (video) {
+        AVRational sar = frame->sample_aspect_ratio;
+        if (!sar.den)
+            sar = (AVRational){ 0, 1 };
+        av_bprintf(&args, "video_size=%dx%d:pix_fmt=%d:time_base=%d/%d:"
+                   "pixel_aspect=%d/%d", frame->width, frame->height,
+                   frame->format, b->time_base.num, b->time_base.den,
+                   sar.num, sar.den);
+        if (b->frame_rate.num && b->frame_rate.den)
+            av_bprintf(&args, ":frame_rate=%d/%d",
+                       b->frame_rate.num, b->frame_rate.den);
+    } else {
+        av_bprintf(&args, "time_base=%d/%d:sample_rate=%d:sample_fmt=%s",
+                   1, frame->sample_rate, frame->sample_rate,
+                   av_get_sample_fmt_name(frame->format));
+        if (av_channel_layout_check(&frame->ch_layout) &&
+            frame->ch_layout.order != AV_CHANNEL_ORDER_UNSPEC) {
+            av_bprintf(&args, ":channel_layout=");
+            av_channel_layout_describe_bprint(&frame->ch_layout, &args);
+        } else
+            av_bprintf(&args, ":channels=%d", frame->ch_layout.nb_channels);
+    }
+
+    ret = avfilter_graph_create_filter(&b->src,
+                                       avfilter_get_by_name(video ? "buffer" : "abuffer"),
+                                       "in", args.str, NULL, b->graph);
+    av_bprint_finalize(&args, NULL);
+    if (ret < 0)
+        goto fail;
+    ret = avfilter_graph_create_filter(&b->sink,
+                                       avfilter_get_by_name(video ? "buffersink" : "abuffersink"),
+                                       "out", NULL, NULL, b->graph);
+    if (ret < 0)
+        goto fail;
+
+    outputs = avfilter_inout_alloc();
+    inputs  = avfilter_inout_alloc();
+    if (!outputs || !inputs) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    outputs->name       = av_strdup("in");
+    outputs->filter_ctx = b->src;
+    inputs->name        = av_strdup("out");
+    inputs->filter_ctx  = b->sink;
+    if (!outputs->name || !inputs->name) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+
+    ret = avfilter_graph_parse_ptr(b->graph, b->desc, &inputs, &outputs, NULL);
+    if (ret >= 0)
+        ret = avfilter_graph_config(b->graph, NULL);
+    if (ret < 0)
+        goto fail;
+
+    b->format      = frame->format;
+    b->width       = frame->width;
+    b->height      = frame->height;
+    b->sample_rate = frame->sample_rate;
+    ret = av_channel_layout_copy(&b->ch_layout, &frame->ch_layout);
+
+fail:
+    avfilter_inout_free(&inputs);
+    avfilter_inout_free(&outputs);
+    if (ret < 0)
+        avfilter_graph_free(&b->graph);
+    return ret;
+}
+
+static int params_changed(const FilterBranch *b, const AVFrame *frame)
+{
+    if (b->format != frame->format)
+        return 1;
+    if (b->type == AVMEDIA_TYPE_VIDEO)
+        return b->width != frame->width || b->height != frame->height;
+    return b->sample_rate != frame->sample_rate ||
+           av_channel_layout_compare(&b->ch_layout, &frame->ch_layout);
+}
+
+/* post_msg returns AVERROR_EXIT when the branch thread is asked to stop */
+static int post_msg(FilterBranch *b, BranchMsg *msg)
+{
+    int ret = 0;
+
+    if (b->threaded) {
+        pthread_mutex_lock(&b->lock);
+        while (!b->finished &&
+               av_fifo_can_read(b->frames_out) >= BRANCH_MAX_FRAMES_OUT)
+            pthread_cond_wait(&b->cond, &b->lock);
+        if (b->finished)
+            ret = AVERROR_EXIT;
+        else
+            ret = av_fifo_write(b->frames_out, msg, 1);
+        pthread_cond_broadcast(&b->cond);
+        pthread_mutex_unlock(&b->lock);
+    } else {
+        ret = av_fifo_write(b->frames_out, msg, 1);
+    }
+
+    if (ret < 0)
+        objpool_release(frame_pool, (void**)&msg->frame);
+    return ret;
+}
+
+/* drain posts the frames available from the sink, returns AVERROR_EOF once
+ * the sink reached EOF */
+static int drain(FilterBranch *b)
+{
+    int ret;
+
+    while (1) {
+        BranchMsg msg = { 0 };
+
+        ret = objpool_get(frame_pool, (void**)&msg.frame);
+        if (ret < 0)
+            return ret;
+        ret = av_buffersink_get_frame(b->sink, msg.frame);
+        if (ret < 0) {
+            objpool_release(frame_pool, (void**)&msg.frame);
+            return ret == AVERROR(EAGAIN) ? 0 : ret;
+        }
+
+        /* the chain may change them, ex: with fps or settb, the graph input
+         * is configured with those of the sink */
+        msg.time_base  = av_buffersink_get_time_base(b->sink);
+        msg.frame_rate = av_buffersink_get_frame_rate(b->sink);
+
+        ret = post_msg(b, &msg);
+        if (ret < 0)
+            return ret;
+    }
+}
+
+/* filter_frame runs frame through the branch, frame NULL flushes it and
+ * returns AVERROR_EOF once all frames are posted */
+static int filter_frame(FilterBranch *b, AVFrame *frame)
+{
+    int ret;
+
+    if (!frame) {
+        ret = 0;
+        if (b->graph && !b->sink_eof) {
+            ret = av_buffersrc_add_frame(b->src, NULL);
+            if (ret >= 0)
+                ret = drain(b);
+        }
+        avfilter_graph_free(&b->graph);
+        b->sink_eof = 0;
+        return ret < 0 && ret != AVERROR_EOF ? ret : AVERROR_EOF;
+    }
+
+    /* the chain ended, ex: with trim, until the input ends too */
+    if (b->sink_eof)
+        return 0;
+
+    if (b->graph && params_changed(b, frame)) {
+        ret = av_buffersrc_add_frame(b->src, NULL);
+        if (ret >= 0)
+            ret = drain(b);
+        avfilter_graph_free(&b->graph);
+        if (ret < 0 && ret != AVERROR_EOF)
+            return ret;
+    }
+    if (!b->graph) {
+        ret = branch_configure(b, frame);
+        if (ret < 0) {
+            av_log(NULL, AV_LOG_ERROR, "Error configuring filters %s: %s\n",
+                   b->desc, av_err2str(ret));
+            return ret;
+        }
+    }
+
+    ret = av_buffersrc_add_frame_flags(b->src, frame, AV_BUFFERSRC_FLAG_PUSH);
+    if (ret < 0)
+        return ret;
+
+    ret = drain(b);
+    if (ret == AVERROR_EOF) {
+        b->sink_eof = 1;
+        ret = 0;
+    }
+    return ret;
+}
+
+static int process(FilterBranch *b, AVFrame *frame)
+{
+    BranchMsg msg = { 0 };
+    int ret = filter_frame(b, frame);
+
+    if (ret >= 0 || ret == AVERROR_EXIT)
+        return ret;
+
+    msg.ret = ret;
+    return post_msg(b, &msg);
+}
+
+static void *branch_thread(void *arg)
+{
+    FilterBranch *b = arg;
+    AVFrame *frame;
+    int ret;
+
+    while (1) {
+        pthread_mutex_lock(&b->lock);
+        while (!b->finished && av_fifo_read(b->frames_in, &frame, 1) < 0)
+            pthread_cond_wait(&b->cond, &b->lock);
+        if (b->finished) {
+            pthread_mutex_unlock(&b->lock);
+            break;
+        }
+        pthread_cond_broadcast(&b->cond);
+        pthread_mutex_unlock(&b->lock);
+
+        ret = process(b, frame);
+        objpool_release(frame_pool, (void**)&frame);
+        if (ret == AVERROR_EXIT)
+            break;
+    }
+
+    return NULL;
+}
+
+static int branch_start(FilterBranch *b)
+{
+    int ret;
+
+    b->started = 1;
+    b->time_base = b->ist->framerate.num ? av_inv_q(b->ist->framerate) :
+                                           b->ist->st->time_base;
+    b->frame_rate = b->ist->framerate;
+    if (!b->frame_rate.num)
+        b->frame_rate = av_guess_frame_rate(input_files[b->ist->file_index]->ctx,
+                                            b->ist->st, NULL);
+    b->frames_in  = av_fifo_alloc2(BRANCH_MAX_FRAMES_IN, sizeof(AVFrame*),
+                                   AV_FIFO_FLAG_AUTO_GROW);
+    b->frames_out = av_fifo_alloc2(BRANCH_MAX_FRAMES_OUT, sizeof(BranchMsg),
+                                   AV_FIFO_FLAG_AUTO_GROW);
+    if (!b->frames_in || !b->frames_out)
+        return AVERROR(ENOMEM);
+
+    pthread_mutex_init(&b->lock, NULL);
+    pthread_cond_init(&b->cond, NULL);
+    b->threaded = 1;
+    if ((ret = pthread_create(&b->thread, NULL, branch_thread, b))) {
+        /* the pthread pool is exhausted, filter on the transcode thread */
+        av_log(NULL, AV_LOG_VERBOSE, "No thread left for filters %s: %s\n",
+               b->desc, strerror(ret));
+        pthread_mutex_destroy(&b->lock);
+        pthread_cond_destroy(&b->cond);
+        b->threaded = 0;
+    }
+
+    return 0;
+}
+
+int branch_send_frame(FilterBranch *b, AVFrame *frame, int keep_reference)
+{
+    AVFrame *tmp = NULL;
+    int ret;
+
+    if (!b->started) {
+        ret = branch_start(b);
+        if (ret < 0)
+            return ret;
+    }
+
+    if (frame) {
+        ret = objpool_get(frame_pool, (void**)&tmp);
+        if (ret < 0)
+            return ret;
+        if (keep_reference) {
+            ret = av_frame_ref(tmp, frame);
+            if (ret < 0) {
+                objpool_release(frame_pool, (void**)&tmp);
+                return ret;
+            }
+        } else
+            av_frame_move_ref(tmp, frame);
+    } else {
+        b->flushing = 1;
+    }
+
+    if (!b->threaded) {
+        ret = process(b, tmp);
+        objpool_release(frame_pool, (void**)&tmp);
+        return ret;
+    }
+
+    pthread_mutex_lock(&b->lock);
+    ret = av_fifo_write(b->frames_in, &tmp, 1);
+    pthread_cond_broadcast(&b->cond);
+    pthread_mutex_unlock(&b->lock);
+
+    if (ret < 0)
+        objpool_release(frame_pool, (void**)&tmp);
+    return ret;
+}
+
+int branch_receive_frame(FilterBranch *b, AVFrame *frame,
+                         AVRational *time_base, AVRational *frame_rate)
+{
+    BranchMsg msg;
+
+    if (b->threaded) {
+        pthread_mutex_lock(&b->lock);
+        /* wait only when the branch is behind or being flushed */
+        while (av_fifo_read(b->frames_out, &msg, 1) < 0) {
+            if (!b->flushing &&
+                av_fifo_can_read(b->frames_in) < BRANCH_MAX_FRAMES_IN) {
+                pthread_mutex_unlock(&b->lock);
+                return AVERROR(EAGAIN);
+            }
+            pthread_cond_wait(&b->cond, &b->lock);
+        }
+        pthread_cond_broadcast(&b->cond);
+        pthread_mutex_unlock(&b->lock);
+    } else if (!b->started || av_fifo_read(b->frames_out, &msg, 1) < 0) {
+        return AVERROR(EAGAIN);
+    }
+
+    if (!msg.frame) {
+        if (msg.ret == AVERROR_EOF)
+            b->flushing = 0;
+        return msg.ret;
+    }
+
+    av_frame_move_ref(frame, msg.frame);
+    objpool_release(frame_pool, (void**)&msg.frame);
+    *time_base  = msg.time_base;
+    *frame_rate = msg.frame_rate;
+    return 0;
+}
+
+void branch_free(FilterBranch **pb)
+{
+    FilterBranch *b = *pb;
+    AVFrame *frame;
+    BranchMsg msg;
+
+    if (!b)
+        return;
+
+    if (b->threaded) {
+        pthread_mutex_lock(&b->lock);
+        b->finished = 1;
+        pthread_cond_broadcast(&b->cond);
+        pthread_mutex_unlock(&b->lock);
+        pthread_join(b->thread, NULL);
+        pthread_mutex_destroy(&b->lock);
+        pthread_cond_destroy(&b->cond);
+    }
+
+    if (b->frames_in) {
+        while (av_fifo_read(b->frames_in, &frame, 1) >= 0)
+            objpool_release(frame_pool, (void**)&frame);
+        av_fifo_freep2(&b->frames_in);
+    }
+    if (b->frames_out) {
+        while (av_fifo_read(b->frames_out, &msg, 1) >= 0)
+            objpool_release(frame_pool, (void**)&msg.frame);
+        av_fifo_freep2(&b->frames_out);
+    }
+
+    avfilter_graph_free(&b->graph);
+    av_channel_layout_uninit(&b->ch_layout);
+    av_freep(&b->in_label);
+    av_freep(&b->out_label);
+    av_freep(&b->desc);
+    av_freep(pb);
+}
+
+#endif /* HAVE_THREADS */
@@ -0,0 +1,223 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Stream info cache of ffmpeg.wasm.
+ *
+ * ffmpeg.wasm runs many ffmpeg() calls in the same module, and
+ * avformat_find_stream_info() reads and decodes the first frames of an input
+ * at every one of them. With -probe_cache, the parameters it filled are kept
+ * here after the first run and copied to the streams of later runs on the
+ * same input instead of probing it again.
+ *
+ * Entries are keyed by path, size and modification time of the file, and by
+ * the options bounding the probing (-probesize, -analyzeduration and
+ * -fpsprobesize). They are only used when the demuxer found the same streams
+ * in the header, with the same ids, codecs and time bases. A changed file, or
+ * one probed with other bounds, is probed again and replaces its entry. Only
+ * local files are cached, the cache lives as long as the module.
+ */
+
+#include <string.h>
+#include <sys/stat.h>
+
+#include "ffmpeg.h"
+
+#include "libavformat/avformat.h"
+#include "libavutil/avstring.h"
+
+/* inputs cached at once, the oldest entry is replaced when full */
+#define PROBE_CACHE_SIZE 16
+
+typedef struct CachedStream {
+    int id;
+    AVRational time_base;
+    AVRational r_frame_rate;
+    AVRational avg_frame_rate;
+    AVRational sample_aspect_ratio;
+    int64_t start_time;
+    int64_t duration;
+    AVCodecParameters *par;
+} CachedStream;
+
+typedef struct CacheEntry {
+    char *path;
+    int64_t size;
+    struct timespec mtime;
+    const AVInputFormat *iformat;
+    int64_t probesize;
+    int64_t max_analyze_duration;
+    int fps_probe_size;
+    int64_t start_time;
+    int64_t duration;
+    int64_t bit_rate;
+    CachedStream *streams;
+    int nb_streams;
+} CacheEntry;
+
+static CacheEntry cache[PROBE_CACHE_SIZE];
+static int next_entry;
+
+static void entry_free(CacheEntry *e)
+{
+    for (int i = 0; i < e->nb_streams; i++)
+        avcodec_parameters_free(&e->streams[i].par);
+    av_freep(&e->streams);
+    av_freep(&e->path);
+    memset(e, 0, sizeof(*e));
+}
+
+/* file_stat fills st for local files only, other protocols are not cached */
+static int file_stat(const char *filename, struct stat *st)
+{
+    const char *proto = avio_find_protocol_name(filename);
+
+    if (!proto || strcmp(proto, "file"))
+        return -1;
+    av_strstart(filename, "file:", &filename);
+    return stat(filename, st);
+}
+
+static CacheEntry *find_entry(const char *filename)
+{
+    for (int i = 0; i < PROBE_CACHE_SIZE; i++)
+        if (cache[i].path && !strcmp(cache[i].path, filename))
+            return &cache[i];
+    return NULL;
+}
+
+/* entry_matches checks ic is probed with the same bounds and its header found
+ * what was probed */
+static int entry_matches(const CacheEntry *e, const AVFormatContext *ic,
+                         const struct stat *st)
+{
+    if (e->size != st->st_size ||
+        e->mtime.tv_sec != st->st_mtim.tv_sec ||
+        e->mtime.tv_nsec != st->st_mtim.tv_nsec ||
+        e->iformat != ic->iformat || e->nb_streams != ic->nb_streams ||
+        e->probesize != ic->probesize ||
+        e->max_analyze_duration != ic->max_analyze_duration ||
+        e->fps_probe_size != ic->fps_probe_size)
+        return 0;
+
+    for (int i = 0; i < ic->nb_streams; i++) {
+        const CachedStream *cs = &e->streams[i];
+        const AVStream *s = ic->streams[i];
+
+        if (cs->id != s->id || av_cmp_q(cs->time_base, s->time_base) ||
+            cs->par->codec_type != s->codecpar->codec_type ||
+            (s->codecpar->codec_id != AV_CODEC_ID_NONE &&
+             cs->par->codec_id != s->codecpar->codec_id))
+            return 0;
+    }
+    return 1;
+}
+
+int probe_cache_restore(AVFormatContext *ic, const char *filename)
+{
+    CacheEntry *e = find_entry(filename);
+    struct stat st;
+    int ret;
+
+    if (!e || file_stat(filename, &st) < 0)
+        return 0;
+    if (!entry_matches(e, ic, &st)) {
+        av_log(NULL, AV_LOG_VERBOSE, "%s changed since it was probed, or is "
+               "probed with other options\n", filename);
+        entry_free(e);
+        return 0;
+    }
+
+    for (int i = 0; i < ic->nb_streams; i++) {
+        const CachedStream *cs = &e->streams[i];
+        AVStream *s = ic->streams[i];
+
+        ret = avcodec_parameters_copy(s->codecpar, cs->par);
+        if (ret < 0)
+            return ret;
+        s->r_frame_rate        = cs->r_frame_rate;
+        s->avg_frame_rate      = cs->avg_frame_rate;
+        s->sample_aspect_ratio = cs->sample_aspect_ratio;
+        s->start_time          = cs->start_time;
+        s->duration            = cs->duration;
+    }
+    ic->start_time = e->start_time;
+    ic->duration   = e->duration;
+    ic->bit_rate   = e->bit_rate;
+
+    av_log(NULL, AV_LOG_VERBOSE, "Using cached stream info of %s\n", filename);
+    return 1;
+}
+
+int probe_cache_store(const AVFormatContext *ic, const char *filename)
+{
+    CacheEntry *e = find_entry(filename);
+    struct stat st;
+
+    if (file_stat(filename, &st) < 0)
+        return 0;
+    if (!e) {
+        e = &cache[next_entry];
+        next_entry = (next_entry + 1) % PROBE_CACHE_SIZE;
+    }
+    entry_free(e);
+
+    e->path    = av_strdup(filename);
+    e->streams = av_calloc(ic->nb_streams, sizeof(*e->streams));
+    if (!e->path || !e->streams)
+        goto fail;
+    e->size       = st.st_size;
+    e->mtime      = st.st_mtim;
+    e->iformat    = ic->iformat;
+    e->probesize  = ic->probesize;
+    e->max_analyze_duration = ic->max_analyze_duration;
+    e->fps_probe_size       = ic->fps_probe_size;
+    e->start_time = ic->start_time;
+    e->duration   = ic->duration;
+    e->bit_rate   = ic->bit_rate;
+
+    for (int i = 0; i < ic->nb_streams; i++) {
+        CachedStream *cs = &e->streams[i];
+        const AVStream *s = ic->streams[i];
+
+        cs->par = avcodec_parameters_alloc();
+        if (!cs->par)
+            goto fail;
+        e->nb_streams++;
+        if (avcodec_parameters_copy(cs->par, s->codecpar) < 0)
+            goto fail;
+        cs->id                  = s->id;
+        cs->time_base           = s->time_base;
+        cs->r_frame_rate        = s->r_frame_rate;
+        cs->avg_frame_rate      = s->avg_frame_rate;
+        cs->sample_aspect_ratio = s->sample_aspect_ratio;
+        cs->start_time          = s->start_time;
+        cs->duration            = s->duration;
+    }
+    return 0;
+fail:
+    entry_free(e);
+    return AVERROR(ENOMEM);
+}
+
+void probe_cache_clear(void)
+{
+    for (int i = 0; i < PROBE_CACHE_SIZE; i++)
+        entry_free(&cache[i]);
+    next_entry = 0;
+}
@@ -0,0 +1,286 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Decoder threads of the MT core.
+ *
+ * Every audio / video decoder runs in its own thread, so decoding of the next
+ * packets overlaps with filtering and encoding of the frames already decoded
+ * on the transcode thread. Packets and frames are exchanged through two
+ * FIFOs sharing one lock, so that the transcode thread can wait for either a
+ * free packet slot or a decoded frame.
+ */
+
+#include "config.h"
+
+#if HAVE_THREADS
+
+#include <string.h>
+
+#include "ffmpeg.h"
+
+#include "libavutil/avassert.h"
+#include "libavutil/fifo.h"
+
+/* packets queued ahead of the decoder before the transcode thread waits */
+#define DEC_MAX_PACKETS 8
+/* decoded frames waiting for the transcode thread */
+#define DEC_MAX_FRAMES  4
+
+typedef struct DecoderMsg {
+    AVFrame *frame;             /* NULL when ret carries an error or EOF */
+    int ret;
+    DecoderState state;         /* of the decoder after this message */
+} DecoderMsg;
+
+struct DecoderThread {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+
+    AVFifo *packets;            /* AVPacket* to the decoder thread */
+    AVFifo *frames;             /* DecoderMsg to the transcode thread */
+    int finished;               /* the decoder thread is asked to stop */
+
+    /* only accessed by the transcode thread */
+    int flushing;               /* a flush packet was sent, waiting for EOF */
+    int eof;
+};
+
+/* send_msg returns 1 when the decoder thread is asked to stop */
+static int send_msg(DecoderThread *dt, DecoderMsg *msg)
+{
+    int finished;
+
+    pthread_mutex_lock(&dt->lock);
+    while (!dt->finished && !av_fifo_can_write(dt->frames))
+        pthread_cond_wait(&dt->cond, &dt->lock);
+    finished = dt->finished;
+    if (!finished) {
+        av_fifo_write(dt->frames, msg, 1);
+        pthread_cond_broadcast(&dt->cond);
+    }
+    pthread_mutex_unlock(&dt->lock);
+
+    if (finished)
+        objpool_release(frame_pool, (void**)&msg->frame);
+    return finished;
+}
+
+static void *decoder_thread(void *arg)
+{
+    InputStream *ist = arg;
+    DecoderThread *dt = ist->dec_thread;
+    AVPacket *pkt;
+    DecoderMsg msg;
+    int ret;
+
+    while (1) {
+        pthread_mutex_lock(&dt->lock);
+        while (!dt->finished && av_fifo_read(dt->packets, &pkt, 1) < 0)
+            pthread_cond_wait(&dt->cond, &dt->lock);
+        if (dt->finished) {
+            pthread_mutex_unlock(&dt->lock);
+            break;
+        }
+        pthread_cond_broadcast(&dt->cond);
+        pthread_mutex_unlock(&dt->lock);
+
+        ret = avcodec_send_packet(ist->dec_ctx, pkt);
+        objpool_release(packet_pool, (void**)&pkt);
+        // In particular, we don't expect AVERROR(EAGAIN), because we read all
+        // decoded frames with avcodec_receive_frame() until done.
+        if (ret < 0 && ret != AVERROR_EOF) {
+            msg = (DecoderMsg){ .ret = ret };
+            dec_state_update(&msg.state, ist->dec_ctx);
+            if (send_msg(dt, &msg))
+                break;
+            continue;
+        }
+
+        do {
+            msg = (DecoderMsg){ 0 };
+            ret = objpool_get(frame_pool, (void**)&msg.frame);
+            if (ret >= 0) {
+                ret = avcodec_receive_frame(ist->dec_ctx, msg.frame);
+                if (ret < 0)
+                    objpool_release(frame_pool, (void**)&msg.frame);
+            }
+            if (ret == AVERROR(EAGAIN))
+                break;
+
+            msg.ret = ret;
+            dec_state_update(&msg.state, ist->dec_ctx);
+            if (send_msg(dt, &msg))
+                return NULL;
+        /* after EOF the decoder is idle until it is flushed */
+        } while (ret != AVERROR_EOF);
+    }
+
+    return NULL;
+}
+
+int dec_thread_start(InputStream *ist)
+{
+    DecoderThread *dt;
+    int ret;
+
+    if (ist->dec_ctx->codec_type != AVMEDIA_TYPE_AUDIO &&
+        ist->dec_ctx->codec_type != AVMEDIA_TYPE_VIDEO)
+        return 0;
+    /* attached pics are decoded right away, see init_input_stream() */
+    if (ist->st->disposition & AV_DISPOSITION_ATTACHED_PIC)
+        return 0;
+
+    dt = av_mallocz(sizeof(*dt));
+    if (!dt)
+        return AVERROR(ENOMEM);
+
+    dt->packets = av_fifo_alloc2(DEC_MAX_PACKETS, sizeof(AVPacket*),
+                                 AV_FIFO_FLAG_AUTO_GROW);
+    dt->frames  = av_fifo_alloc2(DEC_MAX_FRAMES, sizeof(DecoderMsg), 0);
+    if (!dt->packets || !dt->frames) {
+        av_fifo_freep2(&dt->packets);
+        av_fifo_freep2(&dt->frames);
+        av_freep(&dt);
+        return AVERROR(ENOMEM);
+    }
+    pthread_mutex_init(&dt->lock, NULL);
+    pthread_cond_init(&dt->cond, NULL);
+
+    ist->dec_thread = dt;
+    if ((ret = pthread_create(&dt->thread, NULL, decoder_thread, ist))) {
+        /* the pthread pool is exhausted, decode on the transcode thread */
+        av_log(ist->dec_ctx, AV_LOG_VERBOSE, "No thread left for decoding: %s\n",
+               strerror(ret));
+        pthread_mutex_destroy(&dt->lock);
+        pthread_cond_destroy(&dt->cond);
+        av_fifo_freep2(&dt->packets);
+        av_fifo_freep2(&dt->frames);
+        av_freep(&ist->dec_thread);
+    }
+
+    return 0;
+}
+
+void dec_thread_stop(InputStream *ist)
+{
+    DecoderThread *dt = ist->dec_thread;
+    AVPacket *pkt;
+    DecoderMsg msg;
+
+    if (!dt)
+        return;
+
+    pthread_mutex_lock(&dt->lock);
+    dt->finished = 1;
+    pthread_cond_broadcast(&dt->cond);
+    pthread_mutex_unlock(&dt->lock);
+    pthread_join(dt->thread, NULL);
+
+    while (av_fifo_read(dt->packets, &pkt, 1) >= 0)
+        objpool_release(packet_pool, (void**)&pkt);
+    while (av_fifo_read(dt->frames, &msg, 1) >= 0)
+        objpool_release(frame_pool, (void**)&msg.frame);
+    av_fifo_freep2(&dt->packets);
+    av_fifo_freep2(&dt->frames);
+    pthread_mutex_destroy(&dt->lock);
+    pthread_cond_destroy(&dt->cond);
+    av_freep(&ist->dec_thread);
+}
+
+void dec_thread_flush(InputStream *ist)
+{
+    DecoderThread *dt = ist->dec_thread;
+
+    if (!dt)
+        return;
+
+    /* the decoder thread does not touch the codec after sending EOF, so the
+     * caller could flush it */
+    av_assert0(dt->eof);
+    dt->eof = 0;
+}
+
+int dec_thread_decode(InputStream *ist, AVFrame *frame, int *got_frame,
+                      AVPacket *pkt)
+{
+    DecoderThread *dt = ist->dec_thread;
+    AVPacket *queue_pkt = NULL;
+    DecoderMsg msg;
+    int ret;
+
+    *got_frame = 0;
+
+    if (dt->eof)
+        return AVERROR_EOF;
+
+    /* like avcodec_send_packet(), extra flush packets are ignored */
+    if (pkt && !dt->flushing) {
+        ret = objpool_get(packet_pool, (void**)&queue_pkt);
+        if (ret < 0)
+            return ret;
+        ret = av_packet_ref(queue_pkt, pkt);
+        if (ret < 0) {
+            objpool_release(packet_pool, (void**)&queue_pkt);
+            return ret;
+        }
+        dt->flushing = !pkt->data && !pkt->side_data_elems;
+    }
+
+    pthread_mutex_lock(&dt->lock);
+    if (queue_pkt) {
+        ret = av_fifo_write(dt->packets, &queue_pkt, 1);
+        if (ret < 0) {
+            pthread_mutex_unlock(&dt->lock);
+            objpool_release(packet_pool, (void**)&queue_pkt);
+            return ret;
+        }
+        pthread_cond_broadcast(&dt->cond);
+    }
+    /* wait only when the decoder is behind or being drained, otherwise let
+     * the transcode thread read more packets */
+    while (av_fifo_read(dt->frames, &msg, 1) < 0) {
+        if (!dt->flushing && av_fifo_can_read(dt->packets) < DEC_MAX_PACKETS) {
+            pthread_mutex_unlock(&dt->lock);
+            return 0;
+        }
+        pthread_cond_wait(&dt->cond, &dt->lock);
+    }
+    pthread_cond_broadcast(&dt->cond);
+    pthread_mutex_unlock(&dt->lock);
+
+    /* dec_ctx is only read through this copy while the thread runs */
+    ist->dec_state = msg.state;
+
+    if (!msg.frame) {
+        if (msg.ret == AVERROR_EOF) {
+            dt->flushing = 0;
+            dt->eof = 1;
+        }
+        return msg.ret;
+    }
+
+    av_frame_move_ref(frame, msg.frame);
+    objpool_release(frame_pool, (void**)&msg.frame);
+    *got_frame = 1;
+
+    return 0;
+}
+
+#endif /* HAVE_THREADS */
@@ -0,0 +1,266 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Encoder threads of the MT core.
+ *
+ * Every audio / video encoder runs in its own thread, so the outputs of one
+ * job, ex: the renditions of an ABR ladder, encode concurrently while the
+ * transcode thread keeps filtering. Frames and packets are exchanged through
+ * two FIFOs sharing one lock, muxing stays on the transcode thread.
+ */
+
+#include "config.h"
+
+#if HAVE_THREADS
+
+#include <string.h>
+
+#include "ffmpeg.h"
+
+#include "libavutil/fifo.h"
+
+/* frames queued ahead of the encoder before the transcode thread waits */
+#define ENC_MAX_FRAMES  8
+/* encoded packets waiting for the transcode thread */
+#define ENC_MAX_PACKETS 16
+
+typedef struct EncoderMsg {
+    AVPacket *pkt;              /* NULL when ret carries an error or EOF */
+    int ret;
+} EncoderMsg;
+
+struct EncoderThread {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+
+    AVFifo *frames;             /* AVFrame* to the encoder thread, NULL flushes */
+    AVFifo *packets;            /* EncoderMsg to the transcode thread */
+    int finished;               /* the encoder thread is asked to stop */
+
+    /* only accessed by the transcode thread */
+    int flushing;               /* a flush frame was sent, waiting for EOF */
+    int eof;
+};
+
+/* send_msg returns 1 when the encoder thread is asked to stop */
+static int send_msg(EncoderThread *et, EncoderMsg *msg)
+{
+    int finished;
+
+    pthread_mutex_lock(&et->lock);
+    while (!et->finished && !av_fifo_can_write(et->packets))
+        pthread_cond_wait(&et->cond, &et->lock);
+    finished = et->finished;
+    if (!finished) {
+        av_fifo_write(et->packets, msg, 1);
+        pthread_cond_broadcast(&et->cond);
+    }
+    pthread_mutex_unlock(&et->lock);
+
+    if (finished)
+        objpool_release(packet_pool, (void**)&msg->pkt);
+    return finished;
+}
+
+static void *encoder_thread(void *arg)
+{
+    OutputStream *ost = arg;
+    EncoderThread *et = ost->enc_thread;
+    AVFrame *frame;
+    EncoderMsg msg;
+    int ret;
+
+    while (1) {
+        pthread_mutex_lock(&et->lock);
+        while (!et->finished && av_fifo_read(et->frames, &frame, 1) < 0)
+            pthread_cond_wait(&et->cond, &et->lock);
+        if (et->finished) {
+            pthread_mutex_unlock(&et->lock);
+            break;
+        }
+        pthread_cond_broadcast(&et->cond);
+        pthread_mutex_unlock(&et->lock);
+
+        ret = avcodec_send_frame(ost->enc_ctx, frame);
+        objpool_release(frame_pool, (void**)&frame);
+        if (ret < 0 && ret != AVERROR_EOF) {
+            msg = (EncoderMsg){ .ret = ret };
+            if (send_msg(et, &msg))
+                break;
+            continue;
+        }
+
+        do {
+            msg = (EncoderMsg){ 0 };
+            ret = objpool_get(packet_pool, (void**)&msg.pkt);
+            if (ret >= 0) {
+                ret = avcodec_receive_packet(ost->enc_ctx, msg.pkt);
+                if (ret < 0)
+                    objpool_release(packet_pool, (void**)&msg.pkt);
+            }
+            if (ret == AVERROR(EAGAIN))
+                break;
+
+            msg.ret = ret;
+            if (send_msg(et, &msg))
+                return NULL;
+        /* after EOF the encoder is idle until it is stopped */
+        } while (ret != AVERROR_EOF);
+    }
+
+    return NULL;
+}
+
+int enc_thread_start(OutputStream *ost)
+{
+    EncoderThread *et;
+    int ret;
+
+    if (ost->enc_ctx->codec_type != AVMEDIA_TYPE_AUDIO &&
+        ost->enc_ctx->codec_type != AVMEDIA_TYPE_VIDEO)
+        return 0;
+    /* two-pass logs read enc_ctx->stats_out after every packet */
+    if (ost->logfile)
+        return 0;
+
+    et = av_mallocz(sizeof(*et));
+    if (!et)
+        return AVERROR(ENOMEM);
+
+    et->frames  = av_fifo_alloc2(ENC_MAX_FRAMES, sizeof(AVFrame*),
+                                 AV_FIFO_FLAG_AUTO_GROW);
+    et->packets = av_fifo_alloc2(ENC_MAX_PACKETS, sizeof(EncoderMsg), 0);
+    if (!et->frames || !et->packets) {
+        av_fifo_freep2(&et->frames);
+        av_fifo_freep2(&et->packets);
+        av_freep(&et);
+        return AVERROR(ENOMEM);
+    }
+    pthread_mutex_init(&et->lock, NULL);
+    pthread_cond_init(&et->cond, NULL);
+
+    ost->enc_thread = et;
+    if ((ret = pthread_create(&et->thread, NULL, encoder_thread, ost))) {
+        /* the pthread pool is exhausted, encode on the transcode thread */
+        av_log(ost->enc_ctx, AV_LOG_VERBOSE, "No thread left for encoding: %s\n",
+               strerror(ret));
+        pthread_mutex_destroy(&et->lock);
+        pthread_cond_destroy(&et->cond);
+        av_fifo_freep2(&et->frames);
+        av_fifo_freep2(&et->packets);
+        av_freep(&ost->enc_thread);
+    }
+
+    return 0;
+}
+
+void enc_thread_stop(OutputStream *ost)
+{
+    EncoderThread *et = ost->enc_thread;
+    AVFrame *frame;
+    EncoderMsg msg;
+
+    if (!et)
+        return;
+
+    pthread_mutex_lock(&et->lock);
+    et->finished = 1;
+    pthread_cond_broadcast(&et->cond);
+    pthread_mutex_unlock(&et->lock);
+    pthread_join(et->thread, NULL);
+
+    while (av_fifo_read(et->frames, &frame, 1) >= 0)
+        objpool_release(frame_pool, (void**)&frame);
+    while (av_fifo_read(et->packets, &msg, 1) >= 0)
+        objpool_release(packet_pool, (void**)&msg.pkt);
+    av_fifo_freep2(&et->frames);
+    av_fifo_freep2(&et->packets);
+    pthread_mutex_destroy(&et->lock);
+    pthread_cond_destroy(&et->cond);
+    av_freep(&ost->enc_thread);
+}
+
+int enc_thread_send_frame(OutputStream *ost, const AVFrame *frame)
+{
+    EncoderThread *et = ost->enc_thread;
+    AVFrame *queue_frame = NULL;
+    int ret;
+
+    if (et->eof || et->flushing)
+        return AVERROR_EOF;
+
+    if (frame) {
+        ret = objpool_get(frame_pool, (void**)&queue_frame);
+        if (ret < 0)
+            return ret;
+        ret = av_frame_ref(queue_frame, frame);
+        if (ret < 0) {
+            objpool_release(frame_pool, (void**)&queue_frame);
+            return ret;
+        }
+    } else {
+        et->flushing = 1;
+    }
+
+    pthread_mutex_lock(&et->lock);
+    ret = av_fifo_write(et->frames, &queue_frame, 1);
+    pthread_cond_broadcast(&et->cond);
+    pthread_mutex_unlock(&et->lock);
+
+    if (ret < 0)
+        objpool_release(frame_pool, (void**)&queue_frame);
+    return ret;
+}
+
+int enc_thread_receive_packet(OutputStream *ost, AVPacket *pkt)
+{
+    EncoderThread *et = ost->enc_thread;
+    EncoderMsg msg;
+
+    if (et->eof)
+        return AVERROR_EOF;
+
+    pthread_mutex_lock(&et->lock);
+    /* wait only when the encoder is behind or being drained, otherwise let
+     * the transcode thread filter more frames */
+    while (av_fifo_read(et->packets, &msg, 1) < 0) {
+        if (!et->flushing && av_fifo_can_read(et->frames) < ENC_MAX_FRAMES) {
+            pthread_mutex_unlock(&et->lock);
+            return AVERROR(EAGAIN);
+        }
+        pthread_cond_wait(&et->cond, &et->lock);
+    }
+    pthread_cond_broadcast(&et->cond);
+    pthread_mutex_unlock(&et->lock);
+
+    if (!msg.pkt) {
+        if (msg.ret == AVERROR_EOF) {
+            et->flushing = 0;
+            et->eof = 1;
+        }
+        return msg.ret;
+    }
+
+    av_packet_move_ref(pkt, msg.pkt);
+    objpool_release(packet_pool, (void**)&msg.pkt);
+    return 0;
+}
+
+#endif /* HAVE_THREADS */
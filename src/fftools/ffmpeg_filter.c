@@ -232,6 +232,10 @@ static void init_input_filter(FilterGraph *fg, AVFilterInOut *in)
     InputFilter *ifilter;
     int i;
 
+#if HAVE_THREADS
+    FilterBranch *branch = in->name ? branch_find(fg, in->name, &ist) : NULL;
+#endif
+
     // TODO: support other filter types
     if (type != AVMEDIA_TYPE_VIDEO && type != AVMEDIA_TYPE_AUDIO) {
         av_log(NULL, AV_LOG_FATAL, "Only video and audio filters supported "
@@ -239,7 +243,9 @@ static void init_input_filter(FilterGraph *fg, AVFilterInOut *in)
         exit_program(1);
     }
 
-    if (in->name) {
+    if (ist) {
+        /* the link is fed by a branch, see branch_split_graph() */
+    } else if (in->name) {
         AVFormatContext *s;
         AVStream       *st = NULL;
         char *p;
@@ -303,6 +309,9 @@ static void init_input_filter(FilterGraph *fg, AVFilterInOut *in)
     ifilter->format = -1;
     ifilter->type   = ist->st->codecpar->codec_type;
     ifilter->name   = describe_filter_link(fg, in, 1);
+#if HAVE_THREADS
+    ifilter->branch = branch;
+#endif
 
     ifilter->frame_queue = av_fifo_alloc2(8, sizeof(AVFrame*), AV_FIFO_FLAG_AUTO_GROW);
     if (!ifilter->frame_queue)
@@ -318,6 +327,12 @@ int init_complex_filtergraph(FilterGraph *fg)
     AVFilterGraph *graph;
     int ret = 0;
 
+#ifdef __EMSCRIPTEN_PTHREADS__
+    ret = branch_split_graph(fg);
+    if (ret < 0)
+        return ret;
+#endif
+
     /* this graph is only used for determining the kinds of inputs
      * and outputs we have, and is discarded on exit from this function */
     graph = avfilter_graph_alloc();
@@ -735,6 +750,11 @@ static int configure_input_video_filter(FilterGraph *fg, InputFilter *ifilter,
 
     if (!fr.num)
         fr = av_guess_frame_rate(input_files[ist->file_index]->ctx, ist->st, NULL);
+    /* the frames come from a branch, which may have changed the rate */
+    if (ifilter->time_base.num) {
+        tb = ifilter->time_base;
+        fr = ifilter->frame_rate;
+    }
 
     if (ist->dec_ctx->codec_type == AVMEDIA_TYPE_SUBTITLE) {
         ret = sub2video_prepare(ist, ifilter);
@@ -836,6 +856,7 @@ static int configure_input_audio_filter(FilterGraph *fg, InputFilter *ifilter,
     const AVFilter *abuffer_filt = avfilter_get_by_name("abuffer");
     InputStream *ist = ifilter->ist;
     InputFile     *f = input_files[ist->file_index];
+    AVRational tb = ifilter->time_base;
     AVBPrint args;
     char name[255];
     int ret, pad_idx = 0;
@@ -846,9 +867,12 @@ static int configure_input_audio_filter(FilterGraph *fg, InputFilter *ifilter,
         return AVERROR(EINVAL);
     }
 
+    if (!tb.num)
+        tb = (AVRational){ 1, ifilter->sample_rate };
+
     av_bprint_init(&args, 0, AV_BPRINT_SIZE_AUTOMATIC);
     av_bprintf(&args, "time_base=%d/%d:sample_rate=%d:sample_fmt=%s",
-             1, ifilter->sample_rate,
+             tb.num, tb.den,
              ifilter->sample_rate,
              av_get_sample_fmt_name(ifilter->format));
     if (av_channel_layout_check(&ifilter->ch_layout) &&
@@ -990,6 +1014,25 @@ static int graph_is_meta(AVFilterGraph *graph)
     return 1;
 }
 
+#ifdef __EMSCRIPTEN_PTHREADS__
+/* filtergraph_auto_threads sizes slice threading of fg from its share of the
+ * thread budget instead of letting libavfilter count cpus, audio filters do
+ * not use slice threads so audio only graphs get none.
+ */
+static int filtergraph_auto_threads(FilterGraph *fg)
+{
+    int i;
+
+    for (i = 0; i < fg->nb_inputs; i++)
+        if (fg->inputs[i]->type == AVMEDIA_TYPE_VIDEO)
+            return filter_auto_nbthreads;
+    for (i = 0; i < fg->nb_outputs; i++)
+        if (fg->outputs[i]->type == AVMEDIA_TYPE_VIDEO)
+            return filter_auto_nbthreads;
+    return 1;
+}
+#endif
+
 int configure_filtergraph(FilterGraph *fg)
 {
     AVFilterInOut *inputs, *outputs, *cur;
@@ -1011,9 +1054,16 @@ int configure_filtergraph(FilterGraph *fg)
             if (ret < 0)
                 goto fail;
         } else {
-            e = av_dict_get(ost->encoder_opts, "threads", NULL, 0);
+            /* the user's -threads, not the one of init_output_stream() when
+             * the graph is reconfigured */
+            if (!ost->encoder_auto_threads)
+                e = av_dict_get(ost->encoder_opts, "threads", NULL, 0);
             if (e)
                 av_opt_set(fg->graph, "threads", e->value, 0);
+#ifdef __EMSCRIPTEN_PTHREADS__
+            else
+                fg->graph->nb_threads = filtergraph_auto_threads(fg);
+#endif
         }
 
         args[0] = 0;
@@ -1038,6 +1088,10 @@ int configure_filtergraph(FilterGraph *fg)
         av_opt_set(fg->graph, "aresample_swr_opts", args, 0);
     } else {
         fg->graph->nb_threads = filter_complex_nbthreads;
+#ifdef __EMSCRIPTEN_PTHREADS__
+        if (!filter_complex_nbthreads)
+            fg->graph->nb_threads = filtergraph_auto_threads(fg);
+#endif
     }
 
     if ((ret = avfilter_graph_parse2(fg->graph, graph_desc, &inputs, &outputs)) < 0)
@@ -1132,7 +1186,7 @@ int configure_filtergraph(FilterGraph *fg)
         AVFrame *tmp;
         while (av_fifo_read(fg->inputs[i]->frame_queue, &tmp, 1) >= 0) {
             ret = av_buffersrc_add_frame(fg->inputs[i]->filter, tmp);
-            av_frame_free(&tmp);
+            objpool_release(frame_pool, (void**)&tmp);
             if (ret < 0)
                 goto fail;
         }
@@ -0,0 +1,138 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Allocation telemetry of ffmpeg.wasm.
+ *
+ * ffmpeg-core is linked with -Wl,--wrap=malloc,... so every allocation of
+ * FFmpeg libraries and fftools goes through the wrappers below before
+ * reaching the malloc backend selected with -sMALLOC. Bytes are counted with
+ * malloc_usable_size(), which every emscripten backend implements, so the
+ * numbers stay comparable when switching backends.
+ */
+
+#include <malloc.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <emscripten/heap.h>
+
+#include "ffmpeg.h"
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+int __real_posix_memalign(void **memptr, size_t alignment, size_t size);
+void __real_free(void *ptr);
+
+extern unsigned char __heap_base;
+
+/* signed, as blocks from the exported _malloc() used by bind.js may be
+ * released by a wrapped free() */
+static atomic_llong in_use = ATOMIC_VAR_INIT(0);
+static atomic_llong peak_in_use = ATOMIC_VAR_INIT(0);
+static atomic_uint_fast64_t nb_allocs = ATOMIC_VAR_INIT(0);
+static atomic_uint_fast64_t nb_reallocs = ATOMIC_VAR_INIT(0);
+static atomic_uint_fast64_t nb_frees = ATOMIC_VAR_INIT(0);
+
+static void count_alloc(atomic_uint_fast64_t *counter, void *ptr)
+{
+    long long size, cur, peak;
+
+    atomic_fetch_add_explicit(counter, 1, memory_order_relaxed);
+    if (!ptr)
+        return;
+
+    size = malloc_usable_size(ptr);
+    cur = atomic_fetch_add_explicit(&in_use, size, memory_order_relaxed) + size;
+    peak = atomic_load_explicit(&peak_in_use, memory_order_relaxed);
+    while (cur > peak &&
+           !atomic_compare_exchange_weak_explicit(&peak_in_use, &peak, cur,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed))
+        ;
+}
+
+static void count_free(void *ptr)
+{
+    atomic_fetch_sub_explicit(&in_use, malloc_usable_size(ptr),
+                              memory_order_relaxed);
+}
+
+void *__wrap_malloc(size_t size)
+{
+    void *ptr = __real_malloc(size);
+    count_alloc(&nb_allocs, ptr);
+    return ptr;
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size)
+{
+    void *ptr = __real_calloc(nmemb, size);
+    count_alloc(&nb_allocs, ptr);
+    return ptr;
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    size_t old_size = ptr ? malloc_usable_size(ptr) : 0;
+    void *ret = __real_realloc(ptr, size);
+
+    /* on failure the old block is left untouched */
+    if (ptr && (ret || !size))
+        atomic_fetch_sub_explicit(&in_use, old_size, memory_order_relaxed);
+    count_alloc(ptr ? &nb_reallocs : &nb_allocs, ret);
+    return ret;
+}
+
+int __wrap_posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+    int ret = __real_posix_memalign(memptr, alignment, size);
+    count_alloc(&nb_allocs, ret ? NULL : *memptr);
+    return ret;
+}
+
+void __wrap_free(void *ptr)
+{
+    if (ptr) {
+        atomic_fetch_add_explicit(&nb_frees, 1, memory_order_relaxed);
+        count_free(ptr);
+    }
+    __real_free(ptr);
+}
+
+void malloc_stats_reset(void)
+{
+    atomic_store(&peak_in_use, atomic_load(&in_use));
+    atomic_store(&nb_allocs, 0);
+    atomic_store(&nb_reallocs, 0);
+    atomic_store(&nb_frees, 0);
+}
+
+void malloc_stats_get(MallocStats *stats)
+{
+    uintptr_t brk = *emscripten_get_sbrk_ptr();
+
+    stats->in_use      = FFMAX(atomic_load(&in_use), 0);
+    stats->peak_in_use = FFMAX(atomic_load(&peak_in_use), 0);
+    stats->arena       = brk - (uintptr_t)&__heap_base;
+    stats->nb_allocs   = atomic_load(&nb_allocs);
+    stats->nb_reallocs = atomic_load(&nb_reallocs);
+    stats->nb_frees    = atomic_load(&nb_frees);
+}
@@ -87,8 +87,7 @@ void of_write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost,
         ret = av_packet_make_refcounted(pkt);
         if (ret < 0)
             exit_program(1);
-        tmp_pkt = av_packet_alloc();
-        if (!tmp_pkt)
+        if (objpool_get(packet_pool, (void**)&tmp_pkt) < 0)
             exit_program(1);
         av_packet_move_ref(tmp_pkt, pkt);
         ost->muxing_queue_data_size += tmp_pkt->size;
@@ -271,7 +270,7 @@ int of_check_init(OutputFile *of)
         while (av_fifo_read(ost->muxing_queue, &pkt, 1) >= 0) {
             ost->muxing_queue_data_size -= pkt->size;
             of_write_packet(of, pkt, ost, 1);
-            av_packet_free(&pkt);
+            objpool_release(packet_pool, (void**)&pkt);
         }
     }
 
@@ -28,6 +28,7 @@
 #endif
 
 #include "ffmpeg.h"
+#include "ffindex.h"
 #include "fopen_utf8.h"
 #include "cmdutils.h"
 #include "opt_common.h"
@@ -1159,6 +1160,7 @@ static int open_input_file(OptionsContext *o, const char *filename)
     char *subtitle_codec_name = NULL;
     char *    data_codec_name = NULL;
     int scan_all_pmts_set = 0;
+    int *index_entries = NULL, nb_index_entries = 0;
 
     if (o->stop_time != INT64_MAX && o->recording_time != INT64_MAX) {
         o->stop_time = INT64_MAX;
@@ -1277,7 +1279,24 @@ static int open_input_file(OptionsContext *o, const char *filename)
     for (i = 0; i < ic->nb_streams; i++)
         choose_decoder(o, ic, ic->streams[i]);
 
-    if (find_stream_info) {
+    /* the index of the header, probing may add entries, see ffindex_load() */
+    if (o->seek_index) {
+        nb_index_entries = ic->nb_streams;
+        index_entries = av_malloc_array(nb_index_entries, sizeof(*index_entries));
+        if (!index_entries)
+            exit_program(1);
+        for (i = 0; i < nb_index_entries; i++)
+            index_entries[i] = avformat_index_get_entries_count(ic->streams[i]);
+    }
+
+    ret = 0;
+    if (find_stream_info && o->probe_cache)
+        ret = probe_cache_restore(ic, filename);
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_FATAL, "%s: %s\n", filename, av_err2str(ret));
+        exit_program(1);
+    }
+    if (find_stream_info && !ret) {
         AVDictionary **opts = setup_find_stream_info_opts(ic, o->g->codec_opts);
         int orig_nb_streams = ic->nb_streams;
 
@@ -1295,9 +1314,19 @@ static int open_input_file(OptionsContext *o, const char *filename)
                 avformat_close_input(&ic);
                 exit_program(1);
             }
+        } else if (o->probe_cache && probe_cache_store(ic, filename) < 0) {
+            av_log(NULL, AV_LOG_WARNING, "%s: could not cache stream info\n", filename);
         }
     }
 
+    if (o->seek_index) {
+        ret = ffindex_load(ic, o->seek_index, index_entries, nb_index_entries);
+        if (ret < 0)
+            av_log(NULL, AV_LOG_WARNING, "%s: ignoring seek index %s: %s\n",
+                   filename, o->seek_index, av_err2str(ret));
+        av_freep(&index_entries);
+    }
+
     if (o->start_time != AV_NOPTS_VALUE && o->start_time_eof != AV_NOPTS_VALUE) {
         av_log(NULL, AV_LOG_WARNING, "Cannot use -ss and -sseof both, using -ss for %s\n", filename);
         o->start_time_eof = AV_NOPTS_VALUE;
@@ -1339,7 +1368,9 @@ static int open_input_file(OptionsContext *o, const char *filename)
                 seek_timestamp -= 3*AV_TIME_BASE / 23;
             }
         }
-        ret = avformat_seek_file(ic, -1, INT64_MIN, seek_timestamp, seek_timestamp, 0);
+        ret = o->seek_index ? ffindex_seek(ic, seek_timestamp) : -1;
+        if (ret < 0)
+            ret = avformat_seek_file(ic, -1, INT64_MIN, seek_timestamp, seek_timestamp, 0);
         if (ret < 0) {
             av_log(NULL, AV_LOG_WARNING, "%s: could not seek to position %0.3f\n",
                    filename, (double)timestamp / AV_TIME_BASE);
@@ -3696,6 +3727,12 @@ const OptionDef options[] = {
     { "accurate_seek",  OPT_BOOL | OPT_OFFSET | OPT_EXPERT |
                         OPT_INPUT,                                   { .off = OFFSET(accurate_seek) },
         "enable/disable accurate seeking with -ss" },
+    { "probe_cache",    OPT_BOOL | OPT_OFFSET | OPT_EXPERT |
+                        OPT_INPUT,                                   { .off = OFFSET(probe_cache) },
+        "reuse the stream info of the input probed by an earlier run" },
+    { "seek_index",     HAS_ARG | OPT_STRING | OPT_OFFSET |
+                        OPT_EXPERT | OPT_INPUT,                      { .off = OFFSET(seek_index) },
+        "seek with a keyframe index built by ffindex", "file" },
     { "isync",          HAS_ARG | OPT_INT | OPT_OFFSET |
                         OPT_EXPERT | OPT_INPUT,                      { .off = OFFSET(input_sync_ref) },
         "Indicate the input index for sync reference", "sync ref" },
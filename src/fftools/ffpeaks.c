@@ -0,0 +1,368 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * ffpeaks, waveform peak pyramid of ffmpeg.wasm.
+ *
+ * Audio is decoded once with the sample reader of ffsamples.c, level 0 holds
+ * the min / max of every samples_per_peak samples of each channel, and every
+ * next level merges factor peaks of the previous one, so an editor picks the
+ * level closest to its zoom without touching samples.
+ *
+ * usage: ffpeaks -i input [-spp samples_per_peak] [-levels levels]
+ *                [-factor factor] [-ac channels] [output]
+ *
+ * The pyramid is written to output, or sent to JS when there is none. All
+ * fields are little endian:
+ *
+ *   "FFPK" | version u32 | sample rate u32 | channels u32 |
+ *   samples per peak u32 | factor u32 | levels u32 | peaks u32 * levels |
+ *   levels, each: peaks * channels * (min s16, max s16)
+ *
+ * Peaks of a level are stored one after another, the channels of a peak
+ * are interleaved, and samples are scaled from [-1, 1] to [-32767, 32767].
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <emscripten.h>
+#ifdef __wasm_simd128__
+#include <wasm_simd128.h>
+#endif
+
+#include "cmdutils.h"
+#include "ffsamples.h"
+
+#include "libavformat/avio.h"
+#include "libavutil/common.h"
+#include "libavutil/intreadwrite.h"
+
+#define PEAKS_VERSION 1
+/* samples per channel decoded at once */
+#define CHUNK_SIZE    65536
+
+typedef struct PeakLevel {
+    int16_t *peaks;             /* nb_peaks * channels * 2 */
+    int nb_peaks;
+} PeakLevel;
+
+static const char *input_path;
+static const char *output_path;
+static int samples_per_peak, nb_levels, factor, channels;
+
+static SampleReader *reader;
+static PeakLevel *levels;
+static int nb_built;            /* levels holding peaks */
+static uint8_t *output;
+
+static void peaks_cleanup(int ret)
+{
+    sample_reader_close(reader);
+    reader = NULL;
+    for (int i = 0; i < nb_built; i++)
+        av_freep(&levels[i].peaks);
+    av_freep(&levels);
+    nb_built = 0;
+    av_freep(&output);
+}
+
+static void init_globals(void)
+{
+    input_path       = NULL;
+    output_path      = NULL;
+    samples_per_peak = 256;
+    nb_levels        = 8;
+    factor           = 2;
+    channels         = 0;
+}
+
+static void parse_args(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++) {
+        const char *opt = argv[i];
+
+        if (opt[0] != '-' || !opt[1]) {
+            output_path = opt;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            av_log(NULL, AV_LOG_FATAL, "Missing argument for option '%s'\n", opt);
+            exit_program(1);
+        }
+
+        if (!strcmp(opt, "-i"))
+            input_path = argv[++i];
+        else if (!strcmp(opt, "-spp"))
+            samples_per_peak = strtol(argv[++i], NULL, 10);
+        else if (!strcmp(opt, "-levels"))
+            nb_levels = strtol(argv[++i], NULL, 10);
+        else if (!strcmp(opt, "-factor"))
+            factor = strtol(argv[++i], NULL, 10);
+        else if (!strcmp(opt, "-ac"))
+            channels = strtol(argv[++i], NULL, 10);
+        else {
+            av_log(NULL, AV_LOG_FATAL, "Unrecognized option '%s'\n", opt);
+            exit_program(1);
+        }
+    }
+
+    if (!input_path) {
+        av_log(NULL, AV_LOG_FATAL, "usage: ffpeaks -i input [-spp samples_per_peak] "
+               "[-levels levels] [-factor factor] [-ac channels] [output]\n");
+        exit_program(1);
+    }
+    if (samples_per_peak <= 0 || nb_levels <= 0 || factor < 2 || channels < 0) {
+        av_log(NULL, AV_LOG_FATAL, "-spp and -levels must be positive, "
+               "-factor at least 2\n");
+        exit_program(1);
+    }
+}
+
+/* minmax extends *min and *max with n samples of src, it runs on every
+ * decoded sample so it uses 4 lanes of wasm SIMD when built with
+ * -msimd128 */
+static void minmax(const float *src, int n, float *min, float *max)
+{
+    float lo = *min, hi = *max;
+    int i = 0;
+
+#ifdef __wasm_simd128__
+    if (n >= 8) {
+        v128_t vlo0 = wasm_f32x4_splat(lo), vhi0 = wasm_f32x4_splat(hi);
+        v128_t vlo1 = vlo0, vhi1 = vhi0;
+
+        /* two accumulators to hide the latency of min / max */
+        for (; i + 8 <= n; i += 8) {
+            v128_t a = wasm_v128_load(src + i);
+            v128_t b = wasm_v128_load(src + i + 4);
+            vlo0 = wasm_f32x4_pmin(a, vlo0);
+            vhi0 = wasm_f32x4_pmax(a, vhi0);
+            vlo1 = wasm_f32x4_pmin(b, vlo1);
+            vhi1 = wasm_f32x4_pmax(b, vhi1);
+        }
+        vlo0 = wasm_f32x4_pmin(vlo0, vlo1);
+        vhi0 = wasm_f32x4_pmax(vhi0, vhi1);
+        lo = FFMIN(FFMIN(wasm_f32x4_extract_lane(vlo0, 0), wasm_f32x4_extract_lane(vlo0, 1)),
+                   FFMIN(wasm_f32x4_extract_lane(vlo0, 2), wasm_f32x4_extract_lane(vlo0, 3)));
+        hi = FFMAX(FFMAX(wasm_f32x4_extract_lane(vhi0, 0), wasm_f32x4_extract_lane(vhi0, 1)),
+                   FFMAX(wasm_f32x4_extract_lane(vhi0, 2), wasm_f32x4_extract_lane(vhi0, 3)));
+    }
+#endif
+    for (; i < n; i++) {
+        lo = FFMIN(lo, src[i]);
+        hi = FFMAX(hi, src[i]);
+    }
+    *min = lo;
+    *max = hi;
+}
+
+static int16_t to_s16(float v)
+{
+    return lrintf(av_clipf(v, -1.0f, 1.0f) * 32767);
+}
+
+static int add_peak(PeakLevel *level, const float *min, const float *max,
+                    int nb_channels)
+{
+    int16_t *peak = av_dynarray2_add((void **)&level->peaks, &level->nb_peaks,
+                                     nb_channels * 2 * sizeof(*peak), NULL);
+
+    if (!peak)
+        return AVERROR(ENOMEM);
+    for (int c = 0; c < nb_channels; c++) {
+        peak[2 * c]     = to_s16(min[c]);
+        peak[2 * c + 1] = to_s16(max[c]);
+    }
+    return 0;
+}
+
+/* build_base decodes the input into level 0 */
+static int build_base(int nb_channels)
+{
+    float *min = av_malloc_array(nb_channels, sizeof(*min));
+    float *max = av_malloc_array(nb_channels, sizeof(*max));
+    int pos = 0, ret = 0;       /* samples in the current peak */
+
+    if (!min || !max) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    for (;;) {
+        const float *data;
+        int count = sample_reader_read(reader);
+
+        if (count <= 0) {
+            ret = count;
+            break;
+        }
+        data = sample_reader_data(reader);
+
+        for (int offset = 0; offset < count;) {
+            int n = FFMIN(samples_per_peak - pos, count - offset);
+
+            if (!pos) {
+                for (int c = 0; c < nb_channels; c++) {
+                    min[c] = INFINITY;
+                    max[c] = -INFINITY;
+                }
+            }
+            for (int c = 0; c < nb_channels; c++)
+                minmax(data + (size_t)c * CHUNK_SIZE + offset, n, &min[c], &max[c]);
+            offset += n;
+            pos    += n;
+            if (pos == samples_per_peak) {
+                if ((ret = add_peak(&levels[0], min, max, nb_channels)) < 0)
+                    goto end;
+                pos = 0;
+            }
+        }
+    }
+    /* the last peak covers the remaining samples */
+    if (ret >= 0 && pos)
+        ret = add_peak(&levels[0], min, max, nb_channels);
+end:
+    av_free(min);
+    av_free(max);
+    return ret;
+}
+
+/* build_level merges factor peaks of the previous level */
+static int build_level(PeakLevel *dst, const PeakLevel *src, int nb_channels)
+{
+    int stride = nb_channels * 2;
+
+    dst->nb_peaks = (src->nb_peaks + factor - 1) / factor;
+    dst->peaks    = av_malloc_array(dst->nb_peaks, stride * sizeof(*dst->peaks));
+    if (!dst->peaks)
+        return AVERROR(ENOMEM);
+
+    for (int i = 0; i < dst->nb_peaks; i++) {
+        const int16_t *in = src->peaks + (size_t)i * factor * stride;
+        int16_t *out = dst->peaks + (size_t)i * stride;
+        int n = FFMIN(factor, src->nb_peaks - i * factor);
+
+        memcpy(out, in, stride * sizeof(*out));
+        for (int j = 1; j < n; j++) {
+            in += stride;
+            for (int c = 0; c < nb_channels; c++) {
+                out[2 * c]     = FFMIN(out[2 * c],     in[2 * c]);
+                out[2 * c + 1] = FFMAX(out[2 * c + 1], in[2 * c + 1]);
+            }
+        }
+    }
+    return 0;
+}
+
+EM_JS(void, send_peaks, (const uint8_t *data, int size), {
+    Module.receivePeaks(HEAPU8.slice(data, data + size));
+});
+
+static int write_pyramid(int sample_rate, int nb_channels)
+{
+    size_t size = 28 + 4 * nb_built;
+    AVIOContext *pb;
+    uint8_t *p;
+    int ret;
+
+    for (int i = 0; i < nb_built; i++)
+        size += (size_t)levels[i].nb_peaks * nb_channels * 2 * sizeof(int16_t);
+    if (size > INT_MAX)
+        return AVERROR(ERANGE);
+    output = p = av_malloc(size);
+    if (!output)
+        return AVERROR(ENOMEM);
+
+    memcpy(p, "FFPK", 4);
+    AV_WL32(p +  4, PEAKS_VERSION);
+    AV_WL32(p +  8, sample_rate);
+    AV_WL32(p + 12, nb_channels);
+    AV_WL32(p + 16, samples_per_peak);
+    AV_WL32(p + 20, factor);
+    AV_WL32(p + 24, nb_built);
+    p += 28;
+    for (int i = 0; i < nb_built; i++, p += 4)
+        AV_WL32(p, levels[i].nb_peaks);
+    for (int i = 0; i < nb_built; i++) {
+        size_t n = (size_t)levels[i].nb_peaks * nb_channels * 2;
+        for (size_t j = 0; j < n; j++, p += 2)
+            AV_WL16(p, levels[i].peaks[j]);
+    }
+
+    if (!output_path) {
+        send_peaks(output, size);
+        return 0;
+    }
+
+    ret = avio_open(&pb, output_path, AVIO_FLAG_WRITE);
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_FATAL, "%s: %s\n", output_path, av_err2str(ret));
+        return ret;
+    }
+    avio_write(pb, output, size);
+    return avio_closep(&pb);
+}
+
+static int build_pyramid(void)
+{
+    int sample_rate, nb_channels, ret;
+
+    reader = sample_reader_open(input_path, 0, channels, 1, CHUNK_SIZE);
+    if (!reader)
+        return AVERROR(EINVAL);
+    sample_rate = sample_reader_sample_rate(reader);
+    nb_channels = sample_reader_channels(reader);
+
+    levels = av_calloc(nb_levels, sizeof(*levels));
+    if (!levels)
+        return AVERROR(ENOMEM);
+    nb_built = 1;
+    ret = build_base(nb_channels);
+    if (ret < 0)
+        return ret;
+
+    /* levels stop once a single peak covers the input */
+    for (; nb_built < nb_levels && levels[nb_built - 1].nb_peaks > 1; nb_built++) {
+        ret = build_level(&levels[nb_built], &levels[nb_built - 1], nb_channels);
+        if (ret < 0)
+            return ret;
+    }
+
+    return write_pyramid(sample_rate, nb_channels);
+}
+
+int ffpeaks(int argc, char **argv)
+{
+    int ret;
+
+    init_globals();
+    register_exit(peaks_cleanup);
+    av_log_set_flags(AV_LOG_SKIP_REPEATED);
+
+    parse_args(argc, argv);
+
+    ret = build_pyramid();
+    if (ret < 0)
+        av_log(NULL, AV_LOG_ERROR, "ffpeaks failed: %s\n", av_err2str(ret));
+
+    exit_program(ret < 0);
+    return ret < 0;
+}
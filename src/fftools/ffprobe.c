@@ -28,6 +28,15 @@
 
 #include <string.h>
 
+#include <emscripten.h>
+
+/* ffprobe is linked in the same module as ffmpeg, which defines these
+ * symbols too. -h prints the help of ffmpeg as cmdutils calls its
+ * show_help_default(). */
+#define program_name       ffprobe_program_name
+#define program_birth_year ffprobe_program_birth_year
+#define show_help_default  ffprobe_show_help_default
+
 #include "libavformat/avformat.h"
 #include "libavformat/version.h"
 #include "libavcodec/avcodec.h"
@@ -148,6 +157,16 @@ static ReadInterval *read_intervals;
 static int read_intervals_nb = 0;
 
 static int find_stream_info  = 1;
+static int fast_probe = 0;
+
+/* probesize of -fast, enough to detect the format from its header */
+#define FAST_PROBESIZE 65536
+
+/* without -o, the output is kept here and handed to JS when ffprobe
+ * returns, rather than printed line by line */
+static AVBPrint probe_output;
+/* -v of ffprobe must not apply to the next ffmpeg() call */
+static int saved_log_level;
 
 /* section structure definition */
 
@@ -379,6 +398,11 @@ static void ffprobe_cleanup(int ret)
     for (i = 0; i < FF_ARRAY_ELEMS(sections); i++)
         av_dict_free(&(sections[i].entries_to_show));
 
+    av_bprint_finalize(&probe_output, NULL);
+    av_log_set_level(saved_log_level);
+    if (do_show_log)
+        av_log_set_callback(av_log_default_callback);
+
 #if HAVE_THREADS
     pthread_mutex_destroy(&log_mutex);
 #endif
@@ -596,25 +620,29 @@ static inline void writer_printf_avio(WriterContext *wctx, const char *fmt, ...)
     va_end(ap);
 }
 
-static inline void writer_w8_printf(WriterContext *wctx, int b)
+static inline void writer_w8_bprint(WriterContext *wctx, int b)
 {
-    printf("%c", b);
+    av_bprint_chars(&probe_output, b, 1);
 }
 
-static inline void writer_put_str_printf(WriterContext *wctx, const char *str)
+static inline void writer_put_str_bprint(WriterContext *wctx, const char *str)
 {
-    printf("%s", str);
+    av_bprint_append_data(&probe_output, str, strlen(str));
 }
 
-static inline void writer_printf_printf(WriterContext *wctx, const char *fmt, ...)
+static inline void writer_printf_bprint(WriterContext *wctx, const char *fmt, ...)
 {
     va_list ap;
 
     va_start(ap, fmt);
-    vprintf(fmt, ap);
+    av_vbprintf(&probe_output, fmt, ap);
     va_end(ap);
 }
 
+EM_JS(void, send_probe_output, (const char *output, int size), {
+    Module.receiveProbeOutput(UTF8ToString(output, size));
+});
+
 static int writer_open(WriterContext **wctx, const Writer *writer, const char *args,
                        const struct section *sections, int nb_sections, const char *output)
 {
@@ -688,9 +716,9 @@ static int writer_open(WriterContext **wctx, const Writer *writer, const char *a
     }
 
     if (!output_filename) {
-        (*wctx)->writer_w8 = writer_w8_printf;
-        (*wctx)->writer_put_str = writer_put_str_printf;
-        (*wctx)->writer_printf = writer_printf_printf;
+        (*wctx)->writer_w8 = writer_w8_bprint;
+        (*wctx)->writer_put_str = writer_put_str_bprint;
+        (*wctx)->writer_printf = writer_printf_bprint;
     } else {
         if ((ret = avio_open(&(*wctx)->avio, output, AVIO_FLAG_WRITE)) < 0) {
             av_log(*wctx, AV_LOG_ERROR,
@@ -4000,6 +4028,8 @@ static const OptionDef real_options[] = {
     { "print_filename", HAS_ARG, {.func_arg = opt_print_filename}, "override the printed input filename", "print_file"},
     { "find_stream_info", OPT_BOOL | OPT_INPUT | OPT_EXPERT, { &find_stream_info },
         "read and decode the streams to fill missing information with heuristics" },
+    { "fast", OPT_BOOL, { &fast_probe },
+      "only parse the headers of the input, no frame is read or decoded" },
     { NULL, },
 };
 
@@ -4020,6 +4050,66 @@ static inline int check_section_show_entries(int section_id)
             do_show_##varname = 1;                                      \
     } while (0)
 
+/* init_globals initializes global variables to enable multiple
+ * calls of ffprobe(), see the one of ffmpeg.c.
+ */
+static void init_globals(void)
+{
+    int i;
+
+    do_bitexact = 0;
+    do_count_frames = 0;
+    do_count_packets = 0;
+    do_read_frames  = 0;
+    do_read_packets = 0;
+    do_show_chapters = 0;
+    do_show_error   = 0;
+    do_show_format  = 0;
+    do_show_frames  = 0;
+    do_show_packets = 0;
+    do_show_programs = 0;
+    do_show_streams = 0;
+    do_show_stream_disposition = 0;
+    do_show_data    = 0;
+    do_show_program_version  = 0;
+    do_show_library_versions = 0;
+    do_show_pixel_formats = 0;
+    do_show_pixel_format_flags = 0;
+    do_show_pixel_format_components = 0;
+    do_show_log = 0;
+
+    do_show_chapter_tags = 0;
+    do_show_format_tags = 0;
+    do_show_frame_tags = 0;
+    do_show_program_tags = 0;
+    do_show_stream_tags = 0;
+    do_show_packet_tags = 0;
+
+    show_value_unit              = 0;
+    use_value_prefix             = 0;
+    use_byte_value_binary_prefix = 0;
+    use_value_sexagesimal_format = 0;
+    show_private_data            = 1;
+    show_optional_fields = SHOW_OPTIONAL_FIELDS_AUTO;
+
+    av_freep(&stream_specifier);
+    av_freep(&show_data_hash);
+    read_intervals_nb = 0;
+    find_stream_info  = 1;
+    fast_probe = 0;
+
+    input_filename = NULL;
+    print_input_filename = NULL;
+    iformat = NULL;
+    output_filename = NULL;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(sections); i++)
+        sections[i].show_all_entries = 0;
+
+    av_bprint_init(&probe_output, 0, AV_BPRINT_SIZE_UNLIMITED);
+    saved_log_level = av_log_get_level();
+}
+
 int ffprobe(int argc, char **argv)
 {
     const Writer *w;
@@ -4028,6 +4118,7 @@ int ffprobe(int argc, char **argv)
     char *w_name = NULL, *w_args = NULL;
     int ret, input_ret, i;
 
+    init_globals();
     init_dynload();
 
 #if HAVE_THREADS
@@ -4052,6 +4143,14 @@ int ffprobe(int argc, char **argv)
     if (do_show_log)
         av_log_set_callback(log_callback);
 
+    /* stop at the headers: formats are detected from their first bytes
+     * and no packet is read to fill missing stream parameters */
+    if (fast_probe) {
+        find_stream_info = 0;
+        if (!av_dict_get(format_opts, "probesize", NULL, 0))
+            av_dict_set_int(&format_opts, "probesize", FAST_PROBESIZE, 0);
+    }
+
     /* mark things to show, based on -show_entries */
     SET_DO_SHOW(CHAPTERS, chapters);
     SET_DO_SHOW(ERROR, error);
@@ -4160,6 +4259,9 @@ int ffprobe(int argc, char **argv)
         ret = FFMIN(ret, input_ret);
     }
 
+    if (av_bprint_is_complete(&probe_output))
+        send_probe_output(probe_output.str, probe_output.len);
+
 end:
     av_freep(&print_format);
     av_freep(&read_intervals);
@@ -4171,5 +4273,6 @@ end:
 
     avformat_network_deinit();
 
+    exit_program(ret < 0);
     return ret < 0;
 }
@@ -0,0 +1,301 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Sample reader of ffmpeg.wasm, decoded audio as float samples for JS
+ * without FS, the audio counterpart of the frame reader in ffframes.c.
+ *
+ * The best audio stream is decoded, resampled, remixed and converted to
+ * float by swresample in one pass, then cut in chunks of a fixed number of
+ * samples per channel. Every sample_reader_read() fills one chunk in a
+ * buffer of wasm memory reused by every call, interleaved or one plane per
+ * channel, where JS reads it through a Float32Array view. Chunks are
+ * returned as soon as enough samples are decoded, the input is never
+ * decoded ahead.
+ *
+ * As readers outlive a call, errors are returned instead of going through
+ * exit_program().
+ */
+
+#include "libavcodec/avcodec.h"
+#include "libavformat/avformat.h"
+#include "libavutil/audio_fifo.h"
+#include "libavutil/channel_layout.h"
+#include "libswresample/swresample.h"
+
+#include "ffsamples.h"
+
+struct SampleReader {
+    AVFormatContext *fmt_ctx;
+    AVCodecContext *dec_ctx;
+    SwrContext *swr_ctx;
+    AVAudioFifo *fifo;          /* resampled samples not returned yet */
+    AVPacket *pkt;
+    AVFrame *frame;
+    int audio_index;
+    int flushing;               /* the decoder was sent EOF */
+    int eof;                    /* swresample was flushed */
+    int64_t nb_samples;         /* samples per channel returned so far */
+
+    int sample_rate;
+    int channels;
+    enum AVSampleFormat format; /* AV_SAMPLE_FMT_FLT or AV_SAMPLE_FMT_FLTP */
+    int chunk;                  /* samples per channel of a chunk */
+    float *data;                /* a chunk, planes are chunk samples apart */
+    uint8_t **planes;           /* pointers into data, one per plane */
+    uint8_t **conv;             /* output of swresample */
+    int conv_size;              /* samples per channel of conv */
+    double time;                /* time of the first sample of data */
+};
+
+void sample_reader_close(SampleReader *r)
+{
+    if (!r)
+        return;
+    avformat_close_input(&r->fmt_ctx);
+    avcodec_free_context(&r->dec_ctx);
+    swr_free(&r->swr_ctx);
+    if (r->fifo)
+        av_audio_fifo_free(r->fifo);
+    av_packet_free(&r->pkt);
+    av_frame_free(&r->frame);
+    if (r->conv)
+        av_freep(&r->conv[0]);
+    av_free(r->conv);
+    av_free(r->planes);
+    av_free(r->data);
+    av_free(r);
+}
+
+static int open_decoder(SampleReader *r, const char *path)
+{
+    const AVCodec *dec;
+    AVStream *st;
+    int ret;
+
+    ret = avformat_open_input(&r->fmt_ctx, path, NULL, NULL);
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_ERROR, "%s: %s\n", path, av_err2str(ret));
+        return ret;
+    }
+    ret = avformat_find_stream_info(r->fmt_ctx, NULL);
+    if (ret < 0)
+        return ret;
+
+    ret = av_find_best_stream(r->fmt_ctx, AVMEDIA_TYPE_AUDIO, -1, -1, &dec, 0);
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_ERROR, "%s: no decodable audio stream\n", path);
+        return ret;
+    }
+    r->audio_index = ret;
+    for (int i = 0; i < r->fmt_ctx->nb_streams; i++)
+        if (i != r->audio_index)
+            r->fmt_ctx->streams[i]->discard = AVDISCARD_ALL;
+    st = r->fmt_ctx->streams[r->audio_index];
+
+    r->dec_ctx = avcodec_alloc_context3(dec);
+    if (!r->dec_ctx)
+        return AVERROR(ENOMEM);
+    ret = avcodec_parameters_to_context(r->dec_ctx, st->codecpar);
+    if (ret < 0)
+        return ret;
+    r->dec_ctx->pkt_timebase = st->time_base;
+    return avcodec_open2(r->dec_ctx, dec, NULL);
+}
+
+/* open_resampler converts the decoder output to float at sample_rate with
+ * channels, swresample mixes channels down or up with its default matrix */
+static int open_resampler(SampleReader *r, int sample_rate, int channels)
+{
+    AVChannelLayout in_layout = { 0 }, out_layout = { 0 };
+    int ret;
+
+    if (r->dec_ctx->ch_layout.order == AV_CHANNEL_ORDER_UNSPEC)
+        av_channel_layout_default(&in_layout, r->dec_ctx->ch_layout.nb_channels);
+    else if ((ret = av_channel_layout_copy(&in_layout, &r->dec_ctx->ch_layout)) < 0)
+        return ret;
+
+    if (channels > 0)
+        av_channel_layout_default(&out_layout, channels);
+    else if ((ret = av_channel_layout_copy(&out_layout, &in_layout)) < 0)
+        goto end;
+    r->channels    = out_layout.nb_channels;
+    r->sample_rate = sample_rate > 0 ? sample_rate : r->dec_ctx->sample_rate;
+
+    ret = swr_alloc_set_opts2(&r->swr_ctx, &out_layout, r->format, r->sample_rate,
+                              &in_layout, r->dec_ctx->sample_fmt,
+                              r->dec_ctx->sample_rate, 0, NULL);
+    if (ret >= 0)
+        ret = swr_init(r->swr_ctx);
+end:
+    av_channel_layout_uninit(&in_layout);
+    av_channel_layout_uninit(&out_layout);
+    return ret;
+}
+
+/**
+ * Open path and decode its best audio stream into float samples at
+ * sample_rate with channels, ex: 16000 and 1 for speech models. A
+ * sample_rate or channels <= 0 keeps the decoded one. Samples are
+ * interleaved, or one plane per channel when planar is set.
+ *
+ * @return the reader, NULL on error
+ */
+SampleReader *sample_reader_open(const char *path, int sample_rate, int channels,
+                                 int planar, int chunk)
+{
+    SampleReader *r = av_mallocz(sizeof(*r));
+    int nb_planes;
+
+    if (!r)
+        return NULL;
+    r->chunk  = FFMAX(chunk, 1);
+    r->format = planar ? AV_SAMPLE_FMT_FLTP : AV_SAMPLE_FMT_FLT;
+
+    if (open_decoder(r, path) < 0)
+        goto fail;
+    if (open_resampler(r, sample_rate, channels) < 0) {
+        av_log(NULL, AV_LOG_ERROR, "Cannot convert audio to %d Hz %d channels\n",
+               sample_rate, channels);
+        goto fail;
+    }
+
+    if (r->chunk > INT_MAX / sizeof(*r->data) / r->channels)
+        goto fail;
+    nb_planes = planar ? r->channels : 1;
+    r->data   = av_malloc_array((size_t)r->chunk * r->channels, sizeof(*r->data));
+    r->planes = av_calloc(nb_planes, sizeof(*r->planes));
+    r->conv   = av_calloc(nb_planes, sizeof(*r->conv));
+    r->fifo   = av_audio_fifo_alloc(r->format, r->channels, r->chunk);
+    r->pkt    = av_packet_alloc();
+    r->frame  = av_frame_alloc();
+    if (!r->data || !r->planes || !r->conv || !r->fifo || !r->pkt || !r->frame)
+        goto fail;
+    for (int i = 0; i < nb_planes; i++)
+        r->planes[i] = (uint8_t *)(r->data + (size_t)i * r->chunk);
+
+    return r;
+fail:
+    sample_reader_close(r);
+    return NULL;
+}
+
+/* send_packet feeds the decoder with the next packet of the audio stream,
+ * or with EOF at the end of the input */
+static int send_packet(SampleReader *r)
+{
+    int ret;
+
+    while ((ret = av_read_frame(r->fmt_ctx, r->pkt)) >= 0) {
+        if (r->pkt->stream_index == r->audio_index)
+            break;
+        av_packet_unref(r->pkt);
+    }
+    if (ret == AVERROR_EOF) {
+        r->flushing = 1;
+        return avcodec_send_packet(r->dec_ctx, NULL);
+    }
+    if (ret < 0)
+        return ret;
+
+    ret = avcodec_send_packet(r->dec_ctx, r->pkt);
+    av_packet_unref(r->pkt);
+    /* skip corrupt packets like ffmpeg does */
+    return ret == AVERROR_INVALIDDATA ? 0 : ret;
+}
+
+/* resample converts nb_samples of in, NULL to flush swresample, and queues
+ * the result in the fifo */
+static int resample(SampleReader *r, const uint8_t **in, int nb_samples)
+{
+    int size = swr_get_out_samples(r->swr_ctx, nb_samples);
+    int ret;
+
+    if (size < 0)
+        return size;
+    if (size > r->conv_size) {
+        av_freep(&r->conv[0]);
+        ret = av_samples_alloc(r->conv, NULL, r->channels, size, r->format, 0);
+        if (ret < 0)
+            return ret;
+        r->conv_size = size;
+    }
+
+    ret = swr_convert(r->swr_ctx, r->conv, r->conv_size, in, nb_samples);
+    if (ret <= 0)
+        return ret;
+    return av_audio_fifo_write(r->fifo, (void **)r->conv, ret);
+}
+
+/**
+ * Decode the next chunk into sample_reader_data(), overwriting the previous
+ * one. Chunks are full but the last one.
+ *
+ * @return the number of samples per channel, 0 at the end of the input or a
+ *         negative AVERROR
+ */
+int sample_reader_read(SampleReader *r)
+{
+    int ret;
+
+    while (av_audio_fifo_size(r->fifo) < r->chunk && !r->eof) {
+        ret = avcodec_receive_frame(r->dec_ctx, r->frame);
+        if (ret == AVERROR(EAGAIN) && !r->flushing) {
+            if ((ret = send_packet(r)) < 0)
+                return ret;
+            continue;
+        }
+        if (ret == AVERROR_EOF) {
+            r->eof = 1;
+            ret = resample(r, NULL, 0);
+        } else if (ret >= 0) {
+            ret = resample(r, (const uint8_t **)r->frame->extended_data,
+                           r->frame->nb_samples);
+            av_frame_unref(r->frame);
+        }
+        if (ret < 0)
+            return ret;
+    }
+
+    ret = av_audio_fifo_read(r->fifo, (void **)r->planes, r->chunk);
+    if (ret < 0)
+        return ret;
+    r->time        = (double)r->nb_samples / r->sample_rate;
+    r->nb_samples += ret;
+    return ret;
+}
+
+float *sample_reader_data(SampleReader *r)
+{
+    return r->data;
+}
+
+double sample_reader_time(SampleReader *r)
+{
+    return r->time;
+}
+
+int sample_reader_sample_rate(SampleReader *r)
+{
+    return r->sample_rate;
+}
+
+int sample_reader_channels(SampleReader *r)
+{
+    return r->channels;
+}
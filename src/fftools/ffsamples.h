@@ -0,0 +1,39 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef FFTOOLS_FFSAMPLES_H
+#define FFTOOLS_FFSAMPLES_H
+
+/*
+ * Sample reader, decoded audio as float samples, exported to JS and used by
+ * the tools analysing audio, see ffsamples.c.
+ */
+
+typedef struct SampleReader SampleReader;
+
+SampleReader *sample_reader_open(const char *path, int sample_rate, int channels,
+                                 int planar, int chunk);
+int           sample_reader_read(SampleReader *r);
+void          sample_reader_close(SampleReader *r);
+
+float *sample_reader_data(SampleReader *r);
+double sample_reader_time(SampleReader *r);
+int    sample_reader_sample_rate(SampleReader *r);
+int    sample_reader_channels(SampleReader *r);
+
+#endif /* FFTOOLS_FFSAMPLES_H */
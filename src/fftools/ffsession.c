@@ -0,0 +1,619 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Sessions of ffmpeg.wasm, an input kept open to serve the many small
+ * requests of an editing UI, like the frame under a playhead or the audio of
+ * a selection, without an ffmpeg() run for each of them.
+ *
+ * A session opens and probes its input once, with decoders of its best video
+ * and audio streams. session_frame() gives the frame shown at a time, and
+ * session_audio() the samples of a time range, converted into buffers of
+ * wasm memory reused by the next request of the same kind.
+ *
+ * Requests go on from where the previous one stopped when they can: a frame
+ * later in the same GOP, or audio right after the previous range, is
+ * decoded forward, and asking again for the current frame decodes nothing.
+ * Other requests seek the demuxer and flush the decoders. Packets of the
+ * stream not being decoded are dropped, so switching between frames and
+ * audio seeks too.
+ *
+ * As sessions outlive a call, errors are returned instead of going through
+ * exit_program().
+ */
+
+#include <math.h>
+
+#include "libavcodec/avcodec.h"
+#include "libavformat/avformat.h"
+#include "libavutil/audio_fifo.h"
+#include "libavutil/channel_layout.h"
+#include "libavutil/imgutils.h"
+#include "libavutil/pixdesc.h"
+#include "libswresample/swresample.h"
+#include "libswscale/swscale.h"
+
+/* seconds decoded forward instead of seeking, when the input has no index
+ * to tell whether a keyframe is in between */
+#define MAX_DECODE_AHEAD 1.0
+
+typedef struct SessionStream {
+    AVStream *st;
+    AVCodecContext *dec_ctx;
+    int index;                  /* -1 when the input has no such stream */
+    int64_t start;              /* start time of the stream */
+    int flushing;               /* the decoder was sent EOF */
+    int eof;                    /* the decoder returned EOF */
+} SessionStream;
+
+typedef struct Session {
+    AVFormatContext *fmt_ctx;
+    AVPacket *pkt;
+    AVFrame *frame;
+    SessionStream video;
+    SessionStream audio;
+    SessionStream *active;      /* the stream decoded since the last seek */
+
+    struct SwsContext *sws_ctx;
+    AVFrame *cur;               /* frame shown at the last requested time */
+    AVFrame *next;              /* frame decoded after cur */
+    int converted;              /* cur is in data */
+    int width, height;
+    enum AVPixelFormat format;
+    int frame_size;
+    uint8_t *data;              /* cur converted to format */
+    double frame_time;          /* time of data */
+
+    SwrContext *swr_ctx;
+    AVAudioFifo *fifo;          /* resampled samples not returned yet */
+    int64_t fifo_pos;           /* position of the first sample in fifo */
+    uint8_t *conv;              /* output of swresample */
+    int conv_size;              /* samples per channel of conv */
+    int sample_rate;
+    int channels;
+    float *samples;             /* interleaved samples of the last range */
+    int samples_size;           /* samples per channel of samples */
+    double samples_time;        /* time of the first sample of samples */
+} Session;
+
+void session_close(Session *s)
+{
+    if (!s)
+        return;
+    avformat_close_input(&s->fmt_ctx);
+    avcodec_free_context(&s->video.dec_ctx);
+    avcodec_free_context(&s->audio.dec_ctx);
+    sws_freeContext(s->sws_ctx);
+    swr_free(&s->swr_ctx);
+    if (s->fifo)
+        av_audio_fifo_free(s->fifo);
+    av_packet_free(&s->pkt);
+    av_frame_free(&s->frame);
+    av_frame_free(&s->cur);
+    av_frame_free(&s->next);
+    av_free(s->conv);
+    av_free(s->data);
+    av_free(s->samples);
+    av_free(s);
+}
+
+/* open_stream opens a decoder for the best stream of type, a missing or
+ * undecodable stream leaves ss->index at -1 */
+static int open_stream(Session *s, SessionStream *ss, enum AVMediaType type)
+{
+    const AVCodec *dec;
+    int ret;
+
+    ss->index = -1;
+    ret = av_find_best_stream(s->fmt_ctx, type, -1, -1, &dec, 0);
+    if (ret < 0)
+        return 0;
+    ss->st    = s->fmt_ctx->streams[ret];
+    ss->start = ss->st->start_time != AV_NOPTS_VALUE ? ss->st->start_time : 0;
+
+    ss->dec_ctx = avcodec_alloc_context3(dec);
+    if (!ss->dec_ctx)
+        return AVERROR(ENOMEM);
+    ret = avcodec_parameters_to_context(ss->dec_ctx, ss->st->codecpar);
+    if (ret < 0)
+        return ret;
+    ss->dec_ctx->pkt_timebase = ss->st->time_base;
+    ret = avcodec_open2(ss->dec_ctx, dec, NULL);
+    if (ret < 0)
+        return ret;
+    ss->index = ss->st->index;
+    return 0;
+}
+
+static int open_input(Session *s, const char *path)
+{
+    int ret;
+
+    ret = avformat_open_input(&s->fmt_ctx, path, NULL, NULL);
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_ERROR, "%s: %s\n", path, av_err2str(ret));
+        return ret;
+    }
+    ret = avformat_find_stream_info(s->fmt_ctx, NULL);
+    if (ret < 0)
+        return ret;
+
+    if ((ret = open_stream(s, &s->video, AVMEDIA_TYPE_VIDEO)) < 0 ||
+        (ret = open_stream(s, &s->audio, AVMEDIA_TYPE_AUDIO)) < 0)
+        return ret;
+    if (s->video.index < 0 && s->audio.index < 0) {
+        av_log(NULL, AV_LOG_ERROR, "%s: no decodable video or audio stream\n", path);
+        return AVERROR_STREAM_NOT_FOUND;
+    }
+    for (int i = 0; i < s->fmt_ctx->nb_streams; i++)
+        if (i != s->video.index && i != s->audio.index)
+            s->fmt_ctx->streams[i]->discard = AVDISCARD_ALL;
+    return 0;
+}
+
+/* set_size keeps the display aspect ratio when one dimension is missing */
+static void set_size(Session *s, int width, int height)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(s->format);
+    const AVCodecContext *dec_ctx = s->video.dec_ctx;
+    AVRational sar = dec_ctx->sample_aspect_ratio;
+
+    if (!sar.num || !sar.den)
+        sar = (AVRational){ 1, 1 };
+    if (width <= 0 && height <= 0) {
+        width  = dec_ctx->width;
+        height = dec_ctx->height;
+    } else if (width <= 0) {
+        width  = av_rescale(height, dec_ctx->width * (int64_t)sar.num,
+                            dec_ctx->height * (int64_t)sar.den);
+    } else if (height <= 0) {
+        height = av_rescale(width, dec_ctx->height * (int64_t)sar.den,
+                            dec_ctx->width * (int64_t)sar.num);
+    }
+    /* subsampled chroma planes need even dimensions */
+    s->width  = FFMAX(width  & ~((1 << desc->log2_chroma_w) - 1), 1 << desc->log2_chroma_w);
+    s->height = FFMAX(height & ~((1 << desc->log2_chroma_h) - 1), 1 << desc->log2_chroma_h);
+}
+
+static int open_video(Session *s, int width, int height, const char *pix_fmt)
+{
+    s->format = av_get_pix_fmt(pix_fmt);
+    if (s->format == AV_PIX_FMT_NONE ||
+        av_pix_fmt_desc_get(s->format)->flags & AV_PIX_FMT_FLAG_HWACCEL) {
+        av_log(NULL, AV_LOG_ERROR, "Invalid pixel format '%s'\n", pix_fmt);
+        return AVERROR(EINVAL);
+    }
+    set_size(s, width, height);
+
+    s->frame_size = av_image_get_buffer_size(s->format, s->width, s->height, 1);
+    if (s->frame_size < 0)
+        return s->frame_size;
+    s->data = av_malloc(s->frame_size);
+    s->cur  = av_frame_alloc();
+    s->next = av_frame_alloc();
+    if (!s->data || !s->cur || !s->next)
+        return AVERROR(ENOMEM);
+    return 0;
+}
+
+/* open_audio converts the decoder output to interleaved float at
+ * sample_rate with channels, swresample mixes channels down or up */
+static int open_audio(Session *s, int sample_rate, int channels)
+{
+    const AVCodecContext *dec_ctx = s->audio.dec_ctx;
+    AVChannelLayout in_layout = { 0 }, out_layout = { 0 };
+    int ret;
+
+    if (dec_ctx->ch_layout.order == AV_CHANNEL_ORDER_UNSPEC)
+        av_channel_layout_default(&in_layout, dec_ctx->ch_layout.nb_channels);
+    else if ((ret = av_channel_layout_copy(&in_layout, &dec_ctx->ch_layout)) < 0)
+        return ret;
+
+    if (channels > 0)
+        av_channel_layout_default(&out_layout, channels);
+    else if ((ret = av_channel_layout_copy(&out_layout, &in_layout)) < 0)
+        goto end;
+    s->channels    = out_layout.nb_channels;
+    s->sample_rate = sample_rate > 0 ? sample_rate : dec_ctx->sample_rate;
+
+    ret = swr_alloc_set_opts2(&s->swr_ctx, &out_layout, AV_SAMPLE_FMT_FLT,
+                              s->sample_rate, &in_layout, dec_ctx->sample_fmt,
+                              dec_ctx->sample_rate, 0, NULL);
+    if (ret >= 0)
+        ret = swr_init(s->swr_ctx);
+    if (ret >= 0) {
+        s->fifo = av_audio_fifo_alloc(AV_SAMPLE_FMT_FLT, s->channels, 1);
+        if (!s->fifo)
+            ret = AVERROR(ENOMEM);
+    }
+end:
+    av_channel_layout_uninit(&in_layout);
+    av_channel_layout_uninit(&out_layout);
+    return ret;
+}
+
+/**
+ * Open path and decode its best video stream into frames of pix_fmt scaled
+ * to width x height, and its best audio stream into float samples at
+ * sample_rate with channels, like frame_reader_open() and
+ * sample_reader_open() do. The input may have only one of them.
+ *
+ * @return the session, NULL on error
+ */
+Session *session_open(const char *path, int width, int height,
+                      const char *pix_fmt, int sample_rate, int channels)
+{
+    Session *s = av_mallocz(sizeof(*s));
+
+    if (!s)
+        return NULL;
+    s->fifo_pos = AV_NOPTS_VALUE;
+    s->pkt      = av_packet_alloc();
+    s->frame    = av_frame_alloc();
+    if (!s->pkt || !s->frame)
+        goto fail;
+
+    if (open_input(s, path) < 0)
+        goto fail;
+    if (s->video.index >= 0 && open_video(s, width, height, pix_fmt) < 0)
+        goto fail;
+    if (s->audio.index >= 0 && open_audio(s, sample_rate, channels) < 0) {
+        av_log(NULL, AV_LOG_ERROR, "Cannot convert audio to %d Hz %d channels\n",
+               sample_rate, channels);
+        goto fail;
+    }
+    return s;
+fail:
+    session_close(s);
+    return NULL;
+}
+
+static double stream_time(const SessionStream *ss, int64_t ts)
+{
+    return (ts - ss->start) * av_q2d(ss->st->time_base);
+}
+
+static int64_t stream_ts(const SessionStream *ss, double time)
+{
+    return llrint(time / av_q2d(ss->st->time_base)) + ss->start;
+}
+
+/* frame_ts orders frames without timestamp before any time */
+static int64_t frame_ts(const AVFrame *f)
+{
+    return f->best_effort_timestamp != AV_NOPTS_VALUE ?
+           f->best_effort_timestamp : INT64_MIN;
+}
+
+/* seek moves the demuxer to the keyframe of ss at or before time and drops
+ * everything decoded from the previous position */
+static int seek(Session *s, SessionStream *ss, double time)
+{
+    int64_t ts = stream_ts(ss, time);
+    int ret;
+
+    ret = avformat_seek_file(s->fmt_ctx, ss->index, INT64_MIN, ts, ts, 0);
+    if (ret < 0)
+        ret = avformat_seek_file(s->fmt_ctx, ss->index, INT64_MIN, ts, INT64_MAX, 0);
+    if (ret < 0)
+        return ret;
+
+    for (int i = 0; i < 2; i++) {
+        SessionStream *d = i ? &s->audio : &s->video;
+
+        if (d->index < 0)
+            continue;
+        avcodec_flush_buffers(d->dec_ctx);
+        d->flushing = d->eof = 0;
+    }
+    if (s->video.index >= 0) {
+        av_frame_unref(s->cur);
+        av_frame_unref(s->next);
+    }
+    if (s->audio.index >= 0) {
+        av_audio_fifo_reset(s->fifo);
+        s->fifo_pos = AV_NOPTS_VALUE;
+        /* drop the delay of the resampler */
+        if ((ret = swr_init(s->swr_ctx)) < 0)
+            return ret;
+    }
+    s->active = ss;
+    return 0;
+}
+
+/* decode_frame returns the next frame of ss, reading packets of ss only */
+static int decode_frame(Session *s, SessionStream *ss, AVFrame *frame)
+{
+    int ret;
+
+    while ((ret = avcodec_receive_frame(ss->dec_ctx, frame)) == AVERROR(EAGAIN) &&
+           !ss->flushing) {
+        while ((ret = av_read_frame(s->fmt_ctx, s->pkt)) >= 0 &&
+               s->pkt->stream_index != ss->index)
+            av_packet_unref(s->pkt);
+        if (ret == AVERROR_EOF) {
+            ss->flushing = 1;
+            ret = avcodec_send_packet(ss->dec_ctx, NULL);
+        } else if (ret >= 0) {
+            ret = avcodec_send_packet(ss->dec_ctx, s->pkt);
+            av_packet_unref(s->pkt);
+            /* skip corrupt packets like ffmpeg does */
+            if (ret == AVERROR_INVALIDDATA)
+                ret = 0;
+        }
+        if (ret < 0)
+            return ret;
+    }
+    if (ret == AVERROR_EOF)
+        ss->eof = 1;
+    return ret;
+}
+
+/* decode_ahead tells whether decoding from cur reaches ts faster than
+ * seeking, that is when no keyframe lies in between */
+static int decode_ahead(Session *s, int64_t ts)
+{
+    AVStream *st = s->video.st;
+    int64_t cur = frame_ts(s->cur);
+    const AVIndexEntry *e;
+    int i;
+
+    if (cur == INT64_MIN || ts < cur)
+        return 0;
+    i = av_index_search_timestamp(st, ts, AVSEEK_FLAG_BACKWARD);
+    if (i >= 0 && (e = avformat_index_get_entry(st, i)))
+        return e->timestamp <= cur;
+    return (ts - cur) * av_q2d(st->time_base) <= MAX_DECODE_AHEAD;
+}
+
+static int convert_frame(Session *s)
+{
+    AVFrame *f = s->cur;
+    uint8_t *dst_data[4];
+    int dst_linesize[4];
+    int ret;
+
+    ret = av_image_fill_arrays(dst_data, dst_linesize, s->data, s->format,
+                               s->width, s->height, 1);
+    if (ret < 0)
+        return ret;
+
+    if (f->width == s->width && f->height == s->height && f->format == s->format) {
+        av_image_copy(dst_data, dst_linesize, (const uint8_t **)f->data,
+                      f->linesize, s->format, s->width, s->height);
+        return 0;
+    }
+
+    s->sws_ctx = sws_getCachedContext(s->sws_ctx, f->width, f->height, f->format,
+                                      s->width, s->height, s->format,
+                                      SWS_BICUBIC, NULL, NULL, NULL);
+    if (!s->sws_ctx)
+        return AVERROR(EINVAL);
+    sws_scale(s->sws_ctx, (const uint8_t * const *)f->data, f->linesize,
+              0, f->height, dst_data, dst_linesize);
+    return 0;
+}
+
+/**
+ * Convert the frame shown at time in seconds into session_frame_data(), the
+ * last frame at or before time, the first frame of the stream before it and
+ * the last one after its end.
+ *
+ * @return the frame size, 0 when the stream has no frame or a negative
+ *         AVERROR
+ */
+int session_frame(Session *s, double time)
+{
+    SessionStream *vs = &s->video;
+    int64_t ts;
+    int ret;
+
+    if (vs->index < 0)
+        return AVERROR_STREAM_NOT_FOUND;
+    ts = stream_ts(vs, time);
+    if (s->active != vs || !decode_ahead(s, ts)) {
+        if ((ret = seek(s, vs, time)) < 0)
+            return ret;
+    }
+
+    /* cur is shown until the pts of next */
+    for (;;) {
+        if (!s->next->buf) {
+            ret = decode_frame(s, vs, s->next);
+            if (ret == AVERROR_EOF)
+                break;
+            if (ret < 0)
+                return ret;
+        }
+        if (s->cur->buf && frame_ts(s->next) > ts)
+            break;
+        av_frame_unref(s->cur);
+        av_frame_move_ref(s->cur, s->next);
+        s->converted = 0;
+    }
+    if (!s->cur->buf)
+        return 0;
+
+    if (!s->converted) {
+        if ((ret = convert_frame(s)) < 0)
+            return ret;
+        s->converted  = 1;
+        s->frame_time = s->cur->best_effort_timestamp != AV_NOPTS_VALUE ?
+                        stream_time(vs, s->cur->best_effort_timestamp) : NAN;
+    }
+    return s->frame_size;
+}
+
+/* resample converts nb_samples of in, NULL to flush swresample, and queues
+ * the result in the fifo */
+static int resample(Session *s, const uint8_t **in, int nb_samples)
+{
+    int size = swr_get_out_samples(s->swr_ctx, nb_samples);
+    int ret;
+
+    if (size < 0)
+        return size;
+    if (size > s->conv_size) {
+        av_freep(&s->conv);
+        ret = av_samples_alloc(&s->conv, NULL, s->channels, size,
+                               AV_SAMPLE_FMT_FLT, 0);
+        if (ret < 0)
+            return ret;
+        s->conv_size = size;
+    }
+
+    ret = swr_convert(s->swr_ctx, &s->conv, s->conv_size, in, nb_samples);
+    if (ret <= 0)
+        return ret;
+    return av_audio_fifo_write(s->fifo, (void **)&s->conv, ret);
+}
+
+/* decode_samples decodes a frame into the fifo, the first one after a seek
+ * gives the position of the fifo, pos when it has no timestamp */
+static int decode_samples(Session *s, int64_t pos)
+{
+    SessionStream *as = &s->audio;
+    int64_t pts;
+    int ret;
+
+    ret = decode_frame(s, as, s->frame);
+    if (ret == AVERROR_EOF)
+        return resample(s, NULL, 0);
+    if (ret < 0)
+        return ret;
+
+    pts = s->frame->best_effort_timestamp;
+    if (s->fifo_pos == AV_NOPTS_VALUE)
+        s->fifo_pos = pts != AV_NOPTS_VALUE ?
+                      llrint(stream_time(as, pts) * s->sample_rate) : pos;
+    ret = resample(s, (const uint8_t **)s->frame->extended_data,
+                   s->frame->nb_samples);
+    av_frame_unref(s->frame);
+    return ret;
+}
+
+/**
+ * Decode duration seconds of audio from start into session_audio_data(),
+ * overwriting the previous range.
+ *
+ * @return the number of samples per channel, less than requested at the end
+ *         of the input, or a negative AVERROR
+ */
+int session_audio(Session *s, double start, double duration)
+{
+    SessionStream *as = &s->audio;
+    int64_t pos = llrint(start * s->sample_rate);
+    int64_t count = llrint(duration * s->sample_rate);
+    int ret;
+
+    if (as->index < 0)
+        return AVERROR_STREAM_NOT_FOUND;
+    if (count <= 0)
+        return 0;
+    if (count > INT_MAX / sizeof(*s->samples) / s->channels)
+        return AVERROR(EINVAL);
+    if (count > s->samples_size) {
+        av_freep(&s->samples);
+        s->samples = av_malloc_array(count * s->channels, sizeof(*s->samples));
+        if (!s->samples) {
+            s->samples_size = 0;
+            return AVERROR(ENOMEM);
+        }
+        s->samples_size = count;
+    }
+
+    /* a range right after the previous one, or a bit later, goes on */
+    if (s->active != as || s->fifo_pos == AV_NOPTS_VALUE || pos < s->fifo_pos ||
+        pos - s->fifo_pos > MAX_DECODE_AHEAD * s->sample_rate) {
+        if ((ret = seek(s, as, start)) < 0)
+            return ret;
+    }
+
+    for (;;) {
+        /* drop the samples before start */
+        if (s->fifo_pos != AV_NOPTS_VALUE && s->fifo_pos < pos) {
+            int drop = FFMIN(av_audio_fifo_size(s->fifo), pos - s->fifo_pos);
+            av_audio_fifo_drain(s->fifo, drop);
+            s->fifo_pos += drop;
+        }
+        if (as->eof || (s->fifo_pos != AV_NOPTS_VALUE &&
+                        s->fifo_pos + av_audio_fifo_size(s->fifo) >= pos + count))
+            break;
+        if ((ret = decode_samples(s, pos)) < 0)
+            return ret;
+    }
+
+    if (s->fifo_pos == AV_NOPTS_VALUE)
+        s->fifo_pos = pos;
+    s->samples_time = (double)s->fifo_pos / s->sample_rate;
+    ret = av_audio_fifo_read(s->fifo, (void **)&s->samples, count);
+    if (ret > 0)
+        s->fifo_pos += ret;
+    return ret;
+}
+
+uint8_t *session_frame_data(Session *s)
+{
+    return s->data;
+}
+
+double session_frame_time(Session *s)
+{
+    return s->frame_time;
+}
+
+int session_width(Session *s)
+{
+    return s->width;
+}
+
+int session_height(Session *s)
+{
+    return s->height;
+}
+
+int session_frame_size(Session *s)
+{
+    return s->frame_size;
+}
+
+float *session_audio_data(Session *s)
+{
+    return s->samples;
+}
+
+double session_audio_time(Session *s)
+{
+    return s->samples_time;
+}
+
+int session_sample_rate(Session *s)
+{
+    return s->sample_rate;
+}
+
+int session_channels(Session *s)
+{
+    return s->channels;
+}
+
+double session_duration(Session *s)
+{
+    return s->fmt_ctx->duration != AV_NOPTS_VALUE ?
+           s->fmt_ctx->duration / (double)AV_TIME_BASE : NAN;
+}
@@ -0,0 +1,554 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * ffthumb, batch thumbnail extraction of ffmpeg.wasm.
+ *
+ * All positions are served by one demuxer and one decoder: for every position
+ * the demuxer seeks to the keyframe before it, only that keyframe is decoded
+ * and scaled once, then written as an image of its own or as a tile of a
+ * sprite sheet indexed by a WebVTT file. Positions sharing a keyframe reuse
+ * the image of the first one.
+ *
+ * usage: ffthumb -i input -t 1,5.5,00:01:10 [-w width] [-h height] [-q quality]
+ *                [-sprite columns -vtt index.vtt] output
+ *
+ * output is an image path whose encoder is guessed from its extension, it
+ * must contain %d when several images are written, ex: thumb_%03d.jpg.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cmdutils.h"
+
+#include "libavcodec/avcodec.h"
+#include "libavformat/avformat.h"
+#include "libavutil/avstring.h"
+#include "libavutil/bprint.h"
+#include "libavutil/imgutils.h"
+#include "libavutil/parseutils.h"
+#include "libavutil/pixdesc.h"
+#include "libswscale/swscale.h"
+
+/* width of thumbnails when neither -w nor -h is set */
+#define DEFAULT_WIDTH 160
+
+typedef struct Thumb {
+    int64_t time;               /* requested position in AV_TIME_BASE */
+    int index;                  /* position in the -t list */
+} Thumb;
+
+static const char *input_path;
+static const char *output_path;
+static const char *vtt_path;
+static int width, height, quality, columns;
+
+static Thumb *thumbs;
+static int nb_thumbs;
+
+static AVFormatContext *ifmt_ctx;
+static AVCodecContext *dec_ctx;
+static AVCodecContext *enc_ctx;
+static struct SwsContext *sws_ctx;
+static AVPacket *pkt;
+static AVFrame *frame;          /* decoded keyframe */
+static AVFrame *thumb;          /* scaled keyframe */
+static AVFrame *sprite;
+static int video_index;
+static int64_t last_key_pts;    /* keyframe currently scaled in thumb */
+
+static void thumb_cleanup(int ret)
+{
+    avformat_close_input(&ifmt_ctx);
+    avcodec_free_context(&dec_ctx);
+    avcodec_free_context(&enc_ctx);
+    sws_freeContext(sws_ctx);
+    sws_ctx = NULL;
+    av_packet_free(&pkt);
+    av_frame_free(&frame);
+    av_frame_free(&thumb);
+    av_frame_free(&sprite);
+    av_freep(&thumbs);
+    nb_thumbs = 0;
+}
+
+static void init_globals(void)
+{
+    input_path  = NULL;
+    output_path = NULL;
+    vtt_path    = NULL;
+    width       = -1;
+    height      = -1;
+    quality     = -1;
+    columns     = 0;
+    video_index = -1;
+    last_key_pts = AV_NOPTS_VALUE;
+}
+
+static int parse_times(const char *arg)
+{
+    char *list = av_strdup(arg), *ptr = list, *token;
+    int ret = 0;
+
+    if (!list)
+        return AVERROR(ENOMEM);
+
+    while ((token = av_strtok(ptr, ",", &ptr))) {
+        Thumb *t = av_dynarray2_add((void **)&thumbs, &nb_thumbs, sizeof(*thumbs), NULL);
+        if (!t) {
+            ret = AVERROR(ENOMEM);
+            break;
+        }
+        t->index = nb_thumbs - 1;
+        ret = av_parse_time(&t->time, token, 1);
+        if (ret < 0 || t->time < 0) {
+            av_log(NULL, AV_LOG_FATAL, "Invalid position '%s'\n", token);
+            ret = AVERROR(EINVAL);
+            break;
+        }
+    }
+
+    av_free(list);
+    return ret;
+}
+
+static void parse_args(int argc, char **argv)
+{
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        const char *opt = argv[i];
+
+        if (opt[0] != '-' || !opt[1]) {
+            output_path = opt;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            av_log(NULL, AV_LOG_FATAL, "Missing argument for option '%s'\n", opt);
+            exit_program(1);
+        }
+
+        if (!strcmp(opt, "-i"))
+            input_path = argv[++i];
+        else if (!strcmp(opt, "-t")) {
+            if (parse_times(argv[++i]) < 0)
+                exit_program(1);
+        } else if (!strcmp(opt, "-w"))
+            width = strtol(argv[++i], NULL, 10);
+        else if (!strcmp(opt, "-h"))
+            height = strtol(argv[++i], NULL, 10);
+        else if (!strcmp(opt, "-q"))
+            quality = strtol(argv[++i], NULL, 10);
+        else if (!strcmp(opt, "-sprite"))
+            columns = strtol(argv[++i], NULL, 10);
+        else if (!strcmp(opt, "-vtt"))
+            vtt_path = argv[++i];
+        else {
+            av_log(NULL, AV_LOG_FATAL, "Unrecognized option '%s'\n", opt);
+            exit_program(1);
+        }
+    }
+
+    if (!input_path || !output_path || !nb_thumbs) {
+        av_log(NULL, AV_LOG_FATAL, "usage: ffthumb -i input -t positions "
+               "[-w width] [-h height] [-q quality] "
+               "[-sprite columns -vtt index.vtt] output\n");
+        exit_program(1);
+    }
+    if (columns < 0 || (vtt_path && !columns)) {
+        av_log(NULL, AV_LOG_FATAL, "-vtt requires -sprite with a positive "
+               "number of columns\n");
+        exit_program(1);
+    }
+}
+
+static int open_input(void)
+{
+    const AVCodec *dec;
+    AVStream *st;
+    int ret;
+
+    ret = avformat_open_input(&ifmt_ctx, input_path, NULL, NULL);
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_FATAL, "%s: %s\n", input_path, av_err2str(ret));
+        return ret;
+    }
+    ret = avformat_find_stream_info(ifmt_ctx, NULL);
+    if (ret < 0)
+        return ret;
+
+    ret = av_find_best_stream(ifmt_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, &dec, 0);
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_FATAL, "%s: no decodable video stream\n", input_path);
+        return ret;
+    }
+    video_index = ret;
+    st = ifmt_ctx->streams[video_index];
+
+    /* only packets of the video stream are needed, and only keyframes are
+     * decoded */
+    for (int i = 0; i < ifmt_ctx->nb_streams; i++)
+        ifmt_ctx->streams[i]->discard = i == video_index ? AVDISCARD_NONKEY :
+                                                           AVDISCARD_ALL;
+
+    dec_ctx = avcodec_alloc_context3(dec);
+    if (!dec_ctx)
+        return AVERROR(ENOMEM);
+    ret = avcodec_parameters_to_context(dec_ctx, st->codecpar);
+    if (ret < 0)
+        return ret;
+    dec_ctx->pkt_timebase = st->time_base;
+    dec_ctx->skip_frame   = AVDISCARD_NONKEY;
+    /* a single frame is decoded per position, frame threads only add delay */
+    dec_ctx->thread_type  = FF_THREAD_SLICE;
+
+    return avcodec_open2(dec_ctx, dec, NULL);
+}
+
+static int open_encoder(void)
+{
+    const AVOutputFormat *ofmt = av_guess_format(NULL, output_path, NULL);
+    enum AVCodecID id = ofmt ? av_guess_codec(ofmt, NULL, output_path, NULL,
+                                              AVMEDIA_TYPE_VIDEO) : AV_CODEC_ID_NONE;
+    const AVCodec *enc = avcodec_find_encoder(id);
+    AVRational sar = dec_ctx->sample_aspect_ratio;
+    ptrdiff_t linesize[4];
+    int ret;
+
+    if (!enc || !enc->pix_fmts) {
+        av_log(NULL, AV_LOG_FATAL, "%s: no image encoder for this extension\n",
+               output_path);
+        return AVERROR_ENCODER_NOT_FOUND;
+    }
+
+    /* keep the display aspect ratio when one dimension is missing */
+    if (!sar.num || !sar.den)
+        sar = (AVRational){ 1, 1 };
+    if (width <= 0 && height <= 0)
+        width = DEFAULT_WIDTH;
+    if (width <= 0)
+        width = av_rescale(height, dec_ctx->width * (int64_t)sar.num,
+                           dec_ctx->height * (int64_t)sar.den);
+    if (height <= 0)
+        height = av_rescale(width, dec_ctx->height * (int64_t)sar.den,
+                            dec_ctx->width * (int64_t)sar.num);
+    width  = FFMAX(width  & ~1, 2);
+    height = FFMAX(height & ~1, 2);
+
+    enc_ctx = avcodec_alloc_context3(enc);
+    if (!enc_ctx)
+        return AVERROR(ENOMEM);
+    enc_ctx->pix_fmt   = enc->pix_fmts[0];
+    enc_ctx->time_base = (AVRational){ 1, 1 };
+    if (id == AV_CODEC_ID_MJPEG)
+        enc_ctx->color_range = AVCOL_RANGE_JPEG;
+    enc_ctx->sample_aspect_ratio = (AVRational){ 1, 1 };
+    if (columns) {
+        enc_ctx->width  = width  * FFMIN(columns, nb_thumbs);
+        enc_ctx->height = height * ((nb_thumbs + columns - 1) / columns);
+    } else {
+        enc_ctx->width  = width;
+        enc_ctx->height = height;
+    }
+    if (quality >= 0) {
+        enc_ctx->flags |= AV_CODEC_FLAG_QSCALE;
+        enc_ctx->global_quality = FF_QP2LAMBDA * quality;
+    }
+    ret = avcodec_open2(enc_ctx, enc, NULL);
+    if (ret < 0)
+        return ret;
+
+    thumb = av_frame_alloc();
+    if (!thumb)
+        return AVERROR(ENOMEM);
+    thumb->format = enc_ctx->pix_fmt;
+    thumb->width  = width;
+    thumb->height = height;
+    ret = av_frame_get_buffer(thumb, 0);
+    if (ret < 0 || !columns)
+        return ret;
+
+    sprite = av_frame_alloc();
+    if (!sprite)
+        return AVERROR(ENOMEM);
+    sprite->format = enc_ctx->pix_fmt;
+    sprite->width  = enc_ctx->width;
+    sprite->height = enc_ctx->height;
+    ret = av_frame_get_buffer(sprite, 0);
+    if (ret < 0)
+        return ret;
+    /* tiles left empty in the last row are black */
+    for (int i = 0; i < 4; i++)
+        linesize[i] = sprite->linesize[i];
+    return av_image_fill_black(sprite->data, linesize, sprite->format,
+                               enc_ctx->color_range, sprite->width,
+                               sprite->height);
+}
+
+/* decode_keyframe decodes the keyframe before time into frame, returns 1
+ * when it is the keyframe already scaled in thumb */
+static int decode_keyframe(int64_t time)
+{
+    AVStream *st = ifmt_ctx->streams[video_index];
+    int64_t ts = av_rescale_q(time, AV_TIME_BASE_Q, st->time_base);
+    int ret;
+
+    if (st->start_time != AV_NOPTS_VALUE)
+        ts += st->start_time;
+
+    ret = avformat_seek_file(ifmt_ctx, video_index, INT64_MIN, ts, ts, 0);
+    /* before the first keyframe */
+    if (ret < 0)
+        ret = avformat_seek_file(ifmt_ctx, video_index, INT64_MIN, ts, INT64_MAX, 0);
+    if (ret < 0)
+        return ret;
+
+    while ((ret = av_read_frame(ifmt_ctx, pkt)) >= 0) {
+        int64_t key_pts = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+
+        if (pkt->stream_index != video_index || !(pkt->flags & AV_PKT_FLAG_KEY)) {
+            av_packet_unref(pkt);
+            continue;
+        }
+        if (key_pts != AV_NOPTS_VALUE && key_pts == last_key_pts) {
+            av_packet_unref(pkt);
+            return 1;
+        }
+
+        /* drain right away, so decoders with reordering delay output the
+         * keyframe without the frames following it */
+        ret = avcodec_send_packet(dec_ctx, pkt);
+        av_packet_unref(pkt);
+        if (ret >= 0)
+            ret = avcodec_send_packet(dec_ctx, NULL);
+        if (ret >= 0)
+            ret = avcodec_receive_frame(dec_ctx, frame);
+        avcodec_flush_buffers(dec_ctx);
+
+        if (ret >= 0) {
+            last_key_pts = key_pts;
+            return 0;
+        }
+        /* the keyframe could not be decoded on its own, try the next one */
+        if (ret != AVERROR_EOF && ret != AVERROR_INVALIDDATA)
+            return ret;
+    }
+
+    return ret;
+}
+
+static int scale_frame(void)
+{
+    int ret;
+
+    sws_ctx = sws_getCachedContext(sws_ctx, frame->width, frame->height,
+                                   frame->format, width, height, thumb->format,
+                                   SWS_BICUBIC, NULL, NULL, NULL);
+    if (!sws_ctx)
+        return AVERROR(EINVAL);
+
+    ret = av_frame_make_writable(thumb);
+    if (ret < 0)
+        return ret;
+    sws_scale(sws_ctx, (const uint8_t * const *)frame->data, frame->linesize,
+              0, frame->height, thumb->data, thumb->linesize);
+    av_frame_unref(frame);
+    return 0;
+}
+
+static void copy_tile(int index)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(thumb->format);
+    int x = index % columns * width, y = index / columns * height;
+    uint8_t *data[4] = { NULL };
+    int max_step[4];
+
+    av_image_fill_max_pixsteps(max_step, NULL, desc);
+    for (int i = 0; i < 4 && sprite->data[i]; i++) {
+        int chroma = i == 1 || i == 2;
+        data[i] = sprite->data[i] +
+                  (y >> (chroma ? desc->log2_chroma_h : 0)) * sprite->linesize[i] +
+                  (x >> (chroma ? desc->log2_chroma_w : 0)) * max_step[i];
+    }
+    av_image_copy(data, sprite->linesize, (const uint8_t **)thumb->data,
+                  thumb->linesize, thumb->format, width, height);
+}
+
+static int write_image(AVFrame *img, const char *path)
+{
+    FILE *f;
+    int ret;
+
+    img->quality = enc_ctx->global_quality;
+    ret = avcodec_send_frame(enc_ctx, img);
+    if (ret >= 0)
+        ret = avcodec_receive_packet(enc_ctx, pkt);
+    if (ret < 0)
+        return ret;
+
+    f = fopen(path, "wb");
+    if (!f) {
+        ret = AVERROR(errno);
+        av_log(NULL, AV_LOG_FATAL, "%s: %s\n", path, av_err2str(ret));
+    } else {
+        if (fwrite(pkt->data, 1, pkt->size, f) != pkt->size)
+            ret = AVERROR(EIO);
+        if (fclose(f) && ret >= 0)
+            ret = AVERROR(errno);
+    }
+    av_packet_unref(pkt);
+    return ret;
+}
+
+static void print_vtt_time(AVBPrint *bp, int64_t t)
+{
+    t /= 1000;
+    av_bprintf(bp, "%02d:%02d:%02d.%03d", (int)(t / 3600000),
+               (int)(t / 60000 % 60), (int)(t / 1000 % 60), (int)(t % 1000));
+}
+
+/* write_vtt indexes the tiles of the sprite sheet, thumbs are sorted by time,
+ * every tile covers the time up to the next position */
+static int write_vtt(void)
+{
+    const char *name = av_basename(output_path);
+    AVBPrint bp;
+    FILE *f;
+    int ret = 0;
+
+    av_bprint_init(&bp, 0, AV_BPRINT_SIZE_UNLIMITED);
+    av_bprintf(&bp, "WEBVTT\n");
+    for (int i = 0; i < nb_thumbs; i++) {
+        const Thumb *t = &thumbs[i];
+        int64_t end = i + 1 < nb_thumbs ? thumbs[i + 1].time :
+                      ifmt_ctx->duration > t->time ? ifmt_ctx->duration :
+                      t->time + AV_TIME_BASE;
+
+        if (end <= t->time)
+            continue;
+        av_bprintf(&bp, "\n");
+        print_vtt_time(&bp, t->time);
+        av_bprintf(&bp, " --> ");
+        print_vtt_time(&bp, end);
+        av_bprintf(&bp, "\n%s#xywh=%d,%d,%d,%d\n", name,
+                   t->index % columns * width, t->index / columns * height,
+                   width, height);
+    }
+    if (!av_bprint_is_complete(&bp)) {
+        av_bprint_finalize(&bp, NULL);
+        return AVERROR(ENOMEM);
+    }
+
+    f = fopen(vtt_path, "w");
+    if (!f) {
+        ret = AVERROR(errno);
+        av_log(NULL, AV_LOG_FATAL, "%s: %s\n", vtt_path, av_err2str(ret));
+    } else {
+        if (fwrite(bp.str, 1, bp.len, f) != bp.len)
+            ret = AVERROR(EIO);
+        if (fclose(f) && ret >= 0)
+            ret = AVERROR(errno);
+    }
+    av_bprint_finalize(&bp, NULL);
+    return ret;
+}
+
+static int cmp_thumb(const void *a, const void *b)
+{
+    const Thumb *ta = a, *tb = b;
+    return FFDIFFSIGN(ta->time, tb->time);
+}
+
+static int extract(void)
+{
+    char path[1024];
+    int ret;
+
+    pkt   = av_packet_alloc();
+    frame = av_frame_alloc();
+    if (!pkt || !frame)
+        return AVERROR(ENOMEM);
+
+    if ((ret = open_input()) < 0 || (ret = open_encoder()) < 0)
+        return ret;
+
+    /* seek forward only as far as possible */
+    qsort(thumbs, nb_thumbs, sizeof(*thumbs), cmp_thumb);
+
+    for (int i = 0; i < nb_thumbs; i++) {
+        const Thumb *t = &thumbs[i];
+
+        ret = decode_keyframe(t->time);
+        if (ret == 0)
+            ret = scale_frame();
+        if (ret < 0) {
+            av_log(NULL, AV_LOG_FATAL, "Error extracting thumbnail at %f: %s\n",
+                   t->time / (double)AV_TIME_BASE, av_err2str(ret));
+            return ret;
+        }
+
+        if (columns) {
+            copy_tile(t->index);
+            continue;
+        }
+
+        if (av_get_frame_filename2(path, sizeof(path), output_path,
+                                   t->index, 0) < 0) {
+            if (nb_thumbs > 1) {
+                av_log(NULL, AV_LOG_FATAL, "%s: the output path must contain "
+                       "%%d to write several thumbnails\n", output_path);
+                return AVERROR(EINVAL);
+            }
+            av_strlcpy(path, output_path, sizeof(path));
+        }
+        ret = write_image(thumb, path);
+        if (ret < 0)
+            return ret;
+    }
+
+    if (!columns)
+        return 0;
+    ret = write_image(sprite, output_path);
+    if (ret >= 0 && vtt_path)
+        ret = write_vtt();
+    return ret;
+}
+
+/* ffthumb() is exported next to ffmpeg() and follows the same convention,
+ * it returns through exit_program() which sets Module.ret.
+ */
+int ffthumb(int argc, char **argv)
+{
+    int ret;
+
+    init_globals();
+    register_exit(thumb_cleanup);
+    av_log_set_flags(AV_LOG_SKIP_REPEATED);
+
+    parse_args(argc, argv);
+
+    ret = extract();
+    if (ret < 0)
+        av_log(NULL, AV_LOG_ERROR, "ffthumb failed: %s\n", av_err2str(ret));
+
+    exit_program(ret < 0);
+    return ret < 0;
+}
@@ -0,0 +1,223 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdint.h>
+
+#include "config.h"
+
+#include "libavcodec/packet.h"
+
+#include "libavutil/buffer.h"
+#include "libavutil/common.h"
+#include "libavutil/error.h"
+#include "libavutil/frame.h"
+#include "libavutil/mem.h"
+#include "libavutil/thread.h"
+
+#include "objpool.h"
+
+/* The pool grows to the most objects in flight at once, ex: up to
+ * READ_AHEAD_MAX_PACKETS packets per input queued by the read-ahead threads,
+ * so that none of them falls back to the allocator once it is warm. */
+struct ObjPool {
+    void        **pool;
+    unsigned int pool_count;
+    unsigned int pool_size;
+
+    ObjPoolCBAlloc alloc;
+    ObjPoolCBReset reset;
+    ObjPoolCBFree  free;
+
+    AVMutex lock;
+};
+
+ObjPool *objpool_alloc(ObjPoolCBAlloc cb_alloc, ObjPoolCBReset cb_reset,
+                       ObjPoolCBFree cb_free)
+{
+    ObjPool *op = av_mallocz(sizeof(*op));
+
+    if (!op)
+        return NULL;
+
+    op->alloc = cb_alloc;
+    op->reset = cb_reset;
+    op->free  = cb_free;
+
+    if (ff_mutex_init(&op->lock, NULL)) {
+        av_freep(&op);
+        return NULL;
+    }
+
+    return op;
+}
+
+void objpool_free(ObjPool **pop)
+{
+    ObjPool *op = *pop;
+
+    if (!op)
+        return;
+
+    for (unsigned int i = 0; i < op->pool_count; i++)
+        op->free(&op->pool[i]);
+    av_freep(&op->pool);
+
+    ff_mutex_destroy(&op->lock);
+    av_freep(pop);
+}
+
+int objpool_get(ObjPool *op, void **obj)
+{
+    ff_mutex_lock(&op->lock);
+    *obj = op->pool_count ? op->pool[--op->pool_count] : NULL;
+    ff_mutex_unlock(&op->lock);
+
+    if (!*obj)
+        *obj = op->alloc();
+
+    return *obj ? 0 : AVERROR(ENOMEM);
+}
+
+void objpool_release(ObjPool *op, void **obj)
+{
+    void **pool;
+
+    if (!*obj)
+        return;
+
+    op->reset(*obj);
+
+    ff_mutex_lock(&op->lock);
+    pool = av_fast_realloc(op->pool, &op->pool_size,
+                           (op->pool_count + 1) * sizeof(*op->pool));
+    if (pool) {
+        op->pool = pool;
+        op->pool[op->pool_count++] = *obj;
+        *obj = NULL;
+    }
+    ff_mutex_unlock(&op->lock);
+
+    /* no memory left to keep it */
+    if (*obj)
+        op->free(obj);
+}
+
+static void *alloc_packet(void)
+{
+    return av_packet_alloc();
+}
+static void *alloc_frame(void)
+{
+    return av_frame_alloc();
+}
+
+static void reset_packet(void *obj)
+{
+    av_packet_unref(obj);
+}
+static void reset_frame(void *obj)
+{
+    av_frame_unref(obj);
+}
+
+static void free_packet(void **obj)
+{
+    AVPacket *pkt = *obj;
+    av_packet_free(&pkt);
+    *obj = NULL;
+}
+static void free_frame(void **obj)
+{
+    AVFrame *frame = *obj;
+    av_frame_free(&frame);
+    *obj = NULL;
+}
+
+ObjPool *objpool_alloc_packets(void)
+{
+    return objpool_alloc(alloc_packet, reset_packet, free_packet);
+}
+ObjPool *objpool_alloc_frames(void)
+{
+    return objpool_alloc(alloc_frame, reset_frame, free_frame);
+}
+
+/* classes from 4 kB to 256 MB, larger buffers are not pooled */
+#define BUFPOOL_MIN_SHIFT  12
+#define BUFPOOL_NB_CLASSES (4 * 17)
+
+struct BufPool {
+    AVBufferPool *pools[BUFPOOL_NB_CLASSES];
+
+    AVMutex lock;
+};
+
+/* (4 + c % 4) / 4 times the power of two of the class c */
+static size_t class_size(int c)
+{
+    return (size_t)(4 + c % 4) << (BUFPOOL_MIN_SHIFT - 2 + c / 4);
+}
+
+BufPool *bufpool_alloc(void)
+{
+    BufPool *bp = av_mallocz(sizeof(*bp));
+
+    if (!bp)
+        return NULL;
+
+    if (ff_mutex_init(&bp->lock, NULL)) {
+        av_freep(&bp);
+        return NULL;
+    }
+
+    return bp;
+}
+
+void bufpool_free(BufPool **pbp)
+{
+    BufPool *bp = *pbp;
+
+    if (!bp)
+        return;
+
+    for (int i = 0; i < BUFPOOL_NB_CLASSES; i++)
+        av_buffer_pool_uninit(&bp->pools[i]);
+
+    ff_mutex_destroy(&bp->lock);
+    av_freep(pbp);
+}
+
+AVBufferRef *bufpool_get(BufPool *bp, size_t size)
+{
+    AVBufferPool *pool;
+    int c = 0;
+
+    while (c < BUFPOOL_NB_CLASSES && class_size(c) < size)
+        c++;
+    if (c == BUFPOOL_NB_CLASSES)
+        return av_buffer_allocz(size);
+
+    /* zeroed like the buffers of the decoders, in case of broken streams */
+    ff_mutex_lock(&bp->lock);
+    if (!bp->pools[c])
+        bp->pools[c] = av_buffer_pool_init(class_size(c), av_buffer_allocz);
+    pool = bp->pools[c];
+    ff_mutex_unlock(&bp->lock);
+
+    return pool ? av_buffer_pool_get(pool) : NULL;
+}
@@ -0,0 +1,68 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef FFTOOLS_OBJPOOL_H
+#define FFTOOLS_OBJPOOL_H
+
+#include <stddef.h>
+
+#include "libavutil/buffer.h"
+
+/*
+ * A pool of reusable AVPacket / AVFrame shells, so that hot paths queueing
+ * packets and frames do not hit the allocator for every one of them.
+ *
+ * The pool is safe to use from several threads, ex: packets are taken by an
+ * input thread and released by the main thread.
+ */
+
+typedef struct ObjPool ObjPool;
+
+typedef void* (*ObjPoolCBAlloc)(void);
+typedef void  (*ObjPoolCBReset)(void *);
+typedef void  (*ObjPoolCBFree)(void **);
+
+void     objpool_free(ObjPool **op);
+ObjPool *objpool_alloc(ObjPoolCBAlloc cb_alloc, ObjPoolCBReset cb_reset,
+                       ObjPoolCBFree cb_free);
+ObjPool *objpool_alloc_packets(void);
+ObjPool *objpool_alloc_frames(void);
+
+/* get an unused object, allocate a new one when the pool is empty */
+int  objpool_get(ObjPool *op, void **obj);
+/* reset *obj and give it back to the pool, *obj is set to NULL */
+void objpool_release(ObjPool *op, void **obj);
+
+/*
+ * Data buffers in size classes, each served by an AVBufferPool, a quarter of
+ * an octave apart so that at most a fifth of a buffer is left unused. The
+ * pools are shared by all the decoders, so their buffers are reused across
+ * decoders, a decoder reinit or a change of resolution, unlike the pool of
+ * each AVCodecContext.
+ */
+
+typedef struct BufPool BufPool;
+
+BufPool *bufpool_alloc(void);
+/* buffers still referenced stay valid, they are freed once released */
+void     bufpool_free(BufPool **bp);
+
+/* get a buffer of at least size bytes from the pool of its size class */
+AVBufferRef *bufpool_get(BufPool *bp, size_t size);
+
+#endif // FFTOOLS_OBJPOOL_H
@@ -1055,6 +1055,21 @@ int opt_cpuflags(void *optctx, const char *opt, const char *arg)
     return 0;
 }
 
+int forced_cpu_count;
+
+static int cpu_count;
+
+void force_cpu_count(int count)
+{
+    av_cpu_force_count(count);
+    cpu_count = FFMAX(count, 0);
+}
+
+int get_forced_cpu_count(void)
+{
+    return cpu_count;
+}
+
 int opt_cpucount(void *optctx, const char *opt, const char *arg)
 {
     int ret;
@@ -1075,7 +1090,8 @@ int opt_cpucount(void *optctx, const char *opt, const char *arg)
     ret = av_opt_eval_int(&pclass, opts, arg, &count);
 
     if (!ret) {
-        av_cpu_force_count(count);
+        force_cpu_count(count);
+        forced_cpu_count = get_forced_cpu_count();
     }
 
     return ret;
@@ -196,6 +196,22 @@ int opt_cpuflags(void *optctx, const char *opt, const char *arg);
  */
 int opt_cpucount(void *optctx, const char *opt, const char *arg);
 
+/**
+ * The cpu count forced with -cpucount, 0 when it was not given.
+ */
+extern int forced_cpu_count;
+
+/**
+ * av_cpu_force_count() remembering the count, which libavutil has no getter
+ * for, so a tool can restore the count in effect before it ran.
+ */
+void force_cpu_count(int count);
+
+/**
+ * The count last given to force_cpu_count(), 0 when it is not forced.
+ */
+int get_forced_cpu_count(void);
+
 #define CMDUTILS_COMMON_OPTIONS                                                                                         \
     { "L",           OPT_EXIT,             { .func_arg = show_license },     "show license" },                          \
     { "h",           OPT_EXIT,             { .func_arg = show_help },        "show help", "topic" },                    \
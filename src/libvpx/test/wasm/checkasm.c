@@ -0,0 +1,284 @@
+/*
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+// Runs every WebAssembly SIMD128 function against the C one it replaces on
+// random inputs and returns 1 when one differs. Usage: checkasm [seed]
+// Built in the build directory against libvpx.a.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "./vpx_config.h"
+#include "./vpx_dsp_rtcd.h"
+#include "./vp8_rtcd.h"
+
+#include "vp8/encoder/block.h"
+#include "vpx_ports/mem.h"
+#include "vpx_ports/wasm.h"
+
+#define TRIES 100
+#define STRIDE 128
+
+static uint32_t seed;
+static int nb_failed;
+
+static uint32_t rnd(void) {
+  seed = seed * 1664525 + 1013904223;
+  return seed >> 8;
+}
+
+// 64x64 blocks at any position of 128x128 pictures
+DECLARE_ALIGNED(16, static uint8_t, src_buf[STRIDE * STRIDE]);
+DECLARE_ALIGNED(16, static uint8_t, ref_buf[4][STRIDE * STRIDE]);
+
+static void report(const char *name, int ok) {
+  printf(" - %-8s [%s]\n", name, ok ? "OK" : "FAILED");
+  nb_failed += !ok;
+}
+
+static const uint8_t *ref(int i) {
+  return ref_buf[i] + rnd() % (64 * STRIDE + 64);
+}
+
+typedef unsigned int (*sad_fn_t)(const uint8_t *, int, const uint8_t *, int);
+typedef void (*sad4d_fn_t)(const uint8_t *, int, const uint8_t *const[4], int,
+                           uint32_t[4]);
+typedef unsigned int (*variance_fn_t)(const uint8_t *, int, const uint8_t *,
+                                      int, unsigned int *);
+
+typedef struct {
+  const char *name;
+  sad_fn_t sad_c, sad_simd;
+  sad4d_fn_t sad4d_c, sad4d_simd;
+  variance_fn_t variance_c, variance_simd;
+} block_fns_t;
+
+#define BLOCK_FNS(w, h)                                              \
+  { #w "x" #h,                                                       \
+    vpx_sad##w##x##h##_c,                                            \
+    vpx_sad##w##x##h##_simd128,                                      \
+    vpx_sad##w##x##h##x4d_c,                                         \
+    vpx_sad##w##x##h##x4d_simd128,                                   \
+    vpx_variance##w##x##h##_c,                                       \
+    vpx_variance##w##x##h##_simd128 }
+
+static const block_fns_t block_fns[] = {
+  BLOCK_FNS(64, 64), BLOCK_FNS(64, 32), BLOCK_FNS(32, 64), BLOCK_FNS(32, 32),
+  BLOCK_FNS(32, 16), BLOCK_FNS(16, 32), BLOCK_FNS(16, 16), BLOCK_FNS(16, 8),
+  BLOCK_FNS(8, 16),  BLOCK_FNS(8, 8),   BLOCK_FNS(8, 4),   BLOCK_FNS(4, 8),
+  BLOCK_FNS(4, 4),
+};
+
+static void check_pixel(void) {
+  int ok = 1;
+  size_t i;
+  int t;
+
+  for (i = 0; i < sizeof(block_fns) / sizeof(block_fns[0]); ++i) {
+    const block_fns_t *f = &block_fns[i];
+    for (t = 0; t < TRIES; ++t) {
+      const uint8_t *s = src_buf + rnd() % (64 * STRIDE + 64);
+      const uint8_t *r[4] = { ref(0), ref(1), ref(2), ref(3) };
+      uint32_t sad_c[4], sad_simd[4];
+      unsigned int sse_c, sse_simd, var_c, var_simd;
+
+      if (f->sad_c(s, STRIDE, r[0], STRIDE) !=
+          f->sad_simd(s, STRIDE, r[0], STRIDE)) {
+        fprintf(stderr, "sad%s FAILED\n", f->name);
+        ok = 0;
+        break;
+      }
+      f->sad4d_c(s, STRIDE, r, STRIDE, sad_c);
+      f->sad4d_simd(s, STRIDE, r, STRIDE, sad_simd);
+      if (memcmp(sad_c, sad_simd, sizeof(sad_c))) {
+        fprintf(stderr, "sad%sx4d FAILED\n", f->name);
+        ok = 0;
+        break;
+      }
+      var_c = f->variance_c(s, STRIDE, r[0], STRIDE, &sse_c);
+      var_simd = f->variance_simd(s, STRIDE, r[0], STRIDE, &sse_simd);
+      if (var_c != var_simd || sse_c != sse_simd) {
+        fprintf(stderr, "variance%s FAILED\n", f->name);
+        ok = 0;
+        break;
+      }
+    }
+  }
+  report("pixel", ok);
+}
+
+static void check_subtract(void) {
+  DECLARE_ALIGNED(16, int16_t, diff_c[64 * 64]);
+  DECLARE_ALIGNED(16, int16_t, diff_simd[64 * 64]);
+  int ok = 1;
+  int t;
+
+  for (t = 0; t < TRIES && ok; ++t) {
+    const int rows = 4 << (rnd() % 5);
+    const int cols = 4 << (rnd() % 5);
+    const uint8_t *s = src_buf + rnd() % (64 * STRIDE + 64);
+    const uint8_t *p = ref(0);
+
+    memset(diff_c, 0, sizeof(diff_c));
+    memset(diff_simd, 0, sizeof(diff_simd));
+    vpx_subtract_block_c(rows, cols, diff_c, 64, s, STRIDE, p, STRIDE);
+    vpx_subtract_block_simd128(rows, cols, diff_simd, 64, s, STRIDE, p, STRIDE);
+    if (memcmp(diff_c, diff_simd, sizeof(diff_c))) {
+      fprintf(stderr, "subtract_block %dx%d FAILED\n", cols, rows);
+      ok = 0;
+    }
+  }
+  report("subtract", ok);
+}
+
+#if CONFIG_VP9_ENCODER && !CONFIG_VP9_HIGHBITDEPTH
+static void check_satd(void) {
+  DECLARE_ALIGNED(16, tran_low_t, coeff[1024]);
+  int ok = 1;
+  int t, i;
+
+  for (t = 0; t < TRIES && ok; ++t) {
+    const int length = 16 << (2 * (rnd() % 4));
+
+    for (i = 0; i < length; ++i)
+      coeff[i] = t & 1 ? (int16_t)rnd() : (int)(rnd() % 2049) - 1024;
+    if (vpx_satd_c(coeff, length) != vpx_satd_simd128(coeff, length)) {
+      fprintf(stderr, "satd (length %d) FAILED\n", length);
+      ok = 0;
+    }
+  }
+  report("satd", ok);
+}
+#endif  // CONFIG_VP9_ENCODER && !CONFIG_VP9_HIGHBITDEPTH
+
+#if CONFIG_VP8_ENCODER
+static void check_vp8_fdct(void) {
+  DECLARE_ALIGNED(16, short, input[4 * 16]);
+  DECLARE_ALIGNED(16, short, output_c[32]);
+  DECLARE_ALIGNED(16, short, output_simd[32]);
+  int ok = 1;
+  int t, i;
+
+  for (t = 0; t < TRIES && ok; ++t) {
+    // residuals with a pitch of 32 bytes
+    for (i = 0; i < 4 * 16; ++i) input[i] = (int)(rnd() % 511) - 255;
+    vp8_short_fdct4x4_c(input, output_c, 32);
+    vp8_short_fdct4x4_simd128(input, output_simd, 32);
+    if (memcmp(output_c, output_simd, 16 * sizeof(short))) {
+      fprintf(stderr, "vp8_short_fdct4x4 FAILED\n");
+      ok = 0;
+      break;
+    }
+    vp8_short_fdct8x4_c(input, output_c, 32);
+    vp8_short_fdct8x4_simd128(input, output_simd, 32);
+    if (memcmp(output_c, output_simd, sizeof(output_c))) {
+      fprintf(stderr, "vp8_short_fdct8x4 FAILED\n");
+      ok = 0;
+    }
+  }
+  report("vp8fdct", ok);
+}
+
+static void check_vp8_quantize(void) {
+  DECLARE_ALIGNED(16, short, coeff[16]);
+  DECLARE_ALIGNED(16, short, round[16]);
+  DECLARE_ALIGNED(16, short, quant_fast[16]);
+  DECLARE_ALIGNED(16, short, dequant[16]);
+  DECLARE_ALIGNED(16, short, qcoeff_c[16]);
+  DECLARE_ALIGNED(16, short, qcoeff_simd[16]);
+  DECLARE_ALIGNED(16, short, dqcoeff_c[16]);
+  DECLARE_ALIGNED(16, short, dqcoeff_simd[16]);
+  char eob_c, eob_simd;
+  BLOCK b;
+  BLOCKD d_c, d_simd;
+  int ok = 1;
+  int t, i;
+
+  memset(&b, 0, sizeof(b));
+  memset(&d_c, 0, sizeof(d_c));
+  memset(&d_simd, 0, sizeof(d_simd));
+  b.coeff = coeff;
+  b.round = round;
+  b.quant_fast = quant_fast;
+  d_c.dequant = d_simd.dequant = dequant;
+  d_c.qcoeff = qcoeff_c;
+  d_c.dqcoeff = dqcoeff_c;
+  d_c.eob = &eob_c;
+  d_simd.qcoeff = qcoeff_simd;
+  d_simd.dqcoeff = dqcoeff_simd;
+  d_simd.eob = &eob_simd;
+
+  for (t = 0; t < TRIES && ok; ++t) {
+    // the quantizers of vp8cx_init_quantizer(), q from 4 to 284
+    for (i = 0; i < 16; ++i) {
+      const int q = 4 + rnd() % 281;
+      dequant[i] = q;
+      quant_fast[i] = (1 << 16) / q;
+      round[i] = (q * (rnd() % 128)) >> 7;
+      // sparse blocks, and any coefficient every other try
+      coeff[i] = rnd() % 3 ? 0 : (int)(rnd() % 4097) - 2048;
+      if (t & 1) coeff[i] = (int16_t)rnd();
+    }
+    vp8_fast_quantize_b_c(&b, &d_c);
+    vp8_fast_quantize_b_simd128(&b, &d_simd);
+    if (eob_c != eob_simd || memcmp(qcoeff_c, qcoeff_simd, sizeof(qcoeff_c)) ||
+        memcmp(dqcoeff_c, dqcoeff_simd, sizeof(dqcoeff_c))) {
+      fprintf(stderr, "vp8_fast_quantize_b FAILED\n");
+      ok = 0;
+    }
+  }
+  report("vp8quant", ok);
+}
+#endif  // CONFIG_VP8_ENCODER
+
+// vpx_wasm_set_simd128() switches the rtcd names.
+static void check_select(void) {
+  int ok;
+
+  vpx_wasm_set_simd128(0);
+  ok = vpx_sad16x16 == vpx_sad16x16_c &&
+       vpx_subtract_block == vpx_subtract_block_c;
+  vpx_wasm_set_simd128(1);
+  ok = ok && vpx_sad16x16 == vpx_sad16x16_simd128 &&
+       vpx_subtract_block == vpx_subtract_block_simd128;
+  report("select", ok);
+}
+
+int main(int argc, char *argv[]) {
+  int i, j;
+
+  seed = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 0) : (uint32_t)time(NULL);
+  if (!vpx_wasm_simd128) {
+    fprintf(stderr, "checkasm: built without -msimd128, no kernel to test\n");
+    return 0;
+  }
+  printf("checkasm: using random seed %u\n", seed);
+
+  for (i = 0; i < STRIDE * STRIDE; ++i) src_buf[i] = rnd();
+  for (i = 0; i < 4; ++i)
+    for (j = 0; j < STRIDE * STRIDE; ++j) ref_buf[i][j] = rnd();
+  check_pixel();
+  check_subtract();
+#if CONFIG_VP9_ENCODER && !CONFIG_VP9_HIGHBITDEPTH
+  check_satd();
+#endif
+#if CONFIG_VP8_ENCODER
+  check_vp8_fdct();
+  check_vp8_quantize();
+#endif
+  check_select();
+
+  if (nb_failed) {
+    fprintf(stderr, "checkasm: %d tests FAILED\n", nb_failed);
+    return 1;
+  }
+  printf("checkasm: all tests passed\n");
+  return 0;
+}
@@ -0,0 +1,83 @@
+/*
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+
+#include "./vpx_config.h"
+#include "./vp8_rtcd.h"
+
+#include "vpx_ports/mem.h"
+
+static INLINE void transpose_4x4(v128_t *r) {
+  const v128_t t0 = wasm_i32x4_shuffle(r[0], r[1], 0, 4, 1, 5);
+  const v128_t t1 = wasm_i32x4_shuffle(r[0], r[1], 2, 6, 3, 7);
+  const v128_t t2 = wasm_i32x4_shuffle(r[2], r[3], 0, 4, 1, 5);
+  const v128_t t3 = wasm_i32x4_shuffle(r[2], r[3], 2, 6, 3, 7);
+  r[0] = wasm_i64x2_shuffle(t0, t2, 0, 2);
+  r[1] = wasm_i64x2_shuffle(t0, t2, 1, 3);
+  r[2] = wasm_i64x2_shuffle(t1, t3, 0, 2);
+  r[3] = wasm_i64x2_shuffle(t1, t3, 1, 3);
+}
+
+// a * c0 + b * c1 + rounding, in 32 bits like the C.
+static INLINE v128_t mul_add(v128_t a, int c0, v128_t b, int c1, int round) {
+  return wasm_i32x4_add(
+      wasm_i32x4_add(wasm_i32x4_mul(a, wasm_i32x4_splat(c0)),
+                     wasm_i32x4_mul(b, wasm_i32x4_splat(c1))),
+      wasm_i32x4_splat(round));
+}
+
+// Both passes of vp8_short_fdct4x4_c in 32-bit lanes, one row (then column)
+// per lane, the first one truncated to short as it is stored to output there.
+void vp8_short_fdct4x4_simd128(short *input, short *output, int pitch) {
+  v128_t r[4];
+  v128_t a1, b1, c1, d1;
+  int i;
+
+  for (i = 0; i < 4; ++i) r[i] = wasm_i32x4_load16x4(input + i * (pitch / 2));
+  transpose_4x4(r);
+
+  a1 = wasm_i32x4_shl(wasm_i32x4_add(r[0], r[3]), 3);
+  b1 = wasm_i32x4_shl(wasm_i32x4_add(r[1], r[2]), 3);
+  c1 = wasm_i32x4_shl(wasm_i32x4_sub(r[1], r[2]), 3);
+  d1 = wasm_i32x4_shl(wasm_i32x4_sub(r[0], r[3]), 3);
+
+  r[0] = wasm_i32x4_add(a1, b1);
+  r[2] = wasm_i32x4_sub(a1, b1);
+  r[1] = wasm_i32x4_shr(mul_add(c1, 2217, d1, 5352, 14500), 12);
+  r[3] = wasm_i32x4_shr(mul_add(d1, 2217, c1, -5352, 7500), 12);
+  for (i = 0; i < 4; ++i)
+    r[i] = wasm_i32x4_shr(wasm_i32x4_shl(r[i], 16), 16);
+  transpose_4x4(r);
+
+  a1 = wasm_i32x4_add(r[0], r[3]);
+  b1 = wasm_i32x4_add(r[1], r[2]);
+  c1 = wasm_i32x4_sub(r[1], r[2]);
+  d1 = wasm_i32x4_sub(r[0], r[3]);
+
+  r[0] = wasm_i32x4_shr(wasm_i32x4_add(wasm_i32x4_add(a1, b1),
+                                       wasm_i32x4_splat(7)), 4);
+  r[2] = wasm_i32x4_shr(wasm_i32x4_add(wasm_i32x4_sub(a1, b1),
+                                       wasm_i32x4_splat(7)), 4);
+  // + (d1 != 0), the comparison is -1 when true
+  r[1] = wasm_i32x4_sub(wasm_i32x4_shr(mul_add(c1, 2217, d1, 5352, 12000), 16),
+                        wasm_i32x4_ne(d1, wasm_i32x4_splat(0)));
+  r[3] = wasm_i32x4_shr(mul_add(d1, 2217, c1, -5352, 51000), 16);
+
+  wasm_v128_store(output,
+                  wasm_i16x8_shuffle(r[0], r[1], 0, 2, 4, 6, 8, 10, 12, 14));
+  wasm_v128_store(output + 8,
+                  wasm_i16x8_shuffle(r[2], r[3], 0, 2, 4, 6, 8, 10, 12, 14));
+}
+
+void vp8_short_fdct8x4_simd128(short *input, short *output, int pitch) {
+  vp8_short_fdct4x4_simd128(input, output, pitch);
+  vp8_short_fdct4x4_simd128(input + 4, output + 16, pitch);
+}
+#endif  // __wasm_simd128__
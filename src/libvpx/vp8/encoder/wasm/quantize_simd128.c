@@ -0,0 +1,55 @@
+/*
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+
+#include "./vpx_config.h"
+#include "./vp8_rtcd.h"
+
+#include "vp8/common/entropy.h" /* vp8_default_inv_zig_zag */
+#include "vp8/encoder/block.h"
+
+// vp8_fast_quantize_b_c on 8 coefficients in raster order. |z| + round fits
+// 16 unsigned bits and quant_fast is below 1 << 15, so the high half of the
+// 32-bit product is y.
+static INLINE v128_t quantize_8(const short *coeff_ptr, const short *round_ptr,
+                                const short *quant_ptr, const short *dequant_ptr,
+                                short *qcoeff_ptr, short *dqcoeff_ptr) {
+  const v128_t z = wasm_v128_load(coeff_ptr);
+  const v128_t x = wasm_i16x8_add(wasm_i16x8_abs(z), wasm_v128_load(round_ptr));
+  const v128_t q = wasm_v128_load(quant_ptr);
+  const v128_t y = wasm_i16x8_shuffle(wasm_u32x4_extmul_low_u16x8(x, q),
+                                      wasm_u32x4_extmul_high_u16x8(x, q), 1, 3,
+                                      5, 7, 9, 11, 13, 15);
+  const v128_t qcoeff = wasm_v128_bitselect(
+      wasm_i16x8_neg(y), y, wasm_i16x8_lt(z, wasm_i16x8_splat(0)));
+
+  wasm_v128_store(qcoeff_ptr, qcoeff);
+  wasm_v128_store(dqcoeff_ptr,
+                  wasm_i16x8_mul(qcoeff, wasm_v128_load(dequant_ptr)));
+  return wasm_i16x8_ne(y, wasm_i16x8_splat(0));
+}
+
+void vp8_fast_quantize_b_simd128(BLOCK *b, BLOCKD *d) {
+  const v128_t nz0 = quantize_8(b->coeff, b->round, b->quant_fast, d->dequant,
+                                d->qcoeff, d->dqcoeff);
+  const v128_t nz1 =
+      quantize_8(b->coeff + 8, b->round + 8, b->quant_fast + 8,
+                 d->dequant + 8, d->qcoeff + 8, d->dqcoeff + 8);
+  // eob is the largest 1-based zig zag position of a nonzero coefficient.
+  v128_t eob = wasm_i16x8_max(
+      wasm_v128_and(nz0, wasm_v128_load(vp8_default_inv_zig_zag)),
+      wasm_v128_and(nz1, wasm_v128_load(vp8_default_inv_zig_zag + 8)));
+
+  eob = wasm_i16x8_max(eob, wasm_i32x4_shuffle(eob, eob, 2, 3, 0, 1));
+  eob = wasm_i16x8_max(eob, wasm_i32x4_shuffle(eob, eob, 1, 0, 3, 2));
+  eob = wasm_i16x8_max(eob, wasm_i16x8_shuffle(eob, eob, 1, 0, 3, 2, 5, 4, 7, 6));
+  *d->eob = (char)wasm_i16x8_extract_lane(eob, 0);
+}
+#endif  // __wasm_simd128__
@@ -0,0 +1,28 @@
+/*
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef VPX_VP8_ENCODER_WASM_VP8_WASM_H_
+#define VPX_VP8_ENCODER_WASM_VP8_WASM_H_
+
+// WebAssembly SIMD128 versions of vp8_rtcd.h encoder functions, included by
+// vpx_config.h at the end of vp8_rtcd.h like vpx_dsp/wasm/vpx_dsp_wasm.h.
+
+#include "vpx_ports/wasm.h"
+
+void vp8_short_fdct4x4_simd128(short *input, short *output, int pitch);
+void vp8_short_fdct8x4_simd128(short *input, short *output, int pitch);
+void vp8_fast_quantize_b_simd128(struct block *, struct blockd *);
+
+#undef vp8_short_fdct4x4
+#define vp8_short_fdct4x4 VPX_WASM_SIMD128(vp8_short_fdct4x4)
+#undef vp8_short_fdct8x4
+#define vp8_short_fdct8x4 VPX_WASM_SIMD128(vp8_short_fdct8x4)
+#undef vp8_fast_quantize_b
+#define vp8_fast_quantize_b VPX_WASM_SIMD128(vp8_fast_quantize_b)
+
+#endif  // VPX_VP8_ENCODER_WASM_VP8_WASM_H_
@@ -0,0 +1,33 @@
+/*
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+
+#include "./vpx_config.h"
+#include "./vpx_dsp_rtcd.h"
+
+#include "vpx_dsp/vpx_dsp_common.h"
+
+#if !CONFIG_VP9_HIGHBITDEPTH
+// length is a multiple of 16, |coeff| is taken as unsigned so that -32768
+// counts 32768 like abs() in C.
+int vpx_satd_simd128(const tran_low_t *coeff, int length) {
+  v128_t sum = wasm_i32x4_splat(0);
+  int i;
+
+  for (i = 0; i < length; i += 8) {
+    const v128_t a = wasm_i16x8_abs(wasm_v128_load(coeff + i));
+    sum = wasm_i32x4_add(sum, wasm_u32x4_extadd_pairwise_u16x8(a));
+  }
+  sum = wasm_i32x4_add(sum, wasm_i32x4_shuffle(sum, sum, 2, 3, 0, 1));
+  sum = wasm_i32x4_add(sum, wasm_i32x4_shuffle(sum, sum, 1, 0, 3, 2));
+  return wasm_i32x4_extract_lane(sum, 0);
+}
+#endif  // !CONFIG_VP9_HIGHBITDEPTH
+#endif  // __wasm_simd128__
@@ -0,0 +1,116 @@
+/*
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+
+#include "./vpx_config.h"
+#include "./vpx_dsp_rtcd.h"
+
+#include "vpx/vpx_integer.h"
+#include "vpx_ports/mem.h"
+
+// |a - b| of 16 pixels, or of 4 / 8 with the other lanes 0.
+static INLINE v128_t abs_diff_u8(v128_t a, v128_t b) {
+  return wasm_v128_or(wasm_u8x16_sub_sat(a, b), wasm_u8x16_sub_sat(b, a));
+}
+
+static INLINE v128_t load_row(const uint8_t *p, int w) {
+  if (w == 4) return wasm_v128_load32_zero(p);
+  if (w == 8) return wasm_v128_load64_zero(p);
+  return wasm_v128_load(p);
+}
+
+static INLINE uint32_t horizontal_add_u32(v128_t v) {
+  v = wasm_i32x4_add(v, wasm_i32x4_shuffle(v, v, 2, 3, 0, 1));
+  v = wasm_i32x4_add(v, wasm_i32x4_shuffle(v, v, 1, 0, 3, 2));
+  return (uint32_t)wasm_i32x4_extract_lane(v, 0);
+}
+
+// The 16-bit lanes take at most 4 * 2 * 255 per row, the sums are widened
+// every 16 rows.
+static INLINE uint32_t sad_wxh(const uint8_t *src_ptr, int src_stride,
+                               const uint8_t *ref_ptr, int ref_stride, int w,
+                               int h) {
+  v128_t sum = wasm_i32x4_splat(0);
+  int i, j, k;
+
+  for (i = 0; i < h; i += 16) {
+    v128_t sum16 = wasm_i16x8_splat(0);
+    for (j = i; j < i + 16 && j < h; ++j) {
+      for (k = 0; k < w; k += 16) {
+        const v128_t d = abs_diff_u8(load_row(src_ptr + k, w),
+                                     load_row(ref_ptr + k, w));
+        sum16 = wasm_i16x8_add(sum16, wasm_u16x8_extadd_pairwise_u8x16(d));
+      }
+      src_ptr += src_stride;
+      ref_ptr += ref_stride;
+    }
+    sum = wasm_i32x4_add(sum, wasm_u32x4_extadd_pairwise_u16x8(sum16));
+  }
+  return horizontal_add_u32(sum);
+}
+
+static INLINE void sad_wxhx4d(const uint8_t *src_ptr, int src_stride,
+                              const uint8_t *const ref_array[4],
+                              int ref_stride, uint32_t sad_array[4], int w,
+                              int h) {
+  v128_t sum[4] = { wasm_i32x4_splat(0), wasm_i32x4_splat(0),
+                    wasm_i32x4_splat(0), wasm_i32x4_splat(0) };
+  int i, j, k, r;
+
+  for (i = 0; i < h; i += 16) {
+    v128_t sum16[4] = { wasm_i16x8_splat(0), wasm_i16x8_splat(0),
+                        wasm_i16x8_splat(0), wasm_i16x8_splat(0) };
+    for (j = i; j < i + 16 && j < h; ++j) {
+      const uint8_t *s = src_ptr + j * src_stride;
+      for (k = 0; k < w; k += 16) {
+        const v128_t a = load_row(s + k, w);
+        for (r = 0; r < 4; ++r) {
+          const v128_t d =
+              abs_diff_u8(a, load_row(ref_array[r] + j * ref_stride + k, w));
+          sum16[r] =
+              wasm_i16x8_add(sum16[r], wasm_u16x8_extadd_pairwise_u8x16(d));
+        }
+      }
+    }
+    for (r = 0; r < 4; ++r)
+      sum[r] = wasm_i32x4_add(sum[r], wasm_u32x4_extadd_pairwise_u16x8(sum16[r]));
+  }
+  for (r = 0; r < 4; ++r) sad_array[r] = horizontal_add_u32(sum[r]);
+}
+
+#define SAD_WXH(w, h)                                                        \
+  unsigned int vpx_sad##w##x##h##_simd128(const uint8_t *src_ptr,            \
+                                          int src_stride,                    \
+                                          const uint8_t *ref_ptr,            \
+                                          int ref_stride) {                  \
+    return sad_wxh(src_ptr, src_stride, ref_ptr, ref_stride, w, h);          \
+  }                                                                          \
+                                                                             \
+  void vpx_sad##w##x##h##x4d_simd128(                                        \
+      const uint8_t *src_ptr, int src_stride,                                \
+      const uint8_t *const ref_array[4], int ref_stride,                     \
+      uint32_t sad_array[4]) {                                               \
+    sad_wxhx4d(src_ptr, src_stride, ref_array, ref_stride, sad_array, w, h); \
+  }
+
+SAD_WXH(64, 64)
+SAD_WXH(64, 32)
+SAD_WXH(32, 64)
+SAD_WXH(32, 32)
+SAD_WXH(32, 16)
+SAD_WXH(16, 32)
+SAD_WXH(16, 16)
+SAD_WXH(16, 8)
+SAD_WXH(8, 16)
+SAD_WXH(8, 8)
+SAD_WXH(8, 4)
+SAD_WXH(4, 8)
+SAD_WXH(4, 4)
+#endif  // __wasm_simd128__
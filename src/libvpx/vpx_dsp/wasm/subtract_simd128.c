@@ -0,0 +1,40 @@
+/*
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#if defined(__wasm_simd128__)
+#include <stddef.h>
+#include <wasm_simd128.h>
+
+#include "./vpx_config.h"
+#include "./vpx_dsp_rtcd.h"
+
+#include "vpx/vpx_integer.h"
+
+void vpx_subtract_block_simd128(int rows, int cols, int16_t *diff_ptr,
+                                ptrdiff_t diff_stride, const uint8_t *src_ptr,
+                                ptrdiff_t src_stride, const uint8_t *pred_ptr,
+                                ptrdiff_t pred_stride) {
+  int r, c;
+
+  for (r = 0; r < rows; ++r) {
+    for (c = 0; c + 8 <= cols; c += 8) {
+      const v128_t s = wasm_u16x8_load8x8(src_ptr + c);
+      const v128_t p = wasm_u16x8_load8x8(pred_ptr + c);
+      wasm_v128_store(diff_ptr + c, wasm_i16x8_sub(s, p));
+    }
+    if (c < cols) {  // 4 wide
+      const v128_t s = wasm_u16x8_load8x8(src_ptr + c);
+      const v128_t p = wasm_u16x8_load8x8(pred_ptr + c);
+      wasm_v128_store64_lane(diff_ptr + c, wasm_i16x8_sub(s, p), 0);
+    }
+    diff_ptr += diff_stride;
+    src_ptr += src_stride;
+    pred_ptr += pred_stride;
+  }
+}
+#endif  // __wasm_simd128__
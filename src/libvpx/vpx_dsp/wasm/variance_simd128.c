@@ -0,0 +1,83 @@
+/*
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+
+#include "./vpx_config.h"
+#include "./vpx_dsp_rtcd.h"
+
+#include "vpx/vpx_integer.h"
+#include "vpx_ports/mem.h"
+
+static INLINE v128_t load_row(const uint8_t *p, int w) {
+  if (w == 4) return wasm_v128_load32_zero(p);
+  if (w == 8) return wasm_v128_load64_zero(p);
+  return wasm_v128_load(p);
+}
+
+static INLINE int32_t horizontal_add_s32(v128_t v) {
+  v = wasm_i32x4_add(v, wasm_i32x4_shuffle(v, v, 2, 3, 0, 1));
+  v = wasm_i32x4_add(v, wasm_i32x4_shuffle(v, v, 1, 0, 3, 2));
+  return wasm_i32x4_extract_lane(v, 0);
+}
+
+// The sums and squares of the 16-bit differences are accumulated in 32 bits,
+// the lanes of 4 and 8 wide blocks past w are 0 on both sides.
+static INLINE void variance(const uint8_t *src_ptr, int src_stride,
+                            const uint8_t *ref_ptr, int ref_stride, int w,
+                            int h, uint32_t *sse, int *sum) {
+  v128_t vsum = wasm_i32x4_splat(0);
+  v128_t vsse = wasm_i32x4_splat(0);
+  int i, k;
+
+  for (i = 0; i < h; ++i) {
+    for (k = 0; k < w; k += 16) {
+      const v128_t s = load_row(src_ptr + k, w);
+      const v128_t r = load_row(ref_ptr + k, w);
+      const v128_t d_lo = wasm_i16x8_sub(wasm_u16x8_extend_low_u8x16(s),
+                                         wasm_u16x8_extend_low_u8x16(r));
+      vsum = wasm_i32x4_add(vsum, wasm_i32x4_extadd_pairwise_i16x8(d_lo));
+      vsse = wasm_i32x4_add(vsse, wasm_i32x4_dot_i16x8(d_lo, d_lo));
+      if (w > 8) {
+        const v128_t d_hi = wasm_i16x8_sub(wasm_u16x8_extend_high_u8x16(s),
+                                           wasm_u16x8_extend_high_u8x16(r));
+        vsum = wasm_i32x4_add(vsum, wasm_i32x4_extadd_pairwise_i16x8(d_hi));
+        vsse = wasm_i32x4_add(vsse, wasm_i32x4_dot_i16x8(d_hi, d_hi));
+      }
+    }
+    src_ptr += src_stride;
+    ref_ptr += ref_stride;
+  }
+  *sum = horizontal_add_s32(vsum);
+  *sse = (uint32_t)horizontal_add_s32(vsse);
+}
+
+#define VARIANCE_WXH(w, h)                                                  \
+  unsigned int vpx_variance##w##x##h##_simd128(                             \
+      const uint8_t *src_ptr, int src_stride, const uint8_t *ref_ptr,       \
+      int ref_stride, unsigned int *sse) {                                  \
+    int sum;                                                                \
+    variance(src_ptr, src_stride, ref_ptr, ref_stride, w, h, sse, &sum);    \
+    return *sse - (uint32_t)(((int64_t)sum * sum) / (w * h));               \
+  }
+
+VARIANCE_WXH(64, 64)
+VARIANCE_WXH(64, 32)
+VARIANCE_WXH(32, 64)
+VARIANCE_WXH(32, 32)
+VARIANCE_WXH(32, 16)
+VARIANCE_WXH(16, 32)
+VARIANCE_WXH(16, 16)
+VARIANCE_WXH(16, 8)
+VARIANCE_WXH(8, 16)
+VARIANCE_WXH(8, 8)
+VARIANCE_WXH(8, 4)
+VARIANCE_WXH(4, 8)
+VARIANCE_WXH(4, 4)
+#endif  // __wasm_simd128__
@@ -0,0 +1,142 @@
+/*
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef VPX_VPX_DSP_WASM_VPX_DSP_WASM_H_
+#define VPX_VPX_DSP_WASM_VPX_DSP_WASM_H_
+
+// WebAssembly SIMD128 versions of vpx_dsp_rtcd.h functions. generic-gnu has
+// no run time cpu detection, so vpx_dsp_rtcd.h defines each name as its _c
+// function; vpx_config.h includes this header at the end of vpx_dsp_rtcd.h
+// to redefine them as a choice on vpx_wasm_simd128 instead.
+
+#include "vpx_ports/wasm.h"
+
+#define VPX_WASM_SAD(w, h)                                                    \
+  unsigned int vpx_sad##w##x##h##_simd128(const uint8_t *src_ptr,             \
+                                          int src_stride,                     \
+                                          const uint8_t *ref_ptr,             \
+                                          int ref_stride);                    \
+  void vpx_sad##w##x##h##x4d_simd128(const uint8_t *src_ptr, int src_stride,  \
+                                     const uint8_t *const ref_array[4],       \
+                                     int ref_stride, uint32_t sad_array[4]);  \
+  unsigned int vpx_variance##w##x##h##_simd128(                               \
+      const uint8_t *src_ptr, int src_stride, const uint8_t *ref_ptr,         \
+      int ref_stride, unsigned int *sse);
+
+#if CONFIG_ENCODERS
+VPX_WASM_SAD(64, 64)
+VPX_WASM_SAD(64, 32)
+VPX_WASM_SAD(32, 64)
+VPX_WASM_SAD(32, 32)
+VPX_WASM_SAD(32, 16)
+VPX_WASM_SAD(16, 32)
+VPX_WASM_SAD(16, 16)
+VPX_WASM_SAD(16, 8)
+VPX_WASM_SAD(8, 16)
+VPX_WASM_SAD(8, 8)
+VPX_WASM_SAD(8, 4)
+VPX_WASM_SAD(4, 8)
+VPX_WASM_SAD(4, 4)
+
+void vpx_subtract_block_simd128(int rows, int cols, int16_t *diff_ptr,
+                                ptrdiff_t diff_stride, const uint8_t *src_ptr,
+                                ptrdiff_t src_stride, const uint8_t *pred_ptr,
+                                ptrdiff_t pred_stride);
+
+#undef vpx_sad64x64
+#define vpx_sad64x64 VPX_WASM_SIMD128(vpx_sad64x64)
+#undef vpx_sad64x64x4d
+#define vpx_sad64x64x4d VPX_WASM_SIMD128(vpx_sad64x64x4d)
+#undef vpx_variance64x64
+#define vpx_variance64x64 VPX_WASM_SIMD128(vpx_variance64x64)
+#undef vpx_sad64x32
+#define vpx_sad64x32 VPX_WASM_SIMD128(vpx_sad64x32)
+#undef vpx_sad64x32x4d
+#define vpx_sad64x32x4d VPX_WASM_SIMD128(vpx_sad64x32x4d)
+#undef vpx_variance64x32
+#define vpx_variance64x32 VPX_WASM_SIMD128(vpx_variance64x32)
+#undef vpx_sad32x64
+#define vpx_sad32x64 VPX_WASM_SIMD128(vpx_sad32x64)
+#undef vpx_sad32x64x4d
+#define vpx_sad32x64x4d VPX_WASM_SIMD128(vpx_sad32x64x4d)
+#undef vpx_variance32x64
+#define vpx_variance32x64 VPX_WASM_SIMD128(vpx_variance32x64)
+#undef vpx_sad32x32
+#define vpx_sad32x32 VPX_WASM_SIMD128(vpx_sad32x32)
+#undef vpx_sad32x32x4d
+#define vpx_sad32x32x4d VPX_WASM_SIMD128(vpx_sad32x32x4d)
+#undef vpx_variance32x32
+#define vpx_variance32x32 VPX_WASM_SIMD128(vpx_variance32x32)
+#undef vpx_sad32x16
+#define vpx_sad32x16 VPX_WASM_SIMD128(vpx_sad32x16)
+#undef vpx_sad32x16x4d
+#define vpx_sad32x16x4d VPX_WASM_SIMD128(vpx_sad32x16x4d)
+#undef vpx_variance32x16
+#define vpx_variance32x16 VPX_WASM_SIMD128(vpx_variance32x16)
+#undef vpx_sad16x32
+#define vpx_sad16x32 VPX_WASM_SIMD128(vpx_sad16x32)
+#undef vpx_sad16x32x4d
+#define vpx_sad16x32x4d VPX_WASM_SIMD128(vpx_sad16x32x4d)
+#undef vpx_variance16x32
+#define vpx_variance16x32 VPX_WASM_SIMD128(vpx_variance16x32)
+#undef vpx_sad16x16
+#define vpx_sad16x16 VPX_WASM_SIMD128(vpx_sad16x16)
+#undef vpx_sad16x16x4d
+#define vpx_sad16x16x4d VPX_WASM_SIMD128(vpx_sad16x16x4d)
+#undef vpx_variance16x16
+#define vpx_variance16x16 VPX_WASM_SIMD128(vpx_variance16x16)
+#undef vpx_sad16x8
+#define vpx_sad16x8 VPX_WASM_SIMD128(vpx_sad16x8)
+#undef vpx_sad16x8x4d
+#define vpx_sad16x8x4d VPX_WASM_SIMD128(vpx_sad16x8x4d)
+#undef vpx_variance16x8
+#define vpx_variance16x8 VPX_WASM_SIMD128(vpx_variance16x8)
+#undef vpx_sad8x16
+#define vpx_sad8x16 VPX_WASM_SIMD128(vpx_sad8x16)
+#undef vpx_sad8x16x4d
+#define vpx_sad8x16x4d VPX_WASM_SIMD128(vpx_sad8x16x4d)
+#undef vpx_variance8x16
+#define vpx_variance8x16 VPX_WASM_SIMD128(vpx_variance8x16)
+#undef vpx_sad8x8
+#define vpx_sad8x8 VPX_WASM_SIMD128(vpx_sad8x8)
+#undef vpx_sad8x8x4d
+#define vpx_sad8x8x4d VPX_WASM_SIMD128(vpx_sad8x8x4d)
+#undef vpx_variance8x8
+#define vpx_variance8x8 VPX_WASM_SIMD128(vpx_variance8x8)
+#undef vpx_sad8x4
+#define vpx_sad8x4 VPX_WASM_SIMD128(vpx_sad8x4)
+#undef vpx_sad8x4x4d
+#define vpx_sad8x4x4d VPX_WASM_SIMD128(vpx_sad8x4x4d)
+#undef vpx_variance8x4
+#define vpx_variance8x4 VPX_WASM_SIMD128(vpx_variance8x4)
+#undef vpx_sad4x8
+#define vpx_sad4x8 VPX_WASM_SIMD128(vpx_sad4x8)
+#undef vpx_sad4x8x4d
+#define vpx_sad4x8x4d VPX_WASM_SIMD128(vpx_sad4x8x4d)
+#undef vpx_variance4x8
+#define vpx_variance4x8 VPX_WASM_SIMD128(vpx_variance4x8)
+#undef vpx_sad4x4
+#define vpx_sad4x4 VPX_WASM_SIMD128(vpx_sad4x4)
+#undef vpx_sad4x4x4d
+#define vpx_sad4x4x4d VPX_WASM_SIMD128(vpx_sad4x4x4d)
+#undef vpx_variance4x4
+#define vpx_variance4x4 VPX_WASM_SIMD128(vpx_variance4x4)
+#undef vpx_subtract_block
+#define vpx_subtract_block VPX_WASM_SIMD128(vpx_subtract_block)
+#endif  // CONFIG_ENCODERS
+
+#if CONFIG_VP9_ENCODER && !CONFIG_VP9_HIGHBITDEPTH
+int vpx_satd_simd128(const tran_low_t *coeff, int length);
+
+#undef vpx_satd
+#define vpx_satd VPX_WASM_SIMD128(vpx_satd)
+#endif  // CONFIG_VP9_ENCODER && !CONFIG_VP9_HIGHBITDEPTH
+
+#undef VPX_WASM_SAD
+
+#endif  // VPX_VPX_DSP_WASM_VPX_DSP_WASM_H_
@@ -0,0 +1,31 @@
+/*
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef VPX_VPX_PORTS_WASM_H_
+#define VPX_VPX_PORTS_WASM_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Nonzero selects the WebAssembly SIMD128 kernels of vpx_dsp and vp8, zero
+// their C versions. It is 1 when built with -msimd128. The encoders copy the
+// function pointers when they are created, so it is set before.
+extern int vpx_wasm_simd128;
+
+void vpx_wasm_set_simd128(int enabled);
+
+// The rtcd name of a function with a _simd128 version, see
+// vpx_dsp/wasm/vpx_dsp_wasm.h.
+#define VPX_WASM_SIMD128(fn) (vpx_wasm_simd128 ? fn##_simd128 : fn##_c)
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif  // VPX_VPX_PORTS_WASM_H_
@@ -0,0 +1,26 @@
+/*
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "vpx_ports/wasm.h"
+
+// SIMD128 is a compile time feature of WebAssembly, a module built with
+// -msimd128 does not load without it, so there is nothing to detect and the
+// flag only lets the caller fall back to C (-cpuflags 0 in FFmpeg).
+#if defined(__wasm_simd128__)
+int vpx_wasm_simd128 = 1;
+#else
+int vpx_wasm_simd128 = 0;
+#endif
+
+void vpx_wasm_set_simd128(int enabled) {
+#if defined(__wasm_simd128__)
+  vpx_wasm_simd128 = enabled != 0;
+#else
+  (void)enabled;
+#endif
+}
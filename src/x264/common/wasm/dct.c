@@ -0,0 +1,189 @@
+/*****************************************************************************
+ * dct.c: wasm transform
+ *****************************************************************************
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *****************************************************************************/
+
+/* WebAssembly SIMD128 4x4 transforms of 8-bit pixels, two 4x4 blocks side by
+ * side per vector, selected by X264_CPU_SIMD128 when x264 is built with
+ * -msimd128. */
+
+#include "common/common.h"
+#include "dct.h"
+
+#if !HIGH_BIT_DEPTH && defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+
+/* transposes the two 4x4 of rows r[0..3], left block in the low half */
+static ALWAYS_INLINE void transpose_4x4x2( v128_t r[4] )
+{
+    v128_t t0 = wasm_i16x8_shuffle( r[0], r[1], 0, 8, 1, 9, 4, 12, 5, 13 );
+    v128_t t1 = wasm_i16x8_shuffle( r[0], r[1], 2, 10, 3, 11, 6, 14, 7, 15 );
+    v128_t t2 = wasm_i16x8_shuffle( r[2], r[3], 0, 8, 1, 9, 4, 12, 5, 13 );
+    v128_t t3 = wasm_i16x8_shuffle( r[2], r[3], 2, 10, 3, 11, 6, 14, 7, 15 );
+    r[0] = wasm_i32x4_shuffle( t0, t2, 0, 4, 2, 6 );
+    r[1] = wasm_i32x4_shuffle( t0, t2, 1, 5, 3, 7 );
+    r[2] = wasm_i32x4_shuffle( t1, t3, 0, 4, 2, 6 );
+    r[3] = wasm_i32x4_shuffle( t1, t3, 1, 5, 3, 7 );
+}
+
+/* the 1D forward transform of sub4x4_dct across r[0..3] */
+static ALWAYS_INLINE void dct4_1d( v128_t r[4] )
+{
+    v128_t s03 = wasm_i16x8_add( r[0], r[3] );
+    v128_t d03 = wasm_i16x8_sub( r[0], r[3] );
+    v128_t s12 = wasm_i16x8_add( r[1], r[2] );
+    v128_t d12 = wasm_i16x8_sub( r[1], r[2] );
+    r[0] = wasm_i16x8_add( s03, s12 );
+    r[1] = wasm_i16x8_add( wasm_i16x8_shl( d03, 1 ), d12 );
+    r[2] = wasm_i16x8_sub( s03, s12 );
+    r[3] = wasm_i16x8_sub( d03, wasm_i16x8_shl( d12, 1 ) );
+}
+
+/* dct0 and dct1 of the left and right 4x4 of an 8x4 block, the C transforms
+ * rows first but every step is exact, so columns first gives the same */
+static ALWAYS_INLINE void sub8x4_dct( dctcoef dct0[16], dctcoef dct1[16], pixel *pix1, pixel *pix2 )
+{
+    v128_t r[4];
+    for( int y = 0; y < 4; y++ )
+        r[y] = wasm_i16x8_sub( wasm_u16x8_load8x8( pix1 + y * FENC_STRIDE ),
+                               wasm_u16x8_load8x8( pix2 + y * FDEC_STRIDE ) );
+    dct4_1d( r );
+    transpose_4x4x2( r );
+    dct4_1d( r );
+    for( int i = 0; i < 4; i++ )
+    {
+        wasm_v128_store64_lane( dct0 + i * 4, r[i], 0 );
+        wasm_v128_store64_lane( dct1 + i * 4, r[i], 1 );
+    }
+}
+
+static void sub4x4_dct_simd128( dctcoef dct[16], pixel *pix1, pixel *pix2 )
+{
+    dctcoef tmp[16];
+    sub8x4_dct( dct, tmp, pix1, pix2 );
+}
+
+static void sub8x8_dct_simd128( dctcoef dct[4][16], pixel *pix1, pixel *pix2 )
+{
+    sub8x4_dct( dct[0], dct[1], &pix1[0], &pix2[0] );
+    sub8x4_dct( dct[2], dct[3], &pix1[4*FENC_STRIDE], &pix2[4*FDEC_STRIDE] );
+}
+
+static void sub16x16_dct_simd128( dctcoef dct[16][16], pixel *pix1, pixel *pix2 )
+{
+    sub8x8_dct_simd128( &dct[ 0], &pix1[0], &pix2[0] );
+    sub8x8_dct_simd128( &dct[ 4], &pix1[8], &pix2[8] );
+    sub8x8_dct_simd128( &dct[ 8], &pix1[8*FENC_STRIDE+0], &pix2[8*FDEC_STRIDE+0] );
+    sub8x8_dct_simd128( &dct[12], &pix1[8*FENC_STRIDE+8], &pix2[8*FDEC_STRIDE+8] );
+}
+
+/* the 1D inverse transform of add4x4_idct across r[0..3], 16-bit lanes wrap
+ * like the int16 tmp[] of the C first pass */
+static ALWAYS_INLINE void idct4_1d_i16( v128_t r[4] )
+{
+    v128_t s02 = wasm_i16x8_add( r[0], r[2] );
+    v128_t d02 = wasm_i16x8_sub( r[0], r[2] );
+    v128_t s13 = wasm_i16x8_add( r[1], wasm_i16x8_shr( r[3], 1 ) );
+    v128_t d13 = wasm_i16x8_sub( wasm_i16x8_shr( r[1], 1 ), r[3] );
+    r[0] = wasm_i16x8_add( s02, s13 );
+    r[1] = wasm_i16x8_add( d02, d13 );
+    r[2] = wasm_i16x8_sub( d02, d13 );
+    r[3] = wasm_i16x8_sub( s02, s13 );
+}
+
+/* the second pass, in 32 bits like the C one, (x + 32) >> 6 */
+static ALWAYS_INLINE void idct4_1d_i32( v128_t r[4] )
+{
+    v128_t s02 = wasm_i32x4_add( r[0], r[2] );
+    v128_t d02 = wasm_i32x4_sub( r[0], r[2] );
+    v128_t s13 = wasm_i32x4_add( r[1], wasm_i32x4_shr( r[3], 1 ) );
+    v128_t d13 = wasm_i32x4_sub( wasm_i32x4_shr( r[1], 1 ), r[3] );
+    v128_t c32 = wasm_i32x4_splat( 32 );
+    s02 = wasm_i32x4_add( s02, c32 );
+    d02 = wasm_i32x4_add( d02, c32 );
+    r[0] = wasm_i32x4_shr( wasm_i32x4_add( s02, s13 ), 6 );
+    r[1] = wasm_i32x4_shr( wasm_i32x4_add( d02, d13 ), 6 );
+    r[2] = wasm_i32x4_shr( wasm_i32x4_sub( d02, d13 ), 6 );
+    r[3] = wasm_i32x4_shr( wasm_i32x4_sub( s02, s13 ), 6 );
+}
+
+/* adds the inverse transforms of dct0 and dct1 to the left and right 4x4 of
+ * an 8x4 block, or of dct0 only to a 4x4 one when w is 4 */
+static ALWAYS_INLINE void add8x4_idct( pixel *p_dst, dctcoef dct0[16], dctcoef dct1[16], int w )
+{
+    v128_t r[4], lo[4], hi[4];
+    for( int i = 0; i < 4; i++ )
+    {
+        r[i] = wasm_v128_load64_zero( dct0 + i * 4 );
+        if( w == 8 )
+            r[i] = wasm_v128_load64_lane( dct1 + i * 4, r[i], 1 );
+    }
+    idct4_1d_i16( r );
+    transpose_4x4x2( r );
+    for( int i = 0; i < 4; i++ )
+    {
+        lo[i] = wasm_i32x4_extend_low_i16x8( r[i] );
+        hi[i] = wasm_i32x4_extend_high_i16x8( r[i] );
+    }
+    idct4_1d_i32( lo );
+    if( w == 8 )
+        idct4_1d_i32( hi );
+    for( int y = 0; y < 4; y++, p_dst += FDEC_STRIDE )
+    {
+        v128_t d = wasm_i16x8_narrow_i32x4( lo[y], hi[y] );
+        v128_t p = wasm_u16x8_load8x8( p_dst );
+        p = wasm_u8x16_narrow_i16x8( wasm_i16x8_add( p, d ), d );
+        if( w == 8 )
+            wasm_v128_store64_lane( p_dst, p, 0 );
+        else
+            wasm_v128_store32_lane( p_dst, p, 0 );
+    }
+}
+
+static void add4x4_idct_simd128( pixel *p_dst, dctcoef dct[16] )
+{
+    add8x4_idct( p_dst, dct, NULL, 4 );
+}
+
+static void add8x8_idct_simd128( pixel *p_dst, dctcoef dct[4][16] )
+{
+    add8x4_idct( &p_dst[0], dct[0], dct[1], 8 );
+    add8x4_idct( &p_dst[4*FDEC_STRIDE], dct[2], dct[3], 8 );
+}
+
+static void add16x16_idct_simd128( pixel *p_dst, dctcoef dct[16][16] )
+{
+    add8x8_idct_simd128( &p_dst[0], &dct[0] );
+    add8x8_idct_simd128( &p_dst[8], &dct[4] );
+    add8x8_idct_simd128( &p_dst[8*FDEC_STRIDE+0], &dct[8] );
+    add8x8_idct_simd128( &p_dst[8*FDEC_STRIDE+8], &dct[12] );
+}
+#endif // !HIGH_BIT_DEPTH && __wasm_simd128__
+
+void x264_dct_init_wasm( uint32_t cpu, x264_dct_function_t *dctf )
+{
+#if !HIGH_BIT_DEPTH && defined(__wasm_simd128__)
+    if( !(cpu&X264_CPU_SIMD128) )
+        return;
+
+    dctf->sub4x4_dct    = sub4x4_dct_simd128;
+    dctf->add4x4_idct   = add4x4_idct_simd128;
+    dctf->sub8x8_dct    = sub8x8_dct_simd128;
+    dctf->add8x8_idct   = add8x8_idct_simd128;
+    dctf->sub16x16_dct  = sub16x16_dct_simd128;
+    dctf->add16x16_idct = add16x16_idct_simd128;
+#endif // !HIGH_BIT_DEPTH && __wasm_simd128__
+}
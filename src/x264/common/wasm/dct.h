@@ -0,0 +1,25 @@
+/*****************************************************************************
+ * dct.h: wasm transform
+ *****************************************************************************
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *****************************************************************************/
+
+#ifndef X264_WASM_DCT_H
+#define X264_WASM_DCT_H
+
+#define x264_dct_init_wasm x264_template(dct_init_wasm)
+void x264_dct_init_wasm( uint32_t cpu, x264_dct_function_t *dctf );
+
+#endif
@@ -0,0 +1,396 @@
+/*****************************************************************************
+ * pixel.c: wasm pixel metrics
+ *****************************************************************************
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *****************************************************************************/
+
+/* WebAssembly SIMD128 SAD, SSD, SATD, SA8D and variance of 8-bit pixels,
+ * selected by X264_CPU_SIMD128 when x264 is built with -msimd128. */
+
+#include "common/common.h"
+#include "pixel.h"
+
+#if !HIGH_BIT_DEPTH && defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+
+/* w pixels of a row, w is 16, 8 or 4 */
+static ALWAYS_INLINE v128_t load_row( pixel *pix, int w )
+{
+    if( w == 16 )
+        return wasm_v128_load( pix );
+    if( w == 8 )
+        return wasm_v128_load64_zero( pix );
+    return wasm_v128_load32_zero( pix );
+}
+
+static ALWAYS_INLINE v128_t absdiff_u8( v128_t a, v128_t b )
+{
+    return wasm_v128_or( wasm_u8x16_sub_sat( a, b ), wasm_u8x16_sub_sat( b, a ) );
+}
+
+static ALWAYS_INLINE int hsum_i32( v128_t v )
+{
+    v = wasm_i32x4_add( v, wasm_i32x4_shuffle( v, v, 2, 3, 0, 1 ) );
+    v = wasm_i32x4_add( v, wasm_i32x4_shuffle( v, v, 1, 0, 3, 2 ) );
+    return wasm_i32x4_extract_lane( v, 0 );
+}
+
+static ALWAYS_INLINE int hsum_u16( v128_t v )
+{
+    return hsum_i32( wasm_u32x4_extadd_pairwise_u16x8( v ) );
+}
+
+/****************************************************************************
+ * SAD, the sum of 16 rows of |diff| fits the 16-bit lanes
+ ****************************************************************************/
+static ALWAYS_INLINE int sad_wxh( pixel *pix1, intptr_t i_pix1, pixel *pix2, intptr_t i_pix2,
+                                  int w, int h )
+{
+    v128_t sum = wasm_i16x8_splat( 0 );
+    for( int y = 0; y < h; y++, pix1 += i_pix1, pix2 += i_pix2 )
+    {
+        v128_t ad = absdiff_u8( load_row( pix1, w ), load_row( pix2, w ) );
+        sum = wasm_i16x8_add( sum, wasm_u16x8_extadd_pairwise_u8x16( ad ) );
+    }
+    return hsum_u16( sum );
+}
+
+static ALWAYS_INLINE void sad_x4_wxh( pixel *fenc, pixel **pix, intptr_t i_stride,
+                                      int *scores, int n, int w, int h )
+{
+    v128_t sum[4];
+    for( int i = 0; i < n; i++ )
+        sum[i] = wasm_i16x8_splat( 0 );
+    for( int y = 0; y < h; y++ )
+    {
+        v128_t e = load_row( fenc + y * FENC_STRIDE, w );
+        for( int i = 0; i < n; i++ )
+        {
+            v128_t ad = absdiff_u8( e, load_row( pix[i] + y * i_stride, w ) );
+            sum[i] = wasm_i16x8_add( sum[i], wasm_u16x8_extadd_pairwise_u8x16( ad ) );
+        }
+    }
+    for( int i = 0; i < n; i++ )
+        scores[i] = hsum_u16( sum[i] );
+}
+
+#define PIXEL_SAD_SIMD128( w, h ) \
+static int pixel_sad_##w##x##h##_simd128( pixel *pix1, intptr_t i_pix1, pixel *pix2, intptr_t i_pix2 ) \
+{ \
+    return sad_wxh( pix1, i_pix1, pix2, i_pix2, w, h ); \
+} \
+static void pixel_sad_x3_##w##x##h##_simd128( pixel *fenc, pixel *pix0, pixel *pix1, pixel *pix2, \
+                                              intptr_t i_stride, int scores[3] ) \
+{ \
+    pixel *pix[3] = { pix0, pix1, pix2 }; \
+    sad_x4_wxh( fenc, pix, i_stride, scores, 3, w, h ); \
+} \
+static void pixel_sad_x4_##w##x##h##_simd128( pixel *fenc, pixel *pix0, pixel *pix1, pixel *pix2, \
+                                              pixel *pix3, intptr_t i_stride, int scores[4] ) \
+{ \
+    pixel *pix[4] = { pix0, pix1, pix2, pix3 }; \
+    sad_x4_wxh( fenc, pix, i_stride, scores, 4, w, h ); \
+}
+
+PIXEL_SAD_SIMD128( 16, 16 )
+PIXEL_SAD_SIMD128( 16,  8 )
+PIXEL_SAD_SIMD128(  8, 16 )
+PIXEL_SAD_SIMD128(  8,  8 )
+PIXEL_SAD_SIMD128(  8,  4 )
+PIXEL_SAD_SIMD128(  4,  8 )
+PIXEL_SAD_SIMD128(  4,  4 )
+
+/****************************************************************************
+ * SSD
+ ****************************************************************************/
+static ALWAYS_INLINE int ssd_wxh( pixel *pix1, intptr_t i_pix1, pixel *pix2, intptr_t i_pix2,
+                                  int w, int h )
+{
+    v128_t sum = wasm_i32x4_splat( 0 );
+    for( int y = 0; y < h; y++, pix1 += i_pix1, pix2 += i_pix2 )
+    {
+        v128_t a = load_row( pix1, w ), b = load_row( pix2, w );
+        v128_t d = wasm_i16x8_sub( wasm_u16x8_extend_low_u8x16( a ), wasm_u16x8_extend_low_u8x16( b ) );
+        sum = wasm_i32x4_add( sum, wasm_i32x4_dot_i16x8( d, d ) );
+        if( w == 16 )
+        {
+            d = wasm_i16x8_sub( wasm_u16x8_extend_high_u8x16( a ), wasm_u16x8_extend_high_u8x16( b ) );
+            sum = wasm_i32x4_add( sum, wasm_i32x4_dot_i16x8( d, d ) );
+        }
+    }
+    return hsum_i32( sum );
+}
+
+#define PIXEL_SSD_SIMD128( w, h ) \
+static int pixel_ssd_##w##x##h##_simd128( pixel *pix1, intptr_t i_pix1, pixel *pix2, intptr_t i_pix2 ) \
+{ \
+    return ssd_wxh( pix1, i_pix1, pix2, i_pix2, w, h ); \
+}
+
+PIXEL_SSD_SIMD128( 16, 16 )
+PIXEL_SSD_SIMD128( 16,  8 )
+PIXEL_SSD_SIMD128(  8, 16 )
+PIXEL_SSD_SIMD128(  8,  8 )
+PIXEL_SSD_SIMD128(  8,  4 )
+PIXEL_SSD_SIMD128(  4,  8 )
+PIXEL_SSD_SIMD128(  4,  4 )
+
+/****************************************************************************
+ * SATD / SA8D
+ *
+ * Every coefficient of a 4x4 Hadamard has the parity of the sum of the block,
+ * so the C sum of |coef| >> 1 per 4x4 or 8x4 is the exact half of the sum of
+ * the whole block. The last butterfly is folded in with
+ * |a + b| + |a - b| = 2 * max(|a|, |b|), which gives that half directly.
+ ****************************************************************************/
+#define SUMSUB( s, d, a, b ) \
+{ \
+    v128_t t_ = a; \
+    s = wasm_i16x8_add( t_, b ); \
+    d = wasm_i16x8_sub( t_, b ); \
+}
+
+static ALWAYS_INLINE v128_t absmax( v128_t a, v128_t b )
+{
+    return wasm_u16x8_max( wasm_i16x8_abs( a ), wasm_i16x8_abs( b ) );
+}
+
+/* row diffs of up to 8 pixels as 16-bit lanes */
+static ALWAYS_INLINE v128_t diff_row( pixel *pix1, pixel *pix2, int w )
+{
+    if( w == 4 )
+        return wasm_i16x8_sub( wasm_u16x8_extend_low_u8x16( wasm_v128_load32_zero( pix1 ) ),
+                               wasm_u16x8_extend_low_u8x16( wasm_v128_load32_zero( pix2 ) ) );
+    return wasm_i16x8_sub( wasm_u16x8_load8x8( pix1 ), wasm_u16x8_load8x8( pix2 ) );
+}
+
+/* half the sum of |coef| of the 4x4 Hadamards of the left and right 4x4 of
+ * an 8x4 block, as 16-bit lanes */
+static ALWAYS_INLINE v128_t satd_8x4( pixel *pix1, intptr_t i_pix1, pixel *pix2, intptr_t i_pix2, int w )
+{
+    v128_t d0 = diff_row( pix1 + 0 * i_pix1, pix2 + 0 * i_pix2, w );
+    v128_t d1 = diff_row( pix1 + 1 * i_pix1, pix2 + 1 * i_pix2, w );
+    v128_t d2 = diff_row( pix1 + 2 * i_pix1, pix2 + 2 * i_pix2, w );
+    v128_t d3 = diff_row( pix1 + 3 * i_pix1, pix2 + 3 * i_pix2, w );
+    v128_t a0, a1, a2, a3, t0, t1, t2, t3;
+
+    /* vertical */
+    SUMSUB( a0, a1, d0, d1 );
+    SUMSUB( a2, a3, d2, d3 );
+    SUMSUB( d0, d2, a0, a2 );
+    SUMSUB( d1, d3, a1, a3 );
+    /* transpose both 4x4 */
+    t0 = wasm_i16x8_shuffle( d0, d1, 0, 8, 1, 9, 4, 12, 5, 13 );
+    t1 = wasm_i16x8_shuffle( d0, d1, 2, 10, 3, 11, 6, 14, 7, 15 );
+    t2 = wasm_i16x8_shuffle( d2, d3, 0, 8, 1, 9, 4, 12, 5, 13 );
+    t3 = wasm_i16x8_shuffle( d2, d3, 2, 10, 3, 11, 6, 14, 7, 15 );
+    d0 = wasm_i32x4_shuffle( t0, t2, 0, 4, 2, 6 );
+    d1 = wasm_i32x4_shuffle( t0, t2, 1, 5, 3, 7 );
+    d2 = wasm_i32x4_shuffle( t1, t3, 0, 4, 2, 6 );
+    d3 = wasm_i32x4_shuffle( t1, t3, 1, 5, 3, 7 );
+    /* horizontal */
+    SUMSUB( a0, a1, d0, d1 );
+    SUMSUB( a2, a3, d2, d3 );
+    return wasm_i16x8_add( absmax( a0, a2 ), absmax( a1, a3 ) );
+}
+
+static ALWAYS_INLINE int satd_wxh( pixel *pix1, intptr_t i_pix1, pixel *pix2, intptr_t i_pix2,
+                                   int w, int h )
+{
+    v128_t sum = wasm_i32x4_splat( 0 );
+    for( int y = 0; y < h; y += 4 )
+        for( int x = 0; x < w; x += 8 )
+        {
+            v128_t s = satd_8x4( pix1 + y * i_pix1 + x, i_pix1, pix2 + y * i_pix2 + x, i_pix2, w );
+            sum = wasm_i32x4_add( sum, wasm_u32x4_extadd_pairwise_u16x8( s ) );
+        }
+    return hsum_i32( sum );
+}
+
+#define PIXEL_SATD_SIMD128( w, h ) \
+static int pixel_satd_##w##x##h##_simd128( pixel *pix1, intptr_t i_pix1, pixel *pix2, intptr_t i_pix2 ) \
+{ \
+    return satd_wxh( pix1, i_pix1, pix2, i_pix2, w, h ); \
+} \
+static void pixel_satd_x3_##w##x##h##_simd128( pixel *fenc, pixel *pix0, pixel *pix1, pixel *pix2, \
+                                               intptr_t i_stride, int scores[3] ) \
+{ \
+    scores[0] = satd_wxh( fenc, FENC_STRIDE, pix0, i_stride, w, h ); \
+    scores[1] = satd_wxh( fenc, FENC_STRIDE, pix1, i_stride, w, h ); \
+    scores[2] = satd_wxh( fenc, FENC_STRIDE, pix2, i_stride, w, h ); \
+} \
+static void pixel_satd_x4_##w##x##h##_simd128( pixel *fenc, pixel *pix0, pixel *pix1, pixel *pix2, \
+                                               pixel *pix3, intptr_t i_stride, int scores[4] ) \
+{ \
+    scores[0] = satd_wxh( fenc, FENC_STRIDE, pix0, i_stride, w, h ); \
+    scores[1] = satd_wxh( fenc, FENC_STRIDE, pix1, i_stride, w, h ); \
+    scores[2] = satd_wxh( fenc, FENC_STRIDE, pix2, i_stride, w, h ); \
+    scores[3] = satd_wxh( fenc, FENC_STRIDE, pix3, i_stride, w, h ); \
+}
+
+PIXEL_SATD_SIMD128( 16, 16 )
+PIXEL_SATD_SIMD128( 16,  8 )
+PIXEL_SATD_SIMD128(  8, 16 )
+PIXEL_SATD_SIMD128(  8,  8 )
+PIXEL_SATD_SIMD128(  8,  4 )
+PIXEL_SATD_SIMD128(  4,  8 )
+PIXEL_SATD_SIMD128(  4,  4 )
+
+/* half the sum of |coef| of the 8x8 Hadamard, as 16-bit lanes */
+static ALWAYS_INLINE v128_t sa8d_8x8( pixel *pix1, intptr_t i_pix1, pixel *pix2, intptr_t i_pix2 )
+{
+    v128_t d[8], a[8], t[8];
+
+    for( int i = 0; i < 8; i++ )
+        d[i] = diff_row( pix1 + i * i_pix1, pix2 + i * i_pix2, 8 );
+    /* vertical */
+    SUMSUB( a[0], a[1], d[0], d[1] );
+    SUMSUB( a[2], a[3], d[2], d[3] );
+    SUMSUB( a[4], a[5], d[4], d[5] );
+    SUMSUB( a[6], a[7], d[6], d[7] );
+    SUMSUB( d[0], d[2], a[0], a[2] );
+    SUMSUB( d[1], d[3], a[1], a[3] );
+    SUMSUB( d[4], d[6], a[4], a[6] );
+    SUMSUB( d[5], d[7], a[5], a[7] );
+    SUMSUB( a[0], a[4], d[0], d[4] );
+    SUMSUB( a[1], a[5], d[1], d[5] );
+    SUMSUB( a[2], a[6], d[2], d[6] );
+    SUMSUB( a[3], a[7], d[3], d[7] );
+    /* transpose */
+    for( int i = 0; i < 8; i += 2 )
+    {
+        t[i]   = wasm_i16x8_shuffle( a[i], a[i+1], 0, 8, 1, 9, 2, 10, 3, 11 );
+        t[i+1] = wasm_i16x8_shuffle( a[i], a[i+1], 4, 12, 5, 13, 6, 14, 7, 15 );
+    }
+    for( int i = 0; i < 8; i += 4 )
+    {
+        a[i]   = wasm_i32x4_shuffle( t[i],   t[i+2], 0, 4, 1, 5 );
+        a[i+1] = wasm_i32x4_shuffle( t[i],   t[i+2], 2, 6, 3, 7 );
+        a[i+2] = wasm_i32x4_shuffle( t[i+1], t[i+3], 0, 4, 1, 5 );
+        a[i+3] = wasm_i32x4_shuffle( t[i+1], t[i+3], 2, 6, 3, 7 );
+    }
+    for( int i = 0; i < 4; i++ )
+    {
+        d[2*i]   = wasm_i64x2_shuffle( a[i], a[i+4], 0, 2 );
+        d[2*i+1] = wasm_i64x2_shuffle( a[i], a[i+4], 1, 3 );
+    }
+    /* horizontal */
+    SUMSUB( a[0], a[1], d[0], d[1] );
+    SUMSUB( a[2], a[3], d[2], d[3] );
+    SUMSUB( a[4], a[5], d[4], d[5] );
+    SUMSUB( a[6], a[7], d[6], d[7] );
+    SUMSUB( d[0], d[2], a[0], a[2] );
+    SUMSUB( d[1], d[3], a[1], a[3] );
+    SUMSUB( d[4], d[6], a[4], a[6] );
+    SUMSUB( d[5], d[7], a[5], a[7] );
+    return wasm_i16x8_add( wasm_i16x8_add( absmax( d[0], d[4] ), absmax( d[1], d[5] ) ),
+                           wasm_i16x8_add( absmax( d[2], d[6] ), absmax( d[3], d[7] ) ) );
+}
+
+static int pixel_sa8d_8x8_simd128( pixel *pix1, intptr_t i_pix1, pixel *pix2, intptr_t i_pix2 )
+{
+    int sum = hsum_u16( sa8d_8x8( pix1, i_pix1, pix2, i_pix2 ) );
+    return (sum + 1) >> 1;
+}
+
+static int pixel_sa8d_16x16_simd128( pixel *pix1, intptr_t i_pix1, pixel *pix2, intptr_t i_pix2 )
+{
+    v128_t sum = wasm_i32x4_splat( 0 );
+    for( int y = 0; y < 16; y += 8 )
+        for( int x = 0; x < 16; x += 8 )
+        {
+            v128_t s = sa8d_8x8( pix1 + y * i_pix1 + x, i_pix1, pix2 + y * i_pix2 + x, i_pix2 );
+            sum = wasm_i32x4_add( sum, wasm_u32x4_extadd_pairwise_u16x8( s ) );
+        }
+    return (hsum_i32( sum ) + 1) >> 1;
+}
+
+/****************************************************************************
+ * variance, sum and sum of squares of a block
+ ****************************************************************************/
+static ALWAYS_INLINE uint64_t var_wxh( pixel *pix, intptr_t i_stride, int w, int h )
+{
+    v128_t sum = wasm_i16x8_splat( 0 ), sqr = wasm_i32x4_splat( 0 );
+    for( int y = 0; y < h; y++, pix += i_stride )
+    {
+        v128_t p = load_row( pix, w );
+        v128_t lo = wasm_u16x8_extend_low_u8x16( p );
+        sum = wasm_i16x8_add( sum, wasm_u16x8_extadd_pairwise_u8x16( p ) );
+        sqr = wasm_i32x4_add( sqr, wasm_i32x4_dot_i16x8( lo, lo ) );
+        if( w == 16 )
+        {
+            v128_t hi = wasm_u16x8_extend_high_u8x16( p );
+            sqr = wasm_i32x4_add( sqr, wasm_i32x4_dot_i16x8( hi, hi ) );
+        }
+    }
+    return (uint32_t)hsum_u16( sum ) + ((uint64_t)(uint32_t)hsum_i32( sqr ) << 32);
+}
+
+static uint64_t pixel_var_16x16_simd128( pixel *pix, intptr_t i_stride )
+{
+    return var_wxh( pix, i_stride, 16, 16 );
+}
+
+static uint64_t pixel_var_8x16_simd128( pixel *pix, intptr_t i_stride )
+{
+    return var_wxh( pix, i_stride, 8, 16 );
+}
+
+static uint64_t pixel_var_8x8_simd128( pixel *pix, intptr_t i_stride )
+{
+    return var_wxh( pix, i_stride, 8, 8 );
+}
+#endif // !HIGH_BIT_DEPTH && __wasm_simd128__
+
+void x264_pixel_init_wasm( uint32_t cpu, x264_pixel_function_t *pixf )
+{
+#if !HIGH_BIT_DEPTH && defined(__wasm_simd128__)
+    if( !(cpu&X264_CPU_SIMD128) )
+        return;
+
+#define INIT7( name ) \
+    pixf->name[PIXEL_16x16] = pixel_##name##_16x16_simd128; \
+    pixf->name[PIXEL_16x8]  = pixel_##name##_16x8_simd128; \
+    pixf->name[PIXEL_8x16]  = pixel_##name##_8x16_simd128; \
+    pixf->name[PIXEL_8x8]   = pixel_##name##_8x8_simd128; \
+    pixf->name[PIXEL_8x4]   = pixel_##name##_8x4_simd128; \
+    pixf->name[PIXEL_4x8]   = pixel_##name##_4x8_simd128; \
+    pixf->name[PIXEL_4x4]   = pixel_##name##_4x4_simd128;
+
+    INIT7( sad );
+    INIT7( sad_x3 );
+    INIT7( sad_x4 );
+    INIT7( ssd );
+    INIT7( satd );
+    INIT7( satd_x3 );
+    INIT7( satd_x4 );
+#undef INIT7
+
+    pixf->sad_aligned[PIXEL_16x16] = pixel_sad_16x16_simd128;
+    pixf->sad_aligned[PIXEL_16x8]  = pixel_sad_16x8_simd128;
+    pixf->sad_aligned[PIXEL_8x16]  = pixel_sad_8x16_simd128;
+    pixf->sad_aligned[PIXEL_8x8]   = pixel_sad_8x8_simd128;
+    pixf->sad_aligned[PIXEL_8x4]   = pixel_sad_8x4_simd128;
+    pixf->sad_aligned[PIXEL_4x8]   = pixel_sad_4x8_simd128;
+    pixf->sad_aligned[PIXEL_4x4]   = pixel_sad_4x4_simd128;
+
+    pixf->sa8d[PIXEL_16x16] = pixel_sa8d_16x16_simd128;
+    pixf->sa8d[PIXEL_8x8]   = pixel_sa8d_8x8_simd128;
+
+    pixf->var[PIXEL_16x16] = pixel_var_16x16_simd128;
+    pixf->var[PIXEL_8x16]  = pixel_var_8x16_simd128;
+    pixf->var[PIXEL_8x8]   = pixel_var_8x8_simd128;
+#endif // !HIGH_BIT_DEPTH && __wasm_simd128__
+}
@@ -0,0 +1,117 @@
+/*****************************************************************************
+ * quant.c: wasm quantization
+ *****************************************************************************
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *****************************************************************************/
+
+/* WebAssembly SIMD128 quant / dequant of 8-bit coefficients, selected by
+ * X264_CPU_SIMD128 when x264 is built with -msimd128. */
+
+#include "common/common.h"
+#include "quant.h"
+
+#if !HIGH_BIT_DEPTH && defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+
+/* QUANT_ONE of 8 coefficients, the bias is added with unsigned saturation
+ * like the x86 paddusw, otherwise it is exact */
+static ALWAYS_INLINE v128_t quant_8( dctcoef *dct, udctcoef *mf, udctcoef *bias )
+{
+    v128_t c = wasm_v128_load( dct );
+    v128_t t = wasm_u16x8_add_sat( wasm_i16x8_abs( c ), wasm_v128_load( bias ) );
+    v128_t m = wasm_v128_load( mf );
+    v128_t lo = wasm_u32x4_extmul_low_u16x8( t, m );
+    v128_t hi = wasm_u32x4_extmul_high_u16x8( t, m );
+    v128_t q = wasm_i16x8_shuffle( lo, hi, 1, 3, 5, 7, 9, 11, 13, 15 );
+    q = wasm_v128_bitselect( q, wasm_i16x8_neg( q ), wasm_i16x8_gt( c, wasm_i16x8_splat( 0 ) ) );
+    wasm_v128_store( dct, q );
+    return q;
+}
+
+static int quant_4x4_simd128( dctcoef dct[16], udctcoef mf[16], udctcoef bias[16] )
+{
+    v128_t nz = wasm_v128_or( quant_8( dct, mf, bias ), quant_8( dct+8, mf+8, bias+8 ) );
+    return wasm_v128_any_true( nz );
+}
+
+static int quant_8x8_simd128( dctcoef dct[64], udctcoef mf[64], udctcoef bias[64] )
+{
+    v128_t nz = wasm_i16x8_splat( 0 );
+    for( int i = 0; i < 64; i += 8 )
+        nz = wasm_v128_or( nz, quant_8( dct+i, mf+i, bias+i ) );
+    return wasm_v128_any_true( nz );
+}
+
+static int quant_4x4x4_simd128( dctcoef dct[4][16], udctcoef mf[16], udctcoef bias[16] )
+{
+    int nza = 0;
+    for( int j = 0; j < 4; j++ )
+        nza |= quant_4x4_simd128( dct[j], mf, bias ) << j;
+    return nza;
+}
+
+/* DEQUANT_SHL / DEQUANT_SHR of 8 coefficients in 32 bits, then truncated to
+ * dctcoef like the C store */
+static ALWAYS_INLINE void dequant_8( dctcoef *dct, int *dequant_mf, int i_qbits )
+{
+    v128_t c = wasm_v128_load( dct );
+    v128_t lo = wasm_i32x4_mul( wasm_i32x4_extend_low_i16x8( c ), wasm_v128_load( dequant_mf ) );
+    v128_t hi = wasm_i32x4_mul( wasm_i32x4_extend_high_i16x8( c ), wasm_v128_load( dequant_mf+4 ) );
+    if( i_qbits >= 0 )
+    {
+        lo = wasm_i32x4_shl( lo, i_qbits );
+        hi = wasm_i32x4_shl( hi, i_qbits );
+    }
+    else
+    {
+        v128_t f = wasm_i32x4_splat( 1 << (-i_qbits-1) );
+        lo = wasm_i32x4_shr( wasm_i32x4_add( lo, f ), -i_qbits );
+        hi = wasm_i32x4_shr( wasm_i32x4_add( hi, f ), -i_qbits );
+    }
+    wasm_v128_store( dct, wasm_i16x8_shuffle( lo, hi, 0, 2, 4, 6, 8, 10, 12, 14 ) );
+}
+
+static void dequant_4x4_simd128( dctcoef dct[16], int dequant_mf[6][16], int i_qp )
+{
+    const int i_mf = i_qp%6;
+    const int i_qbits = i_qp/6 - 4;
+
+    dequant_8( dct, dequant_mf[i_mf], i_qbits );
+    dequant_8( dct+8, dequant_mf[i_mf]+8, i_qbits );
+}
+
+static void dequant_8x8_simd128( dctcoef dct[64], int dequant_mf[6][64], int i_qp )
+{
+    const int i_mf = i_qp%6;
+    const int i_qbits = i_qp/6 - 6;
+
+    for( int i = 0; i < 64; i += 8 )
+        dequant_8( dct+i, dequant_mf[i_mf]+i, i_qbits );
+}
+#endif // !HIGH_BIT_DEPTH && __wasm_simd128__
+
+void x264_quant_init_wasm( x264_t *h, uint32_t cpu, x264_quant_function_t *pf )
+{
+#if !HIGH_BIT_DEPTH && defined(__wasm_simd128__)
+    if( !(cpu&X264_CPU_SIMD128) )
+        return;
+
+    pf->quant_4x4   = quant_4x4_simd128;
+    pf->quant_4x4x4 = quant_4x4x4_simd128;
+    pf->quant_8x8   = quant_8x8_simd128;
+    pf->dequant_4x4 = dequant_4x4_simd128;
+    pf->dequant_8x8 = dequant_8x8_simd128;
+#endif // !HIGH_BIT_DEPTH && __wasm_simd128__
+}
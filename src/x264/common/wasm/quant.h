@@ -0,0 +1,25 @@
+/*****************************************************************************
+ * quant.h: wasm quantization
+ *****************************************************************************
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *****************************************************************************/
+
+#ifndef X264_WASM_QUANT_H
+#define X264_WASM_QUANT_H
+
+#define x264_quant_init_wasm x264_template(quant_init_wasm)
+void x264_quant_init_wasm( x264_t *h, uint32_t cpu, x264_quant_function_t *pf );
+
+#endif
@@ -0,0 +1,325 @@
+/*****************************************************************************
+ * checkasm.c: wasm kernels test
+ *****************************************************************************
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *****************************************************************************/
+
+/* Runs every X264_CPU_SIMD128 function against the C one it replaces on
+ * random inputs, in the manner of tools/checkasm.c, and returns 1 when one
+ * differs. Usage: checkasm [seed]
+ * Built against the 8-bit objects: -DBIT_DEPTH=8 -DHIGH_BIT_DEPTH=0 */
+
+#include "common/common.h"
+
+#include <time.h>
+
+#define TRIES 100
+
+static uint32_t seed;
+static int nb_failed;
+
+static uint32_t rnd( void )
+{
+    seed = seed * 1664525 + 1013904223;
+    return seed >> 8;
+}
+
+/* 16x16 blocks at any position of 64x64 pictures */
+static pixel pbuf1[64*64];
+static pixel pbuf2[64*64];
+static pixel pbuf3[64*64];
+static pixel pbuf4[64*64];
+
+static void randomize( pixel *buf, int size, int range )
+{
+    for( int i = 0; i < size; i++ )
+        buf[i] = rnd() % range;
+}
+
+static void report( const char *name, int ok )
+{
+    printf( " - %-8s [%s]\n", name, ok ? "OK" : "FAILED" );
+    nb_failed += !ok;
+}
+
+static int check_pixel( void )
+{
+    static const char *const names[7] = { "16x16", "16x8", "8x16", "8x8", "8x4", "4x8", "4x4" };
+    x264_pixel_function_t pixel_c, pixel_simd;
+    int ok = 1;
+
+    x264_pixel_init( 0, &pixel_c );
+    x264_pixel_init( X264_CPU_SIMD128, &pixel_simd );
+
+#define TEST_PIXEL( name, i ) \
+    if( pixel_c.name[i] != pixel_simd.name[i] ) \
+        for( int t = 0; t < TRIES; t++ ) \
+        { \
+            pixel *pix2 = pbuf2 + rnd() % (48*64); \
+            int res_c = pixel_c.name[i]( pbuf1, FENC_STRIDE, pix2, 64 ); \
+            int res_simd = pixel_simd.name[i]( pbuf1, FENC_STRIDE, pix2, 64 ); \
+            if( res_c != res_simd ) \
+            { \
+                ok = 0; \
+                fprintf( stderr, #name "[%d] (%s): %d != %d\n", i, names[i], res_c, res_simd ); \
+                break; \
+            } \
+        }
+
+#define TEST_PIXEL_X( name, n, i ) \
+    if( pixel_c.name##_x##n[i] != pixel_simd.name##_x##n[i] ) \
+        for( int t = 0; t < TRIES; t++ ) \
+        { \
+            int res_c[4] = {0}, res_simd[4] = {0}; \
+            pixel *pix2 = pbuf2 + rnd() % (48*64); \
+            pixel *pix3 = pbuf3 + rnd() % (48*64); \
+            pixel *pix4 = pbuf4 + rnd() % (48*64); \
+            if( n == 3 ) \
+            { \
+                pixel_c.name##_x3[i]( pbuf1, pix2, pix3, pix4, 64, res_c ); \
+                pixel_simd.name##_x3[i]( pbuf1, pix2, pix3, pix4, 64, res_simd ); \
+            } \
+            else \
+            { \
+                pixel_c.name##_x4[i]( pbuf1, pix2, pix3, pix4, pbuf2, 64, res_c ); \
+                pixel_simd.name##_x4[i]( pbuf1, pix2, pix3, pix4, pbuf2, 64, res_simd ); \
+            } \
+            if( memcmp( res_c, res_simd, sizeof(res_c) ) ) \
+            { \
+                ok = 0; \
+                fprintf( stderr, #name "_x" #n "[%d] (%s): [%d,%d,%d,%d] != [%d,%d,%d,%d]\n", i, names[i], \
+                         res_c[0], res_c[1], res_c[2], res_c[3], \
+                         res_simd[0], res_simd[1], res_simd[2], res_simd[3] ); \
+                break; \
+            } \
+        }
+
+    for( int i = 0; i < 7; i++ )
+    {
+        TEST_PIXEL( sad, i );
+        TEST_PIXEL( sad_aligned, i );
+        TEST_PIXEL( ssd, i );
+        TEST_PIXEL( satd, i );
+        TEST_PIXEL_X( sad, 3, i );
+        TEST_PIXEL_X( sad, 4, i );
+        TEST_PIXEL_X( satd, 3, i );
+        TEST_PIXEL_X( satd, 4, i );
+    }
+    for( int i = PIXEL_16x16; i <= PIXEL_8x8; i += PIXEL_8x8 )
+    {
+        if( pixel_c.sa8d[i] == pixel_simd.sa8d[i] )
+            continue;
+        for( int t = 0; t < TRIES; t++ )
+        {
+            pixel *pix2 = pbuf2 + rnd() % (48*64);
+            int res_c = pixel_c.sa8d[i]( pbuf1, FENC_STRIDE, pix2, 64 );
+            int res_simd = pixel_simd.sa8d[i]( pbuf1, FENC_STRIDE, pix2, 64 );
+            if( res_c != res_simd )
+            {
+                ok = 0;
+                fprintf( stderr, "sa8d[%d] (%s): %d != %d\n", i, names[i], res_c, res_simd );
+                break;
+            }
+        }
+    }
+    for( int i = 0; i < 4; i++ )
+    {
+        if( pixel_c.var[i] == pixel_simd.var[i] )
+            continue;
+        for( int t = 0; t < TRIES; t++ )
+        {
+            pixel *pix2 = pbuf2 + rnd() % (48*64);
+            uint64_t res_c = pixel_c.var[i]( pix2, 64 );
+            uint64_t res_simd = pixel_simd.var[i]( pix2, 64 );
+            if( res_c != res_simd )
+            {
+                ok = 0;
+                fprintf( stderr, "var[%d]: %"PRIu64" != %"PRIu64"\n", i, res_c, res_simd );
+                break;
+            }
+        }
+    }
+    report( "pixel", ok );
+    return ok;
+}
+
+static int check_dct( void )
+{
+    x264_dct_function_t dct_c, dct_simd;
+    ALIGNED_16( dctcoef dct1[16][16] );
+    ALIGNED_16( dctcoef dct2[16][16] );
+    ALIGNED_16( pixel fdec1[16*FDEC_STRIDE] );
+    ALIGNED_16( pixel fdec2[16*FDEC_STRIDE] );
+    int ok = 1;
+
+    x264_dct_init( 0, &dct_c );
+    x264_dct_init( X264_CPU_SIMD128, &dct_simd );
+
+#define TEST_DCT( name, t1, t2, size ) \
+    if( dct_c.name != dct_simd.name ) \
+    { \
+        memset( dct1, 0, sizeof(dct1) ); \
+        memset( dct2, 0, sizeof(dct2) ); \
+        dct_c.name( t1, pbuf1, pbuf2 ); \
+        dct_simd.name( t2, pbuf1, pbuf2 ); \
+        if( memcmp( t1, t2, size*sizeof(dctcoef) ) ) \
+        { \
+            ok = 0; \
+            fprintf( stderr, #name " [FAILED]\n" ); \
+        } \
+    }
+
+#define TEST_IDCT( name, src, size ) \
+    if( dct_c.name != dct_simd.name ) \
+    { \
+        memcpy( fdec1, pbuf3, sizeof(fdec1) ); \
+        memcpy( fdec2, pbuf3, sizeof(fdec2) ); \
+        memcpy( dct2, src, size*sizeof(dctcoef) ); \
+        dct_c.name( fdec1, src ); \
+        dct_simd.name( fdec2, (void *)dct2 ); \
+        if( memcmp( fdec1, fdec2, sizeof(fdec1) ) ) \
+        { \
+            ok = 0; \
+            fprintf( stderr, #name " [FAILED]\n" ); \
+        } \
+    }
+
+    for( int t = 0; t < TRIES && ok; t++ )
+    {
+        /* residuals of a random range, up to the full one */
+        int range = t < TRIES/2 ? 256 : 1 + rnd() % 256;
+        randomize( pbuf1, sizeof(pbuf1), range );
+        randomize( pbuf2, sizeof(pbuf2), range );
+        randomize( pbuf3, sizeof(pbuf3), 256 );
+
+        TEST_DCT( sub4x4_dct, dct1[0], dct2[0], 16 );
+        TEST_DCT( sub8x8_dct, (void *)dct1, (void *)dct2, 4*16 );
+        TEST_DCT( sub16x16_dct, dct1, dct2, 16*16 );
+
+        /* the coefficients of the residuals, then random ones */
+        ALIGNED_16( dctcoef src[16][16] );
+        dct_c.sub16x16_dct( src, pbuf1, pbuf2 );
+        if( t & 1 )
+            for( int i = 0; i < 16*16; i++ )
+                src[i/16][i%16] = (int16_t)rnd();
+        TEST_IDCT( add4x4_idct, src[0], 16 );
+        TEST_IDCT( add8x8_idct, (void *)src, 4*16 );
+        TEST_IDCT( add16x16_idct, src, 16*16 );
+    }
+    report( "dct", ok );
+    return ok;
+}
+
+static int check_quant( void )
+{
+    x264_quant_function_t qf_c, qf_simd;
+    ALIGNED_16( dctcoef dct1[4][16] );
+    ALIGNED_16( dctcoef dct2[4][16] );
+    ALIGNED_16( dctcoef dct8_1[64] );
+    ALIGNED_16( dctcoef dct8_2[64] );
+    ALIGNED_16( udctcoef mf[64] );
+    ALIGNED_16( udctcoef bias[64] );
+    int dequant_mf[6][64];
+    x264_t *h = calloc( 1, sizeof(x264_t) );
+    int ok = 1;
+
+    if( !h )
+        return 0;
+    x264_quant_init( h, 0, &qf_c );
+    x264_quant_init( h, X264_CPU_SIMD128, &qf_simd );
+
+    for( int t = 0; t < TRIES && ok; t++ )
+    {
+        int i_qp = rnd() % (QP_MAX_SPEC+1);
+        for( int i = 0; i < 64; i++ )
+        {
+            /* the C QUANT_ONE fits int while |coef| + bias fits 16 bits and
+             * mf 15, as with the x264 quant tables */
+            dct1[i/16][i%16] = (int)(rnd() % 0x4001) - 0x2000;
+            dct8_1[i] = (int)(rnd() % 0x4001) - 0x2000;
+            if( t & 1 )
+                dct1[i/16][i%16] = dct8_1[i] = 0;
+            mf[i] = 1 + rnd() % 0x7fff;
+            bias[i] = rnd() % 0x8000;
+            for( int j = 0; j < 6; j++ )
+                dequant_mf[j][i] = 10 + rnd() % (25*16*16);
+        }
+        /* all zero blocks, nonzero ones and a mix */
+        if( t & 1 )
+            dct1[rnd()%4][rnd()%16] = dct8_1[rnd()%64] = (int)(rnd() % 0x4001) - 0x2000;
+
+#define TEST_QUANT( name, t1, t2, size, ... ) \
+        if( qf_c.name != qf_simd.name ) \
+        { \
+            memcpy( t2, t1, size*sizeof(dctcoef) ); \
+            int res_c = qf_c.name( t1, __VA_ARGS__ ); \
+            int res_simd = qf_simd.name( t2, __VA_ARGS__ ); \
+            if( res_c != res_simd || memcmp( t1, t2, size*sizeof(dctcoef) ) ) \
+            { \
+                ok = 0; \
+                fprintf( stderr, #name " [FAILED]\n" ); \
+            } \
+        }
+
+#define TEST_DEQUANT( name, t1, t2, size ) \
+        if( qf_c.name != qf_simd.name ) \
+        { \
+            memcpy( t2, t1, size*sizeof(dctcoef) ); \
+            qf_c.name( t1, (void *)dequant_mf, i_qp ); \
+            qf_simd.name( t2, (void *)dequant_mf, i_qp ); \
+            if( memcmp( t1, t2, size*sizeof(dctcoef) ) ) \
+            { \
+                ok = 0; \
+                fprintf( stderr, #name " (qp %d) [FAILED]\n", i_qp ); \
+            } \
+        }
+
+        TEST_QUANT( quant_4x4x4, dct1, dct2, 4*16, mf, bias );
+        TEST_QUANT( quant_4x4, dct1[0], dct2[0], 16, mf, bias );
+        TEST_QUANT( quant_8x8, dct8_1, dct8_2, 64, mf, bias );
+        TEST_DEQUANT( dequant_4x4, dct1[0], dct2[0], 16 );
+        TEST_DEQUANT( dequant_8x8, dct8_1, dct8_2, 64 );
+    }
+    free( h );
+    report( "quant", ok );
+    return ok;
+}
+
+int main( int argc, char *argv[] )
+{
+    seed = argc > 1 ? strtoul( argv[1], NULL, 0 ) : (uint32_t)time( NULL );
+    if( !(x264_cpu_detect() & X264_CPU_SIMD128) )
+    {
+        fprintf( stderr, "checkasm: built without -msimd128, no kernel to test\n" );
+        return 0;
+    }
+    printf( "checkasm: using random seed %u\n", seed );
+
+    randomize( pbuf1, sizeof(pbuf1), 256 );
+    randomize( pbuf2, sizeof(pbuf2), 256 );
+    randomize( pbuf3, sizeof(pbuf3), 256 );
+    randomize( pbuf4, sizeof(pbuf4), 256 );
+    check_pixel();
+    check_dct();
+    check_quant();
+
+    if( nb_failed )
+    {
+        fprintf( stderr, "checkasm: %d tests FAILED\n", nb_failed );
+        return 1;
+    }
+    printf( "checkasm: all tests passed\n" );
+    return 0;
+}
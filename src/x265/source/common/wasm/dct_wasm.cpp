@@ -0,0 +1,236 @@
+/*****************************************************************************
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *****************************************************************************/
+
+/* WebAssembly SIMD128 4x4 / 8x8 DCT and IDCT, quant and dequant of 8-bit
+ * residuals, installed by x265_setup_primitives() when param->cpuid has
+ * X265_CPU_SIMD128 and x265 is built with -msimd128 */
+
+#include "common.h"
+#include "primitives.h"
+#include "constants.h"
+
+#if !HIGH_BIT_DEPTH && defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+
+using namespace X265_NS;
+
+namespace {
+// place functions in anonymous namespace (file static)
+
+/* transposes the 4x4 of 16-bit lanes 0..3 of r[0..3] (and the 4x4 of lanes
+ * 4..7 with it) */
+inline void transpose4(v128_t* r)
+{
+    v128_t t0 = wasm_i16x8_shuffle(r[0], r[1], 0, 8, 1, 9, 4, 12, 5, 13);
+    v128_t t1 = wasm_i16x8_shuffle(r[0], r[1], 2, 10, 3, 11, 6, 14, 7, 15);
+    v128_t t2 = wasm_i16x8_shuffle(r[2], r[3], 0, 8, 1, 9, 4, 12, 5, 13);
+    v128_t t3 = wasm_i16x8_shuffle(r[2], r[3], 2, 10, 3, 11, 6, 14, 7, 15);
+
+    r[0] = wasm_i32x4_shuffle(t0, t2, 0, 4, 2, 6);
+    r[1] = wasm_i32x4_shuffle(t0, t2, 1, 5, 3, 7);
+    r[2] = wasm_i32x4_shuffle(t1, t3, 0, 4, 2, 6);
+    r[3] = wasm_i32x4_shuffle(t1, t3, 1, 5, 3, 7);
+}
+
+inline void transpose8(v128_t* r)
+{
+    v128_t t[8], a[8];
+
+    for (int i = 0; i < 8; i += 2)
+    {
+        t[i]     = wasm_i16x8_shuffle(r[i], r[i + 1], 0, 8, 1, 9, 2, 10, 3, 11);
+        t[i + 1] = wasm_i16x8_shuffle(r[i], r[i + 1], 4, 12, 5, 13, 6, 14, 7, 15);
+    }
+    for (int i = 0; i < 8; i += 4)
+    {
+        a[i]     = wasm_i32x4_shuffle(t[i], t[i + 2], 0, 4, 1, 5);
+        a[i + 1] = wasm_i32x4_shuffle(t[i], t[i + 2], 2, 6, 3, 7);
+        a[i + 2] = wasm_i32x4_shuffle(t[i + 1], t[i + 3], 0, 4, 1, 5);
+        a[i + 3] = wasm_i32x4_shuffle(t[i + 1], t[i + 3], 2, 6, 3, 7);
+    }
+    for (int i = 0; i < 4; i++)
+    {
+        r[2 * i]     = wasm_i64x2_shuffle(a[i], a[i + 4], 0, 2);
+        r[2 * i + 1] = wasm_i64x2_shuffle(a[i], a[i + 4], 1, 3);
+    }
+}
+
+/* One pass of partialButterflyN / partialButterflyInverseN, which are the
+ * products by the N x N matrix t (or its transpose) of the rows in[], in 32
+ * bits: out[r] = (sum of t[r][c] * in[c] + add) >> shift. The forward pass
+ * truncates to int16 like the C cast, the inverse one clips. */
+template<int N, bool inverse>
+inline void butterfly(const int16_t (*t)[N], const v128_t* in, v128_t* out, int shift)
+{
+    const v128_t add = wasm_i32x4_splat(1 << (shift - 1));
+
+    for (int r = 0; r < N; r++)
+    {
+        v128_t lo = add, hi = add;
+
+        for (int c = 0; c < N; c++)
+        {
+            v128_t k = wasm_i16x8_splat(inverse ? t[c][r] : t[r][c]);
+
+            lo = wasm_i32x4_add(lo, wasm_i32x4_extmul_low_i16x8(in[c], k));
+            if (N == 8)
+                hi = wasm_i32x4_add(hi, wasm_i32x4_extmul_high_i16x8(in[c], k));
+        }
+        lo = wasm_i32x4_shr(lo, shift);
+        hi = wasm_i32x4_shr(hi, shift);
+        if (inverse)
+            out[r] = wasm_i16x8_narrow_i32x4(lo, hi);
+        else
+            out[r] = wasm_i16x8_shuffle(lo, hi, 0, 2, 4, 6, 8, 10, 12, 14);
+    }
+}
+
+void dct4_simd128(const int16_t* src, int16_t* dst, intptr_t srcStride)
+{
+    const int shift_1st = 1 + X265_DEPTH - 8;
+    const int shift_2nd = 8;
+    v128_t block[4], coef[4];
+
+    for (int i = 0; i < 4; i++)
+        block[i] = wasm_v128_load64_zero(&src[i * srcStride]);
+    transpose4(block);
+    butterfly<4, false>(g_t4, block, coef, shift_1st);
+    transpose4(coef);
+    butterfly<4, false>(g_t4, coef, block, shift_2nd);
+    for (int i = 0; i < 4; i++)
+        wasm_v128_store64_lane(&dst[i * 4], block[i], 0);
+}
+
+void dct8_simd128(const int16_t* src, int16_t* dst, intptr_t srcStride)
+{
+    const int shift_1st = 2 + X265_DEPTH - 8;
+    const int shift_2nd = 9;
+    v128_t block[8], coef[8];
+
+    for (int i = 0; i < 8; i++)
+        block[i] = wasm_v128_load(&src[i * srcStride]);
+    transpose8(block);
+    butterfly<8, false>(g_t8, block, coef, shift_1st);
+    transpose8(coef);
+    butterfly<8, false>(g_t8, coef, block, shift_2nd);
+    for (int i = 0; i < 8; i++)
+        wasm_v128_store(&dst[i * 8], block[i]);
+}
+
+void idct4_simd128(const int16_t* src, int16_t* dst, intptr_t dstStride)
+{
+    const int shift_1st = 7;
+    const int shift_2nd = 12 - (X265_DEPTH - 8);
+    v128_t coef[4], block[4];
+
+    for (int i = 0; i < 4; i++)
+        coef[i] = wasm_v128_load64_zero(&src[i * 4]);
+    butterfly<4, true>(g_t4, coef, block, shift_1st);
+    transpose4(block);
+    butterfly<4, true>(g_t4, block, coef, shift_2nd);
+    transpose4(coef);
+    for (int i = 0; i < 4; i++)
+        wasm_v128_store64_lane(&dst[i * dstStride], coef[i], 0);
+}
+
+void idct8_simd128(const int16_t* src, int16_t* dst, intptr_t dstStride)
+{
+    const int shift_1st = 7;
+    const int shift_2nd = 12 - (X265_DEPTH - 8);
+    v128_t coef[8], block[8];
+
+    for (int i = 0; i < 8; i++)
+        coef[i] = wasm_v128_load(&src[i * 8]);
+    butterfly<8, true>(g_t8, coef, block, shift_1st);
+    transpose8(block);
+    butterfly<8, true>(g_t8, block, coef, shift_2nd);
+    transpose8(coef);
+    for (int i = 0; i < 8; i++)
+        wasm_v128_store(&dst[i * dstStride], coef[i]);
+}
+
+/* quant_c of 4 coefficients, returns the nonzero levels as -1 lanes */
+inline v128_t quant_4(v128_t coef, const int32_t* quantCoeff, int32_t* deltaU, v128_t& level, int qBits, v128_t add)
+{
+    v128_t tmplevel = wasm_i32x4_mul(wasm_i32x4_abs(coef), wasm_v128_load(quantCoeff));
+    v128_t q = wasm_i32x4_shr(wasm_i32x4_add(tmplevel, add), qBits);
+
+    wasm_v128_store(deltaU, wasm_i32x4_shr(wasm_i32x4_sub(tmplevel, wasm_i32x4_shl(q, qBits)), qBits - 8));
+    level = wasm_v128_bitselect(wasm_i32x4_neg(q), q, wasm_i32x4_lt(coef, wasm_i32x4_splat(0)));
+    return wasm_i32x4_ne(q, wasm_i32x4_splat(0));
+}
+
+uint32_t quant_simd128(const int16_t* coef, const int32_t* quantCoeff, int32_t* deltaU, int16_t* qCoef, int qBits, int add, int numCoeff)
+{
+    X265_CHECK(qBits >= 8, "qBits less than 8\n");
+    X265_CHECK((numCoeff % 16) == 0, "numCoeff must be multiple of 16\n");
+    const v128_t vadd = wasm_i32x4_splat(add);
+    v128_t numSig = wasm_i32x4_splat(0);
+
+    for (int blockpos = 0; blockpos < numCoeff; blockpos += 8)
+    {
+        v128_t c = wasm_v128_load(&coef[blockpos]);
+        v128_t lo, hi;
+
+        numSig = wasm_i32x4_sub(numSig, quant_4(wasm_i32x4_extend_low_i16x8(c), &quantCoeff[blockpos],
+                                                &deltaU[blockpos], lo, qBits, vadd));
+        numSig = wasm_i32x4_sub(numSig, quant_4(wasm_i32x4_extend_high_i16x8(c), &quantCoeff[blockpos + 4],
+                                                &deltaU[blockpos + 4], hi, qBits, vadd));
+        wasm_v128_store(&qCoef[blockpos], wasm_i16x8_narrow_i32x4(lo, hi));
+    }
+    numSig = wasm_i32x4_add(numSig, wasm_i32x4_shuffle(numSig, numSig, 2, 3, 0, 1));
+    numSig = wasm_i32x4_add(numSig, wasm_i32x4_shuffle(numSig, numSig, 1, 0, 3, 2));
+    return (uint32_t)wasm_i32x4_extract_lane(numSig, 0);
+}
+
+void dequant_normal_simd128(const int16_t* quantCoef, int16_t* coef, int num, int scale, int shift)
+{
+    X265_CHECK(num <= 32 * 32, "dequant num %d too large\n", num);
+    X265_CHECK((num % 8) == 0, "dequant num %d not multiple of 8\n", num);
+    const v128_t vscale = wasm_i32x4_splat(scale);
+    const v128_t add = wasm_i32x4_splat(1 << (shift - 1));
+
+    for (int n = 0; n < num; n += 8)
+    {
+        v128_t q = wasm_v128_load(&quantCoef[n]);
+        v128_t lo = wasm_i32x4_mul(wasm_i32x4_extend_low_i16x8(q), vscale);
+        v128_t hi = wasm_i32x4_mul(wasm_i32x4_extend_high_i16x8(q), vscale);
+
+        lo = wasm_i32x4_shr(wasm_i32x4_add(lo, add), shift);
+        hi = wasm_i32x4_shr(wasm_i32x4_add(hi, add), shift);
+        wasm_v128_store(&coef[n], wasm_i16x8_narrow_i32x4(lo, hi));
+    }
+}
+}  // end anonymous namespace
+#endif // !HIGH_BIT_DEPTH && __wasm_simd128__
+
+namespace X265_NS {
+// x265 private namespace
+
+void setupDCTPrimitives_wasm(EncoderPrimitives& p)
+{
+#if !HIGH_BIT_DEPTH && defined(__wasm_simd128__)
+    p.cu[BLOCK_4x4].dct  = dct4_simd128;
+    p.cu[BLOCK_8x8].dct  = dct8_simd128;
+    p.cu[BLOCK_4x4].idct = idct4_simd128;
+    p.cu[BLOCK_8x8].idct = idct8_simd128;
+    p.quant = quant_simd128;
+    p.dequant_normal = dequant_normal_simd128;
+#else
+    (void)p;
+#endif
+}
+}
@@ -0,0 +1,326 @@
+/*****************************************************************************
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *****************************************************************************/
+
+/* WebAssembly SIMD128 SAD, SATD and SA8D of 8-bit pixels, installed by
+ * x265_setup_primitives() when param->cpuid has X265_CPU_SIMD128 and x265 is
+ * built with -msimd128 */
+
+#include "common.h"
+#include "primitives.h"
+
+#if !HIGH_BIT_DEPTH && defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+
+using namespace X265_NS;
+
+namespace {
+// place functions in anonymous namespace (file static)
+
+/* n pixels of a row, n is 16, 12, 8 or 4 */
+inline v128_t load_row(const pixel* pix, int n)
+{
+    if (n == 16)
+        return wasm_v128_load(pix);
+    if (n == 12)
+        return wasm_v128_load32_lane(pix + 8, wasm_v128_load64_zero(pix), 2);
+    if (n == 8)
+        return wasm_v128_load64_zero(pix);
+    return wasm_v128_load32_zero(pix);
+}
+
+inline v128_t absdiff_u8(v128_t a, v128_t b)
+{
+    return wasm_v128_or(wasm_u8x16_sub_sat(a, b), wasm_u8x16_sub_sat(b, a));
+}
+
+inline int hsum_i32(v128_t v)
+{
+    v = wasm_i32x4_add(v, wasm_i32x4_shuffle(v, v, 2, 3, 0, 1));
+    v = wasm_i32x4_add(v, wasm_i32x4_shuffle(v, v, 1, 0, 3, 2));
+    return wasm_i32x4_extract_lane(v, 0);
+}
+
+/* SAD of the fenc row against n refs, the 16-bit sums of up to 64 pixels are
+ * widened every 8 rows */
+template<int lx, int ly, int n>
+inline void sad_xn(const pixel* fenc, intptr_t fencstride, const pixel* const* fref, intptr_t frefstride, int32_t* res)
+{
+    v128_t sum[4];
+
+    for (int i = 0; i < n; i++)
+        sum[i] = wasm_i32x4_splat(0);
+    for (int y = 0; y < ly; y += 8)
+    {
+        v128_t sum16[4];
+
+        for (int i = 0; i < n; i++)
+            sum16[i] = wasm_i16x8_splat(0);
+        for (int yy = y; yy < y + 8 && yy < ly; yy++)
+        {
+            for (int x = 0; x < lx; x += 16)
+            {
+                const int w = lx - x < 16 ? lx - x : 16;
+                v128_t e = load_row(fenc + yy * fencstride + x, w);
+
+                for (int i = 0; i < n; i++)
+                {
+                    v128_t ad = absdiff_u8(e, load_row(fref[i] + yy * frefstride + x, w));
+                    sum16[i] = wasm_i16x8_add(sum16[i], wasm_u16x8_extadd_pairwise_u8x16(ad));
+                }
+            }
+        }
+        for (int i = 0; i < n; i++)
+            sum[i] = wasm_i32x4_add(sum[i], wasm_u32x4_extadd_pairwise_u16x8(sum16[i]));
+    }
+    for (int i = 0; i < n; i++)
+        res[i] = hsum_i32(sum[i]);
+}
+
+template<int lx, int ly>
+int sad_simd128(const pixel* pix1, intptr_t stride_pix1, const pixel* pix2, intptr_t stride_pix2)
+{
+    int32_t res;
+
+    sad_xn<lx, ly, 1>(pix1, stride_pix1, &pix2, stride_pix2, &res);
+    return res;
+}
+
+template<int lx, int ly>
+void sad_x3_simd128(const pixel* pix1, const pixel* pix2, const pixel* pix3, const pixel* pix4, intptr_t frefstride, int32_t* res)
+{
+    const pixel* fref[3] = { pix2, pix3, pix4 };
+
+    sad_xn<lx, ly, 3>(pix1, FENC_STRIDE, fref, frefstride, res);
+}
+
+template<int lx, int ly>
+void sad_x4_simd128(const pixel* pix1, const pixel* pix2, const pixel* pix3, const pixel* pix4, const pixel* pix5, intptr_t frefstride, int32_t* res)
+{
+    const pixel* fref[4] = { pix2, pix3, pix4, pix5 };
+
+    sad_xn<lx, ly, 4>(pix1, FENC_STRIDE, fref, frefstride, res);
+}
+
+/* Every coefficient of a 4x4 or 8x8 Hadamard has the parity of the sum of the
+ * block, so the C sums of |coef| >> 1 per 4x4 or 8x4 are the exact halves of
+ * the sums of the whole blocks. The last butterfly is folded in with
+ * |a + b| + |a - b| = 2 * max(|a|, |b|), which gives that half directly. */
+#define SUMSUB(s, d, a, b) \
+    { \
+        v128_t t_ = a; \
+        s = wasm_i16x8_add(t_, b); \
+        d = wasm_i16x8_sub(t_, b); \
+    }
+
+inline v128_t absmax(v128_t a, v128_t b)
+{
+    return wasm_u16x8_max(wasm_i16x8_abs(a), wasm_i16x8_abs(b));
+}
+
+/* row diffs of 8 or 4 pixels as 16-bit lanes */
+inline v128_t diff_row(const pixel* pix1, const pixel* pix2, int w)
+{
+    if (w == 4)
+        return wasm_i16x8_sub(wasm_u16x8_extend_low_u8x16(wasm_v128_load32_zero(pix1)),
+                              wasm_u16x8_extend_low_u8x16(wasm_v128_load32_zero(pix2)));
+    return wasm_i16x8_sub(wasm_u16x8_load8x8(pix1), wasm_u16x8_load8x8(pix2));
+}
+
+/* half the sum of |coef| of the 4x4 Hadamards of the left and right 4x4 of an
+ * 8x4 block, or of the left one only when w is 4, as 16-bit lanes */
+inline v128_t satd_8x4(const pixel* pix1, intptr_t stride_pix1, const pixel* pix2, intptr_t stride_pix2, int w)
+{
+    v128_t d0 = diff_row(pix1 + 0 * stride_pix1, pix2 + 0 * stride_pix2, w);
+    v128_t d1 = diff_row(pix1 + 1 * stride_pix1, pix2 + 1 * stride_pix2, w);
+    v128_t d2 = diff_row(pix1 + 2 * stride_pix1, pix2 + 2 * stride_pix2, w);
+    v128_t d3 = diff_row(pix1 + 3 * stride_pix1, pix2 + 3 * stride_pix2, w);
+    v128_t a0, a1, a2, a3, t0, t1, t2, t3;
+
+    /* vertical */
+    SUMSUB(a0, a1, d0, d1);
+    SUMSUB(a2, a3, d2, d3);
+    SUMSUB(d0, d2, a0, a2);
+    SUMSUB(d1, d3, a1, a3);
+    /* transpose both 4x4 */
+    t0 = wasm_i16x8_shuffle(d0, d1, 0, 8, 1, 9, 4, 12, 5, 13);
+    t1 = wasm_i16x8_shuffle(d0, d1, 2, 10, 3, 11, 6, 14, 7, 15);
+    t2 = wasm_i16x8_shuffle(d2, d3, 0, 8, 1, 9, 4, 12, 5, 13);
+    t3 = wasm_i16x8_shuffle(d2, d3, 2, 10, 3, 11, 6, 14, 7, 15);
+    d0 = wasm_i32x4_shuffle(t0, t2, 0, 4, 2, 6);
+    d1 = wasm_i32x4_shuffle(t0, t2, 1, 5, 3, 7);
+    d2 = wasm_i32x4_shuffle(t1, t3, 0, 4, 2, 6);
+    d3 = wasm_i32x4_shuffle(t1, t3, 1, 5, 3, 7);
+    /* horizontal */
+    SUMSUB(a0, a1, d0, d1);
+    SUMSUB(a2, a3, d2, d3);
+    return wasm_i16x8_add(absmax(a0, a2), absmax(a1, a3));
+}
+
+template<int w, int h>
+int satd_simd128(const pixel* pix1, intptr_t stride_pix1, const pixel* pix2, intptr_t stride_pix2)
+{
+    v128_t sum = wasm_i32x4_splat(0);
+
+    for (int row = 0; row < h; row += 4)
+    {
+        for (int col = 0; col < w; col += 8)
+        {
+            v128_t s = satd_8x4(pix1 + row * stride_pix1 + col, stride_pix1,
+                                pix2 + row * stride_pix2 + col, stride_pix2, w - col < 8 ? 4 : 8);
+            sum = wasm_i32x4_add(sum, wasm_u32x4_extadd_pairwise_u16x8(s));
+        }
+    }
+    return hsum_i32(sum);
+}
+
+/* half the sum of |coef| of the 8x8 Hadamard, as 16-bit lanes */
+inline v128_t sa8d_8x8_half(const pixel* pix1, intptr_t i_pix1, const pixel* pix2, intptr_t i_pix2)
+{
+    v128_t d[8], a[8], t[8];
+
+    for (int i = 0; i < 8; i++)
+        d[i] = diff_row(pix1 + i * i_pix1, pix2 + i * i_pix2, 8);
+    /* vertical */
+    SUMSUB(a[0], a[1], d[0], d[1]);
+    SUMSUB(a[2], a[3], d[2], d[3]);
+    SUMSUB(a[4], a[5], d[4], d[5]);
+    SUMSUB(a[6], a[7], d[6], d[7]);
+    SUMSUB(d[0], d[2], a[0], a[2]);
+    SUMSUB(d[1], d[3], a[1], a[3]);
+    SUMSUB(d[4], d[6], a[4], a[6]);
+    SUMSUB(d[5], d[7], a[5], a[7]);
+    SUMSUB(a[0], a[4], d[0], d[4]);
+    SUMSUB(a[1], a[5], d[1], d[5]);
+    SUMSUB(a[2], a[6], d[2], d[6]);
+    SUMSUB(a[3], a[7], d[3], d[7]);
+    /* transpose */
+    for (int i = 0; i < 8; i += 2)
+    {
+        t[i]     = wasm_i16x8_shuffle(a[i], a[i + 1], 0, 8, 1, 9, 2, 10, 3, 11);
+        t[i + 1] = wasm_i16x8_shuffle(a[i], a[i + 1], 4, 12, 5, 13, 6, 14, 7, 15);
+    }
+    for (int i = 0; i < 8; i += 4)
+    {
+        a[i]     = wasm_i32x4_shuffle(t[i], t[i + 2], 0, 4, 1, 5);
+        a[i + 1] = wasm_i32x4_shuffle(t[i], t[i + 2], 2, 6, 3, 7);
+        a[i + 2] = wasm_i32x4_shuffle(t[i + 1], t[i + 3], 0, 4, 1, 5);
+        a[i + 3] = wasm_i32x4_shuffle(t[i + 1], t[i + 3], 2, 6, 3, 7);
+    }
+    for (int i = 0; i < 4; i++)
+    {
+        d[2 * i]     = wasm_i64x2_shuffle(a[i], a[i + 4], 0, 2);
+        d[2 * i + 1] = wasm_i64x2_shuffle(a[i], a[i + 4], 1, 3);
+    }
+    /* horizontal */
+    SUMSUB(a[0], a[1], d[0], d[1]);
+    SUMSUB(a[2], a[3], d[2], d[3]);
+    SUMSUB(a[4], a[5], d[4], d[5]);
+    SUMSUB(a[6], a[7], d[6], d[7]);
+    SUMSUB(d[0], d[2], a[0], a[2]);
+    SUMSUB(d[1], d[3], a[1], a[3]);
+    SUMSUB(d[4], d[6], a[4], a[6]);
+    SUMSUB(d[5], d[7], a[5], a[7]);
+    return wasm_i16x8_add(wasm_i16x8_add(absmax(d[0], d[4]), absmax(d[1], d[5])),
+                          wasm_i16x8_add(absmax(d[2], d[6]), absmax(d[3], d[7])));
+}
+
+/* (sum + 2) >> 2 of the C is (half + 1) >> 1 */
+int sa8d_8x8_simd128(const pixel* pix1, intptr_t i_pix1, const pixel* pix2, intptr_t i_pix2)
+{
+    v128_t s = sa8d_8x8_half(pix1, i_pix1, pix2, i_pix2);
+
+    return (hsum_i32(wasm_u32x4_extadd_pairwise_u16x8(s)) + 1) >> 1;
+}
+
+int sa8d_16x16_simd128(const pixel* pix1, intptr_t i_pix1, const pixel* pix2, intptr_t i_pix2)
+{
+    v128_t sum = wasm_i32x4_splat(0);
+
+    for (int y = 0; y < 16; y += 8)
+    {
+        for (int x = 0; x < 16; x += 8)
+        {
+            v128_t s = sa8d_8x8_half(pix1 + y * i_pix1 + x, i_pix1, pix2 + y * i_pix2 + x, i_pix2);
+            sum = wasm_i32x4_add(sum, wasm_u32x4_extadd_pairwise_u16x8(s));
+        }
+    }
+    return (hsum_i32(sum) + 1) >> 1;
+}
+
+/* sa8d16 of the C, rounded per 16x16 */
+template<int w, int h>
+int sa8d16_simd128(const pixel* pix1, intptr_t i_pix1, const pixel* pix2, intptr_t i_pix2)
+{
+    int cost = 0;
+
+    for (int y = 0; y < h; y += 16)
+        for (int x = 0; x < w; x += 16)
+            cost += sa8d_16x16_simd128(pix1 + i_pix1 * y + x, i_pix1, pix2 + i_pix2 * y + x, i_pix2);
+    return cost;
+}
+
+#undef SUMSUB
+}  // end anonymous namespace
+#endif // !HIGH_BIT_DEPTH && __wasm_simd128__
+
+namespace X265_NS {
+// x265 private namespace
+
+void setupPixelPrimitives_wasm(EncoderPrimitives& p)
+{
+#if !HIGH_BIT_DEPTH && defined(__wasm_simd128__)
+#define LUMA_PU(W, H) \
+    p.pu[LUMA_ ## W ## x ## H].sad = sad_simd128<W, H>; \
+    p.pu[LUMA_ ## W ## x ## H].sad_x3 = sad_x3_simd128<W, H>; \
+    p.pu[LUMA_ ## W ## x ## H].sad_x4 = sad_x4_simd128<W, H>; \
+    p.pu[LUMA_ ## W ## x ## H].satd = satd_simd128<W, H>;
+
+    LUMA_PU(4, 4);
+    LUMA_PU(8, 8);
+    LUMA_PU(16, 16);
+    LUMA_PU(32, 32);
+    LUMA_PU(64, 64);
+    LUMA_PU(8, 4);
+    LUMA_PU(4, 8);
+    LUMA_PU(16, 8);
+    LUMA_PU(8, 16);
+    LUMA_PU(32, 16);
+    LUMA_PU(16, 32);
+    LUMA_PU(64, 32);
+    LUMA_PU(32, 64);
+    LUMA_PU(16, 12);
+    LUMA_PU(12, 16);
+    LUMA_PU(16, 4);
+    LUMA_PU(4, 16);
+    LUMA_PU(32, 24);
+    LUMA_PU(24, 32);
+    LUMA_PU(32, 8);
+    LUMA_PU(8, 32);
+    LUMA_PU(64, 48);
+    LUMA_PU(48, 64);
+    LUMA_PU(64, 16);
+    LUMA_PU(16, 64);
+#undef LUMA_PU
+
+    p.cu[BLOCK_8x8].sa8d   = sa8d_8x8_simd128;
+    p.cu[BLOCK_16x16].sa8d = sa8d_16x16_simd128;
+    p.cu[BLOCK_32x32].sa8d = sa8d16_simd128<32, 32>;
+    p.cu[BLOCK_64x64].sa8d = sa8d16_simd128<64, 64>;
+#else
+    (void)p;
+#endif
+}
+}
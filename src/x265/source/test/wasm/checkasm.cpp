@@ -0,0 +1,266 @@
+/*****************************************************************************
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *****************************************************************************/
+
+/* Runs every X265_CPU_SIMD128 primitive against the C one it replaces on
+ * random inputs, in the manner of the test bench, and returns 1 when one
+ * differs. Usage: checkasm [seed]
+ * Built against the 8-bit library, with the flags of its common objects. */
+
+#include "common.h"
+#include "primitives.h"
+
+#include <time.h>
+
+using namespace X265_NS;
+
+namespace {
+
+const int TRIES = 100;
+const int STRIDE = 128;
+
+uint32_t seed;
+int nb_failed;
+
+uint32_t rnd()
+{
+    seed = seed * 1664525 + 1013904223;
+    return seed >> 8;
+}
+
+/* 64x64 blocks at any position of 128x128 pictures */
+ALIGN_VAR_32(pixel, fenc[64 * FENC_STRIDE]);
+ALIGN_VAR_32(pixel, pbuf[4][STRIDE * STRIDE]);
+
+void report(const char* name, bool ok)
+{
+    printf(" - %-8s [%s]\n", name, ok ? "OK" : "FAILED");
+    nb_failed += !ok;
+}
+
+const pixel* ref(int i)
+{
+    return pbuf[i] + rnd() % (64 * STRIDE + 64);
+}
+
+bool check_pixel(const EncoderPrimitives& c, const EncoderPrimitives& s)
+{
+    static const char* const names[NUM_PU_SIZES] =
+    {
+        "4x4", "8x8", "16x16", "32x32", "64x64", "8x4", "4x8", "16x8", "8x16", "32x16", "16x32",
+        "64x32", "32x64", "16x12", "12x16", "16x4", "4x16", "32x24", "24x32", "32x8", "8x32",
+        "64x48", "48x64", "64x16", "16x64"
+    };
+    bool ok = true;
+
+    for (int i = 0; i < NUM_PU_SIZES; i++)
+    {
+        for (int t = 0; t < TRIES; t++)
+        {
+            const pixel* r[4] = { ref(0), ref(1), ref(2), ref(3) };
+            int32_t res_c[4], res_s[4];
+
+            if (c.pu[i].sad != s.pu[i].sad &&
+                c.pu[i].sad(fenc, FENC_STRIDE, r[0], STRIDE) != s.pu[i].sad(fenc, FENC_STRIDE, r[0], STRIDE))
+            {
+                fprintf(stderr, "sad[%s] FAILED\n", names[i]);
+                ok = false;
+                break;
+            }
+            if (c.pu[i].satd != s.pu[i].satd &&
+                c.pu[i].satd(fenc, FENC_STRIDE, r[0], STRIDE) != s.pu[i].satd(fenc, FENC_STRIDE, r[0], STRIDE))
+            {
+                fprintf(stderr, "satd[%s] FAILED\n", names[i]);
+                ok = false;
+                break;
+            }
+            if (c.pu[i].sad_x3 != s.pu[i].sad_x3)
+            {
+                c.pu[i].sad_x3(fenc, r[0], r[1], r[2], STRIDE, res_c);
+                s.pu[i].sad_x3(fenc, r[0], r[1], r[2], STRIDE, res_s);
+                if (memcmp(res_c, res_s, 3 * sizeof(int32_t)))
+                {
+                    fprintf(stderr, "sad_x3[%s] FAILED\n", names[i]);
+                    ok = false;
+                    break;
+                }
+            }
+            if (c.pu[i].sad_x4 != s.pu[i].sad_x4)
+            {
+                c.pu[i].sad_x4(fenc, r[0], r[1], r[2], r[3], STRIDE, res_c);
+                s.pu[i].sad_x4(fenc, r[0], r[1], r[2], r[3], STRIDE, res_s);
+                if (memcmp(res_c, res_s, 4 * sizeof(int32_t)))
+                {
+                    fprintf(stderr, "sad_x4[%s] FAILED\n", names[i]);
+                    ok = false;
+                    break;
+                }
+            }
+        }
+    }
+    for (int i = BLOCK_8x8; i <= BLOCK_64x64; i++)
+    {
+        if (c.cu[i].sa8d == s.cu[i].sa8d)
+            continue;
+        for (int t = 0; t < TRIES; t++)
+        {
+            const pixel* r = ref(0);
+
+            if (c.cu[i].sa8d(fenc, FENC_STRIDE, r, STRIDE) != s.cu[i].sa8d(fenc, FENC_STRIDE, r, STRIDE))
+            {
+                fprintf(stderr, "sa8d[%dx%d] FAILED\n", 4 << i, 4 << i);
+                ok = false;
+                break;
+            }
+        }
+    }
+    report("pixel", ok);
+    return ok;
+}
+
+bool check_dct(const EncoderPrimitives& c, const EncoderPrimitives& s)
+{
+    ALIGN_VAR_32(int16_t, src[8 * 16]);
+    ALIGN_VAR_32(int16_t, dst_c[8 * 16]);
+    ALIGN_VAR_32(int16_t, dst_s[8 * 16]);
+    bool ok = true;
+
+    for (int i = BLOCK_4x4; i <= BLOCK_8x8 && ok; i++)
+    {
+        for (int t = 0; t < TRIES; t++)
+        {
+            /* residuals with a stride of 16, then random coefficients */
+            for (int j = 0; j < 8 * 16; j++)
+                src[j] = t & 1 ? (int16_t)rnd() : (int)(rnd() % 511) - 255;
+            memset(dst_c, 0, sizeof(dst_c));
+            memset(dst_s, 0, sizeof(dst_s));
+            if (c.cu[i].dct != s.cu[i].dct && !(t & 1))
+            {
+                c.cu[i].dct(src, dst_c, 16);
+                s.cu[i].dct(src, dst_s, 16);
+                if (memcmp(dst_c, dst_s, sizeof(dst_c)))
+                {
+                    fprintf(stderr, "dct%d FAILED\n", 4 << i);
+                    ok = false;
+                    break;
+                }
+            }
+            if (c.cu[i].idct != s.cu[i].idct)
+            {
+                c.cu[i].idct(src, dst_c, 16);
+                s.cu[i].idct(src, dst_s, 16);
+                if (memcmp(dst_c, dst_s, sizeof(dst_c)))
+                {
+                    fprintf(stderr, "idct%d FAILED\n", 4 << i);
+                    ok = false;
+                    break;
+                }
+            }
+        }
+    }
+    report("dct", ok);
+    return ok;
+}
+
+bool check_quant(const EncoderPrimitives& c, const EncoderPrimitives& s)
+{
+    ALIGN_VAR_32(int16_t, coef[32 * 32]);
+    ALIGN_VAR_32(int32_t, quantCoeff[32 * 32]);
+    ALIGN_VAR_32(int32_t, deltaU_c[32 * 32]);
+    ALIGN_VAR_32(int32_t, deltaU_s[32 * 32]);
+    ALIGN_VAR_32(int16_t, qCoef_c[32 * 32]);
+    ALIGN_VAR_32(int16_t, qCoef_s[32 * 32]);
+    bool ok = true;
+
+    for (int t = 0; t < TRIES && ok; t++)
+    {
+        int num = 16 << (rnd() % 7);
+        int qBits = 8 + rnd() % 15;
+        int add = rnd() % (1 << qBits);
+
+        /* sparse blocks and full ones, |coef| * quantCoeff fits int */
+        for (int j = 0; j < num; j++)
+        {
+            coef[j] = rnd() % 4 ? 0 : (int16_t)rnd();
+            quantCoeff[j] = rnd() % (1 << 15);
+            if (t & 1)
+                coef[j] = (int)(rnd() % 2049) - 1024;
+        }
+        if (c.quant != s.quant)
+        {
+            uint32_t numSig_c = c.quant(coef, quantCoeff, deltaU_c, qCoef_c, qBits, add, num);
+            uint32_t numSig_s = s.quant(coef, quantCoeff, deltaU_s, qCoef_s, qBits, add, num);
+
+            if (numSig_c != numSig_s || memcmp(deltaU_c, deltaU_s, num * sizeof(int32_t)) ||
+                memcmp(qCoef_c, qCoef_s, num * sizeof(int16_t)))
+            {
+                fprintf(stderr, "quant (num %d, qBits %d) FAILED\n", num, qBits);
+                ok = false;
+            }
+        }
+        if (c.dequant_normal != s.dequant_normal)
+        {
+            int scale = rnd() % (72 * 256);
+            int shift = 1 + rnd() % 10;
+
+            c.dequant_normal(coef, qCoef_c, num, scale, shift);
+            s.dequant_normal(coef, qCoef_s, num, scale, shift);
+            if (memcmp(qCoef_c, qCoef_s, num * sizeof(int16_t)))
+            {
+                fprintf(stderr, "dequant_normal (num %d, scale %d, shift %d) FAILED\n", num, scale, shift);
+                ok = false;
+            }
+        }
+    }
+    report("quant", ok);
+    return ok;
+}
+}
+
+int main(int argc, char* argv[])
+{
+    EncoderPrimitives c, s;
+
+    seed = argc > 1 ? strtoul(argv[1], NULL, 0) : (uint32_t)time(NULL);
+    if (!(cpu_detect(false) & X265_CPU_SIMD128))
+    {
+        fprintf(stderr, "checkasm: built without -msimd128, no kernel to test\n");
+        return 0;
+    }
+    printf("checkasm: using random seed %u\n", seed);
+
+    memset(&c, 0, sizeof(c));
+    setupCPrimitives(c);
+    s = c;
+    setupPixelPrimitives_wasm(s);
+    setupDCTPrimitives_wasm(s);
+
+    for (int i = 0; i < 64 * FENC_STRIDE; i++)
+        fenc[i] = rnd();
+    for (int i = 0; i < 4; i++)
+        for (int j = 0; j < STRIDE * STRIDE; j++)
+            pbuf[i][j] = rnd();
+    check_pixel(c, s);
+    check_dct(c, s);
+    check_quant(c, s);
+
+    if (nb_failed)
+    {
+        fprintf(stderr, "checkasm: %d tests FAILED\n", nb_failed);
+        return 1;
+    }
+    printf("checkasm: all tests passed\n");
+    return 0;
+}
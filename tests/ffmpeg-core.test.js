@@ -6,6 +6,8 @@ const reset = () => {
   core.reset();
   core.setLogger(() => {});
   core.setProgress(() => {});
+  core.setMemory(() => {});
+  core.setFileWritten(() => {});
 };
 
 before(async () => {
@@ -53,6 +55,208 @@ describe(genName("exec()"), () => {
     expect(out.length).to.not.equal(0);
     core.FS.unlink("video.avi");
   });
+
+  it("should loop an input", () => {
+    const packets = (path) => {
+      core.ffprobe(
+        "-v", "error", "-of", "json", "-count_packets",
+        "-show_entries", "stream=nb_read_packets", path
+      );
+      core.reset();
+      return Number(JSON.parse(core.probeOutput).streams[0].nb_read_packets);
+    };
+    // the input thread of the MT core is restarted after the seek
+    expect(
+      core.exec(
+        "-stream_loop", "1",
+        "-i", "video.mp4",
+        "-c:v", "libx264", "-preset", "ultrafast",
+        "loop.mp4"
+      )
+    ).to.equal(0);
+    core.reset();
+    expect(packets("loop.mp4")).to.equal(2 * packets("video.mp4"));
+    core.FS.unlink("loop.mp4");
+  });
+
+  const stream = (path) => {
+    core.ffprobe(
+      "-v", "error", "-of", "json", "-count_packets", "-select_streams", "v:0",
+      "-show_entries", "stream=avg_frame_rate,duration,nb_read_packets", path
+    );
+    core.reset();
+    return JSON.parse(core.probeOutput).streams[0];
+  };
+
+  it("should keep the timing of filter chains changing the rate", () => {
+    // in the MT core both chains are filtered in threads of their own
+    expect(
+      core.exec(
+        "-i", "video.mp4",
+        "-filter_complex", "[0:v]fps=10[l];[0:v]fps=10,hflip[r];[l][r]hstack",
+        "-c:v", "libx264", "-preset", "ultrafast",
+        "fps.mp4"
+      )
+    ).to.equal(0);
+    core.reset();
+    const input = stream("video.mp4");
+    const output = stream("fps.mp4");
+    expect(output.avg_frame_rate).to.equal("10/1");
+    expect(Number(output.duration)).to.be.closeTo(Number(input.duration), 0.2);
+    expect(Number(output.nb_read_packets)).to.be.closeTo(
+      Number(input.duration) * 10, 1
+    );
+    core.FS.unlink("fps.mp4");
+  });
+
+  it("should trim the input of filter chains with -ss", () => {
+    // the trim of -ss comes before the chains, which are not split off
+    expect(
+      core.exec(
+        "-ss", "0.5",
+        "-i", "video.mp4",
+        "-filter_complex",
+        "[0:v]setpts=PTS-STARTPTS,fps=10[l];[0:v]setpts=PTS-STARTPTS,fps=10,hflip[r];[l][r]hstack",
+        "-c:v", "libx264", "-preset", "ultrafast",
+        "seek.mp4"
+      )
+    ).to.equal(0);
+    core.reset();
+    const input = stream("video.mp4");
+    const output = stream("seek.mp4");
+    expect(Number(output.duration)).to.be.closeTo(Number(input.duration) - 0.5, 0.2);
+    expect(Number(output.nb_read_packets)).to.be.closeTo(
+      (Number(input.duration) - 0.5) * 10, 1
+    );
+    core.FS.unlink("seek.mp4");
+  });
+
+  it("should filter the outputs of a split", () => {
+    const logs = [];
+    core.setLogger(({ message }) => logs.push(message));
+    expect(
+      core.exec(
+        "-v", "verbose",
+        "-i", "video.mp4",
+        "-filter_complex",
+        "[0:v]split=3[a][b][c];[a]fps=10[l];[b]fps=10,hflip[r];[l][r]hstack[s];[c]fps=10,scale=64:-2[t]",
+        "-map", "[s]", "-c:v", "libx264", "-preset", "ultrafast", "split.mp4",
+        "-map", "[t]", "-c:v", "libx264", "-preset", "ultrafast", "thumb.mp4"
+      )
+    ).to.equal(0);
+    core.reset();
+    // in the MT core each output is filtered in a thread of its own
+    if (FFMPEG_TYPE === "mt")
+      expect(
+        logs.filter((m) => m.includes("in its own thread")).length
+      ).to.equal(3);
+    const input = stream("video.mp4");
+    for (const path of ["split.mp4", "thumb.mp4"]) {
+      const output = stream(path);
+      expect(output.avg_frame_rate).to.equal("10/1");
+      expect(Number(output.nb_read_packets)).to.be.closeTo(
+        Number(input.duration) * 10, 1
+      );
+      core.FS.unlink(path);
+    }
+  });
+});
+
+(FFMPEG_TYPE === "st" ? describe.skip : describe)(
+  genName("getThreadPoolSize()"),
+  () => {
+    let small;
+    const loaded = async () => {
+      while (small.pthreadPoolLoading > 0)
+        await new Promise((resolve) => setTimeout(resolve, 10));
+    };
+
+    before(async () => {
+      small = await createFFmpegCore({ pthreadPoolSize: 2, pthreadPoolMax: 8 });
+      small.FS.writeFile("video.mp4", b64ToUint8Array(VIDEO_1S_MP4));
+    });
+
+    it("should size threads within a small pool", async () => {
+      expect(small.getThreadPoolSize()).to.equal(2);
+      expect(
+        small.exec(
+          "-i", "video.mp4",
+          "-c:v", "libx264", "-preset", "ultrafast",
+          "small.mp4"
+        )
+      ).to.equal(0);
+      small.reset();
+      // grown by the threads the job missed
+      const size = small.getThreadPoolSize();
+      expect(size).to.be.above(2);
+      expect(size).to.be.at.most(8);
+      await loaded();
+    });
+
+    it("should not grow when no thread was missing", () => {
+      const size = small.getThreadPoolSize();
+      expect(
+        small.exec(
+          "-thread_queue_size", "0",
+          "-i", "video.mp4",
+          "-c", "copy",
+          "copy.mp4"
+        )
+      ).to.equal(0);
+      small.reset();
+      expect(small.getThreadPoolSize()).to.equal(size);
+    });
+  }
+);
+
+describe(genName("clearProbeCache()"), () => {
+  const run = (...opts) => {
+    const logs = [];
+    core.setLogger(({ message }) => logs.push(message));
+    core.exec("-v", "verbose", "-probe_cache", ...opts, "-i", "cached.mp4", "-f", "null", "-");
+    core.reset();
+    return logs.some((log) => log.includes("Using cached stream info"));
+  };
+
+  before(() => {
+    core.FS.writeFile("cached.mp4", core.FS.readFile("video.mp4"));
+  });
+  beforeEach(() => {
+    reset();
+    core.clearProbeCache();
+  });
+  after(() => {
+    core.FS.unlink("cached.mp4");
+  });
+
+  it("should exist", () => {
+    expect("clearProbeCache" in core).to.be.true;
+  });
+
+  it("should reuse stream info of earlier runs", () => {
+    expect(run()).to.be.false;
+    expect(run()).to.be.true;
+  });
+
+  it("should probe again after clear", () => {
+    run();
+    core.clearProbeCache();
+    expect(run()).to.be.false;
+  });
+
+  it("should probe again when the file changes", () => {
+    run();
+    core.FS.writeFile("cached.mp4", core.FS.readFile("video.mp4"));
+    core.FS.utime("cached.mp4", Date.now() + 1000, Date.now() + 1000);
+    expect(run()).to.be.false;
+    expect(run()).to.be.true;
+  });
+
+  it("should probe again with other probing options", () => {
+    run();
+    expect(run("-probesize", "65536")).to.be.false;
+    expect(run("-probesize", "65536")).to.be.true;
+  });
 });
 
 describe(genName("setTimeout()"), () => {
@@ -98,3 +302,514 @@ describe(genName("setProgress()"), () => {
     core.FS.unlink("video.avi");
   });
 });
+
+describe(genName("setMemory()"), () => {
+  beforeEach(reset);
+
+  it("should exist", () => {
+    expect("setMemory" in core).to.be.true;
+  });
+
+  it("should handle memory", () => {
+    let heapSize = 0;
+    core.setMemory(({ heapSize: _heapSize }) => (heapSize = _heapSize));
+    expect(core.exec("-i", "video.mp4", "video.avi")).to.equal(0);
+    expect(heapSize).to.be.above(0);
+    core.FS.unlink("video.avi");
+  });
+
+  it("should report allocation telemetry", () => {
+    let memory = null;
+    core.setMemory((m) => (memory = m));
+    expect(core.exec("-i", "video.mp4", "video.avi")).to.equal(0);
+    expect(memory.peakInUse).to.be.at.least(memory.inUse);
+    expect(memory.allocs).to.be.above(0);
+    expect(memory.frees).to.be.above(0);
+    expect(memory.fragmentation).to.be.within(0, 1);
+    core.FS.unlink("video.avi");
+  });
+
+  it("should stop if memory limit is exceeded", () => {
+    core.memoryLimit = 1;
+    expect(core.exec("-i", "video.mp4", "video.avi")).to.equal(1);
+    core.memoryLimit = -1;
+  });
+});
+
+describe(genName("setFileWritten()"), () => {
+  beforeEach(reset);
+
+  it("should exist", () => {
+    expect("setFileWritten" in core).to.be.true;
+  });
+
+  it("should report written files", () => {
+    const files = [];
+    core.setFileWritten((f) => files.push(f));
+    expect(core.exec("-i", "video.mp4", "video.avi")).to.equal(0);
+    const written = files.find(({ path }) => path.endsWith("/video.avi"));
+    expect(written.size).to.equal(core.FS.readFile("video.avi").length);
+    expect(files.map(({ path }) => path)).to.not.include("/video.mp4");
+    core.FS.unlink("video.avi");
+  });
+});
+
+describe(genName("thumbnails()"), () => {
+  beforeEach(reset);
+
+  it("should exist", () => {
+    expect("thumbnails" in core).to.be.true;
+  });
+
+  it("should extract thumbnails", () => {
+    expect(core.thumbnails("-i", "video.mp4", "-t", "0,0.5", "thumb_%d.jpg")).to.equal(0);
+    for (const name of ["thumb_0.jpg", "thumb_1.jpg"]) {
+      const data = core.FS.readFile(name);
+      expect(Array.from(data.slice(0, 2))).to.deep.equal([0xff, 0xd8]);
+      core.FS.unlink(name);
+    }
+  });
+
+  it("should extract a sprite sheet", () => {
+    expect(
+      core.thumbnails(
+        "-i", "video.mp4", "-t", "0,0.5", "-w", "64",
+        "-sprite", "2", "-vtt", "sprite.vtt", "sprite.png"
+      )
+    ).to.equal(0);
+    const vtt = core.FS.readFile("sprite.vtt", { encoding: "utf8" });
+    expect(vtt).to.include("WEBVTT");
+    expect(vtt).to.include("sprite.png#xywh=0,0,64,");
+    expect(vtt).to.include("sprite.png#xywh=64,0,64,");
+    core.FS.unlink("sprite.vtt");
+    core.FS.unlink("sprite.png");
+  });
+
+  it("should fail without positions", () => {
+    expect(core.thumbnails("-i", "video.mp4", "thumb.jpg")).to.equal(1);
+  });
+});
+
+describe(genName("ffprobe()"), () => {
+  beforeEach(reset);
+
+  it("should exist", () => {
+    expect("ffprobe" in core).to.be.true;
+  });
+
+  it("should keep the json output in memory", () => {
+    expect(
+      core.ffprobe("-v", "error", "-of", "json", "-show_format", "-show_streams", "video.mp4")
+    ).to.equal(0);
+    const { format, streams } = JSON.parse(core.probeOutput);
+    expect(format.format_name).to.include("mp4");
+    expect(streams[0].codec_type).to.equal("video");
+  });
+
+  it("should probe the headers only", () => {
+    expect(core.ffprobe("-v", "error", "-of", "json", "-show_streams", "-fast", "video.mp4")).to.equal(0);
+    const { streams } = JSON.parse(core.probeOutput);
+    expect(streams[0].width).to.be.above(0);
+  });
+
+  it("should fail with a missing input", () => {
+    expect(core.ffprobe("-show_format", "missing.mp4")).to.equal(1);
+  });
+});
+
+describe(genName("openFrames()"), () => {
+  beforeEach(reset);
+
+  it("should exist", () => {
+    expect("openFrames" in core).to.be.true;
+  });
+
+  it("should read scaled rgba frames", () => {
+    const reader = core.openFrames("video.mp4", { width: 64, batch: 4 });
+    expect(reader.width).to.equal(64);
+    expect(reader.frameSize).to.equal(64 * reader.height * 4);
+    let frames = 0;
+    let last = -1;
+    for (;;) {
+      const { count, data, times } = reader.read();
+      expect(count).to.be.at.least(0);
+      if (count === 0) break;
+      expect(data.length).to.equal(count * reader.frameSize);
+      expect(times[0]).to.be.above(last);
+      last = times[count - 1];
+      frames += count;
+    }
+    expect(frames).to.be.above(0);
+    reader.close();
+  });
+
+  it("should seek", () => {
+    const reader = core.openFrames("video.mp4", { pixelFormat: "gray" });
+    expect(reader.seek(0.5)).to.equal(0);
+    const { count, times } = reader.read();
+    expect(count).to.equal(1);
+    expect(times[0]).to.be.at.least(0.5);
+    reader.close();
+  });
+
+  it("should fail with an invalid pixel format", () => {
+    expect(core.openFrames("video.mp4", { pixelFormat: "invalid" })).to.be.null;
+  });
+});
+
+describe(genName("openFrameWriter()"), () => {
+  beforeEach(reset);
+
+  it("should exist", () => {
+    expect("openFrameWriter" in core).to.be.true;
+  });
+
+  it("should encode rgba frames", () => {
+    const writer = core.openFrameWriter("frames.mp4", {
+      width: 64,
+      height: 48,
+      frameRate: 25,
+      args: ["-c:v", "libx264", "-pix_fmt", "yuv420p"],
+    });
+    expect(writer.frameSize).to.equal(64 * 48 * 4);
+    const frame = new Uint8Array(writer.frameSize);
+    for (let i = 0; i < 25; i++) {
+      frame.fill(i * 10);
+      expect(writer.write(frame)).to.equal(0);
+    }
+    expect(writer.close()).to.equal(0);
+
+    const reader = core.openFrames("frames.mp4", { batch: 32 });
+    expect(reader.width).to.equal(64);
+    expect(reader.read().count).to.equal(25);
+    reader.close();
+  });
+
+  it("should fail with an unknown encoder", () => {
+    expect(
+      core.openFrameWriter("frames.mp4", {
+        width: 64,
+        height: 48,
+        args: ["-c:v", "invalid"],
+      })
+    ).to.be.null;
+  });
+});
+
+describe(genName("openSamples()"), () => {
+  before(() => {
+    core.FS.writeFile("audio.wav", createSineWav());
+  });
+  beforeEach(reset);
+
+  it("should exist", () => {
+    expect("openSamples" in core).to.be.true;
+  });
+
+  it("should resample and mix down to mono", () => {
+    const reader = core.openSamples("audio.wav", {
+      sampleRate: 16000,
+      channels: 1,
+      chunk: 4096,
+    });
+    expect(reader.sampleRate).to.equal(16000);
+    expect(reader.channels).to.equal(1);
+    let samples = 0;
+    for (;;) {
+      const { count, time, data } = reader.read();
+      expect(count).to.be.at.least(0);
+      if (count === 0) break;
+      expect(data.length).to.equal(count);
+      expect(time).to.be.closeTo(samples / 16000, 1e-9);
+      expect(Math.max(...data)).to.be.below(1);
+      samples += count;
+    }
+    expect(samples).to.be.closeTo(16000, 64);
+    reader.close();
+  });
+
+  it("should read planar chunks", () => {
+    const reader = core.openSamples("audio.wav", { planar: true, chunk: 1024 });
+    expect(reader.sampleRate).to.equal(44100);
+    expect(reader.channels).to.equal(2);
+    const { count, data } = reader.read();
+    expect(count).to.equal(1024);
+    expect(data.length).to.equal(2 * 1024);
+    expect(data[100]).to.equal(data[1024 + 100]);
+    reader.close();
+  });
+
+  it("should fail without audio", () => {
+    expect(core.openSamples("video.mp4")).to.be.null;
+  });
+});
+
+describe(genName("openSession()"), () => {
+  before(() => {
+    core.FS.writeFile("audio.wav", createSineWav());
+  });
+  beforeEach(reset);
+
+  it("should exist", () => {
+    expect("openSession" in core).to.be.true;
+  });
+
+  it("should return the frame shown at a time", () => {
+    const session = core.openSession("video.mp4", { width: 64 });
+    expect(session.width).to.equal(64);
+    expect(session.channels).to.equal(0);
+    expect(session.duration).to.be.closeTo(1, 0.1);
+
+    const { ret, time, data } = session.frame(0.5);
+    expect(ret).to.equal(session.frameSize);
+    expect(data.length).to.equal(session.frameSize);
+    expect(time).to.be.at.most(0.5);
+    expect(time).to.be.above(0.4);
+    // the same frame again, then backwards
+    expect(session.frame(0.5).time).to.equal(time);
+    expect(session.frame(0.1).time).to.be.at.most(0.1);
+    // the last frame after the end
+    expect(session.frame(10).time).to.be.above(0.9);
+    session.close();
+  });
+
+  it("should return audio ranges", () => {
+    const session = core.openSession("audio.wav");
+    expect(session.sampleRate).to.equal(44100);
+    expect(session.channels).to.equal(2);
+    expect(session.frame(0).ret).to.be.below(0);
+
+    let { count, time, data } = session.audio(0.25, 0.5);
+    expect(count).to.equal(22050);
+    expect(data.length).to.equal(2 * 22050);
+    expect(time).to.be.closeTo(0.25, 1e-4);
+    // goes on from the previous range up to the end of the input
+    ({ count, time } = session.audio(0.75, 0.5));
+    expect(count).to.be.closeTo(11025, 64);
+    expect(time).to.be.closeTo(0.75, 1e-4);
+    expect(session.audio(0, 0.1).count).to.equal(4410);
+    session.close();
+  });
+
+  it("should fail without input", () => {
+    expect(core.openSession("missing.mp4")).to.be.null;
+  });
+});
+
+describe(genName("index()"), () => {
+  before(() => {
+    core.exec("-i", "video.mp4", "-c", "copy", "video.ts");
+    core.reset();
+  });
+  beforeEach(reset);
+
+  it("should exist", () => {
+    expect("index" in core).to.be.true;
+  });
+
+  it("should write a keyframe index", () => {
+    expect(core.index("-i", "video.ts")).to.equal(0);
+    const lines = core.FS.readFile("video.ts.ffindex", { encoding: "utf8" })
+      .trim()
+      .split("\n");
+    const size = core.FS.stat("video.ts").size;
+    expect(lines[0]).to.equal(`ffindex 1 ${size} 1`);
+    expect(lines[1]).to.match(/^stream 0 v 1 90000$/);
+    const keys = lines.filter((line) => line.startsWith("key 0 "));
+    expect(keys.length).to.be.above(0);
+    // every packet of the 1s video belongs to a GOP
+    const packets = keys.reduce((n, key) => n + Number(key.split(" ")[5]), 0);
+    expect(packets).to.equal(35);
+  });
+
+  const probe = (entries, path) => {
+    core.ffprobe(
+      "-v", "error", "-of", "json", "-select_streams", "v",
+      "-read_intervals", "%+#1", "-show_entries", entries, path
+    );
+    core.reset();
+    return JSON.parse(core.probeOutput);
+  };
+
+  // keyframes every 5 frames, so that seeks land on different ones
+  const gop = (path, ...args) => {
+    core.exec("-i", "video.mp4", "-c:v", "libx264", "-g", "5", ...args, path);
+    core.reset();
+  };
+
+  const seek = (index, path, output) => {
+    const logs = [];
+    core.setLogger(({ message }) => logs.push(message));
+    expect(
+      core.exec(
+        "-v", "verbose",
+        "-seek_index", index,
+        "-ss", "0.5",
+        "-i", path,
+        "-copyts",
+        "-c", "copy",
+        output
+      )
+    ).to.equal(0);
+    core.reset();
+    const loaded = logs.join("").match(/Loaded (\d+) keyframes/);
+    const { packets } = probe("packet=pts_time", output);
+    core.FS.unlink(output);
+    return {
+      keys: loaded ? Number(loaded[1]) : -1,
+      pts: Number(packets[0].pts_time),
+    };
+  };
+
+  const keyLines = (path) =>
+    core.FS.readFile(path, { encoding: "utf8" })
+      .trim()
+      .split("\n")
+      .filter((line) => line.startsWith("key "));
+
+  it("should seek with the index", () => {
+    gop("gop.ts");
+    core.index("-i", "gop.ts");
+    core.reset();
+    const start = Number(probe("format=start_time", "gop.ts").format.start_time);
+    const keys = keyLines("gop.ts.ffindex");
+    expect(keys.length).to.be.above(1);
+
+    // the copy starts at the indexed keyframe before the target
+    const indexed = seek("gop.ts.ffindex", "gop.ts", "seek.ts");
+    expect(indexed.keys).to.equal(keys.length);
+    expect(indexed.pts).to.be.above(start + 0.1);
+    expect(indexed.pts).to.be.at.most(start + 0.5);
+
+    // a sidecar with the first keyframe only sends the seek back to it
+    const lines = core.FS.readFile("gop.ts.ffindex", { encoding: "utf8" }).split("\n");
+    const skewed = lines.filter((line) => !line.startsWith("key ")).concat(keys[0]);
+    core.FS.writeFile("skewed.ffindex", skewed.join("\n"));
+    const first = seek("skewed.ffindex", "gop.ts", "seek.ts");
+    expect(first.keys).to.equal(1);
+    expect(first.pts).to.be.closeTo(start, 0.01);
+
+    ["gop.ts", "gop.ts.ffindex", "skewed.ffindex"].forEach((f) => core.FS.unlink(f));
+  });
+
+  it("should seek Matroska without cues with the index", () => {
+    // a live stream has no cues, keyframes are indexed by pts and cluster
+    gop("nocues.mkv", "-live", "1");
+    expect(core.index("-i", "nocues.mkv")).to.equal(0);
+    core.reset();
+    const keys = keyLines("nocues.mkv.ffindex");
+    expect(keys.length).to.be.above(1);
+    keys.forEach((key) => expect(Number(key.split(" ")[4])).to.be.at.least(0));
+    const packets = keys.reduce((n, key) => n + Number(key.split(" ")[5]), 0);
+    expect(packets).to.equal(35);
+
+    const { keys: loaded, pts } = seek("nocues.mkv.ffindex", "nocues.mkv", "seek.mkv");
+    expect(loaded).to.equal(keys.length);
+    expect(pts).to.be.above(0.1);
+    expect(pts).to.be.at.most(0.5);
+
+    ["nocues.mkv", "nocues.mkv.ffindex"].forEach((f) => core.FS.unlink(f));
+  });
+
+  it("should keep the own index of mp4", () => {
+    const seek = (...args) => {
+      core.exec(...args, "-ss", "0.5", "-i", "video.mp4", "-c", "copy", "seek.mp4");
+      core.reset();
+      const data = core.FS.readFile("seek.mp4");
+      core.FS.unlink("seek.mp4");
+      return data;
+    };
+    core.index("-i", "video.mp4");
+    core.reset();
+    expect(seek("-seek_index", "video.mp4.ffindex")).to.deep.equal(seek());
+  });
+
+  it("should fail without input", () => {
+    expect(core.index("-i", "missing.ts")).to.equal(1);
+  });
+});
+
+describe(genName("peaks()"), () => {
+  before(() => {
+    core.FS.writeFile("audio.wav", createSineWav({ duration: 2 }));
+  });
+  beforeEach(reset);
+
+  it("should exist", () => {
+    expect("peaks" in core).to.be.true;
+  });
+
+  it("should build a pyramid", () => {
+    expect(core.peaks("-i", "audio.wav", "-spp", "441", "-levels", "4")).to.equal(0);
+    const data = core.peaksOutput;
+    const view = new DataView(data.buffer, data.byteOffset, data.byteLength);
+    expect(String.fromCharCode(...data.subarray(0, 4))).to.equal("FFPK");
+    expect(view.getUint32(8, true)).to.equal(44100);
+    expect(view.getUint32(12, true)).to.equal(2);
+    expect(view.getUint32(24, true)).to.equal(4);
+    expect(view.getUint32(28, true)).to.equal(200);
+    expect(view.getUint32(32, true)).to.equal(100);
+    // a full period of the sine is in the first peak of level 0
+    expect(view.getInt16(44, true)).to.be.closeTo(-16384, 2);
+    expect(view.getInt16(46, true)).to.be.closeTo(16384, 2);
+  });
+
+  it("should write a sidecar", () => {
+    expect(core.peaks("-i", "audio.wav", "-ac", "1", "audio.peaks")).to.equal(0);
+    expect(core.peaksOutput).to.be.null;
+    const data = core.FS.readFile("audio.peaks");
+    expect(new DataView(data.buffer).getUint32(12, true)).to.equal(1);
+    core.FS.unlink("audio.peaks");
+  });
+
+  it("should fail without audio", () => {
+    expect(core.peaks("-i", "video.mp4")).to.equal(1);
+  });
+});
+
+describe(genName("cut()"), () => {
+  beforeEach(reset);
+
+  it("should exist", () => {
+    expect("cut" in core).to.be.true;
+  });
+
+  it("should cut a video", () => {
+    expect(core.cut("-ss", "0.2", "-to", "0.7", "-i", "video.mp4", "cut.mp4")).to.equal(0);
+    reset();
+    expect(core.exec("-i", "cut.mp4", "-f", "null", "-")).to.equal(0);
+    core.FS.unlink("cut.mp4");
+  });
+
+  it("should join copied and encoded GOPs", () => {
+    // 4 GOPs of 1s, the first and last ones are encoded again
+    expect(
+      core.exec(
+        "-f", "lavfi", "-i", "testsrc2=size=320x240:rate=25", "-t", "4",
+        "-c:v", "libx264", "-preset", "ultrafast", "-g", "25",
+        "gops.mp4"
+      )
+    ).to.equal(0);
+    reset();
+    expect(core.cut("-ss", "0.5", "-to", "3.5", "-i", "gops.mp4", "cut.mp4")).to.equal(0);
+    reset();
+    core.ffprobe(
+      "-v", "error", "-of", "json", "-count_frames",
+      "-show_entries", "stream=codec_tag_string,nb_read_frames,duration",
+      "cut.mp4"
+    );
+    const stream = JSON.parse(core.probeOutput).streams[0];
+    expect(stream.codec_tag_string).to.equal("avc3");
+    expect(Number(stream.nb_read_frames)).to.equal(75);
+    expect(Number(stream.duration)).to.be.closeTo(3, 0.05);
+    reset();
+    // every frame decodes with the parameter sets it was encoded with
+    expect(core.exec("-xerror", "-i", "cut.mp4", "-f", "null", "-")).to.equal(0);
+    core.FS.unlink("gops.mp4");
+    core.FS.unlink("cut.mp4");
+  });
+
+  it("should fail if the end is before the start", () => {
+    expect(core.cut("-ss", "0.7", "-to", "0.2", "-i", "video.mp4", "cut.mp4")).to.equal(1);
+  });
+});
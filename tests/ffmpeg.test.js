@@ -131,6 +131,138 @@ describe(genName("FFmpeg.exec()"), function () {
     ffmpeg.off("progress", listener);
   });
 
+  it("should package an hls ladder", async () => {
+    const segments = [];
+    const listener = (segment) => segments.push(segment);
+    ffmpeg.on("segment", listener);
+    const ret = await ffmpeg.ladder({
+      input: "video.mp4",
+      outputDir: "hls",
+      audio: false,
+      segmentDuration: 0.5,
+      rungs: [
+        { name: "360p", height: 360, videoBitrate: "800k" },
+        { name: "240p", height: 240, videoBitrate: "400k" },
+      ],
+    });
+    expect(ret).to.equal(0);
+    const master = await ffmpeg.readFile("hls/master.m3u8", "utf8");
+    expect(master).to.include("360p/index.m3u8");
+    expect(master).to.include("240p/index.m3u8");
+    expect(segments.map(({ rung }) => rung)).to.include.members(["360p", "240p"]);
+    ffmpeg.off("segment", listener);
+  });
+
+  it("should extract a sprite sheet", async () => {
+    const ret = await ffmpeg.thumbnails({
+      input: "video.mp4",
+      times: [0, 0.5],
+      output: "sprite.jpg",
+      sprite: { columns: 2, vtt: "sprite.vtt" },
+    });
+    expect(ret).to.equal(0);
+    const vtt = await ffmpeg.readFile("sprite.vtt", "utf8");
+    expect(vtt).to.include("sprite.jpg#xywh=");
+  });
+
+  it("should probe a video", async () => {
+    const { format, streams } = await ffmpeg.probe({ input: "video.mp4" });
+    expect(format.nb_streams).to.equal(streams.length);
+    expect(streams[0].codec_type).to.equal("video");
+  });
+
+  it("should read frames", async () => {
+    let count = 0;
+    for await (const { data, width, height } of ffmpeg.frames({
+      input: "video.mp4",
+      width: 64,
+    })) {
+      expect(data.length).to.equal(width * height * 4);
+      count++;
+    }
+    expect(count).to.be.above(0);
+  });
+
+  it("should encode frames", async () => {
+    const writer = await ffmpeg.frameWriter({
+      output: "frames.mp4",
+      width: 64,
+      height: 48,
+      args: ["-c:v", "libx264", "-pix_fmt", "yuv420p"],
+    });
+    for (let i = 0; i < 10; i++) {
+      expect(await writer.write(new Uint8Array(writer.frameSize))).to.be.true;
+    }
+    expect(await writer.close()).to.be.true;
+    const data = await ffmpeg.readFile("frames.mp4");
+    expect(data.length).to.be.above(0);
+  });
+
+  it("should read audio samples", async () => {
+    await ffmpeg.writeFile("audio.wav", createSineWav());
+    let samples = 0;
+    for await (const { data, count, channels } of ffmpeg.samples({
+      input: "audio.wav",
+      sampleRate: 16000,
+      channels: 1,
+    })) {
+      expect(channels).to.equal(1);
+      expect(data.length).to.equal(count);
+      samples += count;
+    }
+    expect(samples).to.be.closeTo(16000, 64);
+  });
+
+  it("should serve requests from a session", async () => {
+    const session = await ffmpeg.session({ input: "video.mp4", width: 64 });
+    const frame = await session.frame(0.5);
+    expect(frame.width).to.equal(64);
+    expect(frame.time).to.be.at.most(0.5);
+    expect(frame.data.length).to.equal(64 * frame.height * 4);
+    expect((await session.frame(0)).time).to.equal(0);
+    expect(await session.close()).to.be.true;
+  });
+
+  it("should index keyframes", async () => {
+    const { streams } = await ffmpeg.index({ input: "video.mp4" });
+    expect(streams[0].type).to.equal("video");
+    expect(streams[0].keyframes[0].time).to.equal(0);
+    const data = await ffmpeg.readFile("video.mp4.ffindex");
+    expect(data.length).to.be.above(0);
+  });
+
+  it("should build waveform peaks", async () => {
+    await ffmpeg.writeFile("audio.wav", createSineWav());
+    const { channels, levels, factor } = await ffmpeg.peaks({
+      input: "audio.wav",
+      channels: 1,
+      levels: 3,
+    });
+    expect(channels).to.equal(1);
+    expect(factor).to.equal(2);
+    expect(levels.length).to.equal(3);
+    expect(levels[1].length).to.equal(Math.ceil(levels[0].length / 4) * 2);
+  });
+
+  it("should reuse probed stream info", async () => {
+    const args = ["-probe_cache", "-i", "video.mp4", "-f", "null", "-"];
+    expect(await ffmpeg.exec(args)).to.equal(0);
+    expect(await ffmpeg.exec(args)).to.equal(0);
+    expect(await ffmpeg.clearProbeCache()).to.be.true;
+  });
+
+  it("should cut a video", async () => {
+    const ret = await ffmpeg.cut({
+      input: "video.mp4",
+      output: "cut.mp4",
+      start: 0.2,
+      end: 0.7,
+    });
+    expect(ret).to.equal(0);
+    const data = await ffmpeg.readFile("cut.mp4");
+    expect(data.length).to.be.above(0);
+  });
+
   it("should stop if timeout", async () => {
     const ret = await ffmpeg.exec(["-i", "video.mp4", "video.avi"], 1);
     expect(ret).to.equal(1);
@@ -11,9 +11,45 @@ const b64ToUint8Array = (b64) => {
   return bytes;
 };
 
+/**
+ * A 16-bit PCM wav of a sine at frequency Hz, as no fixture has audio.
+ */
+const createSineWav = ({
+  sampleRate = 44100,
+  channels = 2,
+  duration = 1,
+  frequency = 440,
+} = {}) => {
+  const samples = Math.round(sampleRate * duration);
+  const size = samples * channels * 2;
+  const view = new DataView(new ArrayBuffer(44 + size));
+  const str = (offset, s) =>
+    [...s].forEach((c, i) => view.setUint8(offset + i, c.charCodeAt(0)));
+  str(0, "RIFF");
+  view.setUint32(4, 36 + size, true);
+  str(8, "WAVEfmt ");
+  view.setUint32(16, 16, true);
+  view.setUint16(20, 1, true);
+  view.setUint16(22, channels, true);
+  view.setUint32(24, sampleRate, true);
+  view.setUint32(28, sampleRate * channels * 2, true);
+  view.setUint16(32, channels * 2, true);
+  view.setUint16(34, 16, true);
+  str(36, "data");
+  view.setUint32(40, size, true);
+  for (let i = 0; i < samples; i++) {
+    const v = Math.sin((2 * Math.PI * frequency * i) / sampleRate) * 16384;
+    for (let c = 0; c < channels; c++) {
+      view.setInt16(44 + (i * channels + c) * 2, v, true);
+    }
+  }
+  return new Uint8Array(view.buffer);
+};
+
 if (typeof module !== "undefined") {
   module.exports = {
     VIDEO_1S_MP4,
     b64ToUint8Array,
+    createSineWav,
   };
 }
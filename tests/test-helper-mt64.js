@@ -0,0 +1,11 @@
+const chai = require("chai");
+const browser = require("./test-helper-browser");
+
+global.expect = chai.expect;
+global.createFFmpegCore = require("../packages/core-mt64");
+global.atob = require("./util").atob;
+global.FFMPEG_TYPE = "mt64";
+
+Object.keys(browser).forEach((key) => {
+  global[key] = browser[key];
+});